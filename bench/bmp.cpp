@@ -0,0 +1,541 @@
+/* bmp.cpp
+ * BMP decode benchmark.
+ *
+ * Writes 4096x4096 24-bit, 32-bit BGRA and BGRX and 32-bit 10-10-10-2
+ * bitmaps, plus a 24-bit one 4093 pixels wide with padded lines, and loads
+ * each with bmpread() as RGB and as RGBA, with and without BMPREAD_NO_SIMD.
+ * Reports the fastest decode of each in GB/s of output.  Then loads the
+ * 24- and 32-bit ones reading a line at a time, with one read and the
+ * default way (mapped where the file can be), and reports the time, read()
+ * calls and page faults of each.  Last, loads a side x side 24-bit bitmap
+ * (8192 by default) with bmpread_parallel() on 1, 2, 4, 8 and one per
+ * processor threads, and reports the speedup, and compares copying a
+ * bmpread() into a buffer that's kept around against bmpread_into() it.
+ *
+ * Before that, checks that the SIMD and plain decoders give the same bytes
+ * for every width from 1 to 67 with every combination of flags, that every
+ * way of reading gives the same bytes too, and that each fails on a file cut
+ * short.  Also that bmpread_parallel() gives what bmpread() does for every
+ * bit depth and flag, and bmpread_into() too, with and without a stride of
+ * its own, never writing between lines or past the end.  Exits with 1 if
+ * not.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude bench/bmp.cpp src/bmpread.c -o bmp
+ *   ./bmp [side]
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "bmpread.h"
+
+
+static const int REPEATS = 5; // loads per format, the fastest counts
+static const int SIZE = 4096;
+static const unsigned THREAD_COUNTS[] = { 1, 2, 4, 8, 0 };
+
+typedef std::chrono::steady_clock Clock;
+
+struct Format
+{
+    const char *name;
+    int bits;
+    uint32_t masks[4]; // red, green, blue, alpha; all zero without bitfields
+};
+
+// the 24- and 32-bit ones first, for the SIMD decoders
+
+static const Format FORMATS[] = {
+    { "24-bit", 24, { 0, 0, 0, 0 } },
+    { "32-bit BGRA", 32, { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 } },
+    { "32-bit BGRX", 32, { 0x00ff0000, 0x0000ff00, 0x000000ff, 0 } },
+    { "32-bit ABGR", 32, { 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 } },
+    { "32-bit 10-10-10-2", 32, { 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000 } },
+    { "16-bit 5-6-5", 16, { 0xf800, 0x07e0, 0x001f, 0 } },
+    { "16-bit 1-5-5-5", 16, { 0x7c00, 0x03e0, 0x001f, 0x8000 } },
+    { "8-bit", 8, { 0, 0, 0, 0 } },
+    { "4-bit", 4, { 0, 0, 0, 0 } },
+    { "1-bit", 1, { 0, 0, 0, 0 } },
+};
+static const size_t FORMAT_COUNT = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+static void put16(std::vector<uint8_t> *out, uint32_t x)
+{
+    out->push_back(x & 0xff);
+    out->push_back(x >> 8 & 0xff);
+}
+
+static void put32(std::vector<uint8_t> *out, uint32_t x)
+{
+    put16(out, x & 0xffff);
+    put16(out, x >> 16);
+}
+
+// a bitmap of noise, with a version 4 header for bitfields and a palette of
+// noise below 16 bits
+static bool writeBmp(const char *path, const Format &format, int width, int height, uint32_t seed)
+{
+    const bool bitfields = format.masks[0] != 0;
+    const uint32_t infoSize = bitfields ? 108 : 40;
+    const uint32_t paletteSize = format.bits <= 8 ? 4u << format.bits : 0;
+    const size_t lineLength = ((size_t)width * format.bits + 31) / 32 * 4;
+    const size_t lines = height < 0 ? -height : height;
+
+    std::vector<uint8_t> data;
+    data.push_back('B');
+    data.push_back('M');
+    put32(&data, (uint32_t)(14 + infoSize + paletteSize + lineLength * lines));
+    put32(&data, 0);
+    put32(&data, 14 + infoSize + paletteSize);
+
+    put32(&data, infoSize);
+    put32(&data, (uint32_t)width);
+    put32(&data, (uint32_t)height);
+    put16(&data, 1);
+    put16(&data, format.bits);
+    put32(&data, bitfields ? 3 : 0);
+    for(int i = 0; i < 5; i++) put32(&data, 0);
+    if(bitfields) {
+        for(int i = 0; i < 4; i++) put32(&data, format.masks[i]);
+        data.resize(14 + infoSize, 0);
+    }
+
+    // xorshift, so the lines' padding is noise too
+    uint32_t x = seed | 1;
+    for(size_t i = 0; i < paletteSize + lineLength * lines; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        data.push_back(x >> 24);
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if(!fp) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    return fclose(fp) == 0 && ok;
+}
+
+static size_t outputSize(const bmpread_t &bmp)
+{
+    size_t span = (bmp.flags & BMPREAD_ALPHA) ? 4 : 3;
+    size_t line = (size_t)bmp.width * span;
+    if(!(bmp.flags & BMPREAD_BYTE_ALIGN)) line = (line + 3) & ~(size_t)3;
+    return line * bmp.height;
+}
+
+// loads path with and without BMPREAD_NO_SIMD and compares the output
+static bool sameOutput(const char *path, unsigned flags)
+{
+    bmpread_t simd, plain;
+    bool loaded = bmpread(path, flags, &simd) != 0;
+    if(loaded != (bmpread(path, flags | BMPREAD_NO_SIMD, &plain) != 0)) return false;
+    if(!loaded) return true;
+
+    bool same = simd.width == plain.width && simd.height == plain.height &&
+                memcmp(simd.data, plain.data, outputSize(simd)) == 0;
+    bmpread_free(&simd);
+    bmpread_free(&plain);
+    return same;
+}
+
+static bool checkDecoders(const std::string &dir)
+{
+    std::string path = dir + "/small.bmp";
+    int failures = 0;
+
+    for(size_t f = 0; f < FORMAT_COUNT; f++) {
+        for(int width = 1; width <= 67; width++) {
+            for(int height = -3; height <= 3; height += 6) {
+                if(!writeBmp(path.c_str(), FORMATS[f], width, height, width * 7919 + f)) return false;
+
+                for(unsigned flags = 0; flags < 8; flags++) {
+                    unsigned all = BMPREAD_ANY_SIZE | (flags & 1 ? BMPREAD_TOP_DOWN : 0) |
+                                   (flags & 2 ? BMPREAD_BYTE_ALIGN : 0) | (flags & 4 ? BMPREAD_ALPHA : 0);
+                    if(!sameOutput(path.c_str(), all)) {
+                        printf("%s, %d x %d, flags %u: SIMD and plain decoders differ\n", FORMATS[f].name, width,
+                               height, all);
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+
+    remove(path.c_str());
+    printf("decoders agree on 67 widths x 2 orders x 8 flag sets x %zu formats: %s\n", FORMAT_COUNT,
+           failures ? "NO" : "yes");
+    return failures == 0;
+}
+
+struct ReadMode
+{
+    const char *name;
+    unsigned flags;
+};
+
+static const ReadMode READ_MODES[] = {
+    { "fread per line", BMPREAD_READ_LINES },
+    { "one fread", BMPREAD_READ_WHOLE },
+    { "default", 0 }, // mapped, or a line at a time where it can't be
+};
+
+// every way of reading gives what reading a line at a time does, and none
+// loads a file a byte short
+static bool checkReadModes(const std::string &dir)
+{
+    std::string path = dir + "/small.bmp";
+    int failures = 0;
+
+    for(size_t f = 0; f < FORMAT_COUNT; f++) {
+        for(int width = 1; width <= 9; width++) {
+            if(!writeBmp(path.c_str(), FORMATS[f], width, 5, width + f)) return false;
+
+            bmpread_t lines;
+            unsigned flags = BMPREAD_ANY_SIZE | BMPREAD_ALPHA;
+            if(!bmpread(path.c_str(), flags | BMPREAD_READ_LINES, &lines)) return false;
+            for(size_t m = 1; m < sizeof(READ_MODES) / sizeof(READ_MODES[0]); m++) {
+                bmpread_t bmp;
+                if(!bmpread(path.c_str(), flags | READ_MODES[m].flags, &bmp) ||
+                   memcmp(bmp.data, lines.data, outputSize(lines)) != 0) {
+                    printf("%s, %d wide, %s: differs from fread per line\n", FORMATS[f].name, width,
+                           READ_MODES[m].name);
+                    failures++;
+                }
+                bmpread_free(&bmp);
+            }
+            bmpread_free(&lines);
+
+            long size = 0;
+            FILE *fp = fopen(path.c_str(), "rb");
+            if(fp && fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+            if(fp) fclose(fp);
+            if(size <= 0 || truncate(path.c_str(), size - 1) != 0) return false;
+
+            for(size_t m = 0; m < sizeof(READ_MODES) / sizeof(READ_MODES[0]); m++) {
+                bmpread_t bmp;
+                if(bmpread(path.c_str(), flags | READ_MODES[m].flags, &bmp)) {
+                    printf("%s, %d wide, %s: loaded a truncated file\n", FORMATS[f].name, width, READ_MODES[m].name);
+                    bmpread_free(&bmp);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    remove(path.c_str());
+    printf("every way of reading agrees and rejects truncated files: %s\n", failures ? "NO" : "yes");
+    return failures == 0;
+}
+
+// bmpread_parallel() gives what bmpread() does, with images big enough to be
+// split into a few bands of uneven length
+static bool checkParallel(const std::string &dir)
+{
+    std::string path = dir + "/medium.bmp";
+    int failures = 0;
+
+    for(size_t f = 0; f < FORMAT_COUNT; f++) {
+        for(int height = -1037; height <= 1037; height += 2 * 1037) {
+            if(!writeBmp(path.c_str(), FORMATS[f], 1021, height, f + 1)) return false;
+
+            for(unsigned flags = 0; flags < 8; flags++) {
+                unsigned all = BMPREAD_ANY_SIZE | (flags & 1 ? BMPREAD_TOP_DOWN : 0) |
+                               (flags & 2 ? BMPREAD_BYTE_ALIGN : 0) | (flags & 4 ? BMPREAD_ALPHA : 0);
+                bmpread_t serial;
+                if(!bmpread(path.c_str(), all, &serial)) return false;
+
+                for(size_t t = 1; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+                    bmpread_t parallel;
+                    if(!bmpread_parallel(path.c_str(), all, THREAD_COUNTS[t], &parallel) ||
+                       memcmp(parallel.data, serial.data, outputSize(serial)) != 0) {
+                        printf("%s, height %d, flags %u, %u threads: differs from bmpread()\n", FORMATS[f].name,
+                               height, all, THREAD_COUNTS[t]);
+                        failures++;
+                    }
+                    bmpread_free(&parallel);
+                }
+                bmpread_free(&serial);
+            }
+        }
+    }
+
+    remove(path.c_str());
+    printf("bmpread_parallel() agrees with bmpread() on every bit depth and flag set: %s\n",
+           failures ? "NO" : "yes");
+    return failures == 0;
+}
+
+// bmpread_info() describes what bmpread() gives, bmpread_into() with no
+// stride gives the same bytes, and with a stride gives the same pixels
+// without touching the bytes between lines or after the last
+static bool checkInto(const std::string &dir)
+{
+    std::string path = dir + "/small.bmp";
+    int failures = 0;
+
+    for(size_t f = 0; f < FORMAT_COUNT; f++) {
+        for(int width = 1; width <= 9; width++) {
+            if(!writeBmp(path.c_str(), FORMATS[f], width, -7, width + f)) return false;
+
+            for(unsigned flags = 0; flags < 8; flags++) {
+                unsigned all = BMPREAD_ANY_SIZE | (flags & 1 ? BMPREAD_TOP_DOWN : 0) |
+                               (flags & 2 ? BMPREAD_BYTE_ALIGN : 0) | (flags & 4 ? BMPREAD_ALPHA : 0);
+                bmpread_t bmp;
+                bmpread_info_t info;
+                if(!bmpread(path.c_str(), all, &bmp) || !bmpread_info(path.c_str(), all, &info)) return false;
+
+                const size_t pixelBytes = (size_t)width * (all & BMPREAD_ALPHA ? 4 : 3);
+                bool ok = info.width == bmp.width && info.height == bmp.height && info.flags == all &&
+                          info.data_len == outputSize(bmp) && info.line_len * info.height == info.data_len;
+
+                std::vector<uint8_t> data(info.data_len + 16, 0xaa);
+                ok = ok && !bmpread_into(path.c_str(), all, 1, data.data(), 0, info.data_len - 1);
+                ok = ok && bmpread_into(path.c_str(), all, 1, data.data(), 0, info.data_len);
+                ok = ok && memcmp(data.data(), bmp.data, info.data_len) == 0 && data[info.data_len] == 0xaa;
+
+                const size_t stride = pixelBytes + 5;
+                const size_t needed = stride * (info.height - 1) + pixelBytes;
+                data.assign(needed + 16, 0xaa);
+                ok = ok && !bmpread_into(path.c_str(), all, 1, data.data(), pixelBytes - 1, data.size());
+                ok = ok && !bmpread_into(path.c_str(), all, 1, data.data(), stride, needed - 1);
+                ok = ok && bmpread_into(path.c_str(), all, 1, data.data(), stride, needed);
+                for(int y = 0; ok && y < info.height; y++) {
+                    const uint8_t *line = data.data() + y * stride;
+                    ok = memcmp(line, bmp.data + y * info.line_len, pixelBytes) == 0;
+                    for(size_t i = pixelBytes; ok && i < stride && line + i < data.data() + data.size(); i++) {
+                        ok = line[i] == 0xaa;
+                    }
+                }
+
+                if(!ok) {
+                    printf("%s, %d wide, flags %u: bmpread_info() or bmpread_into() is wrong\n", FORMATS[f].name,
+                           width, all);
+                    failures++;
+                }
+                bmpread_free(&bmp);
+            }
+        }
+    }
+
+    remove(path.c_str());
+    printf("bmpread_info() and bmpread_into() agree with bmpread(): %s\n", failures ? "NO" : "yes");
+    return failures == 0;
+}
+
+// read() calls this process has made, from /proc/self/io, or -1
+static long readCalls()
+{
+    FILE *fp = fopen("/proc/self/io", "r");
+    if(!fp) return -1;
+    char line[128];
+    long calls = -1;
+    while(fgets(line, sizeof(line), fp)) {
+        if(sscanf(line, "syscr: %ld", &calls) == 1) break;
+    }
+    fclose(fp);
+    return calls;
+}
+
+static long pageFaults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+static void benchmarkReads(const std::string &dir, const Format &format, unsigned flags)
+{
+    std::string path = dir + "/large.bmp";
+    if(!writeBmp(path.c_str(), format, SIZE, SIZE, 1)) {
+        printf("failed to write %s\n", path.c_str());
+        return;
+    }
+
+    // reading /proc/self/io counts too
+    long before = readCalls();
+    long overhead = readCalls() - before;
+
+    double lineMs = 0;
+    for(size_t m = 0; m < sizeof(READ_MODES) / sizeof(READ_MODES[0]); m++) {
+        double best = 1e30;
+        long calls = 0, faults = 0;
+        for(int i = 0; i < REPEATS; i++) {
+            bmpread_t bmp;
+            long calls0 = readCalls(), faults0 = pageFaults();
+            Clock::time_point start = Clock::now();
+            bool loaded = bmpread(path.c_str(), flags | READ_MODES[m].flags, &bmp) != 0;
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            faults = pageFaults() - faults0;
+            calls = readCalls() - calls0 - overhead;
+            if(!loaded) {
+                printf("  %-14s failed to load\n", READ_MODES[m].name);
+                break;
+            }
+            bmpread_free(&bmp);
+            if(ms < best) best = ms;
+        }
+        if(m == 0) lineMs = best;
+        printf("  %-12s %-14s %8.1f ms %8ld reads %8ld faults %8.1f ms saved\n", format.name, READ_MODES[m].name, best,
+               calls, faults, lineMs - best);
+    }
+    remove(path.c_str());
+}
+
+// fastest of REPEATS loads in GB/s of output, or -1 if it didn't load
+static double decodeRate(const char *path, unsigned flags)
+{
+    double best = 1e30;
+    size_t bytes = 0;
+    for(int i = 0; i < REPEATS; i++) {
+        bmpread_t bmp;
+        Clock::time_point start = Clock::now();
+        if(!bmpread(path, flags, &bmp)) return -1;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        bytes = outputSize(bmp);
+        bmpread_free(&bmp);
+        if(seconds < best) best = seconds;
+    }
+    return bytes / best / 1e9;
+}
+
+static void benchmark(const std::string &dir, const char *name, const Format &format, int width)
+{
+    std::string path = dir + "/large.bmp";
+    if(!writeBmp(path.c_str(), format, width, SIZE, 1)) {
+        printf("failed to write %s\n", path.c_str());
+        return;
+    }
+
+    for(int alpha = 0; alpha < 2; alpha++) {
+        unsigned flags = BMPREAD_ANY_SIZE | (alpha ? BMPREAD_ALPHA : 0);
+        double plain = decodeRate(path.c_str(), flags | BMPREAD_NO_SIMD);
+        double simd = decodeRate(path.c_str(), flags);
+        printf("  %-24s %-5s %6.2f GB/s %6.2f GB/s  %5.2fx\n", name, alpha ? "RGBA" : "RGB", plain, simd,
+               simd / plain);
+    }
+    remove(path.c_str());
+}
+
+static void benchmarkParallel(const std::string &dir, int side)
+{
+    std::string path = dir + "/large.bmp";
+    if(!writeBmp(path.c_str(), FORMATS[0], side, side, 1)) {
+        printf("failed to write %s\n", path.c_str());
+        return;
+    }
+
+    printf("%d x %d 24-bit as RGBA, %u processors:\n", side, side, (unsigned)sysconf(_SC_NPROCESSORS_ONLN));
+    double serialMs = 0;
+    for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+        double best = 1e30;
+        for(int i = 0; i < REPEATS; i++) {
+            bmpread_t bmp;
+            Clock::time_point start = Clock::now();
+            if(!bmpread_parallel(path.c_str(), BMPREAD_ANY_SIZE | BMPREAD_ALPHA, THREAD_COUNTS[t], &bmp)) {
+                printf("  failed to load\n");
+                remove(path.c_str());
+                return;
+            }
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            bmpread_free(&bmp);
+            if(ms < best) best = ms;
+        }
+        if(t == 0) serialMs = best;
+
+        char threads[32];
+        if(THREAD_COUNTS[t]) snprintf(threads, sizeof(threads), "%u threads", THREAD_COUNTS[t]);
+        else snprintf(threads, sizeof(threads), "per processor");
+        printf("  %-14s %8.1f ms %5.2fx\n", threads, best, serialMs / best);
+    }
+    remove(path.c_str());
+}
+
+// what loading into a buffer that's kept around, like a pixel unpack buffer,
+// costs copying from bmpread() and with bmpread_into()
+static void benchmarkInto(const std::string &dir)
+{
+    std::string path = dir + "/large.bmp";
+    if(!writeBmp(path.c_str(), FORMATS[0], SIZE, SIZE, 1)) {
+        printf("failed to write %s\n", path.c_str());
+        return;
+    }
+
+    const unsigned flags = BMPREAD_ANY_SIZE | BMPREAD_ALPHA;
+    bmpread_info_t info;
+    if(!bmpread_info(path.c_str(), flags, &info)) {
+        printf("  failed to load\n");
+        return;
+    }
+    std::vector<uint8_t> pool(info.data_len, 0);
+
+    double copyMs = 1e30, intoMs = 1e30;
+    for(int i = 0; i < REPEATS; i++) {
+        bmpread_t bmp;
+        Clock::time_point start = Clock::now();
+        if(!bmpread(path.c_str(), flags, &bmp)) break;
+        memcpy(pool.data(), bmp.data, info.data_len);
+        bmpread_free(&bmp);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if(ms < copyMs) copyMs = ms;
+
+        start = Clock::now();
+        if(!bmpread_into(path.c_str(), flags, 1, pool.data(), 0, pool.size())) break;
+        ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if(ms < intoMs) intoMs = ms;
+    }
+
+    printf("%d x %d 24-bit as RGBA into a buffer kept around:\n", SIZE, SIZE);
+    printf("  bmpread() and copy %8.1f ms\n", copyMs);
+    printf("  bmpread_into()     %8.1f ms %5.2fx\n", intoMs, copyMs / intoMs);
+    remove(path.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    int side = argc > 1 ? atoi(argv[1]) : 8192;
+    if(side <= 0) {
+        fprintf(stderr, "usage: bmp [side]\n");
+        return 2;
+    }
+
+    char tmp[] = "/tmp/bmpXXXXXX";
+    if(!mkdtemp(tmp)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string dir = tmp;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    printf("cpu: ssse3 %s, avx2 %s\n", __builtin_cpu_supports("ssse3") ? "yes" : "no",
+           __builtin_cpu_supports("avx2") ? "yes" : "no");
+#endif
+    bool ok = checkDecoders(dir);
+    ok = checkReadModes(dir) && ok;
+    ok = checkParallel(dir) && ok;
+    ok = checkInto(dir) && ok;
+
+    printf("%d x %d, output written per second:\n", SIZE, SIZE);
+    printf("  %-24s %-5s %11s %11s\n", "file", "out", "plain", "SIMD");
+    for(size_t f = 0; f < FORMAT_COUNT && FORMATS[f].bits >= 24; f++) {
+        benchmark(dir, FORMATS[f].name, FORMATS[f], SIZE);
+    }
+    benchmark(dir, "24-bit, 4093 wide", FORMATS[0], SIZE - 3);
+
+    printf("%d x %d, reading the file:\n", SIZE, SIZE);
+    benchmarkReads(dir, FORMATS[0], BMPREAD_ANY_SIZE);
+    benchmarkReads(dir, FORMATS[1], BMPREAD_ANY_SIZE | BMPREAD_ALPHA);
+    benchmarkParallel(dir, side);
+    benchmarkInto(dir);
+
+    rmdir(dir.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/* faces.cpp
+ * Allocation check for tinyobj's face storage.
+ *
+ * Loads generated .obj text of triangles, quads and pentagons at growing
+ * face counts, each in its own process, and reports the heap allocations
+ * LoadObj() made, the peak of the heap bytes it had live and its peak
+ * resident memory.  Faces are stored flat, so the allocation count should
+ * grow with the logarithm of the face count as buffers double, not with the
+ * face count.  Exits with 1 if going from the smallest load to the largest
+ * took more than one extra allocation per 1000 extra faces.
+ *
+ *   g++ -O2 -std=c++17 -Iinclude bench/faces.cpp src/tiny_obj_loader.cpp
+ *       -o faces
+ *   ./faces
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+
+static const int SIDES[] = { 64, 256, 1024 }; // grid of SIDE x SIDE cells
+static const double MAX_PER_1000_FACES = 1.0;
+
+static size_t allocations, liveBytes, peakBytes;
+
+// every allocation keeps its size in front of it so frees can be counted too
+static const size_t HEADER = 16;
+
+void *operator new(size_t size)
+{
+    char *block = (char *)malloc(size + HEADER);
+    if(!block) throw std::bad_alloc();
+    *(size_t *)block = size;
+    allocations++;
+    liveBytes += size;
+    if(liveBytes > peakBytes) peakBytes = liveBytes;
+    return block + HEADER;
+}
+
+void operator delete(void *p) noexcept
+{
+    if(!p) return;
+    char *block = (char *)p - HEADER;
+    liveBytes -= *(size_t *)block;
+    free(block);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+// side x side cells, each a quad, two triangles or a pentagon with an extra
+// vertex at the cell's centre
+static std::string makeObj(int side, size_t *faceCount)
+{
+    std::ostringstream obj;
+    for(int y = 0; y <= side; y++) {
+        for(int x = 0; x <= side; x++) obj << "v " << x << " " << y << " 0\n";
+    }
+    for(int y = 0; y < side; y++) {
+        for(int x = 0; x < side; x++) obj << "v " << x + 0.5f << " " << y + 0.5f << " 0\n";
+    }
+
+    *faceCount = 0;
+    const int corners = (side + 1) * (side + 1);
+    for(int y = 0; y < side; y++) {
+        for(int x = 0; x < side; x++) {
+            int a = y * (side + 1) + x + 1, b = a + 1, c = b + side + 1, d = a + side + 1;
+            int centre = corners + y * side + x + 1;
+            switch((x + y) % 3) {
+            case 0:
+                obj << "f " << a << " " << b << " " << c << " " << d << "\n";
+                *faceCount += 1;
+                break;
+            case 1:
+                obj << "f " << a << " " << b << " " << c << "\nf " << a << " " << c << " " << d << "\n";
+                *faceCount += 2;
+                break;
+            default:
+                obj << "f " << a << " " << centre << " " << b << " " << c << " " << d << "\n";
+                *faceCount += 1;
+                break;
+            }
+        }
+    }
+    return obj.str();
+}
+
+static size_t residentBytes()
+{
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if(f) {
+        if(fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return (size_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+struct LoadResult
+{
+    size_t faces;
+    size_t allocations;
+    size_t peakHeap;
+    size_t peakResident;
+};
+
+// loads a side x side grid in a child process, so its resident peak is its own
+static bool measure(int side, LoadResult *result)
+{
+    int fds[2];
+    if(pipe(fds) != 0) return false;
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        LoadResult r = {};
+        std::istringstream stream(makeObj(side, &r.faces));
+        size_t startResident = residentBytes();
+
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        size_t startAllocations = allocations, startBytes = liveBytes;
+        peakBytes = liveBytes;
+        bool loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream);
+        r.allocations = allocations - startAllocations;
+        r.peakHeap = peakBytes - startBytes;
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        r.peakResident = (size_t)usage.ru_maxrss * 1024 - startResident;
+
+        if(loaded && !shapes.empty()) {
+            if(write(fds[1], &r, sizeof(r)) != sizeof(r)) _exit(1);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    bool ok = pid > 0 && read(fds[0], result, sizeof(*result)) == sizeof(*result);
+    close(fds[0]);
+    if(pid > 0) waitpid(pid, 0, 0);
+    return ok;
+}
+
+int main()
+{
+    std::vector<LoadResult> results;
+    for(size_t i = 0; i < sizeof(SIDES) / sizeof(SIDES[0]); i++) {
+        LoadResult r;
+        if(!measure(SIDES[i], &r)) {
+            printf("%d x %d grid: failed to load\n", SIDES[i], SIDES[i]);
+            return 1;
+        }
+        printf("%8zu faces: %7zu allocations, peak heap %6.1f MB (%5.1f bytes per face), "
+               "peak resident %6.1f MB\n", r.faces, r.allocations, r.peakHeap / 1e6,
+               (double)r.peakHeap / r.faces, r.peakResident / 1e6);
+        results.push_back(r);
+    }
+
+    const LoadResult &small = results.front(), &large = results.back();
+    double per1000 = (double)(large.allocations - small.allocations) * 1000 / (large.faces - small.faces);
+    bool ok = large.allocations >= small.allocations && per1000 <= MAX_PER_1000_FACES;
+    printf("%.3f allocations per 1000 more faces: %s\n", per1000,
+           ok ? "ok" : "FAILED, allocations grow with the face count");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,400 @@
+/* floats.cpp
+ * tinyobj's float parser against strtod() and against the parser it had
+ * before.
+ *
+ * First fuzzes tryParseDouble() against strtod() in the "C" locale.  The
+ * strings are random doubles printed with %.17g (which round trips), %.9g
+ * and %f; random digit strings with exponents; halfway cases, exact ties
+ * between two neighbouring doubles and strings just either side of them;
+ * and subnormals, the underflow and overflow edges and zeros.  Every one
+ * has to be accepted and give the same bits as strtod().  Then random short
+ * strings of digits, signs, dots and exponents have to be accepted or
+ * rejected exactly as the old parser did, and where they are accepted and
+ * strtod() reads the whole string, give what it does.
+ *
+ * Then times the three on tokens like an .obj has, %.6f, and on %.9g and
+ * %.17g ones, and reports millions of floats per second.  Exits with 1 if
+ * any check failed.
+ *
+ *   g++ -O2 -std=c++17 -Iinclude bench/floats.cpp -o floats
+ *   ./floats [count]
+ *
+ * count is the random strings of each kind fuzzed (200000 by default).
+ */
+
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// tryParseDouble() is internal to the implementation, so build it here
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+
+static const int REPEATS = 5; // passes over the tokens, the fastest counts
+static const size_t BENCH_TOKENS = 1000000;
+
+typedef std::chrono::steady_clock Clock;
+
+// tinyobj's tryParseDouble() as it was before it was correctly rounded,
+// kept to check the grammar against and to time
+static bool oldParseDouble(const char *s, const char *s_end, double *result)
+{
+    if(s >= s_end) return false;
+
+    double mantissa = 0.0;
+    int exponent = 0;
+    char sign = '+';
+    char exp_sign = '+';
+    char const *curr = s;
+    int read = 0;
+    bool end_not_reached = false;
+    bool leading_decimal_dots = false;
+
+    if(*curr == '+' || *curr == '-') {
+        sign = *curr;
+        curr++;
+        if((curr != s_end) && (*curr == '.')) leading_decimal_dots = true;
+    } else if(IS_DIGIT(*curr)) {
+    } else if(*curr == '.') {
+        leading_decimal_dots = true;
+    } else {
+        goto fail;
+    }
+
+    end_not_reached = (curr != s_end);
+    if(!leading_decimal_dots) {
+        while(end_not_reached && IS_DIGIT(*curr)) {
+            mantissa *= 10;
+            mantissa += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        if(read == 0) goto fail;
+    }
+
+    if(!end_not_reached) goto assemble;
+
+    if(*curr == '.') {
+        curr++;
+        read = 1;
+        end_not_reached = (curr != s_end);
+        while(end_not_reached && IS_DIGIT(*curr)) {
+            static const double pow_lut[] = {
+                1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+            };
+            const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+            mantissa += static_cast<int>(*curr - 0x30) * (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+            read++;
+            curr++;
+            end_not_reached = (curr != s_end);
+        }
+    } else if(*curr == 'e' || *curr == 'E') {
+    } else {
+        goto assemble;
+    }
+
+    if(!end_not_reached) goto assemble;
+
+    if(*curr == 'e' || *curr == 'E') {
+        curr++;
+        end_not_reached = (curr != s_end);
+        if(end_not_reached && (*curr == '+' || *curr == '-')) {
+            exp_sign = *curr;
+            curr++;
+        } else if(IS_DIGIT(*curr)) {
+        } else {
+            goto fail;
+        }
+
+        read = 0;
+        end_not_reached = (curr != s_end);
+        while(end_not_reached && IS_DIGIT(*curr)) {
+            if(exponent > (2147483647 / 10)) goto fail;
+            exponent *= 10;
+            exponent += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        exponent *= (exp_sign == '+' ? 1 : -1);
+        if(read == 0) goto fail;
+    }
+
+assemble:
+    *result = (sign == '+' ? 1 : -1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+    return true;
+fail:
+    return false;
+}
+
+// splitmix64, so every run fuzzes the same strings
+struct Random
+{
+    uint64_t state;
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned below(unsigned n)
+    {
+        return (unsigned)(next() % n);
+    }
+};
+
+static double fromBits(uint64_t bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static uint64_t toBits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+// a finite double of any exponent and sign
+static double randomDouble(Random *random)
+{
+    for(;;) {
+        double d = fromBits(random->next());
+        if(isfinite(d)) return d;
+    }
+}
+
+static std::string format(const char *fmt, double d)
+{
+    char buf[512];
+    snprintf(buf, sizeof(buf), fmt, d);
+    return buf;
+}
+
+struct Fuzz
+{
+    size_t checked, failed;
+};
+
+// s has to be accepted and give strtod()'s bits
+static void checkString(const std::string &s, Fuzz *fuzz)
+{
+    char *end;
+    const double expected = strtod(s.c_str(), &end);
+    double parsed = 0;
+    const bool ok = tinyobj::tryParseDouble(s.c_str(), s.c_str() + s.size(), &parsed);
+    fuzz->checked++;
+    if(end != s.c_str() + s.size() || !ok || toBits(parsed) != toBits(expected)) {
+        if(fuzz->failed++ < 10) {
+            printf("  %s: %s, strtod %.17g\n", s.c_str(), ok ? format("%.17g", parsed).c_str() : "rejected", expected);
+        }
+    }
+}
+
+static bool fuzzStrtod(size_t count)
+{
+    Random random = { 1 };
+    Fuzz fuzz = { 0, 0 };
+
+    for(size_t i = 0; i < count; i++) {
+        const double d = randomDouble(&random);
+        checkString(format("%.17g", d), &fuzz);
+        checkString(format("%.9g", d), &fuzz);
+
+        // %f of big numbers runs to hundreds of digits, so keep to a range
+        // an .obj might have
+        const double small = ldexp((double)(random.next() >> 11), -(int)random.below(80));
+        checkString(format("%f", random.below(2) ? -small : small), &fuzz);
+    }
+
+    // digit strings of every length with exponents, leading zeros and dots
+    for(size_t i = 0; i < count; i++) {
+        std::string s;
+        if(random.below(4) == 0) s += random.below(2) ? '-' : '+';
+        const unsigned digits = 1 + random.below(30), dot = random.below(digits + 2);
+        for(unsigned k = 0; k < digits; k++) {
+            if(k == dot) s += '.';
+            s += (char)('0' + random.below(10));
+        }
+        if(random.below(2)) {
+            s += random.below(2) ? 'e' : 'E';
+            if(random.below(2)) s += random.below(2) ? '-' : '+';
+            s += std::to_string(random.below(340));
+        }
+        checkString(s, &fuzz);
+    }
+
+    // halfway between d and the next double up: exactly, which has to round
+    // to even, and with the last digit nudged either way
+#if LDBL_MANT_DIG >= 64
+    for(size_t i = 0; i < count / 10; i++) {
+        const double d = fabs(randomDouble(&random));
+        const double up = nextafter(d, INFINITY);
+        if(!isfinite(up)) continue;
+        const long double half = ((long double)d + (long double)up) / 2;
+
+        char buf[1024];
+        snprintf(buf, sizeof(buf), "%.800Le", half);
+        std::string exact = buf;
+        checkString(exact, &fuzz);
+
+        // the last nonzero digit before the exponent
+        size_t e = exact.find('e'), last = exact.find_last_not_of('0', e - 1);
+        if(exact[last] == '.') continue;
+        std::string above = exact, below = exact;
+        above.insert(last + 1, "1");
+        below[last]--;
+        below.insert(last + 1, "9");
+        checkString(above, &fuzz);
+        checkString(below, &fuzz);
+
+        // a short near-halfway string, as another program might print one
+        snprintf(buf, sizeof(buf), "%.25Le", half);
+        checkString(buf, &fuzz);
+    }
+#else
+    printf("  no long double wide enough for exact halfway cases, skipped\n");
+#endif
+
+    // subnormals, then the edges of underflow, overflow and zero
+    for(size_t i = 0; i < count / 10; i++) {
+        const double d = fromBits(random.next() & 0x000fffffffffffffull);
+        checkString(format("%.17g", d), &fuzz);
+        checkString(format("%.9g", d), &fuzz);
+    }
+    const char *edges[] = {
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-324", "3e-324",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "2.2250738585072012e-308",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309", "-1e400",
+        "0", "-0", "0.0", "0e0", "0e999", "-0.000e-999", "1e-400", "9007199254740993", "9007199254740992.5",
+        "123456789012345678901234567890", "0.000000000000000000000000000001",
+    };
+    for(size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) checkString(edges[i], &fuzz);
+
+    printf("strtod: %zu strings, %zu differ\n", fuzz.checked, fuzz.failed);
+    return fuzz.failed == 0;
+}
+
+static bool fuzzGrammar(size_t count)
+{
+    static const char ALPHABET[] = "0123456789.+-eE";
+    Random random = { 2 };
+    size_t differ = 0, accepted = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        std::string s;
+        const unsigned length = 1 + random.below(8);
+        for(unsigned k = 0; k < length; k++) {
+            // mostly digits, so many are numbers
+            s += random.below(2) ? (char)('0' + random.below(10)) : ALPHABET[random.below(sizeof(ALPHABET) - 1)];
+        }
+
+        double oldValue, value;
+        const bool oldOk = oldParseDouble(s.c_str(), s.c_str() + s.size(), &oldValue);
+        const bool ok = tinyobj::tryParseDouble(s.c_str(), s.c_str() + s.size(), &value);
+        char *end;
+        const double expected = strtod(s.c_str(), &end);
+        bool bad = ok != oldOk || (ok && end == s.c_str() + s.size() && toBits(value) != toBits(expected));
+        if(ok) accepted++;
+        if(bad && differ++ < 10) {
+            printf("  %s: %s, old parser %s\n", s.c_str(), ok ? format("%.17g", value).c_str() : "rejected",
+                   oldOk ? "accepts" : "rejects");
+        }
+    }
+
+    printf("grammar: %zu strings, %zu accepted, %zu differ from the old parser\n", count, accepted, differ);
+    return differ == 0;
+}
+
+// tokens of buf, one after another with their ends
+struct Tokens
+{
+    std::string buf;
+    std::vector<size_t> starts, ends;
+};
+
+static Tokens makeTokens(const char *fmt)
+{
+    Random random = { 3 };
+    Tokens tokens;
+    for(size_t i = 0; i < BENCH_TOKENS; i++) {
+        // vertex positions and texture coordinates, as .obj files have them
+        const double d = ((double)(random.next() >> 11) / 9007199254740992.0 - 0.5) * 20;
+        tokens.starts.push_back(tokens.buf.size());
+        tokens.buf += format(fmt, d);
+        tokens.ends.push_back(tokens.buf.size());
+        tokens.buf += ' ';
+    }
+    return tokens;
+}
+
+// fastest of REPEATS passes, in millions of floats per second; sum keeps the
+// parsing from being optimized away
+template <typename Parse>
+static double parseRate(const Tokens &tokens, Parse parse, double *sum)
+{
+    double best = 1e30;
+    const char *buf = tokens.buf.c_str();
+    for(int r = 0; r < REPEATS; r++) {
+        double total = 0;
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < tokens.starts.size(); i++) {
+            double value = 0;
+            parse(buf + tokens.starts[i], buf + tokens.ends[i], &value);
+            total += value;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if(seconds < best) best = seconds;
+        *sum += total;
+    }
+    return tokens.starts.size() / best / 1e6;
+}
+
+static void benchmark()
+{
+    const char *formats[] = { "%.6f", "%.9g", "%.17g" };
+    double sum = 0;
+    printf("\nMfloats/s     tryParseDouble  old parser      strtod\n");
+    for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        Tokens tokens = makeTokens(formats[f]);
+        double now = parseRate(tokens, tinyobj::tryParseDouble, &sum);
+        double old = parseRate(tokens, oldParseDouble, &sum);
+        double libc = parseRate(tokens, [](const char *s, const char *, double *out) {
+            *out = strtod(s, 0);
+            return true;
+        }, &sum);
+        printf("%-12s %15.1f %11.1f %11.1f   %.2fx old, %.2fx strtod\n", formats[f], now, old, libc, now / old, now / libc);
+    }
+    if(sum == 12345) printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? (size_t)atol(argv[1]) : 200000;
+    if(count == 0) {
+        printf("usage: floats [count]\n");
+        return 1;
+    }
+
+    bool ok = fuzzStrtod(count);
+    ok = fuzzGrammar(count) && ok;
+    printf("checks %s\n", ok ? "passed" : "FAILED");
+
+    benchmark();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,591 @@
+/* loaders.cpp
+ * .obj loader benchmark over generated scenes.
+ *
+ * Writes deterministic .obj files, each with an .mtl, of a chosen size and
+ * mix of features: triangles, quads, n-gons of up to 8 sides, negative
+ * (relative) indices, many groups and materials.  Then loads each file
+ * with every load path we have:
+ *   - LoadObj()
+ *   - LoadObjParallel()
+ *   - streamObj()
+ *   - bakeObj() without optimizing, which welds and batches
+ * Every load runs in its own process, so its resident peak is its own.
+ *
+ * The results go to stdout as JSON for regression tracking, one entry per
+ * scene and load path.  Each entry has:
+ *   - the fastest of the repeated load times
+ *   - throughput in MB/s and faces/s
+ *   - the triangles loaded, to check the paths agree
+ *   - the heap allocations of the first load
+ *   - the peak of the heap bytes live
+ *   - the peak resident memory
+ * Then LoadObjParallel() is run again on 1, 2, 4, 8 and one per hardware
+ * thread, and each scene gets a "threads" list of those times with their
+ * MB/s and speedup over LoadObj() ("all" marks the last).  Progress goes to stderr.
+ *
+ * Before any of that, loads a few awkward inputs (empty faces, last lines
+ * without a newline, CRLF, a file big enough to be split) with
+ * LoadObjFromBuffer() and LoadObjParallelFromBuffer() on each of those
+ * thread counts and checks that they return the same.  Exits with 1 if
+ * not, or if any load fails.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude bench/loaders.cpp
+ *       src/mappedfile.cpp src/mesh.cpp src/meshbake.cpp src/meshlet.cpp
+ *       src/meshopt.cpp src/normals.cpp src/objstream.cpp src/plyload.cpp
+ *       src/simplify.cpp src/tiny_obj_loader.cpp -o loaders
+ *   ./loaders [-s side] [-r repeats] [-d dir] [scene...]
+ *
+ * side is the cells per side of each group's grid (default 256); scenes
+ * default to all of them.  Files are written to a temporary directory and
+ * removed afterwards, unless -d gives one to keep them in.
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "meshbake.h"
+#include "objstream.h"
+#include "tiny_obj_loader.h"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static std::atomic<size_t> allocations, liveBytes, peakBytes;
+
+// every allocation keeps its size in front of it so frees can be counted too;
+// atomic, as LoadObjParallel() and bakeObj() allocate on several threads
+static const size_t HEADER = 16;
+
+void *operator new(size_t size)
+{
+    char *block = (char *)malloc(size + HEADER);
+    if(!block) throw std::bad_alloc();
+    *(size_t *)block = size;
+    allocations++;
+    size_t live = liveBytes += size;
+    size_t peak = peakBytes.load();
+    while(live > peak && !peakBytes.compare_exchange_weak(peak, live)) {
+    }
+    return block + HEADER;
+}
+
+void operator delete(void *p) noexcept
+{
+    if(!p) return;
+    char *block = (char *)p - HEADER;
+    liveBytes -= *(size_t *)block;
+    free(block);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+// what goes into a generated scene
+struct Scene
+{
+    const char *name;
+    int groups;     // g lines, each a grid of side x side cells next to the last
+    int materials;  // usemtl switches cycle through these, a row of cells each
+    int quads;      // chances out of 8 of a cell being a quad,
+    int ngons;      // an n-gon of 5 to 8 sides, or else two triangles
+    bool negative;  // corners refer back from the last v line
+    bool texcoords; // vt on every corner
+    bool normals;   // vn on every corner
+};
+
+static const Scene SCENES[] = {
+    { "triangles", 1, 1, 0, 0, false, true, true },
+    { "quads", 1, 1, 8, 0, false, true, true },
+    { "ngons", 1, 1, 0, 8, false, false, true },
+    { "negative", 1, 1, 4, 0, true, true, true },
+    { "groups", 64, 16, 4, 0, false, false, true },
+    { "positions", 1, 1, 4, 0, false, false, false },
+    { "mixed", 16, 8, 3, 2, true, true, true },
+};
+
+// xorshift32, so every run writes the same files
+struct Random
+{
+    uint32_t state;
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // in [0, 1)
+    float unit()
+    {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+struct SceneFile
+{
+    std::string path;
+    size_t bytes;
+    size_t faces; // as written, before triangulating
+    size_t triangles;
+};
+
+// Writes one corner: v, v/vt, v//vn or v/vt/vn, each index 1-based and
+// absolute or relative to the vertexCount v lines so far.
+static void writeCorner(FILE *fp, const Scene &scene, size_t index, size_t vertexCount)
+{
+    long long ref = scene.negative ? (long long)index - (long long)vertexCount - 1 : (long long)index;
+    if(scene.texcoords && scene.normals) fprintf(fp, " %lld/%lld/%lld", ref, ref, ref);
+    else if(scene.texcoords) fprintf(fp, " %lld/%lld", ref, ref);
+    else if(scene.normals) fprintf(fp, " %lld//%lld", ref, ref);
+    else fprintf(fp, " %lld", ref);
+}
+
+// Writes a vertex with a matching vt and vn, if the scene has them.
+static void writeVertex(FILE *fp, const Scene &scene, float x, float y, float z, Random *random)
+{
+    fprintf(fp, "v %.6f %.6f %.6f\n", x, y, z);
+    if(scene.texcoords) fprintf(fp, "vt %.6f %.6f\n", x - (int)x, y - (int)y);
+    if(scene.normals) {
+        float nx = random->unit() * 0.2f - 0.1f, ny = random->unit() * 0.2f - 0.1f;
+        fprintf(fp, "vn %.6f %.6f %.6f\n", nx, ny, 1.0f);
+    }
+}
+
+// Writes dir/<scene>.obj and its .mtl.
+static bool writeScene(const std::string &dir, const Scene &scene, int side, SceneFile *out)
+{
+    out->path = dir + "/" + scene.name + ".obj";
+    out->faces = out->triangles = 0;
+
+    std::string mtlName = std::string(scene.name) + ".mtl";
+    FILE *mtl = fopen((dir + "/" + mtlName).c_str(), "w");
+    if(!mtl) return false;
+    Random random = { 0x9e3779b9u };
+    for(int m = 0; m < scene.materials; m++) {
+        fprintf(mtl, "newmtl material%d\nKd %.3f %.3f %.3f\n\n", m, random.unit(), random.unit(), random.unit());
+    }
+    fclose(mtl);
+
+    FILE *fp = fopen(out->path.c_str(), "w");
+    if(!fp) return false;
+    fprintf(fp, "# generated by bench/loaders.cpp, scene %s, side %d\nmtllib %s\n", scene.name, side, mtlName.c_str());
+
+    size_t vertexCount = 0;
+    int material = 0;
+    std::vector<size_t> ring;
+    for(int g = 0; g < scene.groups; g++) {
+        fprintf(fp, "g group%d\n", g);
+
+        // a height field of grid corners, then each cell's shape
+        const size_t base = vertexCount;
+        const float x0 = (float)g * (side + 1);
+        for(int y = 0; y <= side; y++) {
+            for(int x = 0; x <= side; x++) writeVertex(fp, scene, x0 + x, (float)y, random.unit() * 0.25f, &random);
+        }
+        vertexCount += (size_t)(side + 1) * (side + 1);
+
+        for(int y = 0; y < side; y++) {
+            if(scene.materials > 1 || y == 0) {
+                fprintf(fp, "usemtl material%d\n", material);
+                material = (material + 1) % scene.materials;
+            }
+
+            for(int x = 0; x < side; x++) {
+                size_t a = base + (size_t)y * (side + 1) + x + 1, b = a + 1, c = b + side + 1, d = a + side + 1;
+                int kind = (int)(random.next() % 8);
+
+                if(kind < scene.quads) {
+                    fprintf(fp, "f");
+                    writeCorner(fp, scene, a, vertexCount);
+                    writeCorner(fp, scene, b, vertexCount);
+                    writeCorner(fp, scene, c, vertexCount);
+                    writeCorner(fp, scene, d, vertexCount);
+                    fprintf(fp, "\n");
+                    out->faces += 1;
+                    out->triangles += 2;
+                } else if(kind < scene.quads + scene.ngons) {
+                    // a convex n-gon of its own vertices inside the cell
+                    const int n = 5 + (int)(random.next() % 4);
+                    ring.clear();
+                    for(int k = 0; k < n; k++) {
+                        float angle = 6.2831853f * k / n;
+                        writeVertex(fp, scene, x0 + x + 0.5f + 0.45f * cosf(angle), y + 0.5f + 0.45f * sinf(angle), 0.3f, &random);
+                        ring.push_back(++vertexCount);
+                    }
+                    fprintf(fp, "f");
+                    for(int k = 0; k < n; k++) writeCorner(fp, scene, ring[k], vertexCount);
+                    fprintf(fp, "\n");
+                    out->faces += 1;
+                    out->triangles += n - 2;
+                } else {
+                    fprintf(fp, "f");
+                    writeCorner(fp, scene, a, vertexCount);
+                    writeCorner(fp, scene, b, vertexCount);
+                    writeCorner(fp, scene, c, vertexCount);
+                    fprintf(fp, "\nf");
+                    writeCorner(fp, scene, a, vertexCount);
+                    writeCorner(fp, scene, c, vertexCount);
+                    writeCorner(fp, scene, d, vertexCount);
+                    fprintf(fp, "\n");
+                    out->faces += 2;
+                    out->triangles += 2;
+                }
+            }
+        }
+    }
+
+    long bytes = ftell(fp);
+    bool ok = ferror(fp) == 0 && bytes > 0;
+    if(fclose(fp) != 0) ok = false;
+    out->bytes = (size_t)bytes;
+    return ok;
+}
+
+static std::string directoryOf(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+enum Loader
+{
+    LOAD_OBJ,
+    LOAD_OBJ_PARALLEL,
+    STREAM_OBJ,
+    BAKE_OBJ,
+    LOADER_COUNT
+};
+
+static const char *const LOADER_NAMES[LOADER_COUNT] = { "LoadObj", "LoadObjParallel", "streamObj", "bakeObj" };
+
+// LoadObjParallel() thread counts to sweep; 0 is one per hardware thread
+static const unsigned THREAD_COUNTS[] = { 1, 2, 4, 8, 0 };
+
+// Loads path once with loader, returning the triangles it gave, or 0 if it
+// failed.  threads is LoadObjParallel()'s, 0 for one per hardware thread.
+static size_t load(Loader loader, const std::string &path, unsigned threads)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    size_t triangles = 0;
+
+    switch(loader) {
+    case LOAD_OBJ:
+    case LOAD_OBJ_PARALLEL: {
+        bool ok;
+        if(loader == LOAD_OBJ) {
+            ok = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), directoryOf(path).c_str());
+        } else {
+            std::ifstream stream(path.c_str(), std::ios::binary);
+            tinyobj::MaterialFileReader reader(directoryOf(path));
+            ok = stream && tinyobj::LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, &stream, &reader,
+                                                    true, true, threads);
+        }
+        if(!ok) return 0;
+        for(size_t s = 0; s < shapes.size(); s++) triangles += shapes[s].mesh.num_face_vertices.size();
+        return triangles;
+    }
+    case STREAM_OBJ: {
+        ObjStreamStats stats;
+        bool ok = streamObj(path.c_str(), OBJSTREAM_DEFAULT_BUDGET, [](const MeshChunk &) {}, &stats, &err);
+        return ok ? stats.triangles : 0;
+    }
+    case BAKE_OBJ: {
+        MeshBakeOptions options = defaultMeshBakeOptions();
+        options.optimize = false;
+        BakedMesh baked;
+        if(!bakeObj(path.c_str(), options, &baked, 0, &warn, &err)) return 0;
+        return baked.mesh.indices.size() / 3;
+    }
+    default:
+        return 0;
+    }
+}
+
+// inputs the parallel loader has to give the same result on as the serial one
+static const char *const AWKWARD_OBJS[] = {
+    "v 1 2 3\nf \n",
+    "f \n",
+    "v 1 2 3\nf \nf 1 1 1\n",
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nf \n",
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\ng a\nf 1 2 3\ng b\nf\t\n",
+    "v 1 2 3\r\nf \r\n",
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3",
+    "v 1 2 3\nf",
+};
+
+static bool sameIndices(const std::vector<tinyobj::index_t> &a, const std::vector<tinyobj::index_t> &b)
+{
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); i++) {
+        if(a[i].vertex_index != b[i].vertex_index || a[i].normal_index != b[i].normal_index ||
+           a[i].texcoord_index != b[i].texcoord_index) return false;
+    }
+    return true;
+}
+
+// loads obj with LoadObjFromBuffer() and LoadObjParallelFromBuffer() on each
+// thread count, true if every load gives the same
+static bool compareParallel(const char *name, const std::string &obj)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    const bool ok = tinyobj::LoadObjFromBuffer(&attrib, &shapes, &materials, &warn, &err, obj.data(), obj.size());
+
+    bool same = true;
+    for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+        tinyobj::attrib_t pattrib;
+        std::vector<tinyobj::shape_t> pshapes;
+        std::vector<tinyobj::material_t> pmaterials;
+        std::string pwarn, perr;
+        const bool pok = tinyobj::LoadObjParallelFromBuffer(&pattrib, &pshapes, &pmaterials, &pwarn, &perr,
+                                                            obj.data(), obj.size(), NULL, true, true,
+                                                            THREAD_COUNTS[t]);
+
+        bool match = pok == ok && pwarn == warn && pattrib.vertices == attrib.vertices &&
+                     pattrib.normals == attrib.normals && pattrib.texcoords == attrib.texcoords &&
+                     pshapes.size() == shapes.size();
+        for(size_t s = 0; match && s < shapes.size(); s++) {
+            match = pshapes[s].name == shapes[s].name && sameIndices(pshapes[s].mesh.indices, shapes[s].mesh.indices) &&
+                    pshapes[s].mesh.num_face_vertices == shapes[s].mesh.num_face_vertices &&
+                    pshapes[s].mesh.material_ids == shapes[s].mesh.material_ids;
+        }
+        if(!match) {
+            fprintf(stderr, "%s: LoadObjParallelFromBuffer() on %u threads differs from LoadObjFromBuffer()\n",
+                    name, THREAD_COUNTS[t]);
+            same = false;
+        }
+    }
+    return same;
+}
+
+static bool checkAwkward()
+{
+    bool ok = true;
+    for(size_t i = 0; i < sizeof(AWKWARD_OBJS) / sizeof(AWKWARD_OBJS[0]); i++) {
+        std::string name = "awkward " + std::to_string(i);
+        ok = compareParallel(name.c_str(), AWKWARD_OBJS[i]) && ok;
+    }
+
+    // big enough for every thread count to get its own chunk, so chunks
+    // start and end between empty faces
+    std::string big;
+    while(big.size() < 4u << 20) big += "v 0 0 0\nv 1 0 0\nv 0 1 0\nf -3 -2 -1\nf \n";
+    ok = compareParallel("awkward split", big) && ok;
+
+    fprintf(stderr, "awkward inputs %s\n", ok ? "agree" : "DIFFER");
+    return ok;
+}
+
+static size_t residentBytes()
+{
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if(f) {
+        if(fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return (size_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+struct LoadResult
+{
+    size_t triangles;
+    double seconds; // fastest
+    size_t allocations;
+    size_t peakHeap;
+    size_t peakResident;
+};
+
+// loads path repeats times in a child process
+static bool measure(Loader loader, const std::string &path, unsigned threads, int repeats, LoadResult *result)
+{
+    int fds[2];
+    if(pipe(fds) != 0) return false;
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        LoadResult r = {};
+        size_t startResident = residentBytes();
+
+        for(int i = 0; i < repeats; i++) {
+            size_t startAllocations = allocations, startBytes = liveBytes;
+            peakBytes = startBytes;
+
+            Clock::time_point start = Clock::now();
+            size_t triangles = load(loader, path, threads);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if(!triangles) _exit(1);
+
+            if(i == 0) {
+                r.triangles = triangles;
+                r.seconds = seconds;
+                r.allocations = allocations - startAllocations;
+                r.peakHeap = peakBytes - startBytes;
+            } else if(seconds < r.seconds) {
+                r.seconds = seconds;
+            }
+        }
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        size_t peak = (size_t)usage.ru_maxrss * 1024;
+        r.peakResident = peak > startResident ? peak - startResident : 0;
+
+        if(write(fds[1], &r, sizeof(r)) != sizeof(r)) _exit(1);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    bool ok = pid > 0 && read(fds[0], result, sizeof(*result)) == sizeof(*result);
+    close(fds[0]);
+    if(pid > 0) waitpid(pid, 0, 0);
+    return ok;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: loaders [-s side] [-r repeats] [-d dir] [scene...]\nscenes:");
+    for(size_t i = 0; i < sizeof(SCENES) / sizeof(SCENES[0]); i++) fprintf(stderr, " %s", SCENES[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    int side = 256, repeats = 3;
+    std::string dir;
+    std::vector<const Scene *> scenes;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            side = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            const Scene *scene = 0;
+            for(size_t s = 0; s < sizeof(SCENES) / sizeof(SCENES[0]); s++) {
+                if(strcmp(argv[i], SCENES[s].name) == 0) scene = &SCENES[s];
+            }
+            if(!scene) {
+                usage();
+                return 1;
+            }
+            scenes.push_back(scene);
+        }
+    }
+    if(side < 1 || repeats < 1) {
+        usage();
+        return 1;
+    }
+    if(scenes.empty()) {
+        for(size_t s = 0; s < sizeof(SCENES) / sizeof(SCENES[0]); s++) scenes.push_back(&SCENES[s]);
+    }
+
+    const bool keep = !dir.empty();
+    if(keep) {
+        mkdir(dir.c_str(), 0777);
+    } else {
+        char tmp[] = "/tmp/loadersXXXXXX";
+        if(!mkdtemp(tmp)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        dir = tmp;
+    }
+
+    bool ok = checkAwkward();
+    printf("{\n  \"side\": %d,\n  \"repeats\": %d,\n  \"scenes\": [", side, repeats);
+    for(size_t s = 0; s < scenes.size(); s++) {
+        const Scene &scene = *scenes[s];
+        SceneFile file;
+        if(!writeScene(dir, scene, side, &file)) {
+            fprintf(stderr, "%s: failed to write %s\n", scene.name, file.path.c_str());
+            ok = false;
+            break;
+        }
+        fprintf(stderr, "%s: %.1f MB, %zu faces\n", scene.name, file.bytes / 1e6, file.faces);
+
+        printf("%s\n    {\n      \"name\": \"%s\",\n      \"bytes\": %zu,\n      \"faces\": %zu,\n"
+               "      \"triangles\": %zu,\n      \"loads\": [", s ? "," : "", scene.name, file.bytes, file.faces, file.triangles);
+
+        double loadObjSeconds = 0;
+        for(int l = 0; l < LOADER_COUNT; l++) {
+            LoadResult r;
+            bool loaded = measure((Loader)l, file.path, 0, repeats, &r);
+            if(loaded && l == LOAD_OBJ) loadObjSeconds = r.seconds;
+            printf("%s\n        { \"loader\": \"%s\", \"ok\": %s", l ? "," : "", LOADER_NAMES[l], loaded ? "true" : "false");
+            if(loaded) {
+                printf(", \"seconds\": %.6f, \"mb_per_s\": %.2f, \"faces_per_s\": %.0f, \"triangles\": %zu, "
+                       "\"allocations\": %zu, \"peak_heap_bytes\": %zu, \"peak_rss_bytes\": %zu",
+                       r.seconds, file.bytes / 1e6 / r.seconds, file.faces / r.seconds, r.triangles,
+                       r.allocations, r.peakHeap, r.peakResident);
+                fprintf(stderr, "  %-16s %8.1f ms %8.1f MB/s %10zu allocations, peak heap %7.1f MB, peak resident %7.1f MB\n",
+                        LOADER_NAMES[l], r.seconds * 1e3, file.bytes / 1e6 / r.seconds, r.allocations,
+                        r.peakHeap / 1e6, r.peakResident / 1e6);
+            } else {
+                fprintf(stderr, "  %-16s failed\n", LOADER_NAMES[l]);
+                ok = false;
+            }
+            printf(" }");
+        }
+        printf("\n      ],\n      \"threads\": [");
+
+        for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+            LoadResult r;
+            bool loaded = measure(LOAD_OBJ_PARALLEL, file.path, THREAD_COUNTS[t], repeats, &r);
+            const unsigned threads = THREAD_COUNTS[t] ? THREAD_COUNTS[t] : std::max(std::thread::hardware_concurrency(), 1u);
+            std::string label = THREAD_COUNTS[t] ? "threads " + std::to_string(threads) : "threads all " + std::to_string(threads);
+            printf("%s\n        { \"threads\": %u, \"all\": %s, \"ok\": %s", t ? "," : "", threads,
+                   THREAD_COUNTS[t] ? "false" : "true", loaded ? "true" : "false");
+            if(loaded) {
+                const double speedup = loadObjSeconds > 0 ? loadObjSeconds / r.seconds : 0;
+                printf(", \"seconds\": %.6f, \"mb_per_s\": %.2f, \"speedup\": %.3f", r.seconds,
+                       file.bytes / 1e6 / r.seconds, speedup);
+                fprintf(stderr, "  %-16s %8.1f ms %8.1f MB/s %6.2fx LoadObj\n",
+                        label.c_str(), r.seconds * 1e3, file.bytes / 1e6 / r.seconds, speedup);
+            } else {
+                fprintf(stderr, "  %-16s failed\n", label.c_str());
+                ok = false;
+            }
+            printf(" }");
+        }
+        printf("\n      ]\n    }");
+
+        if(!keep) {
+            remove(file.path.c_str());
+            remove((dir + "/" + scene.name + ".mtl").c_str());
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    if(!keep) rmdir(dir.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+/* meshlets.cpp
+ * Meshlet build and culling benchmark.
+ *
+ * Builds meshlets for a few synthetic meshes and for any .obj files given on
+ * the command line (jason.obj by default), then culls them from cameras
+ * orbiting each mesh and reports how much was rejected and what it cost.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude bench/meshlets.cpp src/meshlet.cpp
+ *       src/meshopt.cpp src/mesh.cpp src/normals.cpp src/tiny_obj_loader.cpp
+ *       -o meshlets
+ *   ./meshlets [file.obj ...]
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include "mesh.h"
+#include "meshlet.h"
+#include "meshopt.h"
+
+
+static const int VIEWS = 32;       // cameras per orbit
+static const int REPEATS = 20;     // culls per camera, for timing
+static const float FOV = 60.0f;    // degrees
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// column-major 4x4, like OpenGL and glm
+static void multiply(const float *a, const float *b, float *out)
+{
+    for(int c = 0; c < 4; c++) {
+        for(int r = 0; r < 4; r++) {
+            float sum = 0;
+            for(int k = 0; k < 4; k++) sum += a[k * 4 + r] * b[c * 4 + k];
+            out[c * 4 + r] = sum;
+        }
+    }
+}
+
+static void perspective(float fovy, float aspect, float zNear, float zFar, float *m)
+{
+    float f = 1.0f / tanf(fovy * 0.5f * 3.14159265f / 180);
+    for(int i = 0; i < 16; i++) m[i] = 0;
+    m[0] = f / aspect;
+    m[5] = f;
+    m[10] = (zFar + zNear) / (zNear - zFar);
+    m[11] = -1;
+    m[14] = 2 * zFar * zNear / (zNear - zFar);
+}
+
+static void lookAt(const float *eye, const float *center, float *m)
+{
+    float f[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+    float fl = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for(int k = 0; k < 3; k++) f[k] /= fl;
+
+    // up is +y; the orbits below never look straight along it
+    float s[3] = { -f[2], 0, f[0] };
+    float sl = sqrtf(s[0] * s[0] + s[2] * s[2]);
+    s[0] /= sl;
+    s[2] /= sl;
+    float u[3] = { s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0] };
+
+    float rows[3][3] = { { s[0], s[1], s[2] }, { u[0], u[1], u[2] }, { -f[0], -f[1], -f[2] } };
+    for(int i = 0; i < 16; i++) m[i] = 0;
+    for(int r = 0; r < 3; r++) {
+        for(int c = 0; c < 3; c++) m[c * 4 + r] = rows[r][c];
+        m[12 + r] = -(rows[r][0] * eye[0] + rows[r][1] * eye[1] + rows[r][2] * eye[2]);
+    }
+    m[15] = 1;
+}
+
+// unit sphere, the best case for cone culling
+static void makeSphere(int segments, Mesh *mesh)
+{
+    const int rings = segments / 2;
+    for(int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for(int s = 0; s <= segments; s++) {
+            float phi = 2 * 3.14159265f * s / segments;
+            Vertex v = {};
+            v.position[0] = sinf(theta) * cosf(phi);
+            v.position[1] = cosf(theta);
+            v.position[2] = sinf(theta) * sinf(phi);
+            for(int k = 0; k < 3; k++) v.normal[k] = v.position[k];
+            mesh->vertices.push_back(v);
+        }
+    }
+    for(int r = 0; r < rings; r++) {
+        for(int s = 0; s < segments; s++) {
+            uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+            uint32_t quad[6] = { a, a + 1, b, b, a + 1, b + 1 };
+            mesh->indices.insert(mesh->indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// bumpy height field, where cones are wide and mostly frustum culling helps
+static void makeTerrain(int size, Mesh *mesh)
+{
+    for(int z = 0; z <= size; z++) {
+        for(int x = 0; x <= size; x++) {
+            float fx = (float)x / size * 2 - 1, fz = (float)z / size * 2 - 1;
+            Vertex v = {};
+            v.position[0] = fx;
+            v.position[1] = 0.1f * sinf(fx * 17) * cosf(fz * 13);
+            v.position[2] = fz;
+            v.normal[1] = 1;
+            mesh->vertices.push_back(v);
+        }
+    }
+    for(int z = 0; z < size; z++) {
+        for(int x = 0; x < size; x++) {
+            uint32_t a = z * (size + 1) + x, b = a + size + 1;
+            uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            mesh->indices.insert(mesh->indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+static void run(const char *name, Mesh &mesh)
+{
+    const size_t nIndices = mesh.indices.size(), nVertices = mesh.vertices.size();
+
+    optimizeVertexCache(mesh.indices.data(), nIndices, nVertices);
+    float acmrBefore = analyzeVertexCache(mesh.indices.data(), nIndices, nVertices).acmr;
+
+    std::vector<Meshlet> meshlets;
+    Clock::time_point start = Clock::now();
+    buildMeshlets(mesh.indices.data(), nIndices, mesh.vertices.data(), nVertices, &meshlets);
+    double buildMs = millisecondsSince(start);
+
+    float acmrAfter = analyzeVertexCache(mesh.indices.data(), nIndices, nVertices).acmr;
+
+    // orbit around the bounding sphere, far enough to see it all and close
+    // enough to see part of it
+    float lo[3], hi[3];
+    for(int k = 0; k < 3; k++) lo[k] = hi[k] = mesh.vertices[0].position[k];
+    for(size_t i = 1; i < nVertices; i++) {
+        for(int k = 0; k < 3; k++) {
+            lo[k] = fminf(lo[k], mesh.vertices[i].position[k]);
+            hi[k] = fmaxf(hi[k], mesh.vertices[i].position[k]);
+        }
+    }
+    float center[3] = { (lo[0] + hi[0]) / 2, (lo[1] + hi[1]) / 2, (lo[2] + hi[2]) / 2 };
+    float radius = sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                         (hi[2] - lo[2]) * (hi[2] - lo[2])) / 2;
+
+    size_t meshletVertices = 0;
+    for(size_t i = 0; i < meshlets.size(); i++) meshletVertices += meshlets[i].vertexCount;
+
+    printf("%s: %zu triangles, %zu meshlets (%.1f triangles, %.1f vertices each), built in %.2f ms, "
+           "ACMR %.3f -> %.3f\n", name, nIndices / 3, meshlets.size(),
+           (double)nIndices / 3 / meshlets.size(), (double)meshletVertices / meshlets.size(),
+           buildMs, acmrBefore, acmrAfter);
+
+    const float distances[2] = { 3.0f, 1.2f };
+    for(int d = 0; d < 2; d++) {
+        size_t meshletsSeen = 0, meshletsCulled = 0, trianglesSeen = 0, trianglesCulled = 0, ranges = 0;
+        double cullMs = 0;
+
+        for(int view = 0; view < VIEWS; view++) {
+            float angle = 2 * 3.14159265f * view / VIEWS;
+            float eye[3] = {
+                center[0] + radius * distances[d] * cosf(angle),
+                center[1] + radius * distances[d] * 0.5f,
+                center[2] + radius * distances[d] * sinf(angle)
+            };
+
+            float projection[16], view4[16], mvp[16];
+            perspective(FOV, 1.0f, 0.01f * radius, 100 * radius, projection);
+            lookAt(eye, center, view4);
+            multiply(projection, view4, mvp);
+
+            CullCamera camera;
+            extractFrustumPlanes(mvp, camera.planes);
+            for(int k = 0; k < 3; k++) camera.position[k] = eye[k];
+
+            std::vector<IndexRange> visible;
+            MeshletCullStats stats = cullMeshlets(meshlets.data(), meshlets.size(), camera, &visible);
+
+            start = Clock::now();
+            for(int r = 0; r < REPEATS; r++) cullMeshlets(meshlets.data(), meshlets.size(), camera, &visible);
+            cullMs += millisecondsSince(start) / REPEATS;
+
+            meshletsSeen += stats.meshlets;
+            meshletsCulled += stats.culledMeshlets;
+            trianglesSeen += stats.triangles;
+            trianglesCulled += stats.culledTriangles;
+            ranges += visible.size();
+        }
+
+        printf("  camera at %.1fx radius: culled %.1f%% of meshlets, %.1f%% of triangles, "
+               "%.1f draw ranges, %.1f us per cull\n", distances[d],
+               100.0 * meshletsCulled / meshletsSeen, 100.0 * trianglesCulled / trianglesSeen,
+               (double)ranges / VIEWS, cullMs * 1000 / VIEWS);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Mesh sphere;
+    makeSphere(256, &sphere);
+    run("sphere", sphere);
+
+    Mesh terrain;
+    makeTerrain(256, &terrain);
+    run("terrain", terrain);
+
+    const char *defaultPaths[] = { "jason.obj" };
+    const char *const *paths = argc > 1 ? argv + 1 : defaultPaths;
+    const int pathCount = argc > 1 ? argc - 1 : 1;
+
+    for(int i = 0; i < pathCount; i++) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, paths[i])) {
+            printf("%s: failed to load\n", paths[i]);
+            continue;
+        }
+
+        std::vector<Mesh> shapeMeshes;
+        buildMeshes(attrib, shapes, &shapeMeshes);
+        Mesh mesh;
+        mergeMeshes(shapeMeshes, &mesh);
+        if(mesh.indices.empty()) continue;
+        run(paths[i], mesh);
+    }
+
+    return 0;
+}
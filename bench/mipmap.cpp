@@ -0,0 +1,218 @@
+/* mipmap.cpp
+ * Mip chain filter benchmark.
+ *
+ * Builds the full chain of a side x side RGBA8 image of noise over
+ * gradients (2048 by default) with the box, Kaiser and Lanczos filters,
+ * averaging as stored and in linear light, on 1, 2, 4, 8 and one per
+ * hardware thread.  Reports the fastest build of each in megapixels of
+ * level 0 per second.
+ *
+ * Before that, checks that every filter keeps a flat image flat at every
+ * level, in both modes, for sizes that aren't powers of two too; that the
+ * box filter averaging as stored gives exactly the rounded 2x2 integer
+ * average, and in linear light is within one of the same averaged in
+ * doubles with pow(); and that every thread count gives the same bytes.
+ * Exits with 1 if not.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude bench/mipmap.cpp src/mipmap.cpp -o mipmap
+ *   ./mipmap [side]
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "mipmap.h"
+
+
+static const int REPEATS = 5; // builds per setting, the fastest counts
+static const unsigned THREAD_COUNTS[] = { 1, 2, 4, 8, 0 };
+static const MipFilter FILTERS[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS };
+static const char *FILTER_NAMES[] = { "box", "Kaiser", "Lanczos" };
+
+typedef std::chrono::steady_clock Clock;
+
+static MipOptions makeOptions(MipFilter filter, bool srgb, unsigned numThreads)
+{
+    MipOptions options;
+    options.filter = filter;
+    options.srgb = srgb;
+    options.numThreads = numThreads;
+    return options;
+}
+
+// gradients with noise on top, so the filters have edges and detail to work on
+static std::vector<uint8_t> makeImage(unsigned width, unsigned height, uint32_t seed)
+{
+    std::vector<uint8_t> rgba((size_t)width * height * 4);
+    for(unsigned y = 0; y < height; y++) {
+        for(unsigned x = 0; x < width; x++) {
+            uint8_t *p = &rgba[((size_t)y * width + x) * 4];
+            seed = seed * 1664525u + 1013904223u;
+            p[0] = (uint8_t)(x * 255 / width);
+            p[1] = (uint8_t)(y * 255 / height);
+            p[2] = (uint8_t)(seed >> 24);
+            p[3] = (x / 8 + y / 8) % 2 ? 255 : (uint8_t)(seed >> 16);
+        }
+    }
+    return rgba;
+}
+
+static double srgbToLinear(double c)
+{
+    return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+static double linearToSrgb(double l)
+{
+    return l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1 / 2.4) - 0.055;
+}
+
+static bool checkFlat()
+{
+    const unsigned sizes[][2] = { { 64, 64 }, { 37, 19 }, { 1, 13 }, { 100, 3 } };
+    const uint8_t colors[][4] = { { 0, 0, 0, 0 }, { 255, 255, 255, 255 }, { 1, 128, 254, 7 } };
+    bool ok = true;
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for(size_t c = 0; c < sizeof(colors) / sizeof(colors[0]); c++) {
+            const unsigned w = sizes[s][0], h = sizes[s][1];
+            std::vector<uint8_t> image((size_t)w * h * 4);
+            for(size_t i = 0; i < image.size(); i++) image[i] = colors[c][i % 4];
+            for(size_t f = 0; f < sizeof(FILTERS) / sizeof(FILTERS[0]); f++) {
+                for(int srgb = 0; srgb < 2; srgb++) {
+                    std::vector<MipLevel> levels;
+                    std::vector<uint8_t> pixels;
+                    buildMipChain(image.data(), w, h, makeOptions(FILTERS[f], srgb != 0, 1), &levels, &pixels);
+                    for(size_t i = 0; i < pixels.size(); i++) {
+                        if(pixels[i] != colors[c][i % 4]) {
+                            printf("%s%s: %ux%u flat image isn't flat at byte %zu\n", FILTER_NAMES[f],
+                                   srgb ? ", sRGB" : "", w, h, i);
+                            ok = false;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static bool checkBox()
+{
+    const unsigned side = 256;
+    std::vector<uint8_t> image = makeImage(side, side, 7);
+    bool ok = true;
+    for(int srgb = 0; srgb < 2; srgb++) {
+        std::vector<MipLevel> levels;
+        std::vector<uint8_t> pixels;
+        buildMipChain(image.data(), side, side, makeOptions(MIP_FILTER_BOX, srgb != 0, 1), &levels, &pixels);
+
+        int worst = 0;
+        for(size_t l = 1; l < levels.size(); l++) {
+            const uint8_t *above = &pixels[levels[l - 1].offset], *level = &pixels[levels[l].offset];
+            const unsigned w = levels[l].width, aw = levels[l - 1].width;
+            for(unsigned y = 0; y < levels[l].height; y++) {
+                for(unsigned x = 0; x < w; x++) {
+                    for(int c = 0; c < 4; c++) {
+                        const uint8_t *p = above + ((size_t)y * 2 * aw + x * 2) * 4 + c;
+                        const uint8_t block[4] = { p[0], p[4], p[aw * 4], p[aw * 4 + 4] };
+                        int expected;
+                        if(srgb && c < 3) {
+                            double sum = 0;
+                            for(int k = 0; k < 4; k++) sum += srgbToLinear(block[k] / 255.0);
+                            expected = (int)floor(linearToSrgb(sum / 4) * 255 + 0.5);
+                        } else {
+                            expected = (block[0] + block[1] + block[2] + block[3] + 2) / 4;
+                        }
+                        int difference = abs(level[((size_t)y * w + x) * 4 + c] - expected);
+                        if(difference > worst) worst = difference;
+                    }
+                }
+            }
+        }
+
+        // as stored it has to be exact
+        const int allowed = srgb ? 1 : 0;
+        printf("box%s: at most %d off the reference\n", srgb ? ", sRGB" : "", worst);
+        ok = ok && worst <= allowed;
+    }
+    return ok;
+}
+
+static bool checkThreads()
+{
+    std::vector<uint8_t> image = makeImage(1001, 517, 3);
+    bool ok = true;
+    for(size_t f = 0; f < sizeof(FILTERS) / sizeof(FILTERS[0]); f++) {
+        for(int srgb = 0; srgb < 2; srgb++) {
+            std::vector<MipLevel> levels;
+            std::vector<uint8_t> serial, pixels;
+            buildMipChain(image.data(), 1001, 517, makeOptions(FILTERS[f], srgb != 0, 1), &levels, &serial);
+            for(size_t t = 1; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+                buildMipChain(image.data(), 1001, 517, makeOptions(FILTERS[f], srgb != 0, THREAD_COUNTS[t]), &levels, &pixels);
+                if(pixels != serial) {
+                    printf("%s%s: %u threads differ from 1\n", FILTER_NAMES[f], srgb ? ", sRGB" : "", THREAD_COUNTS[t]);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// fastest of REPEATS builds, in megapixels of level 0 per second
+static double buildRate(const std::vector<uint8_t> &image, unsigned side, const MipOptions &options)
+{
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t> pixels;
+    double best = 1e30;
+    for(int i = 0; i < REPEATS; i++) {
+        Clock::time_point start = Clock::now();
+        buildMipChain(image.data(), side, side, options, &levels, &pixels);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if(seconds < best) best = seconds;
+    }
+    return (double)side * side / best / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned side = argc > 1 ? (unsigned)atoi(argv[1]) : 2048;
+    if(side == 0) {
+        printf("usage: mipmap [side]\n");
+        return 1;
+    }
+
+    bool ok = checkFlat();
+    ok = checkBox() && ok;
+    ok = checkThreads() && ok;
+    printf("checks %s\n\n", ok ? "passed" : "FAILED");
+
+    std::vector<uint8_t> image = makeImage(side, side, 1);
+    printf("%ux%u, %u levels, Mpixel/s\n%-18s", side, side, mipLevelCount(side, side), "");
+    for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+        if(THREAD_COUNTS[t]) printf(" %5u thr", THREAD_COUNTS[t]);
+        else printf("   all thr");
+    }
+    printf("\n");
+    for(size_t f = 0; f < sizeof(FILTERS) / sizeof(FILTERS[0]); f++) {
+        for(int srgb = 0; srgb < 2; srgb++) {
+            char name[32];
+            snprintf(name, sizeof(name), "%s%s", FILTER_NAMES[f], srgb ? ", sRGB" : "");
+            printf("%-18s", name);
+            for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+                printf(" %9.1f", buildRate(image, side, makeOptions(FILTERS[f], srgb != 0, THREAD_COUNTS[t])));
+                fflush(stdout);
+            }
+            printf("\n");
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+/* normals.cpp
+ * Normal and tangent generation benchmark.
+ *
+ * Generates normals and tangents for a million-triangle synthetic sphere,
+ * and normals for any .obj files given on the command line (jason.obj by
+ * default) with their own normals stripped, on 1, 2, 4 and 8 threads.
+ * Reports the time taken, whether every thread count gave the same bits,
+ * and for the .obj files how far the result is from the file's normals.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude bench/normals.cpp src/normals.cpp
+ *       src/mesh.cpp src/tiny_obj_loader.cpp -o normals
+ *   ./normals [file.obj ...]
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "mesh.h"
+#include "normals.h"
+
+
+static const unsigned THREAD_COUNTS[] = { 1, 2, 4, 8 };
+static const int REPEATS = 5; // runs per thread count, the fastest counts
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// bumpy unit sphere with a texcoord seam where u wraps, normals left zero;
+// groups joins the seam's two copies of each vertex
+static void makeSphere(int segments, Mesh *mesh, std::vector<uint32_t> *groups)
+{
+    const int rings = segments / 2;
+    for(int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for(int s = 0; s <= segments; s++) {
+            float phi = 2 * 3.14159265f * s / segments;
+            float bump = 1 + 0.02f * sinf(phi * 24) * sinf(theta * 18);
+            Vertex v = {};
+            v.position[0] = sinf(theta) * cosf(phi) * bump;
+            v.position[1] = cosf(theta) * bump;
+            v.position[2] = sinf(theta) * sinf(phi) * bump;
+            v.texcoord[0] = (float)s / segments;
+            v.texcoord[1] = (float)r / rings;
+            mesh->vertices.push_back(v);
+            groups->push_back(r * segments + s % segments);
+        }
+    }
+    for(int r = 0; r < rings; r++) {
+        for(int s = 0; s < segments; s++) {
+            uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+            uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            mesh->indices.insert(mesh->indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+static bool sameNormals(const Mesh &a, const Mesh &b)
+{
+    for(size_t i = 0; i < a.vertices.size(); i++) {
+        if(memcmp(a.vertices[i].normal, b.vertices[i].normal, sizeof(a.vertices[i].normal)) != 0) return false;
+    }
+    return true;
+}
+
+static void runSphere()
+{
+    Mesh base;
+    std::vector<uint32_t> groups;
+    makeSphere(1000, &base, &groups);
+    size_t groupCount = 0;
+    for(size_t i = 0; i < groups.size(); i++) {
+        if(groups[i] >= groupCount) groupCount = groups[i] + 1;
+    }
+    printf("sphere: %zu triangles, %zu vertices\n", base.indices.size() / 3, base.vertices.size());
+
+    Mesh reference;
+    std::vector<float> referenceTangents;
+    for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+        double normalMs = 1e30, tangentMs = 1e30;
+        Mesh mesh;
+        std::vector<float> tangents;
+        for(int r = 0; r < REPEATS; r++) {
+            mesh = base;
+            Clock::time_point start = Clock::now();
+            generateNormals(&mesh, groups.data(), groupCount, THREAD_COUNTS[t]);
+            normalMs = fmin(normalMs, millisecondsSince(start));
+
+            start = Clock::now();
+            generateTangents(mesh, &tangents, THREAD_COUNTS[t]);
+            tangentMs = fmin(tangentMs, millisecondsSince(start));
+        }
+
+        if(t == 0) {
+            reference = mesh;
+            referenceTangents = tangents;
+        }
+        bool same = sameNormals(mesh, reference) && tangents == referenceTangents;
+        printf("  %u threads: normals %.1f ms, tangents %.1f ms, %s\n", THREAD_COUNTS[t],
+               normalMs, tangentMs, same ? "same bits" : "DIFFERENT BITS");
+    }
+}
+
+static void runObj(const char *path)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) {
+        printf("%s: failed to load\n", path);
+        return;
+    }
+
+    std::vector<Mesh> shapeMeshes;
+    buildMeshes(attrib, shapes, &shapeMeshes);
+    Mesh original;
+    mergeMeshes(shapeMeshes, &original);
+
+    // the same corners without normals, all smooth, so vertices line up
+    // with the original's as long as its normals didn't split any
+    std::vector<tinyobj::shape_t> stripped = shapes;
+    for(size_t s = 0; s < stripped.size(); s++) {
+        for(size_t i = 0; i < stripped[s].mesh.indices.size(); i++) stripped[s].mesh.indices[i].normal_index = -1;
+        stripped[s].mesh.smoothing_group_ids.assign(stripped[s].mesh.smoothing_group_ids.size(), 1);
+    }
+
+    printf("%s: %zu triangles\n", path, original.indices.size() / 3);
+
+    Mesh reference;
+    for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+        double ms = 1e30;
+        Mesh mesh;
+        for(int r = 0; r < REPEATS; r++) {
+            Clock::time_point start = Clock::now();
+            buildMeshes(attrib, stripped, &shapeMeshes, THREAD_COUNTS[t]);
+            mergeMeshes(shapeMeshes, &mesh);
+            ms = fmin(ms, millisecondsSince(start));
+        }
+
+        if(t == 0) reference = mesh;
+        printf("  %u threads: welded with normals in %.1f ms, %s\n", THREAD_COUNTS[t], ms,
+               sameNormals(mesh, reference) ? "same bits" : "DIFFERENT BITS");
+    }
+
+    if(reference.vertices.size() != original.vertices.size()) {
+        printf("  the file's normals split vertices, not comparing\n");
+        return;
+    }
+
+    double sum = 0, worst = 0;
+    size_t compared = 0;
+    for(size_t i = 0; i < original.vertices.size(); i++) {
+        const float *a = original.vertices[i].normal, *b = reference.vertices[i].normal;
+        float la = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+        if(la == 0) continue;
+        float c = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / la;
+        double degrees = acos(c < -1 ? -1 : c > 1 ? 1 : c) * 180 / 3.14159265;
+        sum += degrees;
+        worst = fmax(worst, degrees);
+        compared++;
+    }
+    if(compared) printf("  against the file's normals: %.2f degrees on average, %.2f at worst\n", sum / compared, worst);
+}
+
+int main(int argc, char **argv)
+{
+    runSphere();
+
+    const char *defaultPaths[] = { "jason.obj" };
+    const char *const *paths = argc > 1 ? argv + 1 : defaultPaths;
+    const int pathCount = argc > 1 ? argc - 1 : 1;
+    for(int i = 0; i < pathCount; i++) runObj(paths[i]);
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+/* ply.cpp
+ * Binary PLY against .obj loading of the same meshes.
+ *
+ * Writes a generated sphere of about a million triangles as .obj text and
+ * as little and big endian binary PLY.  Any .obj files given on the command
+ * line (jason.obj by default) are welded and written out as PLY too.  Then
+ * each file is loaded into a Mesh: the .obj with LoadObj(), buildMeshes()
+ * and mergeMeshes(), the PLY with loadPly().  Reports file sizes and the
+ * fastest load times.  Exits with 1 unless every PLY load gives the same
+ * triangles, corner by corner, as the .obj it came from.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude bench/ply.cpp src/mappedfile.cpp
+ *       src/mesh.cpp src/normals.cpp src/plyload.cpp
+ *       src/tiny_obj_loader.cpp -o ply
+ *   ./ply [file.obj ...]
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "plyload.h"
+
+
+static const int REPEATS = 5; // loads per file, the fastest counts
+static const int SPHERE_RINGS = 512, SPHERE_SEGMENTS = 1024;
+
+typedef std::chrono::steady_clock Clock;
+
+// a UV sphere of rings x segments quads, split into triangles, with normals
+static void makeSphere(Mesh *mesh)
+{
+    for(int r = 0; r <= SPHERE_RINGS; r++) {
+        float theta = 3.14159265f * r / SPHERE_RINGS;
+        for(int s = 0; s <= SPHERE_SEGMENTS; s++) {
+            float phi = 6.2831853f * s / SPHERE_SEGMENTS;
+            Vertex v;
+            v.normal[0] = sinf(theta) * cosf(phi);
+            v.normal[1] = cosf(theta);
+            v.normal[2] = sinf(theta) * sinf(phi);
+            for(int k = 0; k < 3; k++) v.position[k] = v.normal[k] * 2;
+            v.texcoord[0] = (float)s / SPHERE_SEGMENTS;
+            v.texcoord[1] = (float)r / SPHERE_RINGS;
+            mesh->vertices.push_back(v);
+        }
+    }
+
+    for(int r = 0; r < SPHERE_RINGS; r++) {
+        for(int s = 0; s < SPHERE_SEGMENTS; s++) {
+            uint32_t a = r * (SPHERE_SEGMENTS + 1) + s, b = a + 1, c = b + SPHERE_SEGMENTS + 1, d = a + SPHERE_SEGMENTS + 1;
+            uint32_t triangles[6] = { a, b, c, a, c, d };
+            mesh->indices.insert(mesh->indices.end(), triangles, triangles + 6);
+        }
+    }
+    mesh->materialIds.assign(mesh->indices.size() / 3, -1);
+}
+
+// .obj text with one v, vt and vn per vertex; %.9g gives back the same floats
+static bool writeObj(const char *path, const Mesh &mesh)
+{
+    FILE *fp = fopen(path, "w");
+    if(!fp) return false;
+    for(size_t i = 0; i < mesh.vertices.size(); i++) {
+        const Vertex &v = mesh.vertices[i];
+        fprintf(fp, "v %.9g %.9g %.9g\nvt %.9g %.9g\nvn %.9g %.9g %.9g\n", v.position[0], v.position[1], v.position[2],
+                v.texcoord[0], v.texcoord[1], v.normal[0], v.normal[1], v.normal[2]);
+    }
+    for(size_t i = 0; i < mesh.indices.size(); i += 3) {
+        unsigned a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+        fprintf(fp, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+    }
+    return fclose(fp) == 0;
+}
+
+// appends n bytes at p in the file's byte order
+static void putBytes(std::vector<unsigned char> *out, const void *p, size_t n, bool bigEndian)
+{
+    const unsigned char *bytes = (const unsigned char *)p;
+    const uint16_t one = 1;
+    const bool swap = bigEndian == (*(const unsigned char *)&one == 1);
+    for(size_t i = 0; i < n; i++) out->push_back(bytes[swap ? n - 1 - i : i]);
+}
+
+// binary PLY of float x, y, z, nx, ny, nz, u, v and uchar-counted int faces
+static bool writePly(const char *path, const Mesh &mesh, bool bigEndian)
+{
+    std::vector<unsigned char> data;
+    char header[512];
+    int n = snprintf(header, sizeof(header),
+                     "ply\nformat %s 1.0\ncomment written by bench/ply.cpp\n"
+                     "element vertex %zu\nproperty float x\nproperty float y\nproperty float z\n"
+                     "property float nx\nproperty float ny\nproperty float nz\n"
+                     "property float u\nproperty float v\n"
+                     "element face %zu\nproperty list uchar int vertex_indices\nend_header\n",
+                     bigEndian ? "binary_big_endian" : "binary_little_endian",
+                     mesh.vertices.size(), mesh.indices.size() / 3);
+    data.insert(data.end(), header, header + n);
+
+    for(size_t i = 0; i < mesh.vertices.size(); i++) {
+        const Vertex &v = mesh.vertices[i];
+        for(int k = 0; k < 3; k++) putBytes(&data, &v.position[k], 4, bigEndian);
+        for(int k = 0; k < 3; k++) putBytes(&data, &v.normal[k], 4, bigEndian);
+        for(int k = 0; k < 2; k++) putBytes(&data, &v.texcoord[k], 4, bigEndian);
+    }
+    for(size_t i = 0; i < mesh.indices.size(); i += 3) {
+        data.push_back(3);
+        for(int k = 0; k < 3; k++) {
+            int32_t index = (int32_t)mesh.indices[i + k];
+            putBytes(&data, &index, 4, bigEndian);
+        }
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if(!fp) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    return fclose(fp) == 0 && ok;
+}
+
+static bool loadObjMesh(const char *path, Mesh *mesh)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) return false;
+
+    std::vector<Mesh> meshes;
+    buildMeshes(attrib, shapes, &meshes);
+    mergeMeshes(meshes, mesh);
+    return true;
+}
+
+// the same triangles, corner by corner, bit for bit
+static bool sameTriangles(const Mesh &a, const Mesh &b)
+{
+    if(a.indices.size() != b.indices.size()) return false;
+    for(size_t i = 0; i < a.indices.size(); i++) {
+        if(memcmp(&a.vertices[a.indices[i]], &b.vertices[b.indices[i]], sizeof(Vertex)) != 0) return false;
+    }
+    return true;
+}
+
+static long fileSize(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if(!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+// fastest of REPEATS loads in milliseconds, keeping the last load in mesh
+template <typename Fn>
+static double timeLoads(Fn load, Mesh *mesh)
+{
+    double best = 1e30;
+    for(int i = 0; i < REPEATS; i++) {
+        Clock::time_point start = Clock::now();
+        if(!load(mesh)) return -1;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if(ms < best) best = ms;
+    }
+    return best;
+}
+
+// writes PLYs of mesh next to objPath's stem in dir, and compares loading them
+// to loading objPath
+static bool compare(const char *name, const std::string &objPath, const Mesh &mesh, const std::string &dir)
+{
+    Mesh objMesh;
+    double objTime = timeLoads([&](Mesh *out) { return loadObjMesh(objPath.c_str(), out); }, &objMesh);
+    if(objTime < 0) {
+        printf("%s: failed to load %s\n", name, objPath.c_str());
+        return false;
+    }
+    printf("%s: %zu vertices, %zu triangles\n", name, objMesh.vertices.size(), objMesh.indices.size() / 3);
+    printf("  %-22s %7.1f MB %8.1f ms\n", ".obj", fileSize(objPath.c_str()) / 1e6, objTime);
+
+    bool ok = true;
+    for(int bigEndian = 0; bigEndian < 2; bigEndian++) {
+        std::string plyPath = dir + "/" + name + (bigEndian ? ".be.ply" : ".le.ply");
+        if(!writePly(plyPath.c_str(), mesh, bigEndian != 0)) {
+            printf("  failed to write %s\n", plyPath.c_str());
+            return false;
+        }
+
+        Mesh plyMesh;
+        std::string err;
+        double plyTime = timeLoads([&](Mesh *out) { return loadPly(plyPath.c_str(), out, &err); }, &plyMesh);
+        bool same = plyTime >= 0 && sameTriangles(objMesh, plyMesh);
+        printf("  %-22s %7.1f MB %8.1f ms  %5.1fx  %s\n", bigEndian ? "PLY, big endian" : "PLY, little endian",
+               fileSize(plyPath.c_str()) / 1e6, plyTime, objTime / plyTime,
+               plyTime < 0 ? err.c_str() : same ? "same triangles" : "DIFFERENT triangles");
+        ok = ok && same;
+        remove(plyPath.c_str());
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    char tmp[] = "/tmp/plyXXXXXX";
+    if(!mkdtemp(tmp)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string dir = tmp;
+    bool ok = true;
+
+    Mesh sphere;
+    makeSphere(&sphere);
+    std::string spherePath = dir + "/sphere.obj";
+    if(!writeObj(spherePath.c_str(), sphere)) {
+        printf("failed to write %s\n", spherePath.c_str());
+        return 1;
+    }
+    ok = compare("sphere", spherePath, sphere, dir) && ok;
+    remove(spherePath.c_str());
+
+    std::vector<const char *> paths(argv + 1, argv + argc);
+    if(paths.empty()) paths.push_back("jason.obj");
+    for(size_t i = 0; i < paths.size(); i++) {
+        Mesh mesh;
+        if(!loadObjMesh(paths[i], &mesh)) {
+            printf("%s: failed to load\n", paths[i]);
+            ok = false;
+            continue;
+        }
+
+        std::string name = paths[i];
+        size_t slash = name.find_last_of('/');
+        if(slash != std::string::npos) name = name.substr(slash + 1);
+        ok = compare(name.c_str(), paths[i], mesh, dir) && ok;
+    }
+
+    rmdir(dir.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/* assetloader.h
+ * Loads assets on worker threads and uploads them on the GL thread.
+ *
+ * A load runs on a worker: file i/o, parsing, decoding, anything that
+ * doesn't touch GL.  It hands back a PendingUpload holding the CPU-side
+ * result, which goes to the GL thread through a lock-free list.  Once a
+ * frame the GL thread calls upload() with a time budget.  That steps
+ * through the pending uploads in the order their loads finished, a piece at
+ * a time, until the budget is spent.  The GL thread never waits for a
+ * worker, so frames keep coming while assets load.
+ */
+
+
+#ifndef __assetloader_h__
+#define __assetloader_h__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/* CPU-side data of a loaded asset, waiting to go to the GPU. */
+class PendingUpload
+{
+public:
+    PendingUpload() : next_(0) {}
+    virtual ~PendingUpload() {}
+
+    /* Called on the GL thread to do the next piece of the upload, small
+     * enough to fit in a frame.  Returns true once it is all done, after
+     * which the upload is deleted; otherwise it is called again, on the
+     * same or a later frame.
+     */
+    virtual bool uploadStep() = 0;
+
+private:
+    friend class AssetLoader;
+    PendingUpload *next_; /* In AssetLoader's list of finished loads */
+};
+
+/* An upload done in one step by calling fn, for results that aren't
+ * uploaded so much as swapped in, like shader sources.
+ */
+class FunctionUpload : public PendingUpload
+{
+public:
+    explicit FunctionUpload(std::function<void()> fn) : fn_(fn) {}
+
+    bool uploadStep() override
+    {
+        fn_();
+        return true;
+    }
+
+private:
+    std::function<void()> fn_;
+};
+
+class AssetLoader
+{
+public:
+    /* Starts numThreads workers (0 = one per hardware thread). */
+    explicit AssetLoader(unsigned numThreads = 0);
+
+    /* Drops loads that haven't started, waits for the running ones and
+     * deletes every upload not yet done.
+     */
+    ~AssetLoader();
+
+    /* Runs load on a worker.  The upload it returns is queued for the GL
+     * thread; it may return null if there's nothing to upload.
+     */
+    void load(std::function<PendingUpload *()> load);
+
+    /* GL thread only.  Steps through pending uploads until budget seconds
+     * have passed or none are left, and returns how many finished.  At
+     * least one step is taken if any upload is pending, so uploads always
+     * make progress.
+     */
+    size_t upload(double budget);
+
+    /* Loads started and not yet uploaded. */
+    size_t pending() const { return pending_.load(); }
+
+private:
+    AssetLoader(const AssetLoader &);
+    AssetLoader &operator=(const AssetLoader &);
+
+    void work();
+    void finished(PendingUpload *upload);
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<PendingUpload *()> > loads_;
+    bool stopping_;
+
+    std::atomic<PendingUpload *> finished_; /* Newest first, pushed by workers */
+    std::deque<PendingUpload *> uploads_;   /* Oldest first, GL thread only */
+    std::atomic<size_t> pending_;
+};
+
+#endif
@@ -30,6 +30,8 @@
 #ifndef __bmpread_h__
 #define __bmpread_h__
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -51,6 +53,27 @@ extern "C"
 /* Load and output an alpha channel (default is just color channels). */
 #define BMPREAD_ALPHA 8u
 
+/* Decode with the plain C decoders even where SIMD ones would be used for
+ * 24- and 32-bit files.  The output is the same either way; this is for
+ * testing and timing them.
+ */
+#define BMPREAD_NO_SIMD 16u
+
+/* By default the pixel data is decoded straight out of a memory mapping of
+ * the file (mmap() or MapViewOfFile()).  Where the file can't be mapped,
+ * it's read a line at a time, unless it's decoded on several threads, which
+ * need it all in memory: then it's read with one fread() into a buffer and
+ * decoded from there.  This flag skips the mapping and always does the
+ * latter.
+ */
+#define BMPREAD_READ_WHOLE 32u
+
+/* Read the pixel data one line at a time instead, with an fread() per line
+ * into a buffer one line long, even where it could be mapped.  Decodes on
+ * just one thread.
+ */
+#define BMPREAD_READ_LINES 64u
+
 
 /* The struct filled by bmpread().  Holds information about the image's pixels.
  */
@@ -78,7 +101,7 @@ typedef struct bmpread_t
      * Lines by default must span a multiple of four bytes.  If the image width
      * and pixel span don't yield a multiple of four (a non-issue for
      * BMPREAD_ALPHA with four bytes per pixel), the end of each line is padded
-     * with up to three unused bytes to meet the requirement.  For example,
+     * with up to three zero bytes to meet the requirement.  For example,
      * each line of an image three pixels wide, loaded without BMPREAD_ALPHA,
      * will span 12 bytes (3 pixels * 3 (RGB) channels per pixel = 9, padded
      * with 3 bytes up to the next multiple of 4).  However, this behavior is
@@ -134,6 +157,96 @@ typedef struct bmpread_t
 int bmpread(const char * bmp_file, unsigned int flags, bmpread_t * p_bmp_out);
 
 
+/* Like bmpread(), but decodes on several threads, for large images.
+ *
+ * Inputs:
+ * bmp_file, flags, p_bmp_out - As for bmpread().
+ * threads - How many threads to decode on, the calling thread included, or 0
+ *           for one per processor.  Each thread decodes its own band of
+ *           lines straight into place in the output, so the result is exactly
+ *           what bmpread() gives.  Fewer threads are used for images too
+ *           small to be worth it, and just one with BMPREAD_READ_LINES or
+ *           where libbmpread was built without threads (it has them on
+ *           POSIX systems and with MinGW).
+ *
+ * Returns:
+ * As for bmpread().
+ */
+int bmpread_parallel(const char * bmp_file,
+                     unsigned int flags,
+                     unsigned int threads,
+                     bmpread_t * p_bmp_out);
+
+
+/* The struct filled by bmpread_info().  Describes the image bmpread() would
+ * load, without loading it.
+ */
+typedef struct bmpread_info_t
+{
+    int width;          /* Width in pixels. */
+    int height;         /* Height in pixels. */
+    unsigned int flags; /* The flags passed to bmpread_info(). */
+
+    /* Bytes each line of data would span, padding included, given flags (see
+     * bmpread_t's data).
+     */
+    size_t line_len;
+
+    /* Bytes bmpread() would allocate for data: line_len * height. */
+    size_t data_len;
+
+} bmpread_info_t;
+
+
+/* Reads just the headers (and palette) of the specified bitmap file, and
+ * fills out a bmpread_info_t struct with what loading it with the same flags
+ * would give.  Use it to size a buffer for bmpread_into().
+ *
+ * Inputs:
+ * bmp_file, flags - As for bmpread().
+ * p_info_out - Pointer to a bmpread_info_t struct to fill with information.
+ *              Nothing in it needs freeing.
+ *
+ * Returns:
+ * 0 if there's an error (file doesn't exist or is invalid, etc.), or nonzero
+ * if the file's headers are ok.  Any error in the pixel data itself, like
+ * the file being cut short, is only found by loading it.
+ */
+int bmpread_info(const char * bmp_file,
+                 unsigned int flags,
+                 bmpread_info_t * p_info_out);
+
+
+/* Like bmpread_parallel(), but decodes into memory the caller provides
+ * instead of allocating it, such as a mapped OpenGL pixel unpack buffer or a
+ * buffer from a pool.  This saves an allocation and a copy per image.
+ *
+ * Inputs:
+ * bmp_file, flags, threads - As for bmpread_parallel().  threads = 1 decodes
+ *                            on just the calling thread, like bmpread().
+ * data - Where the first line of the output goes.
+ * stride - Bytes from the start of one line of output to the next, or 0 for
+ *          the line_len bmpread_info() gives, in which case data ends up
+ *          exactly as bmpread() would give it.  A stride of its own must be
+ *          at least width * pixel span, and nothing between one line's
+ *          pixels and the next line is written, so the image can go
+ *          straight into part of a larger one.
+ * size - Bytes available at data.  Must be at least (height - 1) * stride
+ *        plus one line (line_len with stride 0, or width * pixel span).
+ *
+ * Returns:
+ * 0 if there's an error, including the image not fitting in size bytes, or
+ * nonzero if the file loaded ok.  data may have been partly written on an
+ * error.
+ */
+int bmpread_into(const char * bmp_file,
+                 unsigned int flags,
+                 unsigned int threads,
+                 void * data,
+                 size_t stride,
+                 size_t size);
+
+
 /* Frees memory allocated during bmpread().  Call bmpread_free() when you are
  * done using the bmpread_t struct (e.g. after you have passed the data on to
  * OpenGL).
@@ -0,0 +1,149 @@
+/* bundle.h
+ * Render-ready assets baked offline into one file (tools/bake.cpp).
+ *
+ * File layout (native byte order, like the mesh cache):
+ *   BundleHeader
+ *   BundleAsset[assetCount]
+ *   MeshCacheBlob[blobCount]   table of contents, each asset's blobs together
+ *   blob data                  each blob starts on a BUNDLE_ALIGNMENT
+ *                              boundary, ready to hand to glBufferData
+ *
+ * Meshes hold the mesh cache's blobs (meshcache.h) plus their vertices
+ * already packed and lit, and their indices already narrowed, so main.cpp
+ * uploads them straight from the mapping.  Textures hold a whole RGBA8 mip
+ * chain.
+ *
+ * Assets are looked up by the path they were baked from.  Each records a
+ * hash of its source files and of how it was baked (hashBundleMesh(),
+ * hashBundleTexture()).  The baker only rebakes assets whose hash changed,
+ * and main.cpp skips a mesh whose hash no longer matches its sources,
+ * loading it as if there were no bundle.
+ */
+
+
+#ifndef __bundle_h__
+#define __bundle_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mappedfile.h"
+#include "meshbake.h"
+#include "meshcache.h"
+#include "mipmap.h"
+#include "vertexpack.h"
+
+
+#define BUNDLE_MAGIC "BNDL"
+#define BUNDLE_VERSION 1u
+#define BUNDLE_ALIGNMENT 16u
+#define BUNDLE_NAME_SIZE 64u
+
+enum BundleAssetType
+{
+    BUNDLE_MESH    = 1,
+    BUNDLE_TEXTURE = 2
+};
+
+/* Blob ids besides the mesh cache's, which meshes also use.  Readers ignore
+ * ids they don't know.
+ */
+enum BundleBlobId
+{
+    BUNDLE_MESH_INFO       = 16, /* BundleMeshInfo */
+    BUNDLE_PACKED_VERTICES = 17, /* PackedVertex (vertexpack.h) per vertex */
+    BUNDLE_INDICES16       = 18, /* uint16 per index, if they all fit */
+    BUNDLE_TEXTURE_INFO    = 32, /* BundleTextureInfo, then a MipLevel
+                                    (mipmap.h) per level */
+    BUNDLE_TEXTURE_PIXELS  = 33  /* RGBA8, every level, bottom row first */
+};
+
+struct BundleHeader
+{
+    char     magic[4]; /* BUNDLE_MAGIC */
+    uint32_t version;  /* BUNDLE_VERSION */
+    uint32_t assetCount;
+    uint32_t blobCount;
+};
+
+struct BundleAsset
+{
+    char     name[BUNDLE_NAME_SIZE]; /* Source path, null terminated */
+    uint32_t type;                   /* BundleAssetType */
+    uint32_t firstBlob;              /* Its blobs in the table of contents */
+    uint32_t blobCount;
+    uint32_t reserved;
+    uint64_t sourceHash; /* Of its sources and how they were baked */
+};
+
+/* How a mesh's packed vertices were made. */
+struct BundleMeshInfo
+{
+    PositionQuantization quant;
+    float light[3]; /* Light position the vertex distances are to */
+    uint32_t reserved;
+};
+
+struct BundleTextureInfo
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t srgb; /* Nonzero if the levels were averaged as sRGB (mipmap.h) */
+};
+
+/* An asset handed to writeBundle(). */
+struct BundleAssetData
+{
+    const char *name;
+    uint32_t type;
+    uint64_t sourceHash;
+    const MeshCacheBlobData *blobs;
+    size_t blobCount;
+};
+
+/* A mapped, validated bundle.  Pointers into it stay valid while the Bundle
+ * is open.
+ */
+class Bundle
+{
+public:
+    /* Maps path.  Returns false if it is missing, malformed or of another
+     * version.
+     */
+    bool open(const char *path);
+    void close() { file_.close(); }
+
+    size_t assetCount() const;
+    const BundleAsset *asset(size_t i) const;
+
+    /* The asset baked from name, or null. */
+    const BundleAsset *findAsset(const char *name) const;
+
+    /* Returns asset's blob with the given id and stores its size in bytes,
+     * or returns null if it has no such blob.
+     */
+    const void *blob(const BundleAsset *asset, uint32_t id, size_t *size) const;
+
+private:
+    MappedFile file_;
+};
+
+/* Writes a bundle of the given assets, under a temporary name and then
+ * renamed into place like writeMeshCache().  Returns false on any i/o error
+ * or if a name doesn't fit in BUNDLE_NAME_SIZE.
+ */
+bool writeBundle(const char *path, const BundleAssetData *assets, size_t assetCount);
+
+/* BundleAsset::sourceHash of a mesh: of the .obj or .ply at meshPath, the
+ * .mtl files an .obj names, the options it was baked with and the light its
+ * vertices were lit from.  A missing file counts as empty.
+ */
+uint64_t hashBundleMesh(const char *meshPath, const MeshBakeOptions &options, const float light[3]);
+
+/* BundleAsset::sourceHash of a texture: of the .bmp at path and the options
+ * its mip chain was built with.
+ */
+uint64_t hashBundleTexture(const char *path, const MipOptions &options);
+
+#endif
@@ -0,0 +1,52 @@
+/* filewatch.h
+ * Reports files that changed on disk, for hot reloading.
+ *
+ * On Linux this uses inotify on each watched file's directory rather than
+ * on the file itself: editors often save by writing a new file and renaming
+ * it over the old one, which would end a watch on the file.  Elsewhere it
+ * compares modification times and sizes on each poll.
+ */
+
+
+#ifndef __filewatch_h__
+#define __filewatch_h__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    /* Starts watching path, which needn't exist yet.  Watching a path twice
+     * is the same as once.  Returns false if it can't be watched.
+     */
+    bool watch(const std::string &path);
+
+    /* Appends each watched path that changed since the last call, once.
+     * Never blocks, so it can be called every frame.
+     */
+    void poll(std::vector<std::string> *changed);
+
+private:
+    FileWatcher(const FileWatcher &);
+    FileWatcher &operator=(const FileWatcher &);
+
+    struct Entry
+    {
+        std::string path;
+        std::string dir, name; /* path split at its last slash */
+        int wd;                /* inotify watch of dir */
+        int64_t mtime, size;   /* at the last poll, without inotify */
+    };
+
+    std::vector<Entry> entries_;
+    int fd_; /* inotify instance, -1 without */
+};
+
+#endif
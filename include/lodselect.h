@@ -0,0 +1,60 @@
+/* lodselect.h
+ * Picks which level of detail to draw from how large its error looks on
+ * screen.
+ *
+ * A LOD's error is a distance in model units (simplify.h).  Seen from the
+ * camera it covers error / distance * pixelScale pixels, taking the near
+ * side of the part's bounding sphere as the distance.  The coarsest LOD
+ * under a pixel threshold is drawn.  Going coarser takes a margin below the
+ * threshold, so a part sitting near a switching distance doesn't pop back
+ * and forth.
+ */
+
+
+#ifndef __lodselect_h__
+#define __lodselect_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+#include "simplify.h"
+
+
+/* A drawable part's bounds and the level it was last drawn at. */
+struct LodState
+{
+    float center[3];
+    float radius;
+    unsigned level; /* 0 for full detail, else lods[level - 1] */
+};
+
+/* Triangles drawn in a frame, and how many full detail would have drawn. */
+struct LodStats
+{
+    size_t triangles;
+    size_t availableTriangles;
+};
+
+/* Sets state to a bounding sphere of the triangles in indices, at full
+ * detail.
+ */
+void initLodState(const uint32_t *indices, size_t indexCount,
+                  const Vertex *vertices, LodState *state);
+
+/* Pixels covered by one model unit at distance 1, for a column-major
+ * perspective projection (as glm::value_ptr() gives) drawn viewportHeight
+ * pixels high.
+ */
+float lodPixelScale(const float *projection, float viewportHeight);
+
+/* Picks the level of state to draw from lods, finest first, as seen from
+ * eye (model space), stores it in state and returns it.  A level qualifies
+ * if its error covers at most threshold pixels, or threshold * (1 -
+ * hysteresis) if it is coarser than the current one.
+ */
+unsigned selectLod(LodState *state, const MeshLod *lods, size_t lodCount,
+                   const float *eye, float pixelScale,
+                   float threshold, float hysteresis);
+
+#endif
@@ -0,0 +1,46 @@
+/* mappedfile.h
+ * Read-only memory mapping of a whole file.
+ */
+
+
+#ifndef __mappedfile_h__
+#define __mappedfile_h__
+
+#include <stddef.h>
+
+
+/* Maps a file read-only into memory.  The mapping is hinted for sequential
+ * access so the OS reads ahead.  Empty files open successfully with a null
+ * data() and size() 0.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /* Maps the file, closing any previous mapping.  Returns false if the file
+     * doesn't exist or can't be mapped.
+     */
+    bool open(const char *path);
+    void close();
+
+    const unsigned char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return open_; }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const unsigned char *data_;
+    size_t size_;
+    bool open_;
+
+#ifdef _WIN32
+    void *file_;
+    void *mapping_;
+#endif
+};
+
+#endif
@@ -0,0 +1,101 @@
+/* mesh.h
+ * Renderable meshes built from parsed .obj data.
+ *
+ * An .obj face corner indexes positions, texcoords and normals separately.
+ * OpenGL wants a single index per vertex, so each distinct (v, vt, vn) triple
+ * becomes one interleaved Vertex and corners sharing a triple share it.
+ */
+
+
+#ifndef __mesh_h__
+#define __mesh_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+
+struct Vertex
+{
+    float position[3];
+    float normal[3];   /* generated if the corner has no normal */
+    float texcoord[2]; /* zero if the corner has no texcoord */
+};
+
+struct Mesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;      /* three per triangle */
+    std::vector<int32_t> materialIds;   /* one per triangle, -1 for none */
+};
+
+/* A run of triangles sharing a material, drawn with one call. */
+struct MeshBatch
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t meshletOffset; /* Its meshlets, if the mesh was split into */
+    uint32_t meshletCount;  /* them (meshlet.h) */
+    uint32_t lodOffset;     /* Its simplified versions, if any were built */
+    uint32_t lodCount;      /* (MeshLod in simplify.h), finest first */
+    int32_t material;       /* Index into the .obj's materials, -1 for none */
+    float diffuse[3];       /* The material's Kd, white for none */
+};
+
+/* Hash and equality of (v, vt, vn) triples, for welding. */
+inline uint32_t hashObjIndex(const tinyobj::index_t &idx)
+{
+    uint32_t h = (uint32_t)idx.vertex_index * 0x9e3779b1u;
+    h ^= (uint32_t)idx.texcoord_index * 0x85ebca77u;
+    h ^= (uint32_t)idx.normal_index * 0xc2b2ae3du;
+    return h ^ (h >> 15);
+}
+
+inline bool sameObjIndex(const tinyobj::index_t &a, const tinyobj::index_t &b)
+{
+    return a.vertex_index == b.vertex_index &&
+           a.texcoord_index == b.texcoord_index &&
+           a.normal_index == b.normal_index;
+}
+
+/* Welds one shape into mesh, replacing its contents.  Vertices are numbered
+ * in order of first use.  The shape must be triangulated, as LoadObj() does
+ * by default.  Corners without a normal get one generated (normals.h):
+ * smooth across faces of the same smoothing group, flat where smoothing is
+ * off, using up to numThreads threads (0 = one per hardware thread).
+ */
+void buildMesh(const tinyobj::attrib_t &attrib, const tinyobj::shape_t &shape,
+               Mesh *mesh, unsigned numThreads = 0);
+
+/* buildMesh() for every shape, one mesh per shape, spread over up to
+ * numThreads threads (0 = one per hardware thread).
+ */
+void buildMeshes(const tinyobj::attrib_t &attrib,
+                 const std::vector<tinyobj::shape_t> &shapes,
+                 std::vector<Mesh> *meshes, unsigned numThreads = 0);
+
+/* Concatenates meshes into out, offsetting indices. */
+void mergeMeshes(const std::vector<Mesh> &meshes, Mesh *out);
+
+/* Reorders the triangles of mesh so each material's are contiguous, in
+ * material order with the triangles without one first, and stores one batch
+ * per material used in batches.  Triangles keep their order within a
+ * material.  Material ids past the end of materials count as none.
+ */
+void groupByMaterial(Mesh *mesh, const std::vector<tinyobj::material_t> &materials,
+                     std::vector<MeshBatch> *batches);
+
+/* True if every index of a mesh with vertexCount vertices fits in 16 bits. */
+inline bool fitsIndices16(size_t vertexCount)
+{
+    return vertexCount <= 65536;
+}
+
+/* Copies indices into out as 16-bit values.  Only valid if fitsIndices16(). */
+void narrowIndices(const uint32_t *indices, size_t count,
+                   std::vector<uint16_t> *out);
+
+#endif
@@ -0,0 +1,85 @@
+/* meshbake.h
+ * Turns an .obj into the render-ready mesh main.cpp draws: welded, batched
+ * by material, optimized and split into meshlets and LODs.
+ *
+ * main.cpp runs this when it has no cached or bundled copy of its mesh, and
+ * the offline baker (tools/bake.cpp) runs it for every mesh it bundles.
+ * Binary PLY files go through the same steps after plyload.h.
+ */
+
+
+#ifndef __meshbake_h__
+#define __meshbake_h__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "meshlet.h"
+#include "meshopt.h"
+#include "simplify.h"
+
+
+struct MeshBakeOptions
+{
+    /* Reorder each material's triangles and the vertices for the vertex
+     * cache and overdraw, split them into meshlets and simplify them into
+     * LODs.  Without it the mesh is only welded and batched.
+     */
+    bool optimize;
+    const float *lodRatios; /* Fraction of the triangles each LOD keeps */
+    size_t lodCount;
+    unsigned numThreads;    /* 0 = one per hardware thread */
+};
+
+/* Everything drawn from one .obj.  The indices of every LOD follow the full
+ * detail ones in mesh.indices.
+ */
+struct BakedMesh
+{
+    Mesh mesh;
+    std::vector<MeshBatch> batches;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> lods; /* lodCount per batch, finest first */
+};
+
+/* Vertex cache and overdraw of the full detail triangles, before and after
+ * optimizing.  All zero if options.optimize was off.
+ */
+struct MeshBakeStats
+{
+    VertexCacheStats cacheBefore, cacheAfter;
+    OverdrawStats overdrawBefore, overdrawAfter;
+};
+
+/* Optimized, with the LODs main.cpp has always built. */
+MeshBakeOptions defaultMeshBakeOptions();
+
+/* Loads objPath and its materials and bakes it into out.  Returns false and
+ * sets err if it can't be loaded; warn gets tinyobj's warnings.  stats may
+ * be null.
+ */
+bool bakeObj(const char *objPath, const MeshBakeOptions &options,
+             BakedMesh *out, MeshBakeStats *stats,
+             std::string *warn, std::string *err);
+
+/* bakeObj() for a binary PLY file (plyload.h).  PLY has no materials, so
+ * the mesh is a single white batch.
+ */
+bool bakePly(const char *plyPath, const MeshBakeOptions &options,
+             BakedMesh *out, MeshBakeStats *stats, std::string *err);
+
+/* bakePly() for paths ending in .ply, any case, else bakeObj(). */
+bool bakeMeshFile(const char *path, const MeshBakeOptions &options,
+                  BakedMesh *out, MeshBakeStats *stats,
+                  std::string *warn, std::string *err);
+
+/* Appends the .mtl files named on the mtllib lines of an .obj whose
+ * contents are obj, with the .obj's directory prepended as LoadObj() does.
+ */
+void findMaterialLibraries(const char *objPath, const void *obj, size_t size,
+                           std::vector<std::string> *mtlPaths);
+
+#endif
@@ -0,0 +1,120 @@
+/* meshcache.h
+ * Binary cache of parsed mesh data, so a source .obj is only parsed once.
+ *
+ * File layout (native byte order, the cache is a local build artifact):
+ *   MeshCacheHeader
+ *   MeshCacheSource[sourceCount] the files it was made from, the mesh first
+ *   MeshCacheBlob[blobCount]     table of contents
+ *   blob data                    each blob starts on a MESHCACHE_ALIGNMENT
+ *                                boundary, ready to hand to glBufferData
+ *
+ * A cache is valid while it was made with the same options and every
+ * source file has the recorded size and modification time.  When a source
+ * is newer, its content hash decides: a touched-but-identical file keeps
+ * the cache, and the cache takes its new time so it isn't hashed again;
+ * anything else is stale.  So is a source that has appeared or gone.
+ */
+
+
+#ifndef __meshcache_h__
+#define __meshcache_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mappedfile.h"
+
+
+#define MESHCACHE_MAGIC "MSHC"
+#define MESHCACHE_VERSION 5u
+#define MESHCACHE_ALIGNMENT 16u
+#define MESHCACHE_PATH_SIZE 256u
+
+/* Blob ids.  Readers look blobs up by id and ignore ids they don't know.
+ * Version 1 stored positions (1) and normals (2) as separate arrays; those
+ * ids are retired.  Version 3 added LODs to MeshBatch, version 4 the
+ * sources after the mesh file and the options hash, version 5 LOD errors
+ * to the furthest vertex rather than an average.
+ */
+enum MeshCacheBlobId
+{
+    MESHCACHE_INDICES  = 3, /* uint32 per index */
+    MESHCACHE_VERTICES = 4, /* interleaved Vertex (mesh.h) per vertex */
+    MESHCACHE_MESHLETS = 5, /* Meshlet (meshlet.h) per meshlet, optional */
+    MESHCACHE_BATCHES  = 6, /* MeshBatch (mesh.h) per material, optional */
+    MESHCACHE_LODS     = 7  /* MeshLod (simplify.h) per LOD, optional */
+};
+
+struct MeshCacheHeader
+{
+    char     magic[4];    /* MESHCACHE_MAGIC */
+    uint32_t version;     /* MESHCACHE_VERSION */
+    uint64_t optionsHash; /* Of how the mesh was made, from the caller */
+    uint32_t sourceCount;
+    uint32_t blobCount;
+};
+
+struct MeshCacheSource
+{
+    char     path[MESHCACHE_PATH_SIZE]; /* As given, null terminated */
+    uint64_t hash;   /* FNV-1a of the contents */
+    int64_t  mtime;  /* Modification time (seconds) */
+    uint64_t size;   /* In bytes */
+    uint32_t exists; /* 0 if it was missing, the rest then 0 too */
+    uint32_t reserved;
+};
+
+struct MeshCacheBlob
+{
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset; /* From the start of the file */
+    uint64_t size;   /* In bytes */
+};
+
+/* A blob handed to writeMeshCache(). */
+struct MeshCacheBlobData
+{
+    uint32_t id;
+    const void *data;
+    size_t size;
+};
+
+/* A mapped, validated cache file.  Blob pointers stay valid while the
+ * MeshCache is alive.
+ */
+class MeshCache
+{
+public:
+    /* Maps cachePath and checks that it was made from sourcePath with
+     * optionsHash and that none of its sources changed.  Returns false if
+     * the cache is missing, malformed, of another version, or stale.
+     */
+    bool open(const char *cachePath, const char *sourcePath, uint64_t optionsHash);
+
+    /* Returns the blob with the given id and stores its size in bytes, or
+     * returns null if the cache has no such blob.
+     */
+    const void *blob(uint32_t id, size_t *size) const;
+
+private:
+    MappedFile file_;
+};
+
+/* Writes a cache holding the given blobs, made from sourcePaths (the mesh
+ * file first, then any it reads, like the .mtl files of an .obj) with
+ * optionsHash.  Sources that are missing are recorded as such.  The file is
+ * written under a temporary name and then renamed into place, so readers
+ * never see a partial cache.  Returns false on any i/o error, if the mesh
+ * file is missing or if a path doesn't fit in MESHCACHE_PATH_SIZE.
+ */
+bool writeMeshCache(const char *cachePath, const char *const *sourcePaths, size_t sourceCount,
+                    uint64_t optionsHash, const MeshCacheBlobData *blobs, size_t blobCount);
+
+/* FNV-1a 64-bit hash of a byte range.  Passing the hash of earlier bytes as
+ * seed continues it, hashing the ranges as if they were one.
+ */
+uint64_t hashBytes(const void *data, size_t size,
+                   uint64_t seed = 14695981039346656037ull);
+
+#endif
@@ -0,0 +1,84 @@
+/* meshlet.h
+ * Small triangle clusters that can be culled on the CPU before drawing.
+ *
+ * A meshlet is a contiguous run of the index buffer covering at most
+ * MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles, the
+ * sizes mesh shading hardware is built around.  Each has a bounding sphere
+ * for frustum culling and a normal cone for rejecting clusters that face
+ * away from the camera.  What survives is drawn as a handful of index ranges
+ * with glMultiDrawElements().
+ */
+
+
+#ifndef __meshlet_h__
+#define __meshlet_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mesh.h"
+
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet
+{
+    uint32_t indexOffset;  /* First index in the mesh's index buffer */
+    uint32_t indexCount;
+    uint32_t vertexCount;  /* Distinct vertices used */
+    float center[3];       /* Bounding sphere */
+    float radius;
+    float coneAxis[3];     /* Average facing of the triangles */
+    float coneCos;         /* cos and sin of the widest angle between the */
+    float coneSin;         /* axis and a triangle normal; 0 and 1 if 90+ */
+};
+
+/* Reorders the triangles of a mesh into meshlets, storing them in meshlets.
+ * Each meshlet is grown from the first unused triangle in index order by
+ * adding the neighbouring triangle that brings in the fewest new vertices,
+ * ties going to the one closest to the meshlet's centre; it ends when it is
+ * full or runs out of neighbours.  Each meshlet then gets its own
+ * optimizeVertexCache() pass.  Run it after optimizeOverdraw(): meshlets
+ * come out in the order of their first triangles.  Triangles face the side
+ * they wind counter-clockwise towards.
+ */
+void buildMeshlets(uint32_t *indices, size_t indexCount,
+                   const Vertex *vertices, size_t vertexCount,
+                   std::vector<Meshlet> *meshlets);
+
+/* What to cull against, in the mesh's model space. */
+struct CullCamera
+{
+    float planes[6][4]; /* Frustum, a x + b y + c z + d >= 0 inside */
+    float position[3];
+};
+
+/* Fills planes from a column-major model-view-projection matrix (as
+ * glm::value_ptr() gives), normalized so they measure distances.
+ */
+void extractFrustumPlanes(const float *mvp, float planes[6][4]);
+
+/* A run of indices to draw. */
+struct IndexRange
+{
+    uint32_t offset;
+    uint32_t count;
+};
+
+struct MeshletCullStats
+{
+    size_t meshlets, triangles;              /* Considered */
+    size_t culledMeshlets, culledTriangles;  /* Rejected */
+};
+
+/* Culls meshlets outside the frustum or facing away from the camera and
+ * stores the rest in ranges, merging meshlets adjacent in the index buffer.
+ */
+MeshletCullStats cullMeshlets(const Meshlet *meshlets, size_t count,
+                              const CullCamera &camera,
+                              std::vector<IndexRange> *ranges);
+
+#endif
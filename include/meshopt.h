@@ -0,0 +1,69 @@
+/* meshopt.h
+ * Index and vertex reordering so meshes render with fewer vertex shader runs
+ * and cache misses.  None of it changes what is drawn, only the order.
+ */
+
+
+#ifndef __meshopt_h__
+#define __meshopt_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+
+
+/* How well an index buffer uses a post-transform vertex cache. */
+struct VertexCacheStats
+{
+    size_t transformed; /* Vertex shader invocations */
+    float acmr;         /* Transformed per triangle; 0.5 is ideal, 3 worst */
+    float atvr;         /* Transformed per vertex; 1 is ideal */
+};
+
+/* Simulates a FIFO post-transform cache of cacheSize entries over a triangle
+ * list.  16 is a fair stand-in for current hardware.
+ */
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+                                    size_t vertexCount, unsigned cacheSize = 16);
+
+/* Reorders triangles in place for vertex cache reuse, using Tom Forsyth's
+ * "Linear-Speed Vertex Cache Optimisation": triangles are emitted greedily by
+ * a score favouring vertices recently used and vertices with few triangles
+ * left.  The winding of each triangle is kept.
+ */
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+/* How many times each covered pixel gets shaded, with a depth test and no
+ * culling, averaged over six orthographic views along the +-x, +-y and +-z
+ * axes.  A CPU stand-in for measuring fill rate on a GPU.
+ */
+struct OverdrawStats
+{
+    size_t covered;  /* Pixels covered, summed over the views */
+    size_t shaded;   /* Fragments that passed the depth test */
+    float overdraw;  /* shaded / covered; 1 is ideal */
+};
+
+OverdrawStats analyzeOverdraw(const uint32_t *indices, size_t indexCount,
+                              const Vertex *vertices, size_t vertexCount);
+
+/* Reorders triangles in place so outward-facing parts of the mesh tend to
+ * draw first and hide what is behind them.  The index buffer is cut into
+ * clusters at points where the vertex cache would start over anyway, or
+ * where a cluster's ACMR is already within threshold (e.g. 1.05 = 5%) of the
+ * ACMR of the run it came from.  Clusters are then sorted by how much they
+ * face away from the mesh centre.  Triangle order inside a cluster is kept,
+ * so run optimizeVertexCache() first; ACMR grows by about threshold at most.
+ */
+void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+                      const Vertex *vertices, size_t vertexCount,
+                      float threshold = 1.05f);
+
+/* Renumbers the vertices of mesh in the order the index buffer first uses
+ * them, so vertex fetch walks memory forwards.  Unreferenced vertices are
+ * dropped.  Run it after the passes above.
+ */
+void optimizeVertexFetch(Mesh *mesh);
+
+#endif
@@ -0,0 +1,70 @@
+/* mipmap.h
+ * Mipmap chains for RGBA8 images.
+ */
+
+
+#ifndef __mipmap_h__
+#define __mipmap_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+
+/* One level of a chain, a run of its pixel buffer. */
+struct MipLevel
+{
+    uint64_t offset; /* In bytes */
+    uint32_t width;
+    uint32_t height;
+};
+
+enum MipFilter
+{
+    MIP_FILTER_BOX,    /* Average of the pixels each one covers */
+    MIP_FILTER_KAISER, /* Kaiser windowed sinc, 3 pixels of the level each way */
+    MIP_FILTER_LANCZOS /* Lanczos, 3 lobes each way */
+};
+
+struct MipOptions
+{
+    MipFilter filter;
+
+    /* Red, green and blue are sRGB encoded, as photos and painted textures
+     * are: average them in linear light and encode the result again, so
+     * smaller levels don't darken.  Alpha is averaged as stored either way.
+     */
+    bool srgb;
+    unsigned numThreads; /* 0 = one per hardware thread */
+};
+
+/* Kaiser filtered and sRGB, on every hardware thread. */
+MipOptions defaultMipOptions();
+
+/* Number of levels in a full chain for a width x height image, down to 1x1. */
+unsigned mipLevelCount(unsigned width, unsigned height);
+
+/* Lays out the full chain of a width x height image in levels, replacing
+ * them, and returns the bytes it spans.  Each level halves the one above,
+ * rounding down; level 0 is the image itself, at offset 0, with its rows
+ * packed together.
+ */
+size_t mipChainLayout(unsigned width, unsigned height, std::vector<MipLevel> *levels);
+
+/* Fills every level after the first of a chain laid out by mipChainLayout()
+ * from the one above it, in place.  pixels must already hold level 0, such
+ * as when an image was decoded straight into it.  Each level is filtered
+ * vertically then horizontally with edges clamped, in bands of rows spread
+ * over the threads; the output doesn't depend on how many there are.
+ */
+void buildMipLevels(uint8_t *pixels, const std::vector<MipLevel> &levels, const MipOptions &options);
+
+/* Copies a width x height RGBA8 image with rows packed together into
+ * pixels, lays out its full chain in levels with mipChainLayout() and fills
+ * it with buildMipLevels(), replacing both.
+ */
+void buildMipChain(const uint8_t *rgba, unsigned width, unsigned height, const MipOptions &options,
+                   std::vector<MipLevel> *levels, std::vector<uint8_t> *pixels);
+
+#endif
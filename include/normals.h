@@ -0,0 +1,47 @@
+/* normals.h
+ * Vertex normals and tangents for meshes that lack them.
+ *
+ * Both are sums over the triangles around a vertex, computed in two passes
+ * so threads never write to the same place: each triangle first works out
+ * what it gives its three corners, then each vertex adds up its corners in
+ * index order.  The result is the same bit for bit on any number of
+ * threads.
+ */
+
+
+#ifndef __normals_h__
+#define __normals_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mesh.h"
+
+
+/* No shared normal: the vertex keeps the normal it has. */
+#define NORMAL_GROUP_NONE 0xffffffffu
+
+/* Computes the normals of mesh's vertices from its triangles.  Vertices
+ * with the same normalGroups entry get the same normal, so a position split
+ * by a texcoord seam still shades smoothly; vertices whose entry is
+ * NORMAL_GROUP_NONE are left alone.  Each triangle counts in proportion to
+ * its area and to its angle at the corner.  Groups are numbered from 0 up
+ * to groupCount.  Work is spread over up to numThreads threads (0 = one per
+ * hardware thread).
+ */
+void generateNormals(Mesh *mesh, const uint32_t *normalGroups, size_t groupCount,
+                     unsigned numThreads = 0);
+
+/* Computes a tangent per vertex of mesh in tangents, four floats each: the
+ * direction of increasing texcoord u, perpendicular to the normal, and in w
+ * the handedness, +1 or -1, to multiply cross(normal, tangent) by for the
+ * bitangent.  Uses the same angle-weighted per-triangle tangents as
+ * MikkTSpace.  Vertices without texcoords get an arbitrary tangent
+ * perpendicular to the normal.
+ */
+void generateTangents(const Mesh &mesh, std::vector<float> *tangents,
+                      unsigned numThreads = 0);
+
+#endif
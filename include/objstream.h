@@ -0,0 +1,66 @@
+/* objstream.h
+ * Loads .obj files of any size in bounded memory.
+ *
+ * LoadObj() keeps every face corner of a file, and buildMesh() copies them
+ * again into a Mesh.  streamObj() instead welds faces into fixed-size
+ * chunks while the file is read and hands each chunk to a sink as soon as
+ * it fills: main.cpp uploads each into its own GPU buffers, a tool could
+ * write it out.  Chunks have at most 65536 vertices, so their indices are
+ * 16-bit.
+ *
+ * A face may refer to any v, vt or vn line before it, so those are kept for
+ * the whole load, as floats in fixed-size blocks that are never copied to
+ * grow.  Everything else fits in the budget.
+ */
+
+
+#ifndef __objstream_h__
+#define __objstream_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+
+#include "mesh.h"
+
+
+#define OBJSTREAM_DEFAULT_BUDGET (4u << 20)
+
+/* A welded piece of the mesh, valid only during the sink call. */
+struct MeshChunk
+{
+    const Vertex *vertices;
+    size_t vertexCount;
+    const uint16_t *indices; /* three per triangle, into vertices */
+    size_t indexCount;
+};
+
+typedef std::function<void(const MeshChunk &chunk)> MeshChunkSink;
+
+struct ObjStreamStats
+{
+    size_t positions, normals, texcoords; /* v, vn and vt lines */
+    size_t triangles;
+    size_t vertices;       /* Summed over chunks */
+    size_t chunks;
+    size_t chunkBytes;     /* Chunk buffers, fixed by the budget */
+    size_t attributeBytes; /* Blocks holding v, vn and vt */
+};
+
+/* Streams the .obj at path into chunks of roughly budgetBytes (at least
+ * enough for 256 vertices, at most 65536).  Quads are split like LoadObj()
+ * splits them, larger polygons into fans.
+ * Corners are welded within a chunk only, so a vertex on a chunk boundary is
+ * repeated in both.  Indices past the end read as zeros, like buildMesh().
+ * Corners without a normal get a zero one: unlike buildMesh(), a chunk
+ * doesn't see every face around a vertex.  Materials and groups are
+ * ignored.  Returns false and sets err if the file can't be read, has a face
+ * LoadObj() would reject for its vertex indices or has a face too large for
+ * a chunk.
+ */
+bool streamObj(const char *path, size_t budgetBytes, const MeshChunkSink &sink,
+               ObjStreamStats *stats, std::string *err);
+
+#endif
@@ -0,0 +1,58 @@
+/* parallel.h
+ * A minimal parallel for loop over an index range.
+ */
+
+
+#ifndef __parallel_h__
+#define __parallel_h__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+/* Number of threads parallelFor() uses for count items: numThreads, or one
+ * per hardware thread if it is 0, but never more than there are items.
+ */
+inline unsigned parallelThreadCount(size_t count, unsigned numThreads)
+{
+    if(numThreads == 0) numThreads = std::thread::hardware_concurrency();
+    if(numThreads == 0) numThreads = 1;
+    if(count < numThreads) numThreads = (unsigned)count;
+    return numThreads ? numThreads : 1;
+}
+
+/* Calls fn(i) for every i in [0, count) on up to numThreads threads
+ * (0 = one per hardware thread), the calling thread included.  Items are
+ * claimed one at a time, so items of uneven cost still balance.  Returns once
+ * every call has finished; fn must be safe to call concurrently.
+ */
+template <typename Fn>
+void parallelFor(size_t count, unsigned numThreads, Fn fn)
+{
+    numThreads = parallelThreadCount(count, numThreads);
+
+    if(numThreads == 1) {
+        for(size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for(;;) {
+            size_t i = next.fetch_add(1);
+            if(i >= count) break;
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for(unsigned t = 1; t < numThreads; t++) threads.emplace_back(worker);
+    worker();
+    for(size_t t = 0; t < threads.size(); t++) threads[t].join();
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* plyload.h
+ * Loads binary PLY meshes straight into a Mesh.
+ *
+ * Scanners write PLY, which is much smaller than the same mesh as .obj
+ * text: a header of text lines, then the elements as packed binary rows.
+ * A PLY vertex already has one index, so rows map one to one onto Vertex
+ * and faces onto indices, with no welding.  The file is read with a single
+ * mapping (mappedfile.h) and parsed in place.
+ *
+ * Vertex properties x, y and z are required.  nx, ny and nz and texcoords
+ * (u/v, s/t, texture_u/texture_v or texture_s/texture_t) are used if they
+ * are there, of any scalar type.  Faces are the face element's
+ * vertex_indices (or vertex_index) list, split into fans.  Other
+ * properties and elements are skipped.  Both byte orders are read; ASCII
+ * PLY isn't.
+ */
+
+
+#ifndef __plyload_h__
+#define __plyload_h__
+
+#include <stddef.h>
+
+#include <string>
+
+#include "mesh.h"
+
+
+/* Parses the size bytes of a PLY file at data into mesh, replacing its
+ * contents.  Every triangle gets material -1.  Without normals in the file,
+ * smooth ones are generated (normals.h) using up to numThreads threads
+ * (0 = one per hardware thread).  Returns false and sets err if the file is
+ * malformed, ASCII, lacks positions or has an index out of range.
+ */
+bool loadPlyFromBuffer(const void *data, size_t size, Mesh *mesh,
+                       std::string *err, unsigned numThreads = 0);
+
+/* Maps path and loads it with loadPlyFromBuffer(). */
+bool loadPly(const char *path, Mesh *mesh, std::string *err,
+             unsigned numThreads = 0);
+
+#endif
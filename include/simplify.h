@@ -0,0 +1,61 @@
+/* simplify.h
+ * Quadric error mesh simplification for building levels of detail.
+ *
+ * Triangles are removed by collapsing edges, one end onto the other, in
+ * order of the error each collapse adds (Garland and Heckbert, "Simplifying
+ * Surfaces with Color and Texture using Quadric Error Metrics").  The error
+ * is measured over position, normal and texcoord together, so collapses
+ * that would smear shading or stretch textures cost more.  No vertices are
+ * created or moved: a LOD is just a shorter index buffer over the same
+ * vertices, and any number of them can share the base mesh's buffers.
+ */
+
+
+#ifndef __simplify_h__
+#define __simplify_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mesh.h"
+
+
+/* One level of detail, a run of an index buffer. */
+struct MeshLod
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error; /* Furthest a vertex of the full mesh is from it, in model units */
+};
+
+/* Simplifies the triangles in indices towards targetIndexCount indices and
+ * stores the result in destination, which needs room for indexCount.
+ * Vertices on an open border, or sharing their position with another
+ * vertex (a normal or texcoord seam), are never collapsed, so the result
+ * may stop short of the target; adjacent meshes simplified separately still
+ * meet.  Collapses that would flip a triangle are skipped.  Returns the
+ * number of indices written.  error gets how far the furthest vertex of
+ * the given triangles is from the result, never less: each is measured by
+ * walking the result from the vertex it was collapsed onto towards the
+ * nearest triangle, which finds the true nearest on any reasonable surface.
+ * A result with nothing left gets the diagonal of the mesh's bounding cube.
+ */
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                    const Vertex *vertices, size_t vertexCount,
+                    size_t targetIndexCount, float *error);
+
+/* Simplifies indices to each fraction of its triangles in ratios, spread
+ * over up to numThreads threads (0 = one per hardware thread), and
+ * optimizes each result for the vertex cache.  The LODs are stored one
+ * after another in lodIndices, replacing its contents, and described in
+ * lods, which needs room for lodCount.
+ */
+void buildLods(const uint32_t *indices, size_t indexCount,
+               const Vertex *vertices, size_t vertexCount,
+               const float *ratios, size_t lodCount,
+               std::vector<uint32_t> *lodIndices, MeshLod *lods,
+               unsigned numThreads = 0);
+
+#endif
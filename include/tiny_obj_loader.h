@@ -77,6 +77,11 @@ namespace tinyobj {
 #define TINYOBJ_OVERRIDE
 #endif
 
+// Parallel loading(`LoadObjParallel`) requires C++11 <thread>.
+#if __cplusplus > 199711L
+#define TINYOBJLOADER_HAS_THREADS
+#endif
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #if __has_warning("-Wzero-as-null-pointer-constant")
@@ -527,8 +532,18 @@ struct ObjReaderConfig {
   ///
   std::string mtl_search_path;
 
+  ///
+  /// Number of threads used for parsing .obj.
+  /// 1 = serial(default), 0 = use all hardware threads.
+  /// Valid only when TINYOBJLOADER_HAS_THREADS is defined.
+  ///
+  unsigned int num_threads;
+
   ObjReaderConfig()
-      : triangulate(true), triangulation_method("simple"), vertex_color(true) {}
+      : triangulate(true),
+        triangulation_method("simple"),
+        vertex_color(true),
+        num_threads(1) {}
 };
 
 ///
@@ -632,6 +647,44 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              MaterialReader *readMatFn = NULL, bool triangulate = true,
              bool default_vcols_fallback = true);
 
+/// Loads object from a memory buffer(e.g. memory mapped .obj file).
+/// The buffer need not be NULL terminated. `v`, `vn`, `vt` and `f` lines are
+/// tokenized in place without copying them into a line buffer.
+/// `LoadObj` with a filename maps the file and uses this function when memory
+/// mapping is available(define TINYOBJLOADER_DISABLE_MMAP to disable it).
+bool LoadObjFromBuffer(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *warn,
+                       std::string *err, const char *buf, size_t len,
+                       MaterialReader *readMatFn = NULL,
+                       bool triangulate = true,
+                       bool default_vcols_fallback = true);
+
+#ifdef TINYOBJLOADER_HAS_THREADS
+/// Loads object from a std::istream using multiple threads.
+/// The whole stream is read into memory and split into newline aligned
+/// chunks which are parsed in parallel, then merged in file order.
+/// Result is identical to `LoadObj`.
+/// 'num_threads' = 0 uses all hardware threads. Small inputs are parsed with
+/// fewer threads.
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *warn,
+                     std::string *err, std::istream *inStream,
+                     MaterialReader *readMatFn = NULL, bool triangulate = true,
+                     bool default_vcols_fallback = true,
+                     unsigned int num_threads = 0);
+
+/// Loads object from a memory buffer using multiple threads.
+/// See `LoadObjFromBuffer` and `LoadObjParallel`.
+bool LoadObjParallelFromBuffer(attrib_t *attrib, std::vector<shape_t> *shapes,
+                               std::vector<material_t> *materials,
+                               std::string *warn, std::string *err,
+                               const char *buf, size_t len,
+                               MaterialReader *readMatFn = NULL,
+                               bool triangulate = true,
+                               bool default_vcols_fallback = true,
+                               unsigned int num_threads = 0);
+#endif
+
 /// Loads materials into std::map
 void LoadMtl(std::map<std::string, int> *material_map,
              std::vector<material_t> *materials, std::istream *inStream,
@@ -655,8 +708,11 @@ bool ParseTextureNameAndOption(std::string *texname, texture_option_t *texopt,
 #endif  // TINY_OBJ_LOADER_H_
 
 #ifdef TINYOBJLOADER_IMPLEMENTATION
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <cfloat>
+#include <clocale>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
@@ -667,6 +723,43 @@ bool ParseTextureNameAndOption(std::string *texname, texture_option_t *texopt,
 #include <sstream>
 #include <utility>
 
+// Correctly rounded, locale independent std::from_chars for floating point
+// (GCC 11, MSVC 2019 16.4).  Used for the rare numbers the fast paths in
+// tryParseDouble() don't cover.
+#if (__cplusplus >= 201703L ||                             \
+     (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) &&    \
+    defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+#define TINYOBJLOADER_HAS_FROM_CHARS
+#endif
+#endif
+#endif
+
+#ifdef TINYOBJLOADER_HAS_THREADS
+#include <thread>
+#endif
+
+#ifndef TINYOBJLOADER_DISABLE_MMAP
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define TINYOBJLOADER_HAS_MMAP
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TINYOBJLOADER_HAS_MMAP
+#endif
+#endif  // TINYOBJLOADER_DISABLE_MMAP
+
 #ifdef TINYOBJLOADER_USE_MAPBOX_EARCUT
 
 #ifdef TINYOBJLOADER_DONOT_INCLUDE_MAPBOX_EARCUT
@@ -702,15 +795,46 @@ struct vertex_index_t {
       : v_idx(vidx), vt_idx(vtidx), vn_idx(vnidx) {}
 };
 
-// Internal data structure for face representation
-// index + smoothing group.
-struct face_t {
-  unsigned int
-      smoothing_group_id;  // smoothing group id. 0 = smoothing groupd is off.
-  int pad_;
-  std::vector<vertex_index_t> vertex_indices;  // face vertex indices.
+// Internal data structure for face representation.
+// Faces are kept flat instead of one std::vector per face, so adding a face
+// only allocates when a buffer has to grow: face i has smoothing group
+// smoothing_group_ids[i] and vertex indices vertex_indices[offsets[i]] up to
+// vertex_indices[offsets[i + 1]]. clear() keeps the memory, so the buffers
+// work as an arena that is reset for each group instead of freed.
+struct face_group_t {
+  std::vector<unsigned int> offsets;  // size() + 1 entries, or none if empty.
+  std::vector<unsigned int> smoothing_group_ids;  // 0 = smoothing group is off.
+  std::vector<vertex_index_t> vertex_indices;  // all faces' vertex indices.
+
+  size_t size() const { return smoothing_group_ids.size(); }
+
+  bool empty() const { return smoothing_group_ids.empty(); }
+
+  size_t num_vertices(size_t i) const { return offsets[i + 1] - offsets[i]; }
+
+  const vertex_index_t *vertices(size_t i) const {
+    return vertex_indices.empty() ? NULL : &vertex_indices[0] + offsets[i];
+  }
+
+  // Ends a face made of the vertex indices added since the previous one.
+  void close_face(unsigned int smoothing_group_id) {
+    if (offsets.empty()) {
+      offsets.push_back(0);
+    }
+    offsets.push_back(static_cast<unsigned int>(vertex_indices.size()));
+    smoothing_group_ids.push_back(smoothing_group_id);
+  }
+
+  // Drops vertex indices added since the last face was closed.
+  void discard_open_face() {
+    vertex_indices.resize(offsets.empty() ? 0 : offsets.back());
+  }
 
-  face_t() : smoothing_group_id(0), pad_(0) {}
+  void clear() {
+    offsets.clear();
+    smoothing_group_ids.clear();
+    vertex_indices.clear();
+  }
 };
 
 // Internal data structure for line representation
@@ -745,7 +869,7 @@ struct obj_shape {
 //
 // Manages group of primitives(face, line, points, ...)
 struct PrimGroup {
-  std::vector<face_t> faceGroup;
+  face_group_t faceGroup;
   std::vector<__line_t> lineGroup;
   std::vector<__points_t> pointsGroup;
 
@@ -867,6 +991,425 @@ static inline int parseInt(const char **token) {
   return i;
 }
 
+// Number parsing.
+//
+// tryParseDouble() gathers the decimal significand of a number into a 64-bit
+// integer, eight digits at a time where it can, and then converts it with the
+// cheapest method that is still correctly rounded:
+//
+//  - Clinger's fast path: when the significand fits in 53 bits and the power
+//    of ten is exact in a double (10^0 .. 10^22), one IEEE multiply or divide
+//    gives the correctly rounded result.  This covers nearly every coordinate
+//    written by an exporter with `%f`-style output.
+//  - Eisel-Lemire: for up to 19 significant digits and a decimal exponent in
+//    [kMinEiselLemireExponent, kMaxEiselLemireExponent], a 64x128-bit multiply
+//    against a truncated power of five yields the rounded binary mantissa.
+//    This picks up `%.17g` output, which has too many digits for Clinger.
+//  - Anything else (more than 19 digits, extreme exponents, subnormals) goes
+//    to std::from_chars, or to strtod() before C++17.
+//
+// All three paths round correctly, so the result equals strtod() in the "C"
+// locale, bit for bit.  Unlike strtod(), the decimal point is always '.'.
+
+// 10^0 .. 10^22 are exactly representable as doubles.
+static const double kExactPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Clinger's fast path relies on doubles being evaluated at double precision.
+// x87 code (FLT_EVAL_METHOD == 2) would round twice, so it skips straight to
+// Eisel-Lemire, which only uses integer arithmetic.
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD != 0) && \
+    (FLT_EVAL_METHOD != 1)
+static const bool kUseClingerFastPath = false;
+#else
+static const bool kUseClingerFastPath = true;
+#endif
+
+static const int kMinEiselLemireExponent = -64;
+static const int kMaxEiselLemireExponent = 64;
+
+// 5^q for q in [kMinEiselLemireExponent, kMaxEiselLemireExponent], normalized
+// so bit 127 is set and truncated to 128 bits as {high, low} words.  Negative
+// powers are 2^b / 5^-q rounded up.  This is the same construction as the
+// full table used by fast_float, cut down to the exponents that occur in
+// geometry; numbers outside the range take the slow path.
+static const unsigned long long kPowersOfFive128[][2] = {
+    {0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL},  // 5^-64
+    {0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL},  // 5^-63
+    {0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL},  // 5^-62
+    {0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL},  // 5^-61
+    {0xcdb02555653131b6ULL, 0x3792f412cb06794dULL},  // 5^-60
+    {0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL},  // 5^-59
+    {0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL},  // 5^-58
+    {0xc8de047564d20a8bULL, 0xf245825a5a445275ULL},  // 5^-57
+    {0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL},  // 5^-56
+    {0x9ced737bb6c4183dULL, 0x55464dd69685606bULL},  // 5^-55
+    {0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL},  // 5^-54
+    {0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL},  // 5^-53
+    {0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL},  // 5^-52
+    {0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL},  // 5^-51
+    {0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL},  // 5^-50
+    {0x95a8637627989aadULL, 0xdde7001379a44aa8ULL},  // 5^-49
+    {0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL},  // 5^-48
+    {0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL},  // 5^-47
+    {0x9226712162ab070dULL, 0xcab3961304ca70e8ULL},  // 5^-46
+    {0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL},  // 5^-45
+    {0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL},  // 5^-44
+    {0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL},  // 5^-43
+    {0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL},  // 5^-42
+    {0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL},  // 5^-41
+    {0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL},  // 5^-40
+    {0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL},  // 5^-39
+    {0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL},  // 5^-38
+    {0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL},  // 5^-37
+    {0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL},  // 5^-36
+    {0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL},  // 5^-35
+    {0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL},  // 5^-34
+    {0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL},  // 5^-33
+    {0xcfb11ead453994baULL, 0x67de18eda5814af2ULL},  // 5^-32
+    {0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL},  // 5^-31
+    {0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL},  // 5^-30
+    {0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL},  // 5^-29
+    {0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL},  // 5^-28
+    {0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL},  // 5^-27
+    {0xc612062576589ddaULL, 0x95364afe032a819eULL},  // 5^-26
+    {0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL},  // 5^-25
+    {0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL},  // 5^-24
+    {0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL},  // 5^-23
+    {0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL},  // 5^-22
+    {0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL},  // 5^-21
+    {0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL},  // 5^-20
+    {0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL},  // 5^-19
+    {0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL},  // 5^-18
+    {0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL},  // 5^-17
+    {0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL},  // 5^-16
+    {0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL},  // 5^-15
+    {0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL},  // 5^-14
+    {0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL},  // 5^-13
+    {0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL},  // 5^-12
+    {0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL},  // 5^-11
+    {0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL},  // 5^-10
+    {0x89705f4136b4a597ULL, 0x31680a88f8953031ULL},  // 5^-9
+    {0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL},  // 5^-8
+    {0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL},  // 5^-7
+    {0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL},  // 5^-6
+    {0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL},  // 5^-5
+    {0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL},  // 5^-4
+    {0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL},  // 5^-3
+    {0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL},  // 5^-2
+    {0xccccccccccccccccULL, 0xcccccccccccccccdULL},  // 5^-1
+    {0x8000000000000000ULL, 0x0000000000000000ULL},  // 5^0
+    {0xa000000000000000ULL, 0x0000000000000000ULL},  // 5^1
+    {0xc800000000000000ULL, 0x0000000000000000ULL},  // 5^2
+    {0xfa00000000000000ULL, 0x0000000000000000ULL},  // 5^3
+    {0x9c40000000000000ULL, 0x0000000000000000ULL},  // 5^4
+    {0xc350000000000000ULL, 0x0000000000000000ULL},  // 5^5
+    {0xf424000000000000ULL, 0x0000000000000000ULL},  // 5^6
+    {0x9896800000000000ULL, 0x0000000000000000ULL},  // 5^7
+    {0xbebc200000000000ULL, 0x0000000000000000ULL},  // 5^8
+    {0xee6b280000000000ULL, 0x0000000000000000ULL},  // 5^9
+    {0x9502f90000000000ULL, 0x0000000000000000ULL},  // 5^10
+    {0xba43b74000000000ULL, 0x0000000000000000ULL},  // 5^11
+    {0xe8d4a51000000000ULL, 0x0000000000000000ULL},  // 5^12
+    {0x9184e72a00000000ULL, 0x0000000000000000ULL},  // 5^13
+    {0xb5e620f480000000ULL, 0x0000000000000000ULL},  // 5^14
+    {0xe35fa931a0000000ULL, 0x0000000000000000ULL},  // 5^15
+    {0x8e1bc9bf04000000ULL, 0x0000000000000000ULL},  // 5^16
+    {0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL},  // 5^17
+    {0xde0b6b3a76400000ULL, 0x0000000000000000ULL},  // 5^18
+    {0x8ac7230489e80000ULL, 0x0000000000000000ULL},  // 5^19
+    {0xad78ebc5ac620000ULL, 0x0000000000000000ULL},  // 5^20
+    {0xd8d726b7177a8000ULL, 0x0000000000000000ULL},  // 5^21
+    {0x878678326eac9000ULL, 0x0000000000000000ULL},  // 5^22
+    {0xa968163f0a57b400ULL, 0x0000000000000000ULL},  // 5^23
+    {0xd3c21bcecceda100ULL, 0x0000000000000000ULL},  // 5^24
+    {0x84595161401484a0ULL, 0x0000000000000000ULL},  // 5^25
+    {0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL},  // 5^26
+    {0xcecb8f27f4200f3aULL, 0x0000000000000000ULL},  // 5^27
+    {0x813f3978f8940984ULL, 0x4000000000000000ULL},  // 5^28
+    {0xa18f07d736b90be5ULL, 0x5000000000000000ULL},  // 5^29
+    {0xc9f2c9cd04674edeULL, 0xa400000000000000ULL},  // 5^30
+    {0xfc6f7c4045812296ULL, 0x4d00000000000000ULL},  // 5^31
+    {0x9dc5ada82b70b59dULL, 0xf020000000000000ULL},  // 5^32
+    {0xc5371912364ce305ULL, 0x6c28000000000000ULL},  // 5^33
+    {0xf684df56c3e01bc6ULL, 0xc732000000000000ULL},  // 5^34
+    {0x9a130b963a6c115cULL, 0x3c7f400000000000ULL},  // 5^35
+    {0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL},  // 5^36
+    {0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL},  // 5^37
+    {0x96769950b50d88f4ULL, 0x1314448000000000ULL},  // 5^38
+    {0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL},  // 5^39
+    {0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL},  // 5^40
+    {0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL},  // 5^41
+    {0xb7abc627050305adULL, 0xf14a3d9e40000000ULL},  // 5^42
+    {0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL},  // 5^43
+    {0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL},  // 5^44
+    {0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL},  // 5^45
+    {0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL},  // 5^46
+    {0x8c213d9da502de45ULL, 0x4526f422cc340000ULL},  // 5^47
+    {0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL},  // 5^48
+    {0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL},  // 5^49
+    {0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL},  // 5^50
+    {0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL},  // 5^51
+    {0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL},  // 5^52
+    {0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL},  // 5^53
+    {0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL},  // 5^54
+    {0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL},  // 5^55
+    {0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL},  // 5^56
+    {0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL},  // 5^57
+    {0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL},  // 5^58
+    {0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL},  // 5^59
+    {0x9f4f2726179a2245ULL, 0x01d762422c946590ULL},  // 5^60
+    {0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL},  // 5^61
+    {0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL},  // 5^62
+    {0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL},  // 5^63
+    {0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL},  // 5^64
+};
+
+static inline bool isLittleEndian() {
+  const unsigned int one = 1;
+  unsigned char first;
+  memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+// SWAR digit scanning: eight ASCII bytes loaded into one 64-bit word, first
+// character in the low byte (little-endian only).
+static inline bool isEightDigits(unsigned long long v) {
+  return ((v & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+         0x3333333333333333ULL;
+}
+
+static inline unsigned int parseEightDigits(unsigned long long v) {
+  const unsigned long long mask = 0x000000FF000000FFULL;
+  const unsigned long long mul1 = 0x000F424000000064ULL;  // 100 + (10^6 << 32)
+  const unsigned long long mul2 = 0x0000271000000001ULL;  // 1 + (10^4 << 32)
+  v -= 0x3030303030303030ULL;
+  v = (v * 10) + (v >> 8);  // pairs of digits in every other byte
+  v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+  return static_cast<unsigned int>(v);
+}
+
+// Appends the digits at *curr to *w, advancing *curr past them.  With
+// `swar`, runs of eight digits go through SWAR first; that only pays off for
+// long runs, so integer parts, which are short in geometry, skip it.  *w
+// wraps around past 19 digits; the caller checks the count.
+static inline void accumulateDigits(const char **curr, const char *s_end,
+                                    unsigned long long *w, bool swar) {
+  const char *p = *curr;
+  unsigned long long v = *w;
+  if (swar && isLittleEndian()) {
+    while (s_end - p >= 8) {
+      unsigned long long word;
+      memcpy(&word, p, sizeof(word));
+      if (!isEightDigits(word)) break;
+      v = v * 100000000ULL + parseEightDigits(word);
+      p += 8;
+    }
+  }
+  while (p != s_end && IS_DIGIT(*p)) {
+    v = v * 10 + static_cast<unsigned int>(*p - '0');
+    p++;
+  }
+  *curr = p;
+  *w = v;
+}
+
+static inline void fullMultiplication(unsigned long long a,
+                                      unsigned long long b,
+                                      unsigned long long *high,
+                                      unsigned long long *low) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 uint128;
+  uint128 r = static_cast<uint128>(a) * b;
+  *high = static_cast<unsigned long long>(r >> 64);
+  *low = static_cast<unsigned long long>(r);
+#else
+  unsigned long long a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+  unsigned long long b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+  unsigned long long p0 = a_lo * b_lo, p1 = a_lo * b_hi;
+  unsigned long long p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+  unsigned long long mid =
+      (p0 >> 32) + (p1 & 0xFFFFFFFFULL) + (p2 & 0xFFFFFFFFULL);
+  *low = (mid << 32) | (p0 & 0xFFFFFFFFULL);
+  *high = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int countLeadingZeros(unsigned long long x) {
+#if defined(__GNUC__)
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  if (!(x & 0xFFFFFFFF00000000ULL)) { n += 32; x <<= 32; }
+  if (!(x & 0xFFFF000000000000ULL)) { n += 16; x <<= 16; }
+  if (!(x & 0xFF00000000000000ULL)) { n += 8; x <<= 8; }
+  if (!(x & 0xF000000000000000ULL)) { n += 4; x <<= 4; }
+  if (!(x & 0xC000000000000000ULL)) { n += 2; x <<= 2; }
+  if (!(x & 0x8000000000000000ULL)) { n += 1; }
+  return n;
+#endif
+}
+
+// Eisel-Lemire: converts w * 10^q, w != 0, to the nearest double.  Returns
+// false for results that are subnormal or overflow, which are left to the
+// slow path.  See Lemire, "Number Parsing at a Gigabyte per Second" (2021),
+// and Mushtak & Lemire, "Fast Number Parsing Without Fallback" (2023) for
+// why the 128-bit product never needs a fallback for exact significands.
+static bool eiselLemire(unsigned long long w, int q, double *result) {
+  const int mantissa_bits = 52;
+  const int lz = countLeadingZeros(w);
+  w <<= lz;
+
+  const unsigned long long *pow5 =
+      kPowersOfFive128[q - kMinEiselLemireExponent];
+  unsigned long long high, low;
+  fullMultiplication(w, pow5[0], &high, &low);
+  // If the bits below the rounding position are all ones, the truncated
+  // low word of the power could carry into them; add it in.
+  const unsigned long long precision_mask =
+      0xFFFFFFFFFFFFFFFFULL >> (mantissa_bits + 3);
+  if ((high & precision_mask) == precision_mask) {
+    unsigned long long high2, low2;
+    fullMultiplication(w, pow5[1], &high2, &low2);
+    low += high2;
+    if (high2 > low) high++;
+  }
+
+  const int upperbit = static_cast<int>(high >> 63);
+  const int shift = upperbit + 64 - mantissa_bits - 3;
+  unsigned long long mantissa = high >> shift;
+
+  // floor(log2(10^q)) + 63, biased.
+  int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+  if (power2 <= 0) return false;  // subnormal
+
+  // Exactly halfway between two doubles: round to even rather than up.
+  // Only possible when 5^q fits in 64 bits, i.e. q in [-4, 23].
+  if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+      (mantissa << shift) == high) {
+    mantissa &= ~1ULL;
+  }
+
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if (mantissa >= (2ULL << mantissa_bits)) {
+    mantissa = 1ULL << mantissa_bits;
+    power2++;
+  }
+  mantissa &= ~(1ULL << mantissa_bits);
+  if (power2 >= 0x7FF) return false;  // overflow
+
+  unsigned long long bits =
+      mantissa | (static_cast<unsigned long long>(power2) << mantissa_bits);
+  memcpy(result, &bits, sizeof(bits));
+  return true;
+}
+
+// Correctly rounded conversion of the number in [s, s_end), which
+// tryParseDouble() has already validated.  q is its decimal exponent, only
+// used to tell overflow from underflow.
+static double slowParseDouble(const char *s, const char *s_end, long long q) {
+  if (*s == '+') s++;
+#ifdef TINYOBJLOADER_HAS_FROM_CHARS
+  double value = 0.0;
+  std::from_chars_result r = std::from_chars(s, s_end, value);
+  if (r.ec == std::errc::result_out_of_range) {
+    value = (q > 0) ? HUGE_VAL : 0.0;
+    return (*s == '-') ? -value : value;
+  }
+  return value;
+#else
+  (void)q;
+  // strtod() wants the current locale's decimal point and a terminating NUL.
+  std::string text(s, s_end);
+  const char *point = localeconv()->decimal_point;
+  if (point && point[0] != '.' && point[0] != '\0') {
+    std::string::size_type dot = text.find('.');
+    if (dot != std::string::npos) text.replace(dot, 1, point);
+  }
+  return strtod(text.c_str(), NULL);
+#endif
+}
+
+// The rest of tryParseDouble() for numbers that aren't a plain decimal with
+// at most 19 digits: reads the exponent, if any, and converts [s, curr).
+static bool tryParseDoubleTail(const char *s, const char *curr,
+                               const char *s_end, bool negative,
+                               unsigned long long w, long long num_digits,
+                               long long num_frac_digits, double *result) {
+  const char *digits_end = curr;
+
+  // Read the exponent part.
+  int exponent = 0;
+  if (curr != s_end && (*curr == 'e' || *curr == 'E')) {
+    curr++;
+    bool exp_negative = false;
+    if (curr != s_end && (*curr == '+' || *curr == '-')) {
+      exp_negative = (*curr == '-');
+      curr++;
+    } else if (curr == s_end || !IS_DIGIT(*curr)) {
+      // Empty E is not allowed.
+      return false;
+    }
+
+    const char *exp_begin = curr;
+    while (curr != s_end && IS_DIGIT(*curr)) {
+      // To avoid annoying MSVC's min/max macro definiton,
+      // Use hardcoded int max value
+      if (exponent >
+          (2147483647 / 10)) {  // 2147483647 = std::numeric_limits<int>::max()
+        // Integer overflow
+        return false;
+      }
+      exponent = exponent * 10 + static_cast<int>(*curr - '0');
+      curr++;
+    }
+    if (curr == exp_begin) return false;
+    if (exp_negative) exponent = -exponent;
+  }
+
+  const long long q = static_cast<long long>(exponent) - num_frac_digits;
+
+  // Leading zeros don't count towards the 19 digits w can hold exactly.
+  bool exact = (num_digits <= 19);
+  if (!exact) {
+    const char *p = s;
+    if (*p == '+' || *p == '-') p++;
+    long long leading_zeros = 0;
+    for (; p != digits_end && (*p == '0' || *p == '.'); p++) {
+      if (*p == '0') leading_zeros++;
+    }
+    exact = (num_digits - leading_zeros <= 19);
+  }
+
+  double value;
+  if (exact && w == 0) {
+    // All digits are zero, or there are none at all, as in "." or "-.".
+    value = 0.0;
+  } else if (exact && kUseClingerFastPath && w <= (1ULL << 53) &&
+             q >= -22 && q <= 22) {
+    value = static_cast<double>(static_cast<long long>(w));
+    if (q < 0) {
+      value /= kExactPowersOfTen[-q];
+    } else {
+      value *= kExactPowersOfTen[q];
+    }
+  } else if (exact && q >= kMinEiselLemireExponent &&
+             q <= kMaxEiselLemireExponent &&
+             eiselLemire(w, static_cast<int>(q), &value)) {
+    // value is set.
+  } else {
+    // The slow path handles the sign itself.
+    *result = slowParseDouble(s, curr, q);
+    return true;
+  }
+
+  *result = negative ? -value : value;
+  return true;
+}
+
 // Tries to parse a floating point number located at s.
 //
 // s_end should be a location in the string where reading should absolutely
@@ -883,6 +1426,8 @@ static inline int parseInt(const char **token) {
 //  Valid strings are for example:
 //   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
 //
+// A leading or trailing "." is accepted too, as in `.7e+2`, `-.5234`, `5.`.
+//
 // If the parsing is a success, result is set to the parsed value and true
 // is returned.
 //
@@ -899,137 +1444,57 @@ static bool tryParseDouble(const char *s, const char *s_end, double *result) {
     return false;
   }
 
-  double mantissa = 0.0;
-  // This exponent is base 2 rather than 10.
-  // However the exponent we parse is supposed to be one of ten,
-  // thus we must take care to convert the exponent/and or the
-  // mantissa to a * 2^E, where a is the mantissa and E is the
-  // exponent.
-  // To get the final double we will use ldexp, it requires the
-  // exponent to be in base 2.
-  int exponent = 0;
-
-  // NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
-  // TO JUMP OVER DEFINITIONS.
-  char sign = '+';
-  char exp_sign = '+';
-  char const *curr = s;
-
-  // How many characters were read in a loop.
-  int read = 0;
-  // Tells whether a loop terminated due to reaching s_end.
-  bool end_not_reached = false;
-  bool leading_decimal_dots = false;
-
-  /*
-          BEGIN PARSING.
-  */
+  const char *curr = s;
+  bool negative = false;
 
   // Find out what sign we've got.
   if (*curr == '+' || *curr == '-') {
-    sign = *curr;
+    negative = (*curr == '-');
     curr++;
-    if ((curr != s_end) && (*curr == '.')) {
-      // accept. Somethig like `.7e+2`, `-.5234`
-      leading_decimal_dots = true;
-    }
-  } else if (IS_DIGIT(*curr)) { /* Pass through. */
-  } else if (*curr == '.') {
-    // accept. Somethig like `.7e+2`, `-.5234`
-    leading_decimal_dots = true;
-  } else {
-    goto fail;
   }
 
-  // Read the integer part.
-  end_not_reached = (curr != s_end);
-  if (!leading_decimal_dots) {
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      mantissa *= 10;
-      mantissa += static_cast<int>(*curr - 0x30);
-      curr++;
-      read++;
-      end_not_reached = (curr != s_end);
-    }
-
-    // We must make sure we actually got something.
-    if (read == 0) goto fail;
+  // The decimal significand, wrapping past 19 digits, and its digit count.
+  unsigned long long w = 0;
+  long long num_digits = 0;
+  long long num_frac_digits = 0;
+
+  // Read the integer part, which may be missing if a "." follows.
+  if (curr != s_end && IS_DIGIT(*curr)) {
+    const char *int_begin = curr;
+    accumulateDigits(&curr, s_end, &w, false);
+    num_digits = curr - int_begin;
+  } else if (curr == s_end || *curr != '.') {
+    return false;
   }
 
-  // We allow numbers of form "#", "###" etc.
-  if (!end_not_reached) goto assemble;
-
   // Read the decimal part.
-  if (*curr == '.') {
+  if (curr != s_end && *curr == '.') {
     curr++;
-    read = 1;
-    end_not_reached = (curr != s_end);
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      static const double pow_lut[] = {
-          1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
-      };
-      const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
-
-      // NOTE: Don't use powf here, it will absolutely murder precision.
-      mantissa += static_cast<int>(*curr - 0x30) *
-                  (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
-      read++;
-      curr++;
-      end_not_reached = (curr != s_end);
-    }
-  } else if (*curr == 'e' || *curr == 'E') {
-  } else {
-    goto assemble;
+    const char *frac_begin = curr;
+    accumulateDigits(&curr, s_end, &w, true);
+    num_frac_digits = curr - frac_begin;
+    num_digits += num_frac_digits;
   }
 
-  if (!end_not_reached) goto assemble;
-
-  // Read the exponent part.
-  if (*curr == 'e' || *curr == 'E') {
-    curr++;
-    // Figure out if a sign is present and if it is.
-    end_not_reached = (curr != s_end);
-    if (end_not_reached && (*curr == '+' || *curr == '-')) {
-      exp_sign = *curr;
-      curr++;
-    } else if (IS_DIGIT(*curr)) { /* Pass through. */
-    } else {
-      // Empty E is not allowed.
-      goto fail;
-    }
-
-    read = 0;
-    end_not_reached = (curr != s_end);
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      // To avoid annoying MSVC's min/max macro definiton,
-      // Use hardcoded int max value
-      if (exponent >
-          (2147483647 / 10)) {  // 2147483647 = std::numeric_limits<int>::max()
-        // Integer overflow
-        goto fail;
-      }
-      exponent *= 10;
-      exponent += static_cast<int>(*curr - 0x30);
-      curr++;
-      read++;
-      end_not_reached = (curr != s_end);
-    }
-    exponent *= (exp_sign == '+' ? 1 : -1);
-    if (read == 0) goto fail;
+  // The common case, a plain decimal like `-0.183941`, is exactly w divided
+  // by a power of ten.
+  if (kUseClingerFastPath && num_digits <= 19 && w <= (1ULL << 53) &&
+      num_frac_digits <= 22 &&
+      (curr == s_end || (*curr != 'e' && *curr != 'E'))) {
+    double value = static_cast<double>(static_cast<long long>(w)) /
+                   kExactPowersOfTen[num_frac_digits];
+    *result = negative ? -value : value;
+    return true;
   }
 
-assemble:
-  *result = (sign == '+' ? 1 : -1) *
-            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
-                      : mantissa);
-  return true;
-fail:
-  return false;
+  return tryParseDoubleTail(s, curr, s_end, negative, w, num_digits,
+                            num_frac_digits, result);
 }
 
 static inline real_t parseReal(const char **token, double default_value = 0.0) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  while (IS_SPACE(**token)) (*token)++;
+  const char *end = *token;
+  while (!IS_SPACE(*end) && !IS_NEW_LINE(*end)) end++;
   double val = default_value;
   tryParseDouble((*token), end, &val);
   real_t f = static_cast<real_t>(val);
@@ -1038,8 +1503,9 @@ static inline real_t parseReal(const char **token, double default_value = 0.0) {
 }
 
 static inline bool parseReal(const char **token, real_t *out) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  while (IS_SPACE(**token)) (*token)++;
+  const char *end = *token;
+  while (!IS_SPACE(*end) && !IS_NEW_LINE(*end)) end++;
   double val;
   bool ret = tryParseDouble((*token), end, &val);
   if (ret) {
@@ -1478,6 +1944,31 @@ inline TinyObjPoint WorldToLocal(const TinyObjPoint &a, const TinyObjPoint &u,
   return TinyObjPoint(dot(a, u), dot(a, v), dot(a, w));
 }
 
+// Makes room for `n` more elements while keeping the amortized growth of
+// push_back, so reserving before each of many small appends stays linear.
+template <typename T>
+static void reserveMore(std::vector<T> *v, size_t n) {
+  if (v->size() + n > v->capacity()) {
+    v->reserve((std::max)(v->size() + n, v->capacity() * 2));
+  }
+}
+
+// Appends `shape` to `shapes` and leaves it empty, handing its buffers over
+// instead of copying them.
+static void flushShape(shape_t *shape, std::vector<shape_t> *shapes) {
+  shapes->push_back(shape_t());
+  shape_t &dst = shapes->back();
+  dst.name.swap(shape->name);
+  dst.mesh.indices.swap(shape->mesh.indices);
+  dst.mesh.num_face_vertices.swap(shape->mesh.num_face_vertices);
+  dst.mesh.material_ids.swap(shape->mesh.material_ids);
+  dst.mesh.smoothing_group_ids.swap(shape->mesh.smoothing_group_ids);
+  dst.mesh.tags.swap(shape->mesh.tags);
+  dst.lines.indices.swap(shape->lines.indices);
+  dst.lines.num_line_vertices.swap(shape->lines.num_line_vertices);
+  dst.points.indices.swap(shape->points.indices);
+}
+
 // TODO(syoyo): refactor function.
 static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
                                 const std::vector<tag_t> &tags,
@@ -1492,11 +1983,34 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
 
   // polygon
   if (!prim_group.faceGroup.empty()) {
+    const face_group_t &faces = prim_group.faceGroup;
+#ifndef TINYOBJLOADER_USE_MAPBOX_EARCUT
+    // scratch buffer for ear clipping, reused across faces.
+    std::vector<vertex_index_t> remainingVertices;
+#endif
+
+    // Size the shape's buffers once rather than doubling them face by face.
+    size_t num_new_faces = 0;
+    size_t num_new_indices = 0;
+    for (size_t i = 0; i < faces.size(); i++) {
+      size_t npolys = faces.num_vertices(i);
+      if (npolys < 3) {
+        continue;
+      }
+      num_new_faces += triangulate ? npolys - 2 : 1;
+      num_new_indices += triangulate ? 3 * (npolys - 2) : npolys;
+    }
+    reserveMore(&shape->mesh.indices, num_new_indices);
+    reserveMore(&shape->mesh.num_face_vertices, num_new_faces);
+    reserveMore(&shape->mesh.material_ids, num_new_faces);
+    reserveMore(&shape->mesh.smoothing_group_ids, num_new_faces);
+
     // Flatten vertices and indices
-    for (size_t i = 0; i < prim_group.faceGroup.size(); i++) {
-      const face_t &face = prim_group.faceGroup[i];
+    for (size_t i = 0; i < faces.size(); i++) {
+      const vertex_index_t *face_vertices = faces.vertices(i);
+      const unsigned int smoothing_group_id = faces.smoothing_group_ids[i];
 
-      size_t npolys = face.vertex_indices.size();
+      size_t npolys = faces.num_vertices(i);
 
       if (npolys < 3) {
         // Face must have 3+ vertices.
@@ -1508,10 +2022,10 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
 
       if (triangulate && npolys != 3) {
         if (npolys == 4) {
-          vertex_index_t i0 = face.vertex_indices[0];
-          vertex_index_t i1 = face.vertex_indices[1];
-          vertex_index_t i2 = face.vertex_indices[2];
-          vertex_index_t i3 = face.vertex_indices[3];
+          vertex_index_t i0 = face_vertices[0];
+          vertex_index_t i1 = face_vertices[1];
+          vertex_index_t i2 = face_vertices[2];
+          vertex_index_t i3 = face_vertices[3];
 
           size_t vi0 = size_t(i0.v_idx);
           size_t vi1 = size_t(i1.v_idx);
@@ -1611,23 +2125,23 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
           shape->mesh.material_ids.push_back(material_id);
           shape->mesh.material_ids.push_back(material_id);
 
-          shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
-          shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
+          shape->mesh.smoothing_group_ids.push_back(smoothing_group_id);
+          shape->mesh.smoothing_group_ids.push_back(smoothing_group_id);
 
         } else {
 #ifdef TINYOBJLOADER_USE_MAPBOX_EARCUT
-          vertex_index_t i0 = face.vertex_indices[0];
+          vertex_index_t i0 = face_vertices[0];
           vertex_index_t i0_2 = i0;
 
           // TMW change: Find the normal axis of the polygon using Newell's
           // method
           TinyObjPoint n;
           for (size_t k = 0; k < npolys; ++k) {
-            i0 = face.vertex_indices[k % npolys];
+            i0 = face_vertices[k % npolys];
             size_t vi0 = size_t(i0.v_idx);
 
             size_t j = (k + 1) % npolys;
-            i0_2 = face.vertex_indices[j];
+            i0_2 = face_vertices[j];
             size_t vi0_2 = size_t(i0_2.v_idx);
 
             real_t v0x = v[vi0 * 3 + 0];
@@ -1685,7 +2199,7 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
 
           // Fill polygon data(facevarying vertices).
           for (size_t k = 0; k < npolys; k++) {
-            i0 = face.vertex_indices[k];
+            i0 = face_vertices[k];
             size_t vi0 = size_t(i0.v_idx);
 
             assert(((3 * vi0 + 2) < v.size()));
@@ -1710,21 +2224,21 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
           for (size_t k = 0; k < indices.size() / 3; k++) {
             {
               index_t idx0, idx1, idx2;
-              idx0.vertex_index = face.vertex_indices[indices[3 * k + 0]].v_idx;
+              idx0.vertex_index = face_vertices[indices[3 * k + 0]].v_idx;
               idx0.normal_index =
-                  face.vertex_indices[indices[3 * k + 0]].vn_idx;
+                  face_vertices[indices[3 * k + 0]].vn_idx;
               idx0.texcoord_index =
-                  face.vertex_indices[indices[3 * k + 0]].vt_idx;
-              idx1.vertex_index = face.vertex_indices[indices[3 * k + 1]].v_idx;
+                  face_vertices[indices[3 * k + 0]].vt_idx;
+              idx1.vertex_index = face_vertices[indices[3 * k + 1]].v_idx;
               idx1.normal_index =
-                  face.vertex_indices[indices[3 * k + 1]].vn_idx;
+                  face_vertices[indices[3 * k + 1]].vn_idx;
               idx1.texcoord_index =
-                  face.vertex_indices[indices[3 * k + 1]].vt_idx;
-              idx2.vertex_index = face.vertex_indices[indices[3 * k + 2]].v_idx;
+                  face_vertices[indices[3 * k + 1]].vt_idx;
+              idx2.vertex_index = face_vertices[indices[3 * k + 2]].v_idx;
               idx2.normal_index =
-                  face.vertex_indices[indices[3 * k + 2]].vn_idx;
+                  face_vertices[indices[3 * k + 2]].vn_idx;
               idx2.texcoord_index =
-                  face.vertex_indices[indices[3 * k + 2]].vt_idx;
+                  face_vertices[indices[3 * k + 2]].vt_idx;
 
               shape->mesh.indices.push_back(idx0);
               shape->mesh.indices.push_back(idx1);
@@ -1733,21 +2247,21 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
               shape->mesh.num_face_vertices.push_back(3);
               shape->mesh.material_ids.push_back(material_id);
               shape->mesh.smoothing_group_ids.push_back(
-                  face.smoothing_group_id);
+                  smoothing_group_id);
             }
           }
 
 #else  // Built-in ear clipping triangulation
-          vertex_index_t i0 = face.vertex_indices[0];
+          vertex_index_t i0 = face_vertices[0];
           vertex_index_t i1(-1);
-          vertex_index_t i2 = face.vertex_indices[1];
+          vertex_index_t i2 = face_vertices[1];
 
           // find the two axes to work in
           size_t axes[2] = {1, 2};
           for (size_t k = 0; k < npolys; ++k) {
-            i0 = face.vertex_indices[(k + 0) % npolys];
-            i1 = face.vertex_indices[(k + 1) % npolys];
-            i2 = face.vertex_indices[(k + 2) % npolys];
+            i0 = face_vertices[(k + 0) % npolys];
+            i1 = face_vertices[(k + 1) % npolys];
+            i2 = face_vertices[(k + 2) % npolys];
             size_t vi0 = size_t(i0.v_idx);
             size_t vi1 = size_t(i1.v_idx);
             size_t vi2 = size_t(i2.v_idx);
@@ -1796,7 +2310,7 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
             }
           }
 
-          face_t remainingFace = face;  // copy
+          remainingVertices.assign(face_vertices, face_vertices + npolys);
           size_t guess_vert = 0;
           vertex_index_t ind[3];
           real_t vx[3];
@@ -1804,16 +2318,16 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
 
           // How many iterations can we do without decreasing the remaining
           // vertices.
-          size_t remainingIterations = face.vertex_indices.size();
+          size_t remainingIterations = npolys;
           size_t previousRemainingVertices =
-              remainingFace.vertex_indices.size();
+              remainingVertices.size();
 
-          while (remainingFace.vertex_indices.size() > 3 &&
+          while (remainingVertices.size() > 3 &&
                  remainingIterations > 0) {
             // std::cout << "remainingIterations " << remainingIterations <<
             // "\n";
 
-            npolys = remainingFace.vertex_indices.size();
+            npolys = remainingVertices.size();
             if (guess_vert >= npolys) {
               guess_vert -= npolys;
             }
@@ -1829,7 +2343,7 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
             }
 
             for (size_t k = 0; k < 3; k++) {
-              ind[k] = remainingFace.vertex_indices[(guess_vert + k) % npolys];
+              ind[k] = remainingVertices[(guess_vert + k) % npolys];
               size_t vi = size_t(ind[k].v_idx);
               if (((vi * 3 + axes[0]) >= v.size()) ||
                   ((vi * 3 + axes[1]) >= v.size())) {
@@ -1870,13 +2384,13 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
             for (size_t otherVert = 3; otherVert < npolys; ++otherVert) {
               size_t idx = (guess_vert + otherVert) % npolys;
 
-              if (idx >= remainingFace.vertex_indices.size()) {
+              if (idx >= remainingVertices.size()) {
                 // std::cout << "???0\n";
                 // ???
                 continue;
               }
 
-              size_t ovi = size_t(remainingFace.vertex_indices[idx].v_idx);
+              size_t ovi = size_t(remainingVertices[idx].v_idx);
 
               if (((ovi * 3 + axes[0]) >= v.size()) ||
                   ((ovi * 3 + axes[1]) >= v.size())) {
@@ -1919,25 +2433,25 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
               shape->mesh.num_face_vertices.push_back(3);
               shape->mesh.material_ids.push_back(material_id);
               shape->mesh.smoothing_group_ids.push_back(
-                  face.smoothing_group_id);
+                  smoothing_group_id);
             }
 
             // remove v1 from the list
             size_t removed_vert_index = (guess_vert + 1) % npolys;
             while (removed_vert_index + 1 < npolys) {
-              remainingFace.vertex_indices[removed_vert_index] =
-                  remainingFace.vertex_indices[removed_vert_index + 1];
+              remainingVertices[removed_vert_index] =
+                  remainingVertices[removed_vert_index + 1];
               removed_vert_index += 1;
             }
-            remainingFace.vertex_indices.pop_back();
+            remainingVertices.pop_back();
           }
 
-          // std::cout << "remainingFace.vi.size = " <<
-          // remainingFace.vertex_indices.size() << "\n";
-          if (remainingFace.vertex_indices.size() == 3) {
-            i0 = remainingFace.vertex_indices[0];
-            i1 = remainingFace.vertex_indices[1];
-            i2 = remainingFace.vertex_indices[2];
+          // std::cout << "remainingVertices.size = " <<
+          // remainingVertices.size() << "\n";
+          if (remainingVertices.size() == 3) {
+            i0 = remainingVertices[0];
+            i1 = remainingVertices[1];
+            i2 = remainingVertices[2];
             {
               index_t idx0, idx1, idx2;
               idx0.vertex_index = i0.v_idx;
@@ -1957,7 +2471,7 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
               shape->mesh.num_face_vertices.push_back(3);
               shape->mesh.material_ids.push_back(material_id);
               shape->mesh.smoothing_group_ids.push_back(
-                  face.smoothing_group_id);
+                  smoothing_group_id);
             }
           }
 #endif
@@ -1965,9 +2479,9 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
       } else {
         for (size_t k = 0; k < npolys; k++) {
           index_t idx;
-          idx.vertex_index = face.vertex_indices[k].v_idx;
-          idx.normal_index = face.vertex_indices[k].vn_idx;
-          idx.texcoord_index = face.vertex_indices[k].vt_idx;
+          idx.vertex_index = face_vertices[k].v_idx;
+          idx.normal_index = face_vertices[k].vn_idx;
+          idx.texcoord_index = face_vertices[k].vt_idx;
           shape->mesh.indices.push_back(idx);
         }
 
@@ -1975,7 +2489,7 @@ static bool exportGroupsToShape(shape_t *shape, const PrimGroup &prim_group,
             static_cast<unsigned int>(npolys));
         shape->mesh.material_ids.push_back(material_id);  // per face
         shape->mesh.smoothing_group_ids.push_back(
-            face.smoothing_group_id);  // per face
+            smoothing_group_id);  // per face
       }
     }
 
@@ -2545,16 +3059,143 @@ bool MaterialStreamReader::operator()(const std::string &matId,
   return true;
 }
 
-bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
-             std::vector<material_t> *materials, std::string *warn,
-             std::string *err, const char *filename, const char *mtl_basedir,
-             bool triangulate, bool default_vcols_fallback) {
+#ifdef TINYOBJLOADER_HAS_MMAP
+// Read-only memory mapping of a whole file.
+// Pages are hinted for sequential access so the OS reads ahead aggressively.
+class obj_mapped_file {
+ public:
+  obj_mapped_file() : data_(NULL), size_(0) {
+#if defined(_WIN32)
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#endif
+  }
+
+  ~obj_mapped_file() {
+#if defined(_WIN32)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+    if (data_) munmap(const_cast<char *>(data_), size_);
+#endif
+  }
+
+  bool Open(const char *filename) {
+#if defined(_WIN32)
+    file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                        NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size)) {
+      return false;
+    }
+    if (file_size.QuadPart == 0) {
+      return true;  // empty file can't be mapped.
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+
+    mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_) {
+      return false;
+    }
+
+    data_ = static_cast<const char *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    return data_ != NULL;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+      close(fd);
+      return false;
+    }
+    if (sb.st_size == 0) {
+      close(fd);
+      return true;  // empty file can't be mapped.
+    }
+
+    void *p = mmap(NULL, static_cast<size_t>(sb.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+    close(fd);  // mapping stays valid after close.
+    if (p == MAP_FAILED) {
+      return false;
+    }
+
+    madvise(p, static_cast<size_t>(sb.st_size), MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char *>(p);
+    size_ = static_cast<size_t>(sb.st_size);
+    return true;
+#endif
+  }
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  obj_mapped_file(const obj_mapped_file &);
+  obj_mapped_file &operator=(const obj_mapped_file &);
+
+  const char *data_;
+  size_t size_;
+#if defined(_WIN32)
+  HANDLE file_;
+  HANDLE mapping_;
+#endif
+};
+#endif  // TINYOBJLOADER_HAS_MMAP
+
+static bool LoadObjFile(attrib_t *attrib, std::vector<shape_t> *shapes,
+                        std::vector<material_t> *materials, std::string *warn,
+                        std::string *err, const char *filename,
+                        const char *mtl_basedir, bool triangulate,
+                        bool default_vcols_fallback, unsigned int num_threads) {
   attrib->vertices.clear();
   attrib->normals.clear();
   attrib->texcoords.clear();
   attrib->colors.clear();
   shapes->clear();
 
+  std::string baseDir = mtl_basedir ? mtl_basedir : "";
+  if (!baseDir.empty()) {
+#ifndef _WIN32
+    const char dirsep = '/';
+#else
+    const char dirsep = '\\';
+#endif
+    if (baseDir[baseDir.length() - 1] != dirsep) baseDir += dirsep;
+  }
+  MaterialFileReader matFileReader(baseDir);
+
+#ifdef TINYOBJLOADER_HAS_MMAP
+  {
+    obj_mapped_file mapped;
+    if (mapped.Open(filename)) {
+#ifdef TINYOBJLOADER_HAS_THREADS
+      if (num_threads != 1) {
+        return LoadObjParallelFromBuffer(
+            attrib, shapes, materials, warn, err, mapped.data(), mapped.size(),
+            &matFileReader, triangulate, default_vcols_fallback, num_threads);
+      }
+#endif
+      return LoadObjFromBuffer(attrib, shapes, materials, warn, err,
+                               mapped.data(), mapped.size(), &matFileReader,
+                               triangulate, default_vcols_fallback);
+    }
+    // Fall back to stream reading(e.g. mmap is not supported for the file).
+  }
+#endif
+
   std::stringstream errss;
 
   std::ifstream ifs(filename);
@@ -2566,16 +3207,15 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
     return false;
   }
 
-  std::string baseDir = mtl_basedir ? mtl_basedir : "";
-  if (!baseDir.empty()) {
-#ifndef _WIN32
-    const char dirsep = '/';
+#ifdef TINYOBJLOADER_HAS_THREADS
+  if (num_threads != 1) {
+    return LoadObjParallel(attrib, shapes, materials, warn, err, &ifs,
+                           &matFileReader, triangulate, default_vcols_fallback,
+                           num_threads);
+  }
 #else
-    const char dirsep = '\\';
+  (void)num_threads;
 #endif
-    if (baseDir[baseDir.length() - 1] != dirsep) baseDir += dirsep;
-  }
-  MaterialFileReader matFileReader(baseDir);
 
   return LoadObj(attrib, shapes, materials, warn, err, &ifs, &matFileReader,
                  triangulate, default_vcols_fallback);
@@ -2583,534 +3223,622 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
 
 bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::vector<material_t> *materials, std::string *warn,
-             std::string *err, std::istream *inStream,
-             MaterialReader *readMatFn /*= NULL*/, bool triangulate,
-             bool default_vcols_fallback) {
-  std::stringstream errss;
+             std::string *err, const char *filename, const char *mtl_basedir,
+             bool triangulate, bool default_vcols_fallback) {
+  return LoadObjFile(attrib, shapes, materials, warn, err, filename,
+                     mtl_basedir, triangulate, default_vcols_fallback, 1);
+}
 
-  std::vector<real_t> v;
-  std::vector<real_t> vertex_weights;  // optional [w] component in `v`
-  std::vector<real_t> vn;
-  std::vector<real_t> vt;
-  std::vector<real_t> vc;
-  std::vector<skin_weight_t> vw;  // tinyobj extension: vertex skin weights
-  std::vector<tag_t> tags;
-  PrimGroup prim_group;
-  std::string name;
+// Marks a face index component(vt or vn) which is not present in `f` line.
+// Used for raw(not yet fixed) index triples.
+static const int kAbsentIndex = (-2147483647 - 1);
 
-  // material
-  std::set<std::string> material_filenames;
-  std::map<std::string, int> material_map;
-  int material = -1;
+// Parse raw triples without fixing indices: i, i/j/k, i//k, i/j
+// Components not present are set to `kAbsentIndex`.
+static vertex_index_t parseRawFaceTriple(const char **token) {
+  vertex_index_t vi(kAbsentIndex);
 
-  // smoothing group id
-  unsigned int current_smoothing_id =
-      0;  // Initial value. 0 means no smoothing.
+  vi.v_idx = atoi((*token));
+  (*token) += strcspn((*token), "/ \t\r\n");
+  if ((*token)[0] != '/') {
+    return vi;
+  }
+  (*token)++;
 
-  int greatest_v_idx = -1;
-  int greatest_vn_idx = -1;
-  int greatest_vt_idx = -1;
+  // i//k
+  if ((*token)[0] == '/') {
+    (*token)++;
+    vi.vn_idx = atoi((*token));
+    (*token) += strcspn((*token), "/ \t\r\n");
+    return vi;
+  }
 
-  shape_t shape;
+  // i/j/k or i/j
+  vi.vt_idx = atoi((*token));
+  (*token) += strcspn((*token), "/ \t\r\n");
+  if ((*token)[0] != '/') {
+    return vi;
+  }
 
-  bool found_all_colors = true;  // check if all 'v' line has color info
+  // i/j/k
+  (*token)++;  // skip '/'
+  vi.vn_idx = atoi((*token));
+  (*token) += strcspn((*token), "/ \t\r\n");
+  return vi;
+}
 
-  size_t line_num = 0;
-  std::string linebuf;
-  while (inStream->peek() != -1) {
-    safeGetline(*inStream, linebuf);
+// Make raw triple zero-base. Same rule as `parseTriple`.
+static bool fixRawTriple(const vertex_index_t &raw, int vsize, int vnsize,
+                         int vtsize, vertex_index_t *ret,
+                         const warning_context &context) {
+  vertex_index_t vi(-1);
 
-    line_num++;
+  if (!fixIndex(raw.v_idx, vsize, &vi.v_idx, false, context)) {
+    return false;
+  }
 
-    // Trim newline '\r\n' or '\n'
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\n')
-        linebuf.erase(linebuf.size() - 1);
-    }
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\r')
-        linebuf.erase(linebuf.size() - 1);
+  if (raw.vt_idx != kAbsentIndex) {
+    if (!fixIndex(raw.vt_idx, vtsize, &vi.vt_idx, true, context)) {
+      return false;
     }
+  }
 
-    // Skip if empty line.
-    if (linebuf.empty()) {
-      continue;
+  if (raw.vn_idx != kAbsentIndex) {
+    if (!fixIndex(raw.vn_idx, vnsize, &vi.vn_idx, true, context)) {
+      return false;
     }
+  }
 
-    // Skip leading space.
-    const char *token = linebuf.c_str();
-    token += strspn(token, " \t");
-
-    assert(token);
-    if (token[0] == '\0') continue;  // empty line
+  (*ret) = vi;
+  return true;
+}
 
-    if (token[0] == '#') continue;  // comment line
+// Parser state of `LoadObj`.
+// Serial and chunked(parallel) loader share this state so that both run the
+// same per-line state machine and produce identical results.
+struct obj_load_state {
+  std::vector<real_t> v;
+  std::vector<real_t> vertex_weights;  // optional [w] component in `v`
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  std::vector<skin_weight_t> vw;  // tinyobj extension: vertex skin weights
+  std::vector<tag_t> tags;
+  PrimGroup prim_group;
+  std::string name;
 
-    // vertex
-    if (token[0] == 'v' && IS_SPACE((token[1]))) {
-      token += 2;
-      real_t x, y, z;
-      real_t r, g, b;
+  // material
+  std::set<std::string> material_filenames;
+  std::map<std::string, int> material_map;
+  int material;
 
-      int num_components = parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
-      found_all_colors &= (num_components == 6);
+  // smoothing group id
+  unsigned int current_smoothing_id;  // 0 means no smoothing.
 
-      v.push_back(x);
-      v.push_back(y);
-      v.push_back(z);
+  int greatest_v_idx;
+  int greatest_vn_idx;
+  int greatest_vt_idx;
 
-      vertex_weights.push_back(
-          r);  // r = w, and initialized to 1.0 when `w` component is not found.
+  shape_t shape;
 
-      if ((num_components == 6) || default_vcols_fallback) {
-        vc.push_back(r);
-        vc.push_back(g);
-        vc.push_back(b);
-      }
+  bool found_all_colors;  // check if all 'v' line has color info
 
-      continue;
-    }
+  std::vector<vertex_index_t> raw_face;  // scratch buffer for `f` line
 
-    // normal
-    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
-      token += 3;
-      real_t x, y, z;
-      parseReal3(&x, &y, &z, &token);
-      vn.push_back(x);
-      vn.push_back(y);
-      vn.push_back(z);
-      continue;
-    }
+  obj_load_state()
+      : material(-1),
+        current_smoothing_id(0),
+        greatest_v_idx(-1),
+        greatest_vn_idx(-1),
+        greatest_vt_idx(-1),
+        found_all_colors(true) {}
+};
 
-    // texcoord
-    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
-      token += 3;
-      real_t x, y;
-      parseReal2(&x, &y, &token);
-      vt.push_back(x);
-      vt.push_back(y);
-      continue;
+// Adds a face from raw index triples to the current primitive group.
+static bool addRawFace(obj_load_state *st, const vertex_index_t *raw,
+                       size_t num_raw, size_t line_num, std::string *warn,
+                       std::string *err) {
+  warning_context context;
+  context.warn = warn;
+  context.line_number = line_num;
+
+  face_group_t &faces = st->prim_group.faceGroup;
+
+  for (size_t i = 0; i < num_raw; i++) {
+    vertex_index_t vi;
+    if (!fixRawTriple(raw[i], static_cast<int>(st->v.size() / 3),
+                      static_cast<int>(st->vn.size() / 3),
+                      static_cast<int>(st->vt.size() / 2), &vi, context)) {
+      if (err) {
+        (*err) +=
+            "Failed to parse `f' line (e.g. a zero value for vertex index "
+            "or invalid relative vertex index). Line " +
+            toString(line_num) + ").\n";
+      }
+      faces.discard_open_face();
+      return false;
     }
 
-    // skin weight. tinyobj extension
-    if (token[0] == 'v' && token[1] == 'w' && IS_SPACE((token[2]))) {
-      token += 3;
+    st->greatest_v_idx =
+        st->greatest_v_idx > vi.v_idx ? st->greatest_v_idx : vi.v_idx;
+    st->greatest_vn_idx =
+        st->greatest_vn_idx > vi.vn_idx ? st->greatest_vn_idx : vi.vn_idx;
+    st->greatest_vt_idx =
+        st->greatest_vt_idx > vi.vt_idx ? st->greatest_vt_idx : vi.vt_idx;
 
-      // vw <vid> <joint_0> <weight_0> <joint_1> <weight_1> ...
-      // example:
-      // vw 0 0 0.25 1 0.25 2 0.5
+    faces.vertex_indices.push_back(vi);
+  }
 
-      // TODO(syoyo): Add syntax check
-      int vid = 0;
-      vid = parseInt(&token);
+  faces.close_face(st->current_smoothing_id);
 
-      skin_weight_t sw;
+  return true;
+}
 
-      sw.vertex_id = vid;
+// Parses one .obj line. `token` points to the first non-space character of
+// a NULL terminated line without newline. `v`, `vn`, `vt` and `f` lines may
+// also be tokenized in place in a buffer where the line ends with LF.
+// Returns false on parse error.
+static bool parseObjLine(obj_load_state *st, const char *token,
+                         size_t line_num, std::vector<shape_t> *shapes,
+                         std::vector<material_t> *materials,
+                         MaterialReader *readMatFn, bool triangulate,
+                         bool default_vcols_fallback, std::string *warn,
+                         std::string *err) {
+  std::vector<real_t> &v = st->v;
+  std::vector<real_t> &vn = st->vn;
+  std::vector<real_t> &vt = st->vt;
+  PrimGroup &prim_group = st->prim_group;
+  shape_t &shape = st->shape;
+
+  // vertex
+  if (token[0] == 'v' && IS_SPACE((token[1]))) {
+    token += 2;
+    real_t x, y, z;
+    real_t r, g, b;
+
+    int num_components = parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+    st->found_all_colors &= (num_components == 6);
+
+    v.push_back(x);
+    v.push_back(y);
+    v.push_back(z);
+
+    st->vertex_weights.push_back(
+        r);  // r = w, and initialized to 1.0 when `w` component is not found.
+
+    if ((num_components == 6) || default_vcols_fallback) {
+      st->vc.push_back(r);
+      st->vc.push_back(g);
+      st->vc.push_back(b);
+    }
 
-      while (!IS_NEW_LINE(token[0])) {
-        real_t j, w;
-        // joint_id should not be negative, weight may be negative
-        // TODO(syoyo): # of elements check
-        parseReal2(&j, &w, &token, -1.0);
-
-        if (j < static_cast<real_t>(0)) {
-          if (err) {
-            std::stringstream ss;
-            ss << "Failed parse `vw' line. joint_id is negative. "
-                  "line "
-               << line_num << ".)\n";
-            (*err) += ss.str();
-          }
-          return false;
-        }
+    return true;
+  }
 
-        joint_and_weight_t jw;
+  // normal
+  if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+    token += 3;
+    real_t x, y, z;
+    parseReal3(&x, &y, &z, &token);
+    vn.push_back(x);
+    vn.push_back(y);
+    vn.push_back(z);
+    return true;
+  }
 
-        jw.joint_id = int(j);
-        jw.weight = w;
+  // texcoord
+  if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+    token += 3;
+    real_t x, y;
+    parseReal2(&x, &y, &token);
+    vt.push_back(x);
+    vt.push_back(y);
+    return true;
+  }
 
-        sw.weightValues.push_back(jw);
+  // skin weight. tinyobj extension
+  if (token[0] == 'v' && token[1] == 'w' && IS_SPACE((token[2]))) {
+    token += 3;
 
-        size_t n = strspn(token, " \t\r");
-        token += n;
-      }
+    // vw <vid> <joint_0> <weight_0> <joint_1> <weight_1> ...
+    // example:
+    // vw 0 0 0.25 1 0.25 2 0.5
 
-      vw.push_back(sw);
-    }
+    // TODO(syoyo): Add syntax check
+    int vid = 0;
+    vid = parseInt(&token);
 
-    warning_context context;
-    context.warn = warn;
-    context.line_number = line_num;
+    skin_weight_t sw;
 
-    // line
-    if (token[0] == 'l' && IS_SPACE((token[1]))) {
-      token += 2;
+    sw.vertex_id = vid;
 
-      __line_t line;
+    while (!IS_NEW_LINE(token[0])) {
+      real_t j, w;
+      // joint_id should not be negative, weight may be negative
+      // TODO(syoyo): # of elements check
+      parseReal2(&j, &w, &token, -1.0);
 
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi, context)) {
-          if (err) {
-            (*err) +=
-                "Failed to parse `l' line (e.g. a zero value for vertex index. "
-                "Line " +
-                toString(line_num) + ").\n";
-          }
-          return false;
+      if (j < static_cast<real_t>(0)) {
+        if (err) {
+          std::stringstream ss;
+          ss << "Failed parse `vw' line. joint_id is negative. "
+                "line "
+             << line_num << ".)\n";
+          (*err) += ss.str();
         }
+        return false;
+      }
 
-        line.vertex_indices.push_back(vi);
+      joint_and_weight_t jw;
 
-        size_t n = strspn(token, " \t\r");
-        token += n;
-      }
+      jw.joint_id = int(j);
+      jw.weight = w;
 
-      prim_group.lineGroup.push_back(line);
+      sw.weightValues.push_back(jw);
 
-      continue;
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    // points
-    if (token[0] == 'p' && IS_SPACE((token[1]))) {
-      token += 2;
+    st->vw.push_back(sw);
+  }
 
-      __points_t pts;
+  warning_context context;
+  context.warn = warn;
+  context.line_number = line_num;
 
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi, context)) {
-          if (err) {
-            (*err) +=
-                "Failed to parse `p' line (e.g. a zero value for vertex index. "
-                "Line " +
-                toString(line_num) + ").\n";
-          }
-          return false;
+  // line
+  if (token[0] == 'l' && IS_SPACE((token[1]))) {
+    token += 2;
+
+    __line_t line;
+
+    while (!IS_NEW_LINE(token[0])) {
+      vertex_index_t vi;
+      if (!parseTriple(&token, static_cast<int>(v.size() / 3),
+                       static_cast<int>(vn.size() / 3),
+                       static_cast<int>(vt.size() / 2), &vi, context)) {
+        if (err) {
+          (*err) +=
+              "Failed to parse `l' line (e.g. a zero value for vertex index. "
+              "Line " +
+              toString(line_num) + ").\n";
         }
-
-        pts.vertex_indices.push_back(vi);
-
-        size_t n = strspn(token, " \t\r");
-        token += n;
+        return false;
       }
 
-      prim_group.pointsGroup.push_back(pts);
+      line.vertex_indices.push_back(vi);
 
-      continue;
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    // face
-    if (token[0] == 'f' && IS_SPACE((token[1]))) {
-      token += 2;
-      token += strspn(token, " \t");
-
-      face_t face;
+    prim_group.lineGroup.push_back(line);
 
-      face.smoothing_group_id = current_smoothing_id;
-      face.vertex_indices.reserve(3);
+    return true;
+  }
 
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi, context)) {
-          if (err) {
-            (*err) +=
-                "Failed to parse `f' line (e.g. a zero value for vertex index "
-                "or invalid relative vertex index). Line " +
-                toString(line_num) + ").\n";
-          }
-          return false;
+  // points
+  if (token[0] == 'p' && IS_SPACE((token[1]))) {
+    token += 2;
+
+    __points_t pts;
+
+    while (!IS_NEW_LINE(token[0])) {
+      vertex_index_t vi;
+      if (!parseTriple(&token, static_cast<int>(v.size() / 3),
+                       static_cast<int>(vn.size() / 3),
+                       static_cast<int>(vt.size() / 2), &vi, context)) {
+        if (err) {
+          (*err) +=
+              "Failed to parse `p' line (e.g. a zero value for vertex index. "
+              "Line " +
+              toString(line_num) + ").\n";
         }
+        return false;
+      }
 
-        greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
-        greatest_vn_idx =
-            greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
-        greatest_vt_idx =
-            greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
+      pts.vertex_indices.push_back(vi);
 
-        face.vertex_indices.push_back(vi);
-        size_t n = strspn(token, " \t\r");
-        token += n;
-      }
+      size_t n = strspn(token, " \t\r");
+      token += n;
+    }
 
-      // replace with emplace_back + std::move on C++11
-      prim_group.faceGroup.push_back(face);
+    prim_group.pointsGroup.push_back(pts);
 
-      continue;
+    return true;
+  }
+
+  // face
+  if (token[0] == 'f' && IS_SPACE((token[1]))) {
+    token += 2;
+    token += strspn(token, " \t");
+
+    st->raw_face.clear();
+    while (!IS_NEW_LINE(token[0])) {
+      st->raw_face.push_back(parseRawFaceTriple(&token));
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6))) {
-      token += 6;
-      std::string namebuf = parseString(&token);
+    if (st->raw_face.empty()) {
+      return addRawFace(st, NULL, 0, line_num, warn, err);
+    }
+    return addRawFace(st, &st->raw_face.at(0), st->raw_face.size(), line_num,
+                      warn, err);
+  }
 
-      int newMaterialId = -1;
-      std::map<std::string, int>::const_iterator it =
-          material_map.find(namebuf);
-      if (it != material_map.end()) {
-        newMaterialId = it->second;
-      } else {
-        // { error!! material not found }
-        if (warn) {
-          (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
-        }
-      }
+  // use mtl
+  if ((0 == strncmp(token, "usemtl", 6))) {
+    token += 6;
+    std::string namebuf = parseString(&token);
 
-      if (newMaterialId != material) {
-        // Create per-face material. Thus we don't add `shape` to `shapes` at
-        // this time.
-        // just clear `faceGroup` after `exportGroupsToShape()` call.
-        exportGroupsToShape(&shape, prim_group, tags, material, name,
-                            triangulate, v, warn);
-        prim_group.faceGroup.clear();
-        material = newMaterialId;
+    int newMaterialId = -1;
+    std::map<std::string, int>::const_iterator it =
+        st->material_map.find(namebuf);
+    if (it != st->material_map.end()) {
+      newMaterialId = it->second;
+    } else {
+      // { error!! material not found }
+      if (warn) {
+        (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
       }
+    }
 
-      continue;
+    if (newMaterialId != st->material) {
+      // Create per-face material. Thus we don't add `shape` to `shapes` at
+      // this time.
+      // just clear `faceGroup` after `exportGroupsToShape()` call.
+      exportGroupsToShape(&shape, prim_group, st->tags, st->material, st->name,
+                          triangulate, v, warn);
+      prim_group.faceGroup.clear();
+      st->material = newMaterialId;
     }
 
-    // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
-      if (readMatFn) {
-        token += 7;
+    return true;
+  }
 
-        std::vector<std::string> filenames;
-        SplitString(std::string(token), ' ', '\\', filenames);
+  // load mtl
+  if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+    if (readMatFn) {
+      token += 7;
 
-        if (filenames.empty()) {
-          if (warn) {
-            std::stringstream ss;
-            ss << "Looks like empty filename for mtllib. Use default "
-                  "material (line "
-               << line_num << ".)\n";
+      std::vector<std::string> filenames;
+      SplitString(std::string(token), ' ', '\\', filenames);
+
+      if (filenames.empty()) {
+        if (warn) {
+          std::stringstream ss;
+          ss << "Looks like empty filename for mtllib. Use default "
+                "material (line "
+             << line_num << ".)\n";
 
-            (*warn) += ss.str();
+          (*warn) += ss.str();
+        }
+      } else {
+        bool found = false;
+        for (size_t s = 0; s < filenames.size(); s++) {
+          if (st->material_filenames.count(filenames[s]) > 0) {
+            found = true;
+            continue;
           }
-        } else {
-          bool found = false;
-          for (size_t s = 0; s < filenames.size(); s++) {
-            if (material_filenames.count(filenames[s]) > 0) {
-              found = true;
-              continue;
-            }
 
-            std::string warn_mtl;
-            std::string err_mtl;
-            bool ok = (*readMatFn)(filenames[s].c_str(), materials,
-                                   &material_map, &warn_mtl, &err_mtl);
-            if (warn && (!warn_mtl.empty())) {
-              (*warn) += warn_mtl;
-            }
+          std::string warn_mtl;
+          std::string err_mtl;
+          bool ok = (*readMatFn)(filenames[s].c_str(), materials,
+                                 &st->material_map, &warn_mtl, &err_mtl);
+          if (warn && (!warn_mtl.empty())) {
+            (*warn) += warn_mtl;
+          }
 
-            if (err && (!err_mtl.empty())) {
-              (*err) += err_mtl;
-            }
+          if (err && (!err_mtl.empty())) {
+            (*err) += err_mtl;
+          }
 
-            if (ok) {
-              found = true;
-              material_filenames.insert(filenames[s]);
-              break;
-            }
+          if (ok) {
+            found = true;
+            st->material_filenames.insert(filenames[s]);
+            break;
           }
+        }
 
-          if (!found) {
-            if (warn) {
-              (*warn) +=
-                  "Failed to load material file(s). Use default "
-                  "material.\n";
-            }
+        if (!found) {
+          if (warn) {
+            (*warn) +=
+                "Failed to load material file(s). Use default "
+                "material.\n";
           }
         }
       }
-
-      continue;
     }
 
-    // group name
-    if (token[0] == 'g' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
-                                     triangulate, v, warn);
-      (void)ret;  // return value not used.
+    return true;
+  }
 
-      if (shape.mesh.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
+  // group name
+  if (token[0] == 'g' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportGroupsToShape(&shape, prim_group, st->tags, st->material,
+                                   st->name, triangulate, v, warn);
+    (void)ret;  // return value not used.
 
-      shape = shape_t();
+    if (shape.mesh.indices.size() > 0) {
+      flushShape(&shape, shapes);
+    }
 
-      // material = -1;
-      prim_group.clear();
+    shape = shape_t();
 
-      std::vector<std::string> names;
+    // material = -1;
+    prim_group.clear();
 
-      while (!IS_NEW_LINE(token[0])) {
-        std::string str = parseString(&token);
-        names.push_back(str);
-        token += strspn(token, " \t\r");  // skip tag
-      }
+    std::vector<std::string> names;
 
-      // names[0] must be 'g'
+    while (!IS_NEW_LINE(token[0])) {
+      std::string str = parseString(&token);
+      names.push_back(str);
+      token += strspn(token, " \t\r");  // skip tag
+    }
 
-      if (names.size() < 2) {
-        // 'g' with empty names
-        if (warn) {
-          std::stringstream ss;
-          ss << "Empty group name. line: " << line_num << "\n";
-          (*warn) += ss.str();
-          name = "";
-        }
-      } else {
-        std::stringstream ss;
-        ss << names[1];
+    // names[0] must be 'g'
 
-        // tinyobjloader does not support multiple groups for a primitive.
-        // Currently we concatinate multiple group names with a space to get
-        // single group name.
+    if (names.size() < 2) {
+      // 'g' with empty names
+      if (warn) {
+        std::stringstream ss;
+        ss << "Empty group name. line: " << line_num << "\n";
+        (*warn) += ss.str();
+        st->name = "";
+      }
+    } else {
+      std::stringstream ss;
+      ss << names[1];
 
-        for (size_t i = 2; i < names.size(); i++) {
-          ss << " " << names[i];
-        }
+      // tinyobjloader does not support multiple groups for a primitive.
+      // Currently we concatinate multiple group names with a space to get
+      // single group name.
 
-        name = ss.str();
+      for (size_t i = 2; i < names.size(); i++) {
+        ss << " " << names[i];
       }
 
-      continue;
+      st->name = ss.str();
     }
 
-    // object name
-    if (token[0] == 'o' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
-                                     triangulate, v, warn);
-      (void)ret;  // return value not used.
-
-      if (shape.mesh.indices.size() > 0 || shape.lines.indices.size() > 0 ||
-          shape.points.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
-
-      // material = -1;
-      prim_group.clear();
-      shape = shape_t();
+    return true;
+  }
 
-      // @todo { multiple object name? }
-      token += 2;
-      std::stringstream ss;
-      ss << token;
-      name = ss.str();
+  // object name
+  if (token[0] == 'o' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportGroupsToShape(&shape, prim_group, st->tags, st->material,
+                                   st->name, triangulate, v, warn);
+    (void)ret;  // return value not used.
 
-      continue;
+    if (shape.mesh.indices.size() > 0 || shape.lines.indices.size() > 0 ||
+        shape.points.indices.size() > 0) {
+      flushShape(&shape, shapes);
     }
 
-    if (token[0] == 't' && IS_SPACE(token[1])) {
-      const int max_tag_nums = 8192;  // FIXME(syoyo): Parameterize.
-      tag_t tag;
+    // material = -1;
+    prim_group.clear();
+    shape = shape_t();
 
-      token += 2;
+    // @todo { multiple object name? }
+    token += 2;
+    std::stringstream ss;
+    ss << token;
+    st->name = ss.str();
 
-      tag.name = parseString(&token);
+    return true;
+  }
 
-      tag_sizes ts = parseTagTriple(&token);
+  if (token[0] == 't' && IS_SPACE(token[1])) {
+    const int max_tag_nums = 8192;  // FIXME(syoyo): Parameterize.
+    tag_t tag;
 
-      if (ts.num_ints < 0) {
-        ts.num_ints = 0;
-      }
-      if (ts.num_ints > max_tag_nums) {
-        ts.num_ints = max_tag_nums;
-      }
+    token += 2;
 
-      if (ts.num_reals < 0) {
-        ts.num_reals = 0;
-      }
-      if (ts.num_reals > max_tag_nums) {
-        ts.num_reals = max_tag_nums;
-      }
+    tag.name = parseString(&token);
 
-      if (ts.num_strings < 0) {
-        ts.num_strings = 0;
-      }
-      if (ts.num_strings > max_tag_nums) {
-        ts.num_strings = max_tag_nums;
-      }
+    tag_sizes ts = parseTagTriple(&token);
 
-      tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+    if (ts.num_ints < 0) {
+      ts.num_ints = 0;
+    }
+    if (ts.num_ints > max_tag_nums) {
+      ts.num_ints = max_tag_nums;
+    }
 
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
-        tag.intValues[i] = parseInt(&token);
-      }
+    if (ts.num_reals < 0) {
+      ts.num_reals = 0;
+    }
+    if (ts.num_reals > max_tag_nums) {
+      ts.num_reals = max_tag_nums;
+    }
 
-      tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
-        tag.floatValues[i] = parseReal(&token);
-      }
+    if (ts.num_strings < 0) {
+      ts.num_strings = 0;
+    }
+    if (ts.num_strings > max_tag_nums) {
+      ts.num_strings = max_tag_nums;
+    }
 
-      tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
-        tag.stringValues[i] = parseString(&token);
-      }
+    tag.intValues.resize(static_cast<size_t>(ts.num_ints));
 
-      tags.push_back(tag);
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
+      tag.intValues[i] = parseInt(&token);
+    }
 
-      continue;
+    tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
+      tag.floatValues[i] = parseReal(&token);
     }
 
-    if (token[0] == 's' && IS_SPACE(token[1])) {
-      // smoothing group id
-      token += 2;
+    tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
+      tag.stringValues[i] = parseString(&token);
+    }
 
-      // skip space.
-      token += strspn(token, " \t");  // skip space
+    st->tags.push_back(tag);
 
-      if (token[0] == '\0') {
-        continue;
-      }
+    return true;
+  }
 
-      if (token[0] == '\r' || token[1] == '\n') {
-        continue;
-      }
+  if (token[0] == 's' && IS_SPACE(token[1])) {
+    // smoothing group id
+    token += 2;
+
+    // skip space.
+    token += strspn(token, " \t");  // skip space
+
+    if (token[0] == '\0') {
+      return true;
+    }
+
+    if (token[0] == '\r' || token[1] == '\n') {
+      return true;
+    }
 
-      if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' &&
-          token[2] == 'f') {
-        current_smoothing_id = 0;
+    if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' &&
+        token[2] == 'f') {
+      st->current_smoothing_id = 0;
+    } else {
+      // assume number
+      int smGroupId = parseInt(&token);
+      if (smGroupId < 0) {
+        // parse error. force set to 0.
+        // FIXME(syoyo): Report warning.
+        st->current_smoothing_id = 0;
       } else {
-        // assume number
-        int smGroupId = parseInt(&token);
-        if (smGroupId < 0) {
-          // parse error. force set to 0.
-          // FIXME(syoyo): Report warning.
-          current_smoothing_id = 0;
-        } else {
-          current_smoothing_id = static_cast<unsigned int>(smGroupId);
-        }
+        st->current_smoothing_id = static_cast<unsigned int>(smGroupId);
       }
+    }
 
-      continue;
-    }  // smoothing group id
+    return true;
+  }  // smoothing group id
 
-    // Ignore unknown command.
-  }
+  // Ignore unknown command.
+  return true;
+}
 
+// Flushes the last shape and moves parsed attributes to `attrib`.
+static void finishObjLoad(obj_load_state *st, size_t line_num,
+                          attrib_t *attrib, std::vector<shape_t> *shapes,
+                          bool triangulate, bool default_vcols_fallback,
+                          std::string *warn) {
   // not all vertices have colors, no default colors desired? -> clear colors
-  if (!found_all_colors && !default_vcols_fallback) {
-    vc.clear();
+  if (!st->found_all_colors && !default_vcols_fallback) {
+    st->vc.clear();
   }
 
-  if (greatest_v_idx >= static_cast<int>(v.size() / 3)) {
+  if (st->greatest_v_idx >= static_cast<int>(st->v.size() / 3)) {
     if (warn) {
       std::stringstream ss;
       ss << "Vertex indices out of bounds (line " << line_num << ".)\n\n";
       (*warn) += ss.str();
     }
   }
-  if (greatest_vn_idx >= static_cast<int>(vn.size() / 3)) {
+  if (st->greatest_vn_idx >= static_cast<int>(st->vn.size() / 3)) {
     if (warn) {
       std::stringstream ss;
       ss << "Vertex normal indices out of bounds (line " << line_num
@@ -3118,7 +3846,7 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
       (*warn) += ss.str();
     }
   }
-  if (greatest_vt_idx >= static_cast<int>(vt.size() / 2)) {
+  if (st->greatest_vt_idx >= static_cast<int>(st->vt.size() / 2)) {
     if (warn) {
       std::stringstream ss;
       ss << "Vertex texcoord indices out of bounds (line " << line_num
@@ -3127,33 +3855,487 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
     }
   }
 
-  bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
-                                 triangulate, v, warn);
+  bool ret = exportGroupsToShape(&st->shape, st->prim_group, st->tags,
+                                 st->material, st->name, triangulate, st->v,
+                                 warn);
   // exportGroupsToShape return false when `usemtl` is called in the last
   // line.
   // we also add `shape` to `shapes` when `shape.mesh` has already some
   // faces(indices)
-  if (ret || shape.mesh.indices
+  if (ret || st->shape.mesh.indices
                  .size()) {  // FIXME(syoyo): Support other prims(e.g. lines)
-    shapes->push_back(shape);
+    flushShape(&st->shape, shapes);
   }
-  prim_group.clear();  // for safety
+  st->prim_group.clear();  // for safety
+
+  attrib->vertices.swap(st->v);
+  attrib->vertex_weights.swap(st->vertex_weights);
+  attrib->normals.swap(st->vn);
+  attrib->texcoords.swap(st->vt);
+  attrib->texcoord_ws.swap(st->vt);
+  attrib->colors.swap(st->vc);
+  attrib->skin_weights.swap(st->vw);
+}
 
-  if (err) {
-    (*err) += errss.str();
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *warn,
+             std::string *err, std::istream *inStream,
+             MaterialReader *readMatFn /*= NULL*/, bool triangulate,
+             bool default_vcols_fallback) {
+  obj_load_state st;
+
+  size_t line_num = 0;
+  std::string linebuf;
+  while (inStream->peek() != -1) {
+    safeGetline(*inStream, linebuf);
+
+    line_num++;
+
+    // Trim newline '\r\n' or '\n'
+    if (linebuf.size() > 0) {
+      if (linebuf[linebuf.size() - 1] == '\n')
+        linebuf.erase(linebuf.size() - 1);
+    }
+    if (linebuf.size() > 0) {
+      if (linebuf[linebuf.size() - 1] == '\r')
+        linebuf.erase(linebuf.size() - 1);
+    }
+
+    // Skip if empty line.
+    if (linebuf.empty()) {
+      continue;
+    }
+
+    // Skip leading space.
+    const char *token = linebuf.c_str();
+    token += strspn(token, " \t");
+
+    assert(token);
+    if (token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    if (!parseObjLine(&st, token, line_num, shapes, materials, readMatFn,
+                      triangulate, default_vcols_fallback, warn, err)) {
+      return false;
+    }
+  }
+
+  finishObjLoad(&st, line_num, attrib, shapes, triangulate,
+                default_vcols_fallback, warn);
+
+  return true;
+}
+
+// Returns the end of the line starting at `p`(excluding newline) and sets
+// `next` to the beginning of the next line. Same line breaking rule as
+// `safeGetline`(LF, CR and CRLF).
+static const char *findLineEnd(const char *p, const char *end,
+                               const char **next) {
+  while (p < end && (*p) != '\n' && (*p) != '\r') {
+    p++;
+  }
+  const char *line_end = p;
+  if (p < end) {
+    if ((*p) == '\r' && (p + 1) < end && p[1] == '\n') {
+      p += 2;
+    } else {
+      p++;
+    }
+  }
+  (*next) = p;
+  return line_end;
+}
+
+// Returns true for `v`, `vn`, `vt` and `f` lines. These are tokenized in
+// place(without copying the line) when they are terminated by LF.
+static bool isInPlaceObjLine(const char *token, const char *line_end) {
+  size_t n = static_cast<size_t>(line_end - token);
+  if (n >= 2 && (token[0] == 'v' || token[0] == 'f') && IS_SPACE(token[1])) {
+    return true;
+  }
+  if (n >= 3 && token[0] == 'v' && (token[1] == 'n' || token[1] == 't') &&
+      IS_SPACE(token[2])) {
+    return true;
+  }
+  return false;
+}
+
+// Returns true when the line ending at `line_end` is terminated by LF(or
+// CRLF) within the buffer. Token parsers stop at LF, but not at CR alone or
+// at the end of a non NULL terminated buffer.
+static bool hasLineFeed(const char *line_end, const char *end) {
+  if (line_end >= end) {
+    return false;
+  }
+  if (line_end[0] == '\r') {
+    return ((line_end + 1) < end) && (line_end[1] == '\n');
+  }
+  return line_end[0] == '\n';
+}
+
+bool LoadObjFromBuffer(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *warn,
+                       std::string *err, const char *buf, size_t len,
+                       MaterialReader *readMatFn /*= NULL*/, bool triangulate,
+                       bool default_vcols_fallback) {
+  obj_load_state st;
+
+  const char *end = buf + len;
+
+  size_t line_num = 0;
+  std::string linebuf;  // only used for lines which can't be parsed in place
+  const char *p = buf;
+  while (p < end) {
+    const char *next;
+    const char *line_end = findLineEnd(p, end, &next);
+    const char *line_begin = p;
+    p = next;
+
+    line_num++;
+
+    // Skip leading space.
+    const char *token = line_begin;
+    while (token < line_end && IS_SPACE(token[0])) {
+      token++;
+    }
+
+    if (token == line_end || token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    if (!isInPlaceObjLine(token, line_end) || !hasLineFeed(line_end, end)) {
+      linebuf.assign(line_begin, line_end);
+      token = linebuf.c_str();
+      token += strspn(token, " \t");
+    }
+
+    if (!parseObjLine(&st, token, line_num, shapes, materials, readMatFn,
+                      triangulate, default_vcols_fallback, warn, err)) {
+      return false;
+    }
+  }
+
+  finishObjLoad(&st, line_num, attrib, shapes, triangulate,
+                default_vcols_fallback, warn);
+
+  return true;
+}
+
+#ifdef TINYOBJLOADER_HAS_THREADS
+
+// Chunked parallel loading.
+//
+// The input is split into newline aligned chunks. Each thread parses `v`,
+// `vn`, `vt` and `f` lines of its chunk(the hot path, dominated by number
+// parsing) into chunk-local buffers. Face indices are kept raw since relative
+// indices depend on the number of attributes defined before the face.
+// All other lines are recorded and replayed in file order during a serial
+// merge, which runs the same state machine as `LoadObj` so the result is
+// identical to serial loading.
+
+// Minimum chunk size. Avoid spawning threads for small files.
+static const size_t kMinObjChunkSize = 256 * 1024;
+
+struct obj_chunk_command_t {
+  bool is_face;     // true: `f`, false: other line to be replayed.
+  size_t line_num;  // chunk-local line number(1-based)
+  size_t offset;    // face: offset in `face_indices`, other: offset in buffer
+  size_t length;    // face: # of vertices, other: # of bytes in line
+  size_t num_v;     // # of `v` lines in the chunk before this line
+  size_t num_vn;
+  size_t num_vt;
+};
+
+struct obj_chunk_t {
+  std::vector<real_t> v;
+  std::vector<real_t> vertex_weights;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  std::vector<vertex_index_t> face_indices;  // raw index triples
+  std::vector<obj_chunk_command_t> commands;
+  size_t num_lines;
+  bool found_all_colors;
+
+  obj_chunk_t() : num_lines(0), found_all_colors(true) {}
+};
+
+static void parseObjChunk(const char *begin, const char *end,
+                          bool default_vcols_fallback, obj_chunk_t *chunk) {
+  std::string linebuf;
+
+  const char *p = begin;
+  while (p < end) {
+    const char *next;
+    const char *line_end = findLineEnd(p, end, &next);
+    const char *line_begin = p;
+    p = next;
+
+    chunk->num_lines++;
+
+    // Skip leading space.
+    const char *token = line_begin;
+    while (token < line_end && IS_SPACE(token[0])) {
+      token++;
+    }
+
+    if (token == line_end || token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    obj_chunk_command_t command;
+    command.line_num = chunk->num_lines;
+    command.num_v = chunk->v.size() / 3;
+    command.num_vn = chunk->vn.size() / 3;
+    command.num_vt = chunk->vt.size() / 2;
+
+    if (!isInPlaceObjLine(token, line_end)) {
+      // Other lines are replayed in merge.
+      command.is_face = false;
+      command.offset = static_cast<size_t>(line_begin - begin);
+      command.length = static_cast<size_t>(line_end - line_begin);
+      chunk->commands.push_back(command);
+      continue;
+    }
+
+    if (!hasLineFeed(line_end, end)) {
+      linebuf.assign(line_begin, line_end);
+      token = linebuf.c_str();
+      token += strspn(token, " \t");
+    }
+
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1]))) {
+      token += 2;
+      real_t x, y, z;
+      real_t r, g, b;
+
+      int num_components =
+          parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+      chunk->found_all_colors &= (num_components == 6);
+
+      chunk->v.push_back(x);
+      chunk->v.push_back(y);
+      chunk->v.push_back(z);
+
+      chunk->vertex_weights.push_back(r);
+
+      if ((num_components == 6) || default_vcols_fallback) {
+        chunk->vc.push_back(r);
+        chunk->vc.push_back(g);
+        chunk->vc.push_back(b);
+      }
+      continue;
+    }
+
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y, z;
+      parseReal3(&x, &y, &z, &token);
+      chunk->vn.push_back(x);
+      chunk->vn.push_back(y);
+      chunk->vn.push_back(z);
+      continue;
+    }
+
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y;
+      parseReal2(&x, &y, &token);
+      chunk->vt.push_back(x);
+      chunk->vt.push_back(y);
+      continue;
+    }
+
+    // face
+    token += 2;
+    token += strspn(token, " \t");
+
+    command.is_face = true;
+    command.offset = chunk->face_indices.size();
+
+    while (!IS_NEW_LINE(token[0])) {
+      chunk->face_indices.push_back(parseRawFaceTriple(&token));
+      size_t n = strspn(token, " \t\r");
+      token += n;
+    }
+
+    command.length = chunk->face_indices.size() - command.offset;
+    chunk->commands.push_back(command);
+  }
+}
+
+// Appends chunk attributes up to the given counts to the load state.
+static void flushChunkAttribs(obj_load_state *st, const obj_chunk_t &chunk,
+                              size_t num_v, size_t num_vn, size_t num_vt,
+                              size_t *cur_v, size_t *cur_vn, size_t *cur_vt) {
+  if (num_v > (*cur_v)) {
+    st->v.insert(st->v.end(), chunk.v.begin() + std::ptrdiff_t(3 * (*cur_v)),
+                 chunk.v.begin() + std::ptrdiff_t(3 * num_v));
+    (*cur_v) = num_v;
+  }
+  if (num_vn > (*cur_vn)) {
+    st->vn.insert(st->vn.end(),
+                  chunk.vn.begin() + std::ptrdiff_t(3 * (*cur_vn)),
+                  chunk.vn.begin() + std::ptrdiff_t(3 * num_vn));
+    (*cur_vn) = num_vn;
+  }
+  if (num_vt > (*cur_vt)) {
+    st->vt.insert(st->vt.end(),
+                  chunk.vt.begin() + std::ptrdiff_t(2 * (*cur_vt)),
+                  chunk.vt.begin() + std::ptrdiff_t(2 * num_vt));
+    (*cur_vt) = num_vt;
+  }
+}
+
+bool LoadObjParallelFromBuffer(attrib_t *attrib, std::vector<shape_t> *shapes,
+                               std::vector<material_t> *materials,
+                               std::string *warn, std::string *err,
+                               const char *buf, size_t len,
+                               MaterialReader *readMatFn /*= NULL*/,
+                               bool triangulate, bool default_vcols_fallback,
+                               unsigned int num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+
+  size_t num_chunks = len / kMinObjChunkSize;
+  if (num_chunks > num_threads) {
+    num_chunks = num_threads;
+  }
+  if (num_chunks == 0) {
+    num_chunks = 1;
+  }
+
+  // Split at '\n' so that no line(including CRLF) spans two chunks.
+  std::vector<size_t> chunk_begin(num_chunks + 1);
+  chunk_begin[0] = 0;
+  chunk_begin[num_chunks] = len;
+  for (size_t c = 1; c < num_chunks; c++) {
+    size_t pos = (len / num_chunks) * c;
+    if (pos < chunk_begin[c - 1]) {
+      pos = chunk_begin[c - 1];
+    }
+    while (pos < len && buf[pos] != '\n') {
+      pos++;
+    }
+    chunk_begin[c] = (pos < len) ? pos + 1 : len;
+  }
+
+  std::vector<obj_chunk_t> chunks(num_chunks);
+  {
+    std::vector<std::thread> workers;
+    for (size_t c = 1; c < num_chunks; c++) {
+      workers.push_back(std::thread(
+          parseObjChunk, buf + chunk_begin[c], buf + chunk_begin[c + 1],
+          default_vcols_fallback, &chunks[c]));
+    }
+    parseObjChunk(buf + chunk_begin[0], buf + chunk_begin[1],
+                  default_vcols_fallback, &chunks[0]);
+    for (size_t t = 0; t < workers.size(); t++) {
+      workers[t].join();
+    }
+  }
+
+  // Merge in file order.
+  obj_load_state st;
+
+  size_t total_v = 0, total_vn = 0, total_vt = 0, total_vc = 0;
+  for (size_t c = 0; c < num_chunks; c++) {
+    total_v += chunks[c].v.size();
+    total_vn += chunks[c].vn.size();
+    total_vt += chunks[c].vt.size();
+    total_vc += chunks[c].vc.size();
+  }
+  st.v.reserve(total_v);
+  st.vertex_weights.reserve(total_v / 3);
+  st.vn.reserve(total_vn);
+  st.vt.reserve(total_vt);
+  st.vc.reserve(total_vc);
+
+  size_t line_base = 0;
+  std::string linebuf;
+  for (size_t c = 0; c < num_chunks; c++) {
+    const obj_chunk_t &chunk = chunks[c];
+    const char *chunk_buf = buf + chunk_begin[c];
+
+    size_t cur_v = 0, cur_vn = 0, cur_vt = 0;
+
+    for (size_t i = 0; i < chunk.commands.size(); i++) {
+      const obj_chunk_command_t &command = chunk.commands[i];
+
+      flushChunkAttribs(&st, chunk, command.num_v, command.num_vn,
+                        command.num_vt, &cur_v, &cur_vn, &cur_vt);
+
+      size_t line_num = line_base + command.line_num;
+
+      if (command.is_face) {
+        // an empty `f` line may be the last face, with offset at the end
+        const vertex_index_t *raw =
+            command.length ? &chunk.face_indices[command.offset] : NULL;
+        if (!addRawFace(&st, raw, command.length, line_num, warn, err)) {
+          return false;
+        }
+        continue;
+      }
+
+      linebuf.assign(chunk_buf + command.offset, command.length);
+
+      const char *token = linebuf.c_str();
+      token += strspn(token, " \t");
+
+      if (!parseObjLine(&st, token, line_num, shapes, materials, readMatFn,
+                        triangulate, default_vcols_fallback, warn, err)) {
+        return false;
+      }
+    }
+
+    flushChunkAttribs(&st, chunk, chunk.v.size() / 3, chunk.vn.size() / 3,
+                      chunk.vt.size() / 2, &cur_v, &cur_vn, &cur_vt);
+    st.vertex_weights.insert(st.vertex_weights.end(),
+                             chunk.vertex_weights.begin(),
+                             chunk.vertex_weights.end());
+    st.vc.insert(st.vc.end(), chunk.vc.begin(), chunk.vc.end());
+    st.found_all_colors &= chunk.found_all_colors;
+
+    line_base += chunk.num_lines;
+
+    // Release chunk memory early to keep peak memory low.
+    chunks[c] = obj_chunk_t();
   }
 
-  attrib->vertices.swap(v);
-  attrib->vertex_weights.swap(vertex_weights);
-  attrib->normals.swap(vn);
-  attrib->texcoords.swap(vt);
-  attrib->texcoord_ws.swap(vt);
-  attrib->colors.swap(vc);
-  attrib->skin_weights.swap(vw);
+  finishObjLoad(&st, line_base, attrib, shapes, triangulate,
+                default_vcols_fallback, warn);
 
   return true;
 }
 
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *warn,
+                     std::string *err, std::istream *inStream,
+                     MaterialReader *readMatFn /*= NULL*/, bool triangulate,
+                     bool default_vcols_fallback, unsigned int num_threads) {
+  std::string buf;
+  {
+    std::stringstream ss;
+    ss << inStream->rdbuf();
+    buf = ss.str();
+  }
+
+  return LoadObjParallelFromBuffer(attrib, shapes, materials, warn, err,
+                                   buf.data(), buf.size(), readMatFn,
+                                   triangulate, default_vcols_fallback,
+                                   num_threads);
+}
+
+#endif  // TINYOBJLOADER_HAS_THREADS
+
 bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
                          void *user_data /*= NULL*/,
                          MaterialReader *readMatFn /*= NULL*/,
@@ -3467,9 +4649,10 @@ bool ObjReader::ParseFromFile(const std::string &filename,
     mtl_search_path = config.mtl_search_path;
   }
 
-  valid_ = LoadObj(&attrib_, &shapes_, &materials_, &warning_, &error_,
-                   filename.c_str(), mtl_search_path.c_str(),
-                   config.triangulate, config.vertex_color);
+  valid_ = LoadObjFile(&attrib_, &shapes_, &materials_, &warning_, &error_,
+                       filename.c_str(), mtl_search_path.c_str(),
+                       config.triangulate, config.vertex_color,
+                       config.num_threads);
 
   return valid_;
 }
@@ -3477,16 +4660,25 @@ bool ObjReader::ParseFromFile(const std::string &filename,
 bool ObjReader::ParseFromString(const std::string &obj_text,
                                 const std::string &mtl_text,
                                 const ObjReaderConfig &config) {
-  std::stringbuf obj_buf(obj_text);
   std::stringbuf mtl_buf(mtl_text);
 
-  std::istream obj_ifs(&obj_buf);
   std::istream mtl_ifs(&mtl_buf);
 
   MaterialStreamReader mtl_ss(mtl_ifs);
 
-  valid_ = LoadObj(&attrib_, &shapes_, &materials_, &warning_, &error_,
-                   &obj_ifs, &mtl_ss, config.triangulate, config.vertex_color);
+#ifdef TINYOBJLOADER_HAS_THREADS
+  if (config.num_threads != 1) {
+    valid_ = LoadObjParallelFromBuffer(
+        &attrib_, &shapes_, &materials_, &warning_, &error_, obj_text.data(),
+        obj_text.size(), &mtl_ss, config.triangulate, config.vertex_color,
+        config.num_threads);
+    return valid_;
+  }
+#endif
+
+  valid_ = LoadObjFromBuffer(&attrib_, &shapes_, &materials_, &warning_,
+                             &error_, obj_text.data(), obj_text.size(),
+                             &mtl_ss, config.triangulate, config.vertex_color);
 
   return valid_;
 }
@@ -0,0 +1,76 @@
+/* vertexpack.h
+ * Compact vertex layout for uploading meshes.
+ *
+ * A float Vertex plus the color and light distance main.cpp adds to it take
+ * 48 bytes.  PackedVertex holds the same in 20: positions as 16-bit fixed
+ * point within the mesh bounds, normals octahedral-encoded into two snorm16,
+ * texcoords and distance as half floats and colors as RGBA8.  The GPU turns
+ * all of it back into floats for free when fetching; positions need a scale
+ * and offset applied in the vertex shader.
+ */
+
+
+#ifndef __vertexpack_h__
+#define __vertexpack_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+
+
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT,  /* Vertex, plus separate color and distance buffers */
+    VERTEX_FORMAT_PACKED  /* PackedVertex */
+};
+
+struct PackedVertex
+{
+    uint16_t position[3]; /* unorm16 within the bounds, GL_UNSIGNED_SHORT normalized */
+    uint16_t distance;    /* GL_HALF_FLOAT */
+    int16_t normal[2];    /* octahedral, GL_SHORT normalized */
+    uint16_t texcoord[2]; /* GL_HALF_FLOAT */
+    uint8_t color[4];     /* GL_UNSIGNED_BYTE normalized */
+};
+
+/* position = offset + scale * packed position / 65535 */
+struct PositionQuantization
+{
+    float offset[3];
+    float scale[3];
+};
+
+/* Largest difference between packed and float data, all in the units of the
+ * source except normals, which are in degrees.
+ */
+struct VertexPackError
+{
+    float position;
+    float normal;
+    float texcoord;
+    float color;
+    float distance;
+};
+
+uint16_t floatToHalf(float f);
+float halfToFloat(uint16_t h);
+
+/* Packs count vertices into out, which must have room for them.  colors holds
+ * three floats per vertex in [0, 1]; alpha is packed as 1.  The bounds of the
+ * positions are stored in quant, to be passed to the shader.  Zero normals,
+ * as streamObj() leaves for corners without one, come out as +z.
+ */
+void packVertices(const Vertex *vertices, const float *colors,
+                  const float *distances, size_t count,
+                  PackedVertex *out, PositionQuantization *quant);
+
+/* Decodes packed the way the GPU would and compares it to the source.
+ * Vertices with zero normals are left out of the normal error.
+ */
+VertexPackError measurePackError(const Vertex *vertices, const float *colors,
+                                 const float *distances, size_t count,
+                                 const PackedVertex *packed,
+                                 const PositionQuantization &quant);
+
+#endif
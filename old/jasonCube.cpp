@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <math.h>
 #include <bmpread.h>
+#include <mipmap.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -246,20 +247,32 @@ int main() {
 
     bmpread_t bitmap;
 
-    if(!bmpread("jason(3).bmp", 0, &bitmap)) {
+    if(!bmpread("jason(3).bmp", BMPREAD_ALPHA, &bitmap)) {
         std::cout << "Error reading texture" << std::endl;
         return -1;
     }
 
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t> pixels;
+    buildMipChain(bitmap.data, bitmap.width, bitmap.height, defaultMipOptions(), &levels, &pixels);
+    bmpread_free(&bitmap);
+
     GLuint texid;
     glGenTextures(1, &texid);
     glBindTexture(GL_TEXTURE_2D, texid);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bitmap.width, bitmap.height, 0, GL_RGB, GL_UNSIGNED_BYTE, bitmap.data);
+    // trilinear: blend the two nearest levels, each sampled bilinearly, so
+    // the cube doesn't shimmer as it shrinks
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for(size_t i = 0; i < levels.size(); i++) {
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     pixels.data() + levels[i].offset);
+    }
 
     GLuint attribTex;
     attribTex = glGetUniformLocation(shaderProgram, "tex");
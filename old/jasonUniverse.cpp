@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <math.h>
 #include <bmpread.h>
+#include <mipmap.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -252,9 +253,26 @@ int main() {
     GLuint attribTime;
     attribTime = glGetUniformLocation(shaderProgram, "time");
 
-    bmpread_t bitmap;
+    bmpread_info_t bitmap;
 
-    if(!bmpread("jason(3).bmp", 0, &bitmap)) {
+    if(!bmpread_info("jason(3).bmp", BMPREAD_ALPHA, &bitmap)) {
+        std::cout << "Error reading texture" << std::endl;
+        return -1;
+    }
+
+    // decode straight into the first level of a mip chain in a pixel unpack
+    // buffer, and filter the rest of the chain down from it there; mapped
+    // for reading too, since each level is read back to make the next
+    std::vector<MipLevel> levels;
+    size_t chainSize = mipChainLayout(bitmap.width, bitmap.height, &levels);
+    GLuint pixelBuffer;
+    glGenBuffers(1, &pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, chainSize, NULL, GL_STREAM_DRAW);
+    uint8_t *pixels = (uint8_t *)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_READ_WRITE);
+    bool decoded = pixels && bmpread_into("jason(3).bmp", BMPREAD_ALPHA, 0, pixels, 0, bitmap.data_len);
+    if(decoded) buildMipLevels(pixels, levels, defaultMipOptions());
+    if(!pixels || !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) || !decoded) {
         std::cout << "Error reading texture" << std::endl;
         return -1;
     }
@@ -263,11 +281,20 @@ int main() {
     glGenTextures(1, &texid);
     glBindTexture(GL_TEXTURE_2D, texid);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bitmap.width, bitmap.height, 0, GL_RGB, GL_UNSIGNED_BYTE, bitmap.data);
+    // trilinear: blend the two nearest levels, each sampled bilinearly, so
+    // far off cubes don't shimmer
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for(size_t i = 0; i < levels.size(); i++) {
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     (const void *)(uintptr_t)levels[i].offset);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &pixelBuffer);
 
     GLuint attribTex;
     attribTex = glGetUniformLocation(shaderProgram, "tex");
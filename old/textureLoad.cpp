@@ -131,9 +131,22 @@ int main() {
     glBindBuffer(GL_ARRAY_BUFFER, positionsData);
     glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions, GL_STATIC_DRAW);
 
-    bmpread_t bitmap;
+    bmpread_info_t bitmap;
 
-    if(!bmpread("texture.bmp", 0, &bitmap)) {
+    if(!bmpread_info("texture.bmp", 0, &bitmap)) {
+        std::cout << "Error reading texture" << std::endl;
+        return -1;
+    }
+
+    // decode straight into a pixel unpack buffer rather than into memory of
+    // our own that then gets copied
+    GLuint pixelBuffer;
+    glGenBuffers(1, &pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bitmap.data_len, NULL, GL_STREAM_DRAW);
+    void *pixels = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    bool decoded = pixels && bmpread_into("texture.bmp", 0, 1, pixels, 0, bitmap.data_len);
+    if(!pixels || !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) || !decoded) {
         std::cout << "Error reading texture" << std::endl;
         return -1;
     }
@@ -144,9 +157,11 @@ int main() {
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // bmpread pads lines to 4 bytes
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bitmap.width, bitmap.height, 0, GL_RGB, GL_UNSIGNED_BYTE, bitmap.data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bitmap.width, bitmap.height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &pixelBuffer);
 
     //attribs
     GLuint attribPosition;
@@ -0,0 +1,6 @@
+#version 120
+varying vec4 outColor;
+
+void main() {
+    gl_FragColor = outColor;
+}
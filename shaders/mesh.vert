@@ -0,0 +1,87 @@
+// #version and #defines are put in front by main.cpp
+
+//position, fixed point within the mesh bounds when packed
+attribute vec4 inPosition;
+//color
+attribute vec3 inColor;
+//normal, octahedral when packed
+#ifdef PACKED_VERTICES
+attribute vec2 inNormal;
+#else
+attribute vec3 inNormal;
+#endif
+
+//inPosition to model space, identity for float vertices
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+//time for rotation
+uniform float time;
+
+//surface -> light vector
+uniform vec3 light;
+
+//light color
+uniform vec3 lightColor;
+
+//diffuse color
+uniform vec3 diffuseColor;
+
+//model view projection matrix
+uniform mat4 mvp;
+
+//distance from surface to light
+attribute float distance;
+
+//output color
+varying vec4 outColor;
+
+//light power
+uniform float power;
+
+#ifdef PACKED_VERTICES
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n;
+}
+#endif
+
+void main() {
+    // float theta = time;
+    // float c = cos(theta);
+    // float s = sin(theta);
+    // mat4 rotationY = mat4(
+    //     c, 0, s, 0,
+    //     0, 1, 0, 0,
+    //     -s, 0, c, 0,
+    //     0, 0, 0, 1
+    // );
+    // mat4 rotationX = mat4(
+    //     1, 0, 0, 0,
+    //     0, c, -s, 0,
+    //     0, s, c, 0,
+    //     0, 0, 0, 1
+    // );
+
+    // outColor = vec4(inColor,1);
+    // gl_Position = mvp * rotationX * rotationY * inPosition;
+
+    vec3 ambientColor = lightColor * 0.1;
+
+#ifdef PACKED_VERTICES
+    vec3 n = normalize(octDecode(inNormal));
+#else
+    vec3 n = normalize(inNormal);
+#endif
+
+    vec3 l = normalize(light);
+
+    float cosTheta = clamp(dot(n, l), 0, 1);
+
+    outColor = vec4(ambientColor + diffuseColor * inColor * lightColor * power * cosTheta / (distance * distance), 1);
+    gl_Position = mvp * vec4(positionOffset + positionScale * inPosition.xyz, 1.0);
+
+}
@@ -0,0 +1,104 @@
+/* assetloader.cpp
+ * Loads assets on worker threads and uploads them on the GL thread.
+ */
+
+
+#include "assetloader.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+AssetLoader::AssetLoader(unsigned numThreads)
+    : stopping_(false), finished_(0), pending_(0)
+{
+    if(numThreads == 0) numThreads = std::thread::hardware_concurrency();
+    if(numThreads == 0) numThreads = 1;
+
+    threads_.reserve(numThreads);
+    for(unsigned t = 0; t < numThreads; t++) threads_.emplace_back(&AssetLoader::work, this);
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        loads_.clear();
+    }
+    wake_.notify_all();
+    for(size_t t = 0; t < threads_.size(); t++) threads_[t].join();
+
+    for(PendingUpload *upload = finished_.exchange(0); upload;) {
+        PendingUpload *next = upload->next_;
+        delete upload;
+        upload = next;
+    }
+    for(size_t i = 0; i < uploads_.size(); i++) delete uploads_[i];
+}
+
+void AssetLoader::load(std::function<PendingUpload *()> load)
+{
+    pending_++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loads_.push_back(load);
+    }
+    wake_.notify_one();
+}
+
+void AssetLoader::work()
+{
+    for(;;) {
+        std::function<PendingUpload *()> load;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !loads_.empty(); });
+            if(stopping_) return;
+            load = loads_.front();
+            loads_.pop_front();
+        }
+
+        PendingUpload *upload = load();
+        if(upload) {
+            finished(upload);
+        } else {
+            pending_--;
+        }
+    }
+}
+
+// pushes upload onto the finished list; release so the GL thread sees
+// everything the load wrote
+void AssetLoader::finished(PendingUpload *upload)
+{
+    upload->next_ = finished_.load(std::memory_order_relaxed);
+    while(!finished_.compare_exchange_weak(upload->next_, upload, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+size_t AssetLoader::upload(double budget)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+
+    // take the whole finished list at once, so no other thread can still be
+    // looking at its nodes, and put it back in the order loads finished
+    PendingUpload *list = finished_.exchange(0, std::memory_order_acquire);
+    size_t firstNew = uploads_.size();
+    for(; list; list = list->next_) uploads_.push_back(list);
+    std::reverse(uploads_.begin() + firstNew, uploads_.end());
+
+    size_t done = 0;
+    while(!uploads_.empty()) {
+        PendingUpload *upload = uploads_.front();
+        if(upload->uploadStep()) {
+            uploads_.pop_front();
+            delete upload;
+            pending_--;
+            done++;
+        }
+        if(std::chrono::duration<double>(Clock::now() - start).count() >= budget) break;
+    }
+    return done;
+}
@@ -27,6 +27,11 @@
  */
 
 
+/* fileno(), for mapping the file, is POSIX rather than standard C. */
+#if defined(__unix__) && !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "bmpread.h"
 
 #include <limits.h>
@@ -52,6 +57,57 @@
 #error "libbmpread requires CHAR_BIT == 8"
 #endif
 
+/* SIMD decoders for 24- and 32-bit files (see DecodeShuffled*() below).  On
+ * x86 they're picked at run time from what the CPU supports, which needs
+ * GCC's or Clang's target attribute and __builtin_cpu_supports().  AArch64
+ * always has NEON.  Define BMPREAD_NO_SIMD_DECODERS to build without them.
+ */
+#ifndef BMPREAD_NO_SIMD_DECODERS
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BMPREAD_X86_SIMD 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BMPREAD_NEON_SIMD 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+/* Pixel data is decoded from a memory mapping of the file, with mmap() on
+ * POSIX systems and MapViewOfFile() on Windows (see LoadPixels() below).
+ * Define BMPREAD_NO_MMAP to always read it with stdio instead.
+ */
+#ifndef BMPREAD_NO_MMAP
+#if defined(_WIN32)
+#define BMPREAD_MMAP 1
+#include <io.h>
+#elif defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define BMPREAD_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#endif
+
+/* bmpread_parallel() decodes on POSIX threads where there are any, which
+ * on Windows means MinGW's winpthreads.  Define BMPREAD_NO_THREADS to build
+ * without them, making it the same as bmpread().
+ */
+#if !defined(BMPREAD_NO_THREADS) && \
+    (defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)) || \
+     defined(__MINGW32__))
+#define BMPREAD_THREADS 1
+#include <pthread.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#endif
+
 
 /* Default value for alpha when none is present in the file. */
 #define BMPREAD_DEFAULT_ALPHA 255
@@ -411,11 +467,20 @@ typedef struct read_context
     uint32_t       after_headers; /* Size of space for palette. */
     int32_t        lines;         /* How many scan lines (abs(height)). */
     size_t         file_line_len; /* How many bytes each scan line is. */
+    size_t         pixels_len;    /* Bytes of pixel data (all scan lines). */
     size_t         out_channels;  /* Output color channels (3, or 4=alpha). */
     size_t         out_line_len;  /* Bytes in each output line. */
+    size_t         out_stride;    /* Bytes from one output line to the next. */
+    size_t         out_pad;       /* Bytes zeroed after each line's pixels. */
     bitfield       bitfields[4];  /* How to decode 16- and 32-bits. */
+    int            shuffled;      /* Nonzero if shuffle decodes pixels. */
+    uint8_t        shuffle[16];   /* Byte shuffle decoding four pixels. */
+    uint8_t        fill[16];      /* Bytes ORed into the shuffled pixels. */
     bmp_color    * palette;       /* Enough entries for our bit depth. */
-    uint8_t      * file_data;     /* A line of data in the file. */
+    uint8_t      * file_data;     /* A line, or all lines, of the file. */
+    const uint8_t* pixels;        /* All lines, mapped or in file_data. */
+    void         * map;           /* Mapping of the file, or NULL. */
+    size_t         map_len;       /* Bytes mapped. */
     uint8_t      * data_out;      /* RGB(A) data output buffer. */
 
 } read_context;
@@ -457,6 +522,65 @@ static int ValidateBitfields(read_context * p_ctx)
     return 1;
 }
 
+/* Marks in shuffle a byte that the shuffle zeroes. */
+#define SHUFFLE_ZERO 0x80
+
+/* Decoding 24-bit data, and 32-bit data whose bitfields all span whole bytes,
+ * only moves bytes around: each output byte is some byte of the same pixel in
+ * the file, or the default alpha.  This works out the pattern for four pixels
+ * at a time, which the SIMD decoders below apply with a single byte shuffle
+ * (and an OR to put the alpha in).  Sets shuffled if the image's pixels can be
+ * decoded this way.  Assumes the bitfields have been validated.
+ */
+static void SetupShuffle(read_context * p_ctx)
+{
+    const bitfield * bf = p_ctx->bitfields;
+    size_t in_span = p_ctx->info.bits / 8;
+
+    /* For each output channel, the byte of the file's pixel it comes from, or
+     * -1 for the default alpha.
+     */
+    int sources[4] = { 2, 1, 0, -1 };
+
+    size_t pixel;
+    size_t c;
+
+    if(p_ctx->info.bits == 32)
+    {
+        if(p_ctx->info.compression != COMPRESSION_BITFIELDS) return;
+
+        for(c = 0; c < p_ctx->out_channels; c++)
+        {
+            if(bf[c].span == 8 && bf[c].start % 8 == 0)
+                sources[c] = (int)(bf[c].start / 8);
+            else if(c == 3 && bf[c].span == 0)
+                sources[c] = -1;
+            else
+                return;
+        }
+    }
+    else if(p_ctx->info.bits != 24)
+        return;
+
+    memset(p_ctx->shuffle, SHUFFLE_ZERO, sizeof(p_ctx->shuffle));
+    memset(p_ctx->fill, 0, sizeof(p_ctx->fill));
+
+    for(pixel = 0; pixel < 4; pixel++)
+    {
+        for(c = 0; c < p_ctx->out_channels; c++)
+        {
+            size_t i = pixel * p_ctx->out_channels + c;
+
+            if(sources[c] < 0)
+                p_ctx->fill[i] = BMPREAD_DEFAULT_ALPHA;
+            else
+                p_ctx->shuffle[i] = (uint8_t)(pixel * in_span + sources[c]);
+        }
+    }
+
+    p_ctx->shuffled = 1;
+}
+
 /* A sub-function to Validate() that handles the palette.  Returns 0 on EOF or
  * invalid palette, or nonzero on success.
  */
@@ -597,13 +721,25 @@ static int Validate(read_context * p_ctx)
     if(!ValidateBitfields(p_ctx))      return 0;
     if(!ValidateAndReadPalette(p_ctx)) return 0;
 
-    /* Set things up for decoding. */
-    if(!(p_ctx->file_data = (uint8_t *)malloc(p_ctx->file_line_len))) return 0;
+    SetupShuffle(p_ctx);
 
+    /* Set things up for decoding.  The pixel data is read (or mapped) later,
+     * by LoadPixels(), but its size gets checked here with everything else.
+     */
     if(!CanMakeSizeT(p_ctx->lines))                           return 0;
+    if(!CanMultiply( p_ctx->lines, p_ctx->file_line_len))     return 0;
+    p_ctx->pixels_len = (size_t)p_ctx->lines * p_ctx->file_line_len;
+    if(!CanMakeSizeT(p_ctx->header.data_offset))              return 0;
+    if(!CanAdd(p_ctx->header.data_offset, p_ctx->pixels_len)) return 0;
+
     if(!CanMultiply( p_ctx->lines, p_ctx->out_line_len))      return 0;
-    if(!(p_ctx->data_out = (uint8_t *)
-         malloc((size_t)p_ctx->lines * p_ctx->out_line_len))) return 0;
+
+    /* Lines follow each other in the output, padding and all, unless
+     * bmpread_into() is given its own stride.
+     */
+    p_ctx->out_stride = p_ctx->out_line_len;
+    p_ctx->out_pad    = p_ctx->out_line_len -
+                        (size_t)p_ctx->info.width * p_ctx->out_channels;
 
     return 1;
 }
@@ -645,15 +781,21 @@ static uint32_t Make8Bits(uint32_t value, uint32_t bitspan)
                                ((uint32_t)(buf)[2] << 16) + \
                                ((uint32_t)(buf)[3] << 24))
 
+/* The decoders below all take a pointer to an output buffer scan line (p_out),
+ * a pointer to the end of the *pixel data* of this scan line (p_out_end), a
+ * pointer to the source scan line of file data (p_file), and our context.
+ */
+typedef void (* line_decoder)(uint8_t *,
+                              const uint8_t *,
+                              const uint8_t *,
+                              const read_context *);
+
 /* Decodes 32-bit bitmap data by applying bitmasks.  The 16- and 32-bit
  * decoders could be made more efficient by whitelisting supported bit patterns
  * ahead of time and special-casing their decoding here, but this allows us to
  * support more bitmask patterns, and shouldn't be *too* inefficient in any
- * case.
- *
- * Takes a pointer to an output buffer scan line (p_out), a pointer to the end
- * of the *pixel data* of this scan line (p_out_end), a pointer to the source
- * scan line of file data (p_file), and our context.
+ * case.  Files with whole-byte bitfields get a SIMD decoder instead where
+ * there is one.
  */
 static void Decode32(uint8_t * p_out,
                      const uint8_t * p_out_end,
@@ -682,7 +824,7 @@ static void Decode32(uint8_t * p_out,
 }
 
 /* Decodes 24-bit bitmap data--basically just swaps the order of color
- * components.
+ * components.  A SIMD decoder does this instead where there is one.
  */
 static void Decode24(uint8_t * p_out,
                      const uint8_t * p_out_end,
@@ -701,6 +843,249 @@ static void Decode24(uint8_t * p_out,
     }
 }
 
+#if defined(BMPREAD_X86_SIMD) || defined(BMPREAD_NEON_SIMD)
+
+/* The SIMD decoders shuffle four pixels at a time, using SetupShuffle()'s
+ * pattern, with 16-byte loads and stores.  At three bytes per pixel, in the
+ * file or the output, those run four bytes past the four pixels; the next
+ * block's store overwrites the extra output bytes.  This returns how far into
+ * a scan line of the given number of pixels blocks can go while staying
+ * inside it: a block starting at pixel i is safe if i + 4 <= the result.
+ */
+static size_t ShuffleEnd(size_t pixels, const read_context * p_ctx)
+{
+    if(p_ctx->info.bits == 32 && p_ctx->out_channels == 4)
+        return pixels;
+
+    return (pixels > 2) ? pixels - 2 : 0;
+}
+
+/* Decodes the pixels of a scan line from pixel first on with Decode24() or
+ * Decode32(), finishing off after a SIMD decoder.
+ */
+static void DecodeRest(uint8_t * p_out,
+                       const uint8_t * p_out_end,
+                       const uint8_t * p_file,
+                       size_t first,
+                       const read_context * p_ctx)
+{
+    p_out  += first * p_ctx->out_channels;
+    p_file += first * (p_ctx->info.bits / 8);
+
+    if(p_ctx->info.bits == 32)
+        Decode32(p_out, p_out_end, p_file, p_ctx);
+    else
+        Decode24(p_out, p_out_end, p_file, p_ctx);
+}
+
+#endif
+
+#ifdef BMPREAD_X86_SIMD
+
+/* Decodes 24- or 32-bit data SetupShuffle() set up for, 16 pixels at a time,
+ * with SSSE3's byte shuffle.  (SSE2 alone has nothing that can do it without
+ * unpacking every channel.)  Otherwise the same as Decode24() and Decode32().
+ */
+__attribute__((target("ssse3")))
+static void DecodeShuffledSSSE3(uint8_t * p_out,
+                                const uint8_t * p_out_end,
+                                const uint8_t * p_file,
+                                const read_context * p_ctx)
+{
+    size_t in_span  = p_ctx->info.bits / 8;
+    size_t out_span = p_ctx->out_channels;
+    size_t end      = ShuffleEnd((size_t)(p_out_end - p_out) / out_span, p_ctx);
+    size_t i;
+
+    __m128i shuffle = _mm_loadu_si128((const __m128i *)p_ctx->shuffle);
+    __m128i fill    = _mm_loadu_si128((const __m128i *)p_ctx->fill);
+
+    for(i = 0; i + 16 <= end; i += 16)
+    {
+        const uint8_t * in = p_file + i * in_span;
+        uint8_t * out = p_out + i * out_span;
+
+        __m128i a = _mm_loadu_si128((const __m128i *)(in               ));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in +  4 * in_span));
+        __m128i c = _mm_loadu_si128((const __m128i *)(in +  8 * in_span));
+        __m128i d = _mm_loadu_si128((const __m128i *)(in + 12 * in_span));
+
+        a = _mm_or_si128(_mm_shuffle_epi8(a, shuffle), fill);
+        b = _mm_or_si128(_mm_shuffle_epi8(b, shuffle), fill);
+        c = _mm_or_si128(_mm_shuffle_epi8(c, shuffle), fill);
+        d = _mm_or_si128(_mm_shuffle_epi8(d, shuffle), fill);
+
+        /* In order, so each store's extra bytes are overwritten. */
+        _mm_storeu_si128((__m128i *)(out                ), a);
+        _mm_storeu_si128((__m128i *)(out +  4 * out_span), b);
+        _mm_storeu_si128((__m128i *)(out +  8 * out_span), c);
+        _mm_storeu_si128((__m128i *)(out + 12 * out_span), d);
+    }
+
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p_file + i * in_span));
+        a = _mm_or_si128(_mm_shuffle_epi8(a, shuffle), fill);
+        _mm_storeu_si128((__m128i *)(p_out + i * out_span), a);
+    }
+
+    DecodeRest(p_out, p_out_end, p_file, i, p_ctx);
+}
+
+/* Loads eight pixels for DecodeShuffledAVX2(), four to each 128-bit lane,
+ * since its byte shuffle can't cross lanes.
+ */
+__attribute__((target("avx2")))
+static __m256i Load8(const uint8_t * in, size_t in_span)
+{
+    if(in_span == 4)
+        return _mm256_loadu_si256((const __m256i *)in);
+
+    return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+            _mm_loadu_si128((const __m128i *)(in + 4 * in_span)), 1);
+}
+
+/* Stores eight pixels shuffled from what Load8() loaded. */
+__attribute__((target("avx2")))
+static void Store8(uint8_t * out, __m256i v, size_t out_span)
+{
+    if(out_span == 4)
+    {
+        _mm256_storeu_si256((__m256i *)out, v);
+        return;
+    }
+
+    _mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(v));
+    _mm_storeu_si128((__m128i *)(out + 4 * out_span),
+                     _mm256_extracti128_si256(v, 1));
+}
+
+/* DecodeShuffledSSSE3() with AVX2, 32 pixels at a time. */
+__attribute__((target("avx2")))
+static void DecodeShuffledAVX2(uint8_t * p_out,
+                               const uint8_t * p_out_end,
+                               const uint8_t * p_file,
+                               const read_context * p_ctx)
+{
+    size_t in_span  = p_ctx->info.bits / 8;
+    size_t out_span = p_ctx->out_channels;
+    size_t end      = ShuffleEnd((size_t)(p_out_end - p_out) / out_span, p_ctx);
+    size_t i;
+
+    __m256i shuffle = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)p_ctx->shuffle));
+    __m256i fill    = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)p_ctx->fill));
+
+    for(i = 0; i + 32 <= end; i += 32)
+    {
+        const uint8_t * in = p_file + i * in_span;
+        uint8_t * out = p_out + i * out_span;
+
+        __m256i a = Load8(in,                in_span);
+        __m256i b = Load8(in +  8 * in_span, in_span);
+        __m256i c = Load8(in + 16 * in_span, in_span);
+        __m256i d = Load8(in + 24 * in_span, in_span);
+
+        a = _mm256_or_si256(_mm256_shuffle_epi8(a, shuffle), fill);
+        b = _mm256_or_si256(_mm256_shuffle_epi8(b, shuffle), fill);
+        c = _mm256_or_si256(_mm256_shuffle_epi8(c, shuffle), fill);
+        d = _mm256_or_si256(_mm256_shuffle_epi8(d, shuffle), fill);
+
+        Store8(out,                 a, out_span);
+        Store8(out +  8 * out_span, b, out_span);
+        Store8(out + 16 * out_span, c, out_span);
+        Store8(out + 24 * out_span, d, out_span);
+    }
+
+    for(; i + 8 <= end; i += 8)
+    {
+        __m256i a = Load8(p_file + i * in_span, in_span);
+        a = _mm256_or_si256(_mm256_shuffle_epi8(a, shuffle), fill);
+        Store8(p_out + i * out_span, a, out_span);
+    }
+
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p_file + i * in_span));
+        a = _mm_or_si128(_mm_shuffle_epi8(a, _mm256_castsi256_si128(shuffle)),
+                         _mm256_castsi256_si128(fill));
+        _mm_storeu_si128((__m128i *)(p_out + i * out_span), a);
+    }
+
+    DecodeRest(p_out, p_out_end, p_file, i, p_ctx);
+}
+
+#endif
+
+#ifdef BMPREAD_NEON_SIMD
+
+/* DecodeShuffledSSSE3() with NEON's table lookup, which also zeroes bytes for
+ * out of range indices.
+ */
+static void DecodeShuffledNEON(uint8_t * p_out,
+                               const uint8_t * p_out_end,
+                               const uint8_t * p_file,
+                               const read_context * p_ctx)
+{
+    size_t in_span  = p_ctx->info.bits / 8;
+    size_t out_span = p_ctx->out_channels;
+    size_t end      = ShuffleEnd((size_t)(p_out_end - p_out) / out_span, p_ctx);
+    size_t i;
+
+    uint8x16_t shuffle = vld1q_u8(p_ctx->shuffle);
+    uint8x16_t fill    = vld1q_u8(p_ctx->fill);
+
+    for(i = 0; i + 16 <= end; i += 16)
+    {
+        const uint8_t * in = p_file + i * in_span;
+        uint8_t * out = p_out + i * out_span;
+
+        uint8x16_t a = vld1q_u8(in               );
+        uint8x16_t b = vld1q_u8(in +  4 * in_span);
+        uint8x16_t c = vld1q_u8(in +  8 * in_span);
+        uint8x16_t d = vld1q_u8(in + 12 * in_span);
+
+        a = vorrq_u8(vqtbl1q_u8(a, shuffle), fill);
+        b = vorrq_u8(vqtbl1q_u8(b, shuffle), fill);
+        c = vorrq_u8(vqtbl1q_u8(c, shuffle), fill);
+        d = vorrq_u8(vqtbl1q_u8(d, shuffle), fill);
+
+        vst1q_u8(out                , a);
+        vst1q_u8(out +  4 * out_span, b);
+        vst1q_u8(out +  8 * out_span, c);
+        vst1q_u8(out + 12 * out_span, d);
+    }
+
+    for(; i + 4 <= end; i += 4)
+    {
+        uint8x16_t a = vld1q_u8(p_file + i * in_span);
+        a = vorrq_u8(vqtbl1q_u8(a, shuffle), fill);
+        vst1q_u8(p_out + i * out_span, a);
+    }
+
+    DecodeRest(p_out, p_out_end, p_file, i, p_ctx);
+}
+
+#endif
+
+/* Returns the fastest SIMD decoder this CPU can run for pixels SetupShuffle()
+ * set up for, or NULL if there isn't one.
+ */
+static line_decoder ShuffleDecoder(void)
+{
+#if defined(BMPREAD_X86_SIMD)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))  return DecodeShuffledAVX2;
+    if(__builtin_cpu_supports("ssse3")) return DecodeShuffledSSSE3;
+#elif defined(BMPREAD_NEON_SIMD)
+    return DecodeShuffledNEON;
+#endif
+
+    return NULL;
+}
+
 /* Reads two bytes out of a memory buffer and converts it to a uint16_t.
  */
 #define LoadLittleUint16(buf) (((uint16_t)(buf)[0]     ) + \
@@ -807,55 +1192,116 @@ static void Decode1(uint8_t * p_out,
     }
 }
 
-/* Selects an above decoder and runs it for each scan line of the file.
- * Returns 0 if there's an error or 1 if it's gravy.
+#ifdef BMPREAD_MMAP
+
+/* Maps the file up to the end of its pixel data and points p_ctx->pixels
+ * at them.  Returns 1 if it's mapped, 0 if it can't be, like a pipe, so the
+ * caller reads it instead, or -1 if the file is too short for all its lines.
  */
-static int Decode(read_context * p_ctx)
+static int MapPixels(read_context * p_ctx)
 {
-    void (* decoder)(uint8_t *, const uint8_t *, const uint8_t *,
-                     const read_context *);
+    /* Both checked for overflow in Validate(). */
+    size_t data_offset = p_ctx->header.data_offset;
+    size_t data_end    = data_offset + p_ctx->pixels_len;
+
+#ifdef _WIN32
+    HANDLE file = (HANDLE)_get_osfhandle(_fileno(p_ctx->fp));
+    HANDLE mapping;
+    LARGE_INTEGER size;
+
+    /* Anything but a disk file gets read instead. */
+    if(file == INVALID_HANDLE_VALUE || GetFileType(file) != FILE_TYPE_DISK)
+        return 0;
+    if(!GetFileSizeEx(file, &size)) return 0;
+
+    /* A view can't reach past the end of the file. */
+    if(size.QuadPart < 0 || (uint64_t)size.QuadPart < data_end) return -1;
+
+    if(!(mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)))
+        return 0;
+    p_ctx->map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, data_end);
+    CloseHandle(mapping); /* The view keeps the mapping open. */
+    if(!p_ctx->map) return 0;
+#else
+    int fd = fileno(p_ctx->fp);
+    struct stat sb;
+
+    /* Anything but a regular file, like a pipe, gets read instead. */
+    if(fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) return 0;
+
+    /* Mapping past the end of the file isn't an error, but touching the
+     * pages would be, so a short file has to be caught here.
+     */
+    if(sb.st_size < 0 || (uintmax_t)sb.st_size < data_end) return -1;
 
-    uint8_t * p_out;      /* Pointer to current scan line in output buffer. */
-    uint8_t * p_out_end;  /* End marker for output buffer. */
-    uint8_t * p_line_end; /* Pointer to end of current scan line in output. */
+    p_ctx->map = mmap(NULL, data_end, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p_ctx->map == MAP_FAILED)
+    {
+        p_ctx->map = NULL;
+        return 0;
+    }
+#endif
 
-    /* out_inc is an incrementor for p_out to advance it one scan line.  I'm
-     * not exactly sure what the correct type for it would be, perhaps ssize_t,
-     * but that's not C standard.  I went with ptrdiff_t because its value
-     * will be equivalent to the difference between two pointers, whether it
-     * was derived that way or not.
-     */
-    ptrdiff_t out_inc;
+    p_ctx->map_len = data_end;
+    p_ctx->pixels  = (const uint8_t *)p_ctx->map + data_offset;
+    return 1;
+}
 
-    /* Double check this won't overflow.  Who knows, man. */
-#if SIZE_MAX > PTRDIFF_MAX
-    if(p_ctx->out_line_len > PTRDIFF_MAX) return 0;
+/* Undoes MapPixels(). */
+static void UnmapPixels(read_context * p_ctx)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(p_ctx->map);
+#else
+    munmap(p_ctx->map, p_ctx->map_len);
 #endif
-    out_inc = p_ctx->out_line_len;
+}
 
-    if(!(p_ctx->info.height < 0) == !(p_ctx->flags & BMPREAD_TOP_DOWN))
+#endif
+
+/* Gets the file's pixel data ready for Decode().  Where the file can be
+ * mapped, the pixels are decoded in place.  Otherwise, with
+ * BMPREAD_READ_WHOLE or whole set (decoding on several threads needs every
+ * line at once), they're read into file_data with a single fread() and
+ * decoded from there.  Failing all that, or with BMPREAD_READ_LINES, this
+ * just allocates file_data for one line and seeks to the first, leaving
+ * pixels NULL for Decode() to read a line at a time, which is what's
+ * fastest without a mapping.  Returns 0 if there's an error, including the
+ * file being too short for all its lines, or 1 if it's ok.
+ */
+static int LoadPixels(read_context * p_ctx, int whole)
+{
+#ifdef BMPREAD_MMAP
+    if(!(p_ctx->flags & (BMPREAD_READ_WHOLE | BMPREAD_READ_LINES)))
     {
-        /* We're keeping scan lines in order.  These and subsequent operations
-         * have all been checked earlier.
-         */
-        p_out     = p_ctx->data_out;
-        p_out_end = p_ctx->data_out +
-                    ((size_t)p_ctx->lines * p_ctx->out_line_len);
+        int mapped = MapPixels(p_ctx);
+        if(mapped) return (mapped > 0);
     }
-    else /* We're reversing scan lines. */
-    {
-        /* TODO: I'm not 100% sure about the legality, purely C spec-wise, of
-         * this subtraction.
-         */
-        p_out_end = p_ctx->data_out - p_ctx->out_line_len;
-        p_out     = p_ctx->data_out +
-                    (((size_t)p_ctx->lines - 1) * p_ctx->out_line_len);
+#endif
+
+    if(!CanMakeLong(p_ctx->header.data_offset))               return 0;
+    if(fseek(p_ctx->fp, p_ctx->header.data_offset, SEEK_SET)) return 0;
 
-        /* Always safe, given two's complement, since it was positive. */
-        out_inc = -out_inc;
+    if((p_ctx->flags & BMPREAD_READ_LINES) ||
+       !(whole || (p_ctx->flags & BMPREAD_READ_WHOLE)))
+    {
+        p_ctx->file_data = (uint8_t *)malloc(p_ctx->file_line_len);
+        return (p_ctx->file_data != NULL);
     }
 
-    p_line_end = p_out + (size_t)p_ctx->info.width * p_ctx->out_channels;
+    if(!(p_ctx->file_data = (uint8_t *)malloc(p_ctx->pixels_len))) return 0;
+    if(fread(p_ctx->file_data, 1, p_ctx->pixels_len, p_ctx->fp) !=
+       p_ctx->pixels_len) return 0;
+
+    p_ctx->pixels = p_ctx->file_data;
+    return 1;
+}
+
+/* Selects an above decoder for the file.  Returns NULL if there isn't one.
+ */
+static line_decoder SelectDecoder(const read_context * p_ctx)
+{
+    line_decoder decoder;
 
     switch(p_ctx->info.bits)
     {
@@ -865,23 +1311,196 @@ static int Decode(read_context * p_ctx)
         case 8:  decoder = Decode8;  break;
         case 4:  decoder = Decode4;  break;
         case 1:  decoder = Decode1;  break;
-        default: return 0;
+        default: return NULL;
     }
 
-    if(!CanMakeLong(p_ctx->header.data_offset))               return 0;
-    if(fseek(p_ctx->fp, p_ctx->header.data_offset, SEEK_SET)) return 0;
+    if(p_ctx->shuffled && !(p_ctx->flags & BMPREAD_NO_SIMD))
+    {
+        line_decoder simd = ShuffleDecoder();
+        if(simd)
+            decoder = simd;
+    }
+
+    return decoder;
+}
+
+/* Runs decoder for count scan lines of the file, starting with line first (in
+ * file order), whose data starts at p_file.  Each goes to its place in the
+ * output buffer, flipped or not, followed by zeroed padding.  Lines are
+ * independent, so different threads can decode different ones.
+ */
+static void DecodeLines(const read_context * p_ctx,
+                        line_decoder decoder,
+                        const uint8_t * p_file,
+                        size_t first,
+                        size_t count)
+{
+    /* These have all been checked in Validate() (or bmpread_into()). */
+    size_t pixel_bytes = (size_t)p_ctx->info.width * p_ctx->out_channels;
+    size_t lines       = (size_t)p_ctx->lines;
 
-    while(p_out != p_out_end &&
-          fread(p_ctx->file_data, 1, p_ctx->file_line_len, p_ctx->fp) ==
-          p_ctx->file_line_len)
+    /* Whether we're keeping scan lines in order, or reversing them. */
+    int in_order = (!(p_ctx->info.height < 0) ==
+                    !(p_ctx->flags & BMPREAD_TOP_DOWN));
+
+    size_t line;
+    for(line = first; line < first + count; line++)
     {
-        decoder(p_out, p_line_end, p_ctx->file_data, p_ctx);
+        uint8_t * p_out = p_ctx->data_out + p_ctx->out_stride *
+                          (in_order ? line : lines - 1 - line);
+
+        decoder(p_out, p_out + pixel_bytes, p_file, p_ctx);
+        memset(p_out + pixel_bytes, 0, p_ctx->out_pad);
+
+        p_file += p_ctx->file_line_len;
+    }
+}
+
+#ifdef BMPREAD_THREADS
+
+/* The least output a thread gets to decode, so small images don't pay for
+ * starting threads they don't need.
+ */
+#define MIN_BAND_BYTES ((size_t)1 << 20)
+
+/* A band of scan lines for a thread to decode. */
+typedef struct decode_band
+{
+    const read_context * p_ctx;
+    line_decoder         decoder;
+    size_t               first;
+    size_t               count;
+    pthread_t            thread;
+    int                  started;
+
+} decode_band;
+
+/* Decodes a band; the start routine for each thread. */
+static void * DecodeBand(void * p_band)
+{
+    const decode_band * band = (const decode_band *)p_band;
+
+    DecodeLines(band->p_ctx, band->decoder,
+                band->p_ctx->pixels + band->first * band->p_ctx->file_line_len,
+                band->first, band->count);
+    return NULL;
+}
+
+/* Returns how many threads to decode on, given threads as for
+ * bmpread_parallel(): never more than would get MIN_BAND_BYTES each, and
+ * at least 1.
+ */
+static unsigned int BandCount(const read_context * p_ctx, unsigned int threads)
+{
+    size_t lines = (size_t)p_ctx->lines;
+    size_t max_threads = lines * p_ctx->out_line_len / MIN_BAND_BYTES;
+
+    if(threads == 0)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threads = info.dwNumberOfProcessors ?
+                  (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 0) ? (unsigned int)processors : 1;
+#endif
+    }
+    if(threads > max_threads) threads = (unsigned int)max_threads;
+    if(threads > lines)       threads = (unsigned int)lines;
+
+    return threads ? threads : 1;
+}
+
+/* Splits the scan lines into one band per thread, as evenly as they go, and
+ * decodes them on that many threads, the calling one included.  threads is
+ * from BandCount().  If threads can't be had, the calling thread does their
+ * bands too.
+ */
+static void DecodeBands(const read_context * p_ctx,
+                        line_decoder decoder,
+                        unsigned int threads)
+{
+    size_t lines = (size_t)p_ctx->lines;
+    decode_band * bands;
+    size_t i;
+
+    if(threads <= 1 ||
+       !(bands = (decode_band *)calloc(threads, sizeof(bands[0]))))
+    {
+        DecodeLines(p_ctx, decoder, p_ctx->pixels, 0, lines);
+        return;
+    }
+
+    for(i = 0; i < threads; i++)
+    {
+        bands[i].p_ctx   = p_ctx;
+        bands[i].decoder = decoder;
+        bands[i].first   = lines * i / threads;
+        bands[i].count   = lines * (i + 1) / threads - bands[i].first;
+    }
+
+    for(i = 1; i < threads; i++)
+        bands[i].started = !pthread_create(&bands[i].thread, NULL,
+                                           DecodeBand, &bands[i]);
+
+    DecodeBand(&bands[0]);
+
+    for(i = 1; i < threads; i++)
+    {
+        if(bands[i].started)
+            pthread_join(bands[i].thread, NULL);
+        else
+            DecodeBand(&bands[i]);
+    }
+
+    free(bands);
+}
+
+#endif
+
+/* Selects an above decoder and runs it for each scan line of the file, on up
+ * to threads threads (see bmpread_parallel()) unless it's read a line at a
+ * time.  Returns 0 if there's an error or 1 if it's gravy.
+ */
+static int Decode(read_context * p_ctx, unsigned int threads)
+{
+    line_decoder decoder;
+    size_t line;
+
+#ifdef BMPREAD_THREADS
+    threads = (p_ctx->flags & BMPREAD_READ_LINES) ? 1 :
+              BandCount(p_ctx, threads);
+#else
+    threads = 1;
+#endif
+
+    if(!(decoder = SelectDecoder(p_ctx)))  return 0;
+    if(!LoadPixels(p_ctx, (threads > 1)))  return 0;
+
+    if(!p_ctx->pixels)
+    {
+        for(line = 0; line < (size_t)p_ctx->lines; line++)
+        {
+            if(fread(p_ctx->file_data, 1, p_ctx->file_line_len, p_ctx->fp) !=
+               p_ctx->file_line_len) return 0;
+
+            DecodeLines(p_ctx, decoder, p_ctx->file_data, line, 1);
+        }
+        return 1;
+    }
 
-        p_out      += out_inc;
-        p_line_end += out_inc;
+#ifdef BMPREAD_THREADS
+    if(threads > 1)
+    {
+        DecodeBands(p_ctx, decoder, threads);
+        return 1;
     }
+#endif
 
-    return (p_out == p_out_end);
+    DecodeLines(p_ctx, decoder, p_ctx->pixels, 0, (size_t)p_ctx->lines);
+    return 1;
 }
 
 /* Frees resources allocated by various functions along the way.  Only frees
@@ -896,12 +1515,43 @@ static void FreeContext(read_context * p_ctx, int leave_data_out)
         free(p_ctx->palette);
     if(p_ctx->file_data)
         free(p_ctx->file_data);
+#ifdef BMPREAD_MMAP
+    if(p_ctx->map)
+        UnmapPixels(p_ctx);
+#endif
 
     if(!leave_data_out && p_ctx->data_out)
         free(p_ctx->data_out);
 }
 
-int bmpread(const char * bmp_file, unsigned int flags, bmpread_t * p_bmp_out)
+/* Opens and validates the file, the start of every entry point below.  The
+ * context must be zeroed.  Returns 0 if there's an error or 1 if it's ok.
+ */
+static int Open(read_context * p_ctx, const char * bmp_file, unsigned int flags)
+{
+    if(!bmp_file) return 0;
+
+    p_ctx->flags = flags;
+
+    if(!(p_ctx->fp = fopen(bmp_file, "rb"))) return 0;
+    if(!Validate(p_ctx))                     return 0;
+
+    /* Make sure we can stuff these into ints.  I feel like this is slightly
+     * justified by how it keeps the header definition dead simple.
+     */
+#if INT32_MAX > INT_MAX
+    if(p_ctx->info.width > INT_MAX) return 0;
+    if(p_ctx->lines      > INT_MAX) return 0;
+#endif
+
+    return 1;
+}
+
+/* bmpread() and bmpread_parallel(). */
+static int Read(const char * bmp_file,
+                unsigned int flags,
+                unsigned int threads,
+                bmpread_t * p_bmp_out)
 {
     int success = 0;
 
@@ -910,26 +1560,16 @@ int bmpread(const char * bmp_file, unsigned int flags, bmpread_t * p_bmp_out)
 
     do
     {
-        if(!bmp_file)  break;
         if(!p_bmp_out) break;
         memset(p_bmp_out, 0, sizeof(*p_bmp_out));
 
-        ctx.flags = flags;
+        if(!Open(&ctx, bmp_file, flags)) break;
 
-        if(!(ctx.fp = fopen(bmp_file, "rb"))) break;
-        if(!Validate(&ctx))                   break;
-        if(!Decode(&ctx))                     break;
+        /* Checked in Validate(). */
+        if(!(ctx.data_out = (uint8_t *)
+             malloc((size_t)ctx.lines * ctx.out_line_len))) break;
 
-        /* Finally, make sure we can stuff these into ints.  I feel like this
-         * is slightly justified by how it keeps the header definition dead
-         * simple (including, well, no #includes).  I suppose this could also
-         * be done way earlier and maybe save some disk reads, but I like
-         * keeping the check with the code it's checking.
-         */
-#if INT32_MAX > INT_MAX
-        if(ctx.info.width > INT_MAX) break;
-        if(ctx.lines      > INT_MAX) break;
-#endif
+        if(!Decode(&ctx, threads)) break;
 
         p_bmp_out->width  = ctx.info.width;
         p_bmp_out->height = ctx.lines;
@@ -944,6 +1584,100 @@ int bmpread(const char * bmp_file, unsigned int flags, bmpread_t * p_bmp_out)
     return success;
 }
 
+int bmpread(const char * bmp_file, unsigned int flags, bmpread_t * p_bmp_out)
+{
+    return Read(bmp_file, flags, 1, p_bmp_out);
+}
+
+int bmpread_parallel(const char * bmp_file,
+                     unsigned int flags,
+                     unsigned int threads,
+                     bmpread_t * p_bmp_out)
+{
+    return Read(bmp_file, flags, threads, p_bmp_out);
+}
+
+int bmpread_info(const char * bmp_file,
+                 unsigned int flags,
+                 bmpread_info_t * p_info_out)
+{
+    int success = 0;
+
+    read_context ctx;
+    memset(&ctx, 0, sizeof(ctx));
+
+    do
+    {
+        if(!p_info_out) break;
+        memset(p_info_out, 0, sizeof(*p_info_out));
+
+        if(!Open(&ctx, bmp_file, flags)) break;
+
+        p_info_out->width    = ctx.info.width;
+        p_info_out->height   = ctx.lines;
+        p_info_out->flags    = ctx.flags;
+        p_info_out->line_len = ctx.out_line_len;
+        p_info_out->data_len = (size_t)ctx.lines * ctx.out_line_len;
+
+        success = 1;
+    } while(0);
+
+    FreeContext(&ctx, 0);
+
+    return success;
+}
+
+int bmpread_into(const char * bmp_file,
+                 unsigned int flags,
+                 unsigned int threads,
+                 void * data,
+                 size_t stride,
+                 size_t size)
+{
+    int success = 0;
+
+    read_context ctx;
+    memset(&ctx, 0, sizeof(ctx));
+
+    do
+    {
+        size_t pixel_bytes;
+        size_t needed;
+
+        if(!data) break;
+
+        if(!Open(&ctx, bmp_file, flags)) break;
+
+        /* With the caller's stride, the bytes between lines are theirs, so
+         * nothing gets written past each line's pixels.
+         */
+        pixel_bytes = (size_t)ctx.info.width * ctx.out_channels;
+        if(stride)
+        {
+            if(stride < pixel_bytes) break;
+            ctx.out_stride = stride;
+            ctx.out_pad    = 0;
+        }
+
+        /* The last line needs only its pixels and padding, not a stride. */
+        if(!CanMultiply((size_t)ctx.lines - 1, ctx.out_stride)) break;
+        needed = ((size_t)ctx.lines - 1) * ctx.out_stride;
+        if(!CanAdd(needed, pixel_bytes + ctx.out_pad)) break;
+        needed += pixel_bytes + ctx.out_pad;
+        if(size < needed) break;
+
+        ctx.data_out = (uint8_t *)data;
+        if(!Decode(&ctx, threads)) break;
+
+        success = 1;
+    } while(0);
+
+    /* data is the caller's to free. */
+    FreeContext(&ctx, 1);
+
+    return success;
+}
+
 void bmpread_free(bmpread_t * p_bmp)
 {
     if(p_bmp)
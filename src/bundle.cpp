@@ -0,0 +1,231 @@
+/* bundle.cpp
+ * Render-ready assets baked offline into one file.
+ */
+
+
+#include "bundle.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+static size_t alignUp(size_t x)
+{
+    return (x + BUNDLE_ALIGNMENT - 1) & ~(size_t)(BUNDLE_ALIGNMENT - 1);
+}
+
+// continues hash over a file's path and contents; a missing file counts as empty
+static uint64_t hashFile(const char *path, uint64_t hash, MappedFile *file)
+{
+    hash = hashBytes(path, strlen(path) + 1, hash);
+    if(file->open(path)) hash = hashBytes(file->data(), file->size(), hash);
+    return hash;
+}
+
+static uint64_t hashAssetType(uint32_t type)
+{
+    uint32_t version = BUNDLE_VERSION;
+    uint64_t hash = hashBytes(&version, sizeof(version));
+    return hashBytes(&type, sizeof(type), hash);
+}
+
+static const MeshCacheBlob *tableOfContents(const unsigned char *data)
+{
+    const BundleHeader *header = (const BundleHeader *)data;
+    return (const MeshCacheBlob *)((const BundleAsset *)(header + 1) + header->assetCount);
+}
+
+bool Bundle::open(const char *path)
+{
+    if(!file_.open(path)) return false;
+
+    do {
+        size_t size = file_.size();
+        if(size < sizeof(BundleHeader)) break;
+
+        const BundleHeader *header = (const BundleHeader *)file_.data();
+        if(memcmp(header->magic, BUNDLE_MAGIC, 4) != 0) break;
+        if(header->version != BUNDLE_VERSION) break;
+
+        // asset table and table of contents must fit in the file
+        size_t tocEnd = sizeof(BundleHeader);
+        if(header->assetCount > (size - tocEnd) / sizeof(BundleAsset)) break;
+        tocEnd += header->assetCount * sizeof(BundleAsset);
+        if(header->blobCount > (size - tocEnd) / sizeof(MeshCacheBlob)) break;
+        tocEnd += header->blobCount * sizeof(MeshCacheBlob);
+
+        const BundleAsset *assets = (const BundleAsset *)(header + 1);
+        uint32_t i;
+        for(i = 0; i < header->assetCount; i++) {
+            if(!memchr(assets[i].name, 0, BUNDLE_NAME_SIZE)) break;
+            if(assets[i].firstBlob > header->blobCount) break;
+            if(assets[i].blobCount > header->blobCount - assets[i].firstBlob) break;
+        }
+        if(i != header->assetCount) break;
+
+        const MeshCacheBlob *toc = tableOfContents(file_.data());
+        for(i = 0; i < header->blobCount; i++) {
+            if(toc[i].offset < tocEnd || toc[i].offset > size) break;
+            if(toc[i].size > size - toc[i].offset) break;
+            if(toc[i].offset % BUNDLE_ALIGNMENT) break;
+        }
+        if(i != header->blobCount) break;
+
+        return true;
+    } while(0);
+
+    file_.close();
+    return false;
+}
+
+size_t Bundle::assetCount() const
+{
+    if(!file_.data()) return 0;
+    return ((const BundleHeader *)file_.data())->assetCount;
+}
+
+const BundleAsset *Bundle::asset(size_t i) const
+{
+    if(i >= assetCount()) return 0;
+    return (const BundleAsset *)((const BundleHeader *)file_.data() + 1) + i;
+}
+
+const BundleAsset *Bundle::findAsset(const char *name) const
+{
+    for(size_t i = 0; i < assetCount(); i++) {
+        if(strcmp(asset(i)->name, name) == 0) return asset(i);
+    }
+    return 0;
+}
+
+const void *Bundle::blob(const BundleAsset *asset, uint32_t id, size_t *size) const
+{
+    if(!file_.data() || !asset) return 0;
+
+    const MeshCacheBlob *toc = tableOfContents(file_.data()) + asset->firstBlob;
+    for(uint32_t i = 0; i < asset->blobCount; i++) {
+        if(toc[i].id == id) {
+            if(size) *size = (size_t)toc[i].size;
+            return file_.data() + toc[i].offset;
+        }
+    }
+
+    return 0;
+}
+
+bool writeBundle(const char *path, const BundleAssetData *assets, size_t assetCount)
+{
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BUNDLE_MAGIC, 4);
+    header.version = BUNDLE_VERSION;
+    header.assetCount = (uint32_t)assetCount;
+
+    size_t blobCount = 0;
+    for(size_t a = 0; a < assetCount; a++) {
+        if(strlen(assets[a].name) >= BUNDLE_NAME_SIZE) return false;
+        blobCount += assets[a].blobCount;
+    }
+    header.blobCount = (uint32_t)blobCount;
+
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if(!fp) return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    // asset table
+    uint32_t firstBlob = 0;
+    for(size_t a = 0; ok && a < assetCount; a++) {
+        BundleAsset entry;
+        memset(&entry, 0, sizeof(entry));
+        strcpy(entry.name, assets[a].name);
+        entry.type = assets[a].type;
+        entry.firstBlob = firstBlob;
+        entry.blobCount = (uint32_t)assets[a].blobCount;
+        entry.sourceHash = assets[a].sourceHash;
+        ok = fwrite(&entry, sizeof(entry), 1, fp) == 1;
+
+        firstBlob += entry.blobCount;
+    }
+
+    // table of contents
+    const size_t tocEnd = sizeof(header) + assetCount * sizeof(BundleAsset) + blobCount * sizeof(MeshCacheBlob);
+    size_t offset = alignUp(tocEnd);
+    for(size_t a = 0; ok && a < assetCount; a++) {
+        for(size_t i = 0; ok && i < assets[a].blobCount; i++) {
+            MeshCacheBlob entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.id = assets[a].blobs[i].id;
+            entry.offset = offset;
+            entry.size = assets[a].blobs[i].size;
+            ok = fwrite(&entry, sizeof(entry), 1, fp) == 1;
+
+            offset = alignUp(offset + entry.size);
+        }
+    }
+
+    // blob data, zero padded up to each aligned offset
+    static const unsigned char zeros[BUNDLE_ALIGNMENT] = {0};
+    size_t written = tocEnd;
+    for(size_t a = 0; ok && a < assetCount; a++) {
+        for(size_t i = 0; ok && i < assets[a].blobCount; i++) {
+            const MeshCacheBlobData &blob = assets[a].blobs[i];
+            size_t pad = alignUp(written) - written;
+            if(pad) ok = fwrite(zeros, 1, pad, fp) == pad;
+            written += pad;
+
+            if(ok && blob.size) ok = fwrite(blob.data, 1, blob.size, fp) == blob.size;
+            written += blob.size;
+        }
+    }
+
+    if(fclose(fp) != 0) ok = false;
+
+    if(!ok) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    // rename() doesn't replace an existing file on Windows
+    remove(path);
+    return rename(tmpPath.c_str(), path) == 0;
+}
+
+uint64_t hashBundleMesh(const char *meshPath, const MeshBakeOptions &options, const float light[3])
+{
+    uint64_t hash = hashAssetType(BUNDLE_MESH);
+    hash = hashBytes(&options.optimize, sizeof(options.optimize), hash);
+    hash = hashBytes(options.lodRatios, options.lodCount * sizeof(float), hash);
+    hash = hashBytes(light, 3 * sizeof(float), hash);
+
+    MappedFile mesh;
+    hash = hashFile(meshPath, hash, &mesh);
+
+    // an .obj's materials are baked into its batches; a .ply has none
+    const size_t n = strlen(meshPath);
+    const bool ply = n >= 4 && meshPath[n - 4] == '.' && tolower(meshPath[n - 3]) == 'p' &&
+                     tolower(meshPath[n - 2]) == 'l' && tolower(meshPath[n - 1]) == 'y';
+    std::vector<std::string> mtlPaths;
+    if(!ply) findMaterialLibraries(meshPath, mesh.data(), mesh.size(), &mtlPaths);
+
+    for(size_t i = 0; i < mtlPaths.size(); i++) {
+        MappedFile mtl;
+        hash = hashFile(mtlPaths[i].c_str(), hash, &mtl);
+    }
+    return hash;
+}
+
+uint64_t hashBundleTexture(const char *path, const MipOptions &options)
+{
+    uint64_t hash = hashAssetType(BUNDLE_TEXTURE);
+    hash = hashBytes(&options.filter, sizeof(options.filter), hash);
+    hash = hashBytes(&options.srgb, sizeof(options.srgb), hash);
+
+    MappedFile file;
+    return hashFile(path, hash, &file);
+}
@@ -0,0 +1,121 @@
+/* filewatch.cpp
+ * Reports files that changed on disk, for hot reloading.
+ */
+
+
+#include "filewatch.h"
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+// modification time and size, -1 if it doesn't exist
+static void statFile(const std::string &path, int64_t *mtime, int64_t *size)
+{
+    struct stat sb;
+    if(stat(path.c_str(), &sb) != 0) {
+        *mtime = -1;
+        *size = -1;
+        return;
+    }
+#ifdef __linux__
+    *mtime = (int64_t)sb.st_mtim.tv_sec * 1000000000 + sb.st_mtim.tv_nsec;
+#else
+    *mtime = (int64_t)sb.st_mtime;
+#endif
+    *size = (int64_t)sb.st_size;
+}
+
+static void addOnce(const std::string &path, std::vector<std::string> *changed)
+{
+    for(size_t i = 0; i < changed->size(); i++) {
+        if((*changed)[i] == path) return;
+    }
+    changed->push_back(path);
+}
+
+FileWatcher::FileWatcher()
+    : fd_(-1)
+{
+#ifdef __linux__
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if(fd_ >= 0) close(fd_);
+#endif
+}
+
+bool FileWatcher::watch(const std::string &path)
+{
+    for(size_t i = 0; i < entries_.size(); i++) {
+        if(entries_[i].path == path) return true;
+    }
+
+    Entry entry;
+    entry.path = path;
+    size_t slash = path.find_last_of("/\\");
+    entry.dir = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+    entry.name = slash == std::string::npos ? path : path.substr(slash + 1);
+    entry.wd = -1;
+    statFile(path, &entry.mtime, &entry.size);
+
+#ifdef __linux__
+    // the same directory gives back the same watch
+    if(fd_ >= 0) {
+        entry.wd = inotify_add_watch(fd_, entry.dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if(entry.wd < 0) return false;
+    }
+#endif
+
+    entries_.push_back(entry);
+    return true;
+}
+
+void FileWatcher::poll(std::vector<std::string> *changed)
+{
+#ifdef __linux__
+    if(fd_ >= 0) {
+        alignas(struct inotify_event) char buffer[4096];
+        for(;;) {
+            ssize_t n = read(fd_, buffer, sizeof(buffer));
+            if(n <= 0) break;
+
+            for(char *p = buffer; p < buffer + n;) {
+                const struct inotify_event *event = (const struct inotify_event *)p;
+                p += sizeof(struct inotify_event) + event->len;
+
+                // events were lost, so anything may have changed
+                if(event->mask & IN_Q_OVERFLOW) {
+                    for(size_t i = 0; i < entries_.size(); i++) addOnce(entries_[i].path, changed);
+                    continue;
+                }
+                if(!event->len) continue;
+
+                for(size_t i = 0; i < entries_.size(); i++) {
+                    if(entries_[i].wd == event->wd && entries_[i].name == event->name) addOnce(entries_[i].path, changed);
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    for(size_t i = 0; i < entries_.size(); i++) {
+        Entry &entry = entries_[i];
+        int64_t mtime, size;
+        statFile(entry.path, &mtime, &size);
+        if(mtime == entry.mtime && size == entry.size) continue;
+
+        entry.mtime = mtime;
+        entry.size = size;
+        if(mtime >= 0) addOnce(entry.path, changed);
+    }
+}
@@ -0,0 +1,70 @@
+/* lodselect.cpp
+ * Picks which level of detail to draw from how large its error looks on
+ * screen.
+ */
+
+
+#include "lodselect.h"
+
+#include <math.h>
+
+
+void initLodState(const uint32_t *indices, size_t indexCount,
+                  const Vertex *vertices, LodState *state)
+{
+    state->level = 0;
+    state->radius = 0;
+    for(int k = 0; k < 3; k++) state->center[k] = 0;
+    if(indexCount == 0) return;
+
+    // centre of the box, radius to the furthest vertex
+    float lo[3], hi[3];
+    for(int k = 0; k < 3; k++) lo[k] = hi[k] = vertices[indices[0]].position[k];
+    for(size_t i = 1; i < indexCount; i++) {
+        const float *p = vertices[indices[i]].position;
+        for(int k = 0; k < 3; k++) {
+            if(p[k] < lo[k]) lo[k] = p[k];
+            if(p[k] > hi[k]) hi[k] = p[k];
+        }
+    }
+    for(int k = 0; k < 3; k++) state->center[k] = (lo[k] + hi[k]) * 0.5f;
+
+    float radius2 = 0;
+    for(size_t i = 0; i < indexCount; i++) {
+        const float *p = vertices[indices[i]].position;
+        float dx = p[0] - state->center[0], dy = p[1] - state->center[1], dz = p[2] - state->center[2];
+        float d2 = dx * dx + dy * dy + dz * dz;
+        if(d2 > radius2) radius2 = d2;
+    }
+    state->radius = sqrtf(radius2);
+}
+
+float lodPixelScale(const float *projection, float viewportHeight)
+{
+    // the y scale is cot(fovy / 2), the half heights a unit at distance 1
+    // spans; a uniform model or view scale changes sizes and distances alike
+    return fabsf(projection[5]) * viewportHeight * 0.5f;
+}
+
+unsigned selectLod(LodState *state, const MeshLod *lods, size_t lodCount,
+                   const float *eye, float pixelScale,
+                   float threshold, float hysteresis)
+{
+    float dx = state->center[0] - eye[0], dy = state->center[1] - eye[1], dz = state->center[2] - eye[2];
+    float distance = sqrtf(dx * dx + dy * dy + dz * dz) - state->radius;
+
+    // inside the sphere anything could be right up against the camera
+    unsigned level = 0;
+    if(distance > 0) {
+        for(size_t i = lodCount; i > 0; i--) {
+            float limit = i > state->level ? threshold * (1 - hysteresis) : threshold;
+            if(lods[i - 1].error * pixelScale / distance <= limit) {
+                level = (unsigned)i;
+                break;
+            }
+        }
+    }
+
+    state->level = level;
+    return level;
+}
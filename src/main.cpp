@@ -1,273 +1,943 @@
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <math.h>
-#define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
+#include <meshcache.h>
+#include <bundle.h>
+#include <mesh.h>
+#include <meshopt.h>
+#include <meshlet.h>
+#include <vertexpack.h>
+#include <objstream.h>
+#include <simplify.h>
+#include <lodselect.h>
+#include <meshbake.h>
+#include <assetloader.h>
+#include <filewatch.h>
+#include <mappedfile.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-int main() {
-    GLFWwindow *window;
+// bytes of a buffer uploaded per step of a MeshUpload
+static const size_t UPLOAD_CHUNK_SIZE = 256 * 1024;
+
+// shader inputs fed per vertex
+struct VertexAttribs
+{
+    GLint position, color, normal, distance;
+};
+
+// a mesh on its way to the GPU: loaded and prepared on a loader thread, then
+// uploaded on the GL thread by a MeshUpload
+struct MeshData
+{
+    // the welded mesh lives in one of these, depending on where it came from
+    Bundle bundle;
+    MeshCache meshCache;
+    BakedMesh baked;
+
+    const Vertex *vertices = 0;
+    size_t vertexCount = 0;
+    const GLuint *indices = 0;
+    size_t indexCount = 0;
+    const Meshlet *meshlets = 0;
+    size_t meshletCount = 0;
+    const MeshLod *lods = 0;
+    std::vector<MeshBatch> batches;
+    std::vector<LodState> lodStates; // per batch
+
+    // what gets uploaded, pointing into the above or the vectors below
+    VertexFormat format = VERTEX_FORMAT_FLOAT;
+    PositionQuantization quant = { { 0, 0, 0 }, { 1, 1, 1 } };
+    const void *vertexData = 0;
+    const void *indexData = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::vector<PackedVertex> packed;
+    std::vector<GLfloat> colors, distances; // float vertices only
+    std::vector<uint16_t> indices16;
+
+    bool loaded = false;
+    std::vector<std::string> materialLibraries; // .mtl files, to watch
+    std::string log; // printed by the GL thread, so it doesn't interleave with its own
+};
+
+// uploaded geometry with its own vertex array
+struct MeshDraw
+{
+    GLuint vao;
+    GLenum indexType;
+    PositionQuantization quant;
+    std::vector<MeshBatch> batches; // one draw call each
+    std::vector<LodState> lodStates; // per batch
+    const Meshlet *meshlets;
+    const MeshLod *lods;
+    std::shared_ptr<MeshData> data; // keeps meshlets and lods alive
+    std::vector<GLuint> buffers;    // for deleteDraw()
+};
+
+// a batch of indexCount indices and meshletCount meshlets with no material
+static MeshBatch wholeBatch(size_t indexCount, size_t meshletCount)
+{
+    MeshBatch batch = { 0, (uint32_t)indexCount, 0, (uint32_t)meshletCount, 0, 0, -1, { 1, 1, 1 } };
+    return batch;
+}
+
+// Fills in mesh's vertex data in format, white and lit from light.  error, if
+// given, gets the packing error.
+static void prepareVertices(MeshData *mesh, VertexFormat format, const glm::vec3 &light, VertexPackError *error)
+{
+    const size_t count = mesh->vertexCount;
+    const Vertex *vertices = mesh->vertices;
 
-    const GLchar *vertex120 = R"END(
-    #version 120
-    //position
-    attribute vec4 inPosition;
-    //color
-    attribute vec3 inColor;
-    //normal
-    attribute vec3 inNormal;
-    
-    //time for rotation
-    uniform float time;
+    // colors
+    mesh->colors.assign(count * 3, 1);
 
-    //surface -> light vector
-    uniform vec3 light;
+    mesh->distances.resize(count);
+    //calculate distance between each vertex and light
+    for(size_t i = 0; i < count; i++) {
+        const float *p = vertices[i].position;
+        mesh->distances[i] = sqrt(pow(p[0] - light.x, 2) + pow(p[1] - light.y, 2) + pow(p[2] - light.z, 2));
+    }
 
-    //light color
-    uniform vec3 lightColor;
+    mesh->format = format;
+    if(format == VERTEX_FORMAT_PACKED) {
+        mesh->packed.resize(count);
+        packVertices(vertices, mesh->colors.data(), mesh->distances.data(), count, mesh->packed.data(), &mesh->quant);
+        if(error) *error = measurePackError(vertices, mesh->colors.data(), mesh->distances.data(), count, mesh->packed.data(), mesh->quant);
+        mesh->vertexData = mesh->packed.data();
+
+        // packed into the vertices now
+        std::vector<GLfloat>().swap(mesh->colors);
+        std::vector<GLfloat>().swap(mesh->distances);
+    } else {
+        mesh->vertexData = vertices;
+    }
+}
+
+// Fills in mesh's index data, 16-bit when the mesh is small enough.
+static void prepareIndices(MeshData *mesh)
+{
+    if(fitsIndices16(mesh->vertexCount)) {
+        narrowIndices(mesh->indices, mesh->indexCount, &mesh->indices16);
+        mesh->indexData = mesh->indices16.data();
+        mesh->indexType = GL_UNSIGNED_SHORT;
+    } else {
+        mesh->indexData = mesh->indices;
+        mesh->indexType = GL_UNSIGNED_INT;
+    }
+}
+
+// Hash of the options that change what bakeMeshFile() makes, for the mesh
+// cache; numThreads doesn't.
+static uint64_t hashBakeOptions(const MeshBakeOptions &options)
+{
+    uint64_t hash = hashBytes(&options.optimize, sizeof(options.optimize));
+    hash = hashBytes(&options.lodCount, sizeof(options.lodCount), hash);
+    return hashBytes(options.lodRatios, options.lodCount * sizeof(float), hash);
+}
+
+// Loads objPath into mesh from the bundle, the mesh cache or the file itself
+// (an .obj, or a binary .ply), in that order, writing the cache in the last
+// case, and prepares it for upload.  The bundle and the cache are only used
+// while they match the file, its materials and bakeOptions.  A reload after
+// the file or its materials changed goes straight to the file, as the others
+// are stale.
+// Runs on a loader thread, so no GL.  Returns false with the reason in
+// mesh->log on failure.
+static bool loadMesh(const char *objPath, const char *cachePath, const char *bundlePath, bool reload,
+                     const MeshBakeOptions &bakeOptions, VertexFormat format, const glm::vec3 &light,
+                     MeshData *mesh)
+{
+    std::ostringstream log;
+
+    const MeshBatch *batches = 0;
+    size_t verticesSize = 0, indicesSize = 0, batchesSize = 0, meshletsSize = 0, lodsSize = 0; // bytes
+
+    // from the bundle only: vertices ready to upload if they were lit from
+    // light, and 16-bit indices if they fit
+    const BundleMeshInfo *meshInfo = 0;
+    const PackedVertex *packedVertices = 0;
+    const uint16_t *bundleIndices16 = 0;
+    size_t meshInfoSize = 0, packedVerticesSize = 0, bundleIndices16Size = 0; // bytes
+
+    Bundle &bundle = mesh->bundle;
+    MeshCache &meshCache = mesh->meshCache;
+    const BundleAsset *bundled = !reload && bundle.open(bundlePath) ? bundle.findAsset(objPath) : 0;
+    if(bundled && bundled->type == BUNDLE_MESH) {
+        // hashed with the light it was baked for, as one that differs only
+        // means relighting the vertices below
+        meshInfo = (const BundleMeshInfo *)bundle.blob(bundled, BUNDLE_MESH_INFO, &meshInfoSize);
+        if(!meshInfo || meshInfoSize != sizeof(BundleMeshInfo) ||
+           hashBundleMesh(objPath, bakeOptions, meshInfo->light) != bundled->sourceHash) {
+            log << bundlePath << " is out of date for " << objPath << std::endl;
+            meshInfo = 0;
+            bundled = 0;
+            bundle.close();
+        }
+    }
+    if(bundled && bundled->type == BUNDLE_MESH) {
+        mesh->vertices = (const Vertex *)bundle.blob(bundled, MESHCACHE_VERTICES, &verticesSize);
+        mesh->indices = (const GLuint *)bundle.blob(bundled, MESHCACHE_INDICES, &indicesSize);
+        batches = (const MeshBatch *)bundle.blob(bundled, MESHCACHE_BATCHES, &batchesSize);
+        mesh->meshlets = (const Meshlet *)bundle.blob(bundled, MESHCACHE_MESHLETS, &meshletsSize);
+        mesh->lods = (const MeshLod *)bundle.blob(bundled, MESHCACHE_LODS, &lodsSize);
+        packedVertices = (const PackedVertex *)bundle.blob(bundled, BUNDLE_PACKED_VERTICES, &packedVerticesSize);
+        bundleIndices16 = (const uint16_t *)bundle.blob(bundled, BUNDLE_INDICES16, &bundleIndices16Size);
+        log << "Loaded " << objPath << " from " << bundlePath << std::endl;
+    } else if(!reload && meshCache.open(cachePath, objPath, hashBakeOptions(bakeOptions))) {
+        mesh->vertices = (const Vertex *)meshCache.blob(MESHCACHE_VERTICES, &verticesSize);
+        mesh->indices = (const GLuint *)meshCache.blob(MESHCACHE_INDICES, &indicesSize);
+        batches = (const MeshBatch *)meshCache.blob(MESHCACHE_BATCHES, &batchesSize);
+        mesh->meshlets = (const Meshlet *)meshCache.blob(MESHCACHE_MESHLETS, &meshletsSize);
+        mesh->lods = (const MeshLod *)meshCache.blob(MESHCACHE_LODS, &lodsSize);
+    }
 
-    //diffuse color
-    uniform vec3 diffuseColor;
+    if(!mesh->vertices || !mesh->indices) {
+        BakedMesh &objMesh = mesh->baked;
+        MeshBakeStats stats;
+        std::string err;
+        std::string warn;
+
+        if(!bakeMeshFile(objPath, bakeOptions, &objMesh, &stats, &warn, &err)) {
+            log << "Failed to load obj file\n" << err << std::endl;
+            mesh->log = log.str();
+            return false;
+        }
+
+        if(!warn.empty()) {
+            log << "Warning: " << warn << std::endl;
+        }
+
+        if(bakeOptions.optimize) {
+            log << "Vertex cache: ACMR " << stats.cacheBefore.acmr << " -> " << stats.cacheAfter.acmr
+                << ", ATVR " << stats.cacheBefore.atvr << " -> " << stats.cacheAfter.atvr << std::endl;
+            log << "Overdraw: " << stats.overdrawBefore.overdraw << " -> " << stats.overdrawAfter.overdraw << std::endl;
+
+            const size_t lodLevels = bakeOptions.lodCount;
+            log << "LODs:";
+            for(size_t i = 0; i < lodLevels; i++) {
+                size_t triangles = 0;
+                float error = 0;
+                for(size_t b = 0; b < objMesh.batches.size(); b++) {
+                    const MeshLod &lod = objMesh.lods[b * lodLevels + i];
+                    triangles += lod.indexCount / 3;
+                    if(lod.error > error) error = lod.error;
+                }
+                log << " " << triangles << " triangles (error " << error << ")";
+            }
+            log << std::endl;
+        }
+
+        mesh->vertices = objMesh.mesh.vertices.data();
+        verticesSize = objMesh.mesh.vertices.size() * sizeof(Vertex);
+        mesh->indices = objMesh.mesh.indices.data();
+        indicesSize = objMesh.mesh.indices.size() * sizeof(GLuint);
+        batches = objMesh.batches.data();
+        batchesSize = objMesh.batches.size() * sizeof(MeshBatch);
+        mesh->meshlets = objMesh.meshlets.data();
+        meshletsSize = objMesh.meshlets.size() * sizeof(Meshlet);
+        mesh->lods = objMesh.lods.data();
+        lodsSize = objMesh.lods.size() * sizeof(MeshLod);
+
+        MeshCacheBlobData blobs[] = {
+            { MESHCACHE_VERTICES, mesh->vertices, verticesSize },
+            { MESHCACHE_INDICES, mesh->indices, indicesSize },
+            { MESHCACHE_BATCHES, batches, batchesSize },
+            { MESHCACHE_MESHLETS, mesh->meshlets, meshletsSize },
+            { MESHCACHE_LODS, mesh->lods, lodsSize }
+        };
+        // the .mtl files too, as the batches hold their colours
+        std::vector<std::string> mtlPaths;
+        MappedFile obj;
+        if(obj.open(objPath)) findMaterialLibraries(objPath, obj.data(), obj.size(), &mtlPaths);
+        obj.close();
+        std::vector<const char *> sourcePaths(1, objPath);
+        for(size_t i = 0; i < mtlPaths.size(); i++) sourcePaths.push_back(mtlPaths[i].c_str());
+
+        if(!writeMeshCache(cachePath, sourcePaths.data(), sourcePaths.size(), hashBakeOptions(bakeOptions),
+                           blobs, sizeof(blobs) / sizeof(blobs[0]))) {
+            log << "Warning: could not write mesh cache " << cachePath << std::endl;
+        }
+    }
 
-    //model view projection matrix
-    uniform mat4 mvp;
+    mesh->vertexCount = verticesSize / sizeof(Vertex);
+    mesh->indexCount = indicesSize / sizeof(GLuint);
+    mesh->meshletCount = mesh->meshlets ? meshletsSize / sizeof(Meshlet) : 0;
 
-    //distance from surface to light
-    attribute float distance;
+    // caches from before materials hold a single white batch
+    if(batches && batchesSize) {
+        mesh->batches.assign(batches, batches + batchesSize / sizeof(MeshBatch));
+    } else {
+        mesh->batches.push_back(wholeBatch(mesh->indexCount, mesh->meshletCount));
+    }
 
-    //output color
-    varying vec4 outColor;
+    mesh->lodStates.resize(mesh->batches.size());
+    for(size_t b = 0; b < mesh->batches.size(); b++) {
+        const MeshBatch &batch = mesh->batches[b];
+        initLodState(mesh->indices + batch.indexOffset, batch.indexCount, mesh->vertices, &mesh->lodStates[b]);
+    }
 
-    //light power
-    uniform float power;
+    const bool prePacked = format == VERTEX_FORMAT_PACKED && meshInfo && meshInfoSize == sizeof(BundleMeshInfo) &&
+                           packedVerticesSize == mesh->vertexCount * sizeof(PackedVertex) &&
+                           meshInfo->light[0] == light.x && meshInfo->light[1] == light.y && meshInfo->light[2] == light.z;
+
+    if(prePacked) {
+        mesh->format = VERTEX_FORMAT_PACKED;
+        mesh->vertexData = packedVertices;
+        mesh->quant = meshInfo->quant;
+    } else {
+        VertexPackError error;
+        prepareVertices(mesh, format, light, &error);
+        if(format == VERTEX_FORMAT_PACKED) {
+            log << "Packed vertices: " << sizeof(Vertex) + 4 * sizeof(GLfloat) << " -> " << sizeof(PackedVertex)
+                << " bytes, max error: position " << error.position << ", normal " << error.normal
+                << " deg, texcoord " << error.texcoord << ", color " << error.color
+                << ", distance " << error.distance << std::endl;
+        }
+    }
 
-    void main() {
-        // float theta = time;
-        // float c = cos(theta);
-        // float s = sin(theta);
-        // mat4 rotationY = mat4(
-        //     c, 0, s, 0,
-        //     0, 1, 0, 0,
-        //     -s, 0, c, 0,
-        //     0, 0, 0, 1
-        // );
-        // mat4 rotationX = mat4(
-        //     1, 0, 0, 0,
-        //     0, c, -s, 0,
-        //     0, s, c, 0,
-        //     0, 0, 0, 1
-        // );
+    if(fitsIndices16(mesh->vertexCount) && bundleIndices16 && bundleIndices16Size == mesh->indexCount * sizeof(uint16_t)) {
+        mesh->indexData = bundleIndices16;
+        mesh->indexType = GL_UNSIGNED_SHORT;
+    } else {
+        prepareIndices(mesh);
+    }
 
-        // outColor = vec4(inColor,1);
-        // gl_Position = mvp * rotationX * rotationY * inPosition;
+    MappedFile obj;
+    if(obj.open(objPath)) findMaterialLibraries(objPath, obj.data(), obj.size(), &mesh->materialLibraries);
 
-        vec3 ambientColor = lightColor * 0.1;
+    mesh->loaded = true;
+    mesh->log = log.str();
+    return true;
+}
 
-        vec3 n = normalize(inNormal);
+// Points attribs at the vertex buffers of the bound vertex array: one buffer
+// of packed vertices, or float vertices, colors and distances.
+static void bindVertexAttribs(VertexFormat format, const GLuint *buffers, const VertexAttribs &attribs)
+{
+    if(format == VERTEX_FORMAT_PACKED) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
 
-        vec3 l = normalize(light);
+        glEnableVertexAttribArray(attribs.position);
+        glVertexAttribPointer(attribs.position, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, position));
 
-        float cosTheta = clamp(dot(n, l), 0, 1);
+        glEnableVertexAttribArray(attribs.normal);
+        glVertexAttribPointer(attribs.normal, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, normal));
 
-        outColor = vec4(ambientColor + diffuseColor * inColor * lightColor * power * cosTheta / (distance * distance), 1);
-        gl_Position = mvp * inPosition;
+        glEnableVertexAttribArray(attribs.color);
+        glVertexAttribPointer(attribs.color, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, color));
 
-    }
-    )END";
+        glEnableVertexAttribArray(attribs.distance);
+        glVertexAttribPointer(attribs.distance, 1, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, distance));
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
 
-    const GLchar *fragment120 = R"END(
-    #version 120
-    varying vec4 outColor;
+        glEnableVertexAttribArray(attribs.position);
+        glVertexAttribPointer(attribs.position, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
 
-    void main() {
-        gl_FragColor = outColor;
+        glEnableVertexAttribArray(attribs.normal);
+        glVertexAttribPointer(attribs.normal, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+        glEnableVertexAttribArray(attribs.color);
+        glVertexAttribPointer(attribs.color, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+        glEnableVertexAttribArray(attribs.distance);
+        glVertexAttribPointer(attribs.distance, 1, GL_FLOAT, GL_FALSE, 0, 0);
+    }
+}
+
+// Uploads a MeshData into buffers UPLOAD_CHUNK_SIZE bytes per step, then
+// hands done the finished draw, or null if the mesh failed to load.
+class MeshUpload : public PendingUpload
+{
+public:
+    MeshUpload(std::shared_ptr<MeshData> mesh, const VertexAttribs &attribs,
+               std::function<void(const MeshDraw *)> done)
+        : mesh_(mesh), attribs_(attribs), done_(done), vao_(0), buffer_(0), offset_(0)
+    {
+        if(!mesh->loaded) return;
+
+        if(mesh->format == VERTEX_FORMAT_PACKED) {
+            addBuffer(GL_ARRAY_BUFFER, mesh->vertexData, mesh->vertexCount * sizeof(PackedVertex));
+        } else {
+            addBuffer(GL_ARRAY_BUFFER, mesh->vertexData, mesh->vertexCount * sizeof(Vertex));
+            addBuffer(GL_ARRAY_BUFFER, mesh->colors.data(), mesh->colors.size() * sizeof(GLfloat));
+            addBuffer(GL_ARRAY_BUFFER, mesh->distances.data(), mesh->distances.size() * sizeof(GLfloat));
+        }
+        const size_t indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(GLuint);
+        addBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexData, mesh->indexCount * indexSize);
     }
-    )END";
 
-    if (!glfwInit()) {
-        std::cout << "Init error";
-        return -1;
+    bool uploadStep() override
+    {
+        if(!vao_) {
+            std::cout << mesh_->log << std::flush;
+            if(!mesh_->loaded) {
+                done_(0);
+                return true;
+            }
+            glGenVertexArrays(1, &vao_);
+        }
+        glBindVertexArray(vao_);
+
+        if(buffer_ < buffers_.size()) {
+            Buffer &buffer = buffers_[buffer_];
+            if(!buffer.name) {
+                glGenBuffers(1, &buffer.name);
+                glBindBuffer(buffer.target, buffer.name);
+                glBufferData(buffer.target, buffer.size, 0, GL_STATIC_DRAW);
+            }
+            glBindBuffer(buffer.target, buffer.name);
+
+            size_t size = buffer.size - offset_;
+            if(size > UPLOAD_CHUNK_SIZE) size = UPLOAD_CHUNK_SIZE;
+            glBufferSubData(buffer.target, offset_, size, (const unsigned char *)buffer.data + offset_);
+            offset_ += size;
+
+            if(offset_ == buffer.size) {
+                buffer_++;
+                offset_ = 0;
+            }
+            return false;
+        }
+
+        GLuint vertexBuffers[3];
+        for(size_t i = 0; i + 1 < buffers_.size(); i++) vertexBuffers[i] = buffers_[i].name;
+        bindVertexAttribs(mesh_->format, vertexBuffers, attribs_);
+
+        MeshDraw draw;
+        draw.vao = vao_;
+        draw.indexType = mesh_->indexType;
+        draw.quant = mesh_->quant;
+        draw.batches = mesh_->batches;
+        draw.lodStates = mesh_->lodStates;
+        draw.meshlets = mesh_->meshlets;
+        draw.lods = mesh_->lods;
+        draw.data = mesh_;
+        for(size_t i = 0; i < buffers_.size(); i++) draw.buffers.push_back(buffers_[i].name);
+
+        // on the GPU now
+        std::vector<PackedVertex>().swap(mesh_->packed);
+        std::vector<GLfloat>().swap(mesh_->colors);
+        std::vector<GLfloat>().swap(mesh_->distances);
+        std::vector<uint16_t>().swap(mesh_->indices16);
+
+        done_(&draw);
+        return true;
     }
 
-    window = glfwCreateWindow(800, 800, "Hello", 0, 0);
-    if (!window) {
-        std::cout << "Window creation error";
-        glfwTerminate();
-        return -1;
+    // Does every step now, for meshes needed before the first frame.
+    void uploadAll()
+    {
+        while(!uploadStep()) {
+        }
     }
 
-    glfwMakeContextCurrent(window);
-    
-    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "GLAD init error";
-        return -1;
+private:
+    struct Buffer
+    {
+        GLenum target;
+        const void *data;
+        size_t size;
+        GLuint name;
+    };
+
+    void addBuffer(GLenum target, const void *data, size_t size)
+    {
+        Buffer buffer = { target, data, size, 0 };
+        buffers_.push_back(buffer);
     }
 
-    // compile shaders
+    std::shared_ptr<MeshData> mesh_;
+    const VertexAttribs &attribs_;
+    std::function<void(const MeshDraw *)> done_;
+    GLuint vao_;
+    std::vector<Buffer> buffers_; // vertex buffers, then the index buffer
+    size_t buffer_, offset_;      // next one to upload and how much of it is
+};
+
+// A white octahedron of radius size, drawn until the real mesh is uploaded.
+static void placeholderMesh(float size, MeshData *mesh)
+{
+    static const float corners[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+    // flat faces, so three vertices of their own each
+    Mesh &placeholder = mesh->baked.mesh;
+    for(int f = 0; f < 8; f++) {
+        const float sx = f & 1 ? -1.0f : 1.0f, sy = f & 2 ? -1.0f : 1.0f, sz = f & 4 ? -1.0f : 1.0f;
+        const float *c[3] = { corners[f & 1], corners[2 + ((f >> 1) & 1)], corners[4 + ((f >> 2) & 1)] };
+        const bool flip = (sx * sy * sz) < 0;
+        const float n = 1.0f / sqrtf(3.0f);
+
+        for(int k = 0; k < 3; k++) {
+            const float *p = c[flip ? 2 - k : k];
+            Vertex v = { { p[0] * size, p[1] * size, p[2] * size }, { sx * n, sy * n, sz * n }, { 0, 0 } };
+            placeholder.indices.push_back((uint32_t)placeholder.vertices.size());
+            placeholder.vertices.push_back(v);
+        }
+    }
+
+    mesh->vertices = placeholder.vertices.data();
+    mesh->vertexCount = placeholder.vertices.size();
+    mesh->indices = placeholder.indices.data();
+    mesh->indexCount = placeholder.indices.size();
+    mesh->batches.push_back(wholeBatch(mesh->indexCount, 0));
+    mesh->lodStates.resize(1);
+    initLodState(mesh->indices, mesh->indexCount, mesh->vertices, &mesh->lodStates[0]);
+    mesh->loaded = true;
+}
+
+// Deletes the vertex array and buffers of draw.
+static void deleteDraw(const MeshDraw &draw)
+{
+    glDeleteVertexArrays(1, &draw.vao);
+    glDeleteBuffers((GLsizei)draw.buffers.size(), draw.buffers.data());
+}
+
+// uniform locations of the mesh shader
+struct ShaderUniforms
+{
+    GLint mvp, positionOffset, positionScale, time, light, lightColor, diffuseColor, power;
+};
+
+// Reads the whole of path into text.
+static bool readTextFile(const char *path, std::string *text)
+{
+    MappedFile file;
+    if(!file.open(path)) return false;
+    text->assign((const char *)file.data(), file.size());
+    return true;
+}
+
+// Info log of a shader or program.
+static std::string infoLog(GLuint object, bool program)
+{
+    GLint length = 0;
+    if(program) glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+    else glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(length > 0 ? length : 0, '\0');
+    if(length > 0 && program) glGetProgramInfoLog(object, length, &length, &log[0]);
+    else if(length > 0) glGetShaderInfoLog(object, length, &length, &log[0]);
+    log.resize(length > 0 ? length : 0);
+    return log;
+}
+
+// Compiles and links the mesh shader with #version and the #defines for
+// format in front of the vertex source.  attribs are bound to their
+// locations, so vertex arrays work with every program built from here.
+// Returns 0 with the reason in log if it doesn't build.
+static GLuint buildProgram(const std::string &vertexSource, const std::string &fragmentSource,
+                           VertexFormat format, const VertexAttribs &attribs, std::string *log)
+{
+    const GLchar *vertexSources[] = {
+        format == VERTEX_FORMAT_PACKED ? "#version 120\n#define PACKED_VERTICES\n" : "#version 120\n",
+        vertexSource.c_str()
+    };
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertex120, 0);
+    glShaderSource(vertexShader, 2, vertexSources, 0);
     glCompileShader(vertexShader);
 
+    const GLchar *fragmentSources[] = { fragmentSource.c_str() };
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragment120, 0);
+    glShaderSource(fragmentShader, 1, fragmentSources, 0);
     glCompileShader(fragmentShader);
 
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glUseProgram(shaderProgram);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, attribs.position, "inPosition");
+    glBindAttribLocation(program, attribs.color, "inColor");
+    glBindAttribLocation(program, attribs.normal, "inNormal");
+    glBindAttribLocation(program, attribs.distance, "distance");
+    glLinkProgram(program);
 
     int success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        int length;
-        glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &length);
-        char *log = new char[length];
-        glGetProgramInfoLog(shaderProgram, length, &length, log);
-        std::cout << "Shader program linking failed\n" << log << std::endl;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success) {
+        *log = "Shader program linking failed\n" + infoLog(vertexShader, false) + infoLog(fragmentShader, false) + infoLog(program, true);
+        glDeleteProgram(program);
+        program = 0;
     }
 
-    // attributes
-    GLint attribPos = glGetAttribLocation(shaderProgram, "inPosition");
-    GLint attribColor = glGetAttribLocation(shaderProgram, "inColor");
+    // freed along with the program
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+// Makes program current, sets the uniforms that are the same every frame and
+// returns where the rest go.
+static ShaderUniforms useProgram(GLuint program, const glm::mat4 &mvp, const glm::vec3 &light)
+{
+    glUseProgram(program);
+
+    ShaderUniforms uniforms;
+    uniforms.mvp = glGetUniformLocation(program, "mvp");
+    uniforms.positionOffset = glGetUniformLocation(program, "positionOffset");
+    uniforms.positionScale = glGetUniformLocation(program, "positionScale");
+    uniforms.time = glGetUniformLocation(program, "time");
+    uniforms.light = glGetUniformLocation(program, "light");
+    uniforms.lightColor = glGetUniformLocation(program, "lightColor");
+    uniforms.diffuseColor = glGetUniformLocation(program, "diffuseColor");
+    uniforms.power = glGetUniformLocation(program, "power");
+
+    glUniformMatrix4fv(uniforms.mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+    glUniform3f(uniforms.light, light.x, light.y, light.z);
+    glUniform3f(uniforms.lightColor, 1, 1, 1);
+    glUniform3f(uniforms.diffuseColor, 1, 1, 1);
+    glUniform1f(uniforms.power, 100);
+    return uniforms;
+}
+
+// milliseconds since start
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string err;
-    std::string warn;
+int main() {
+    GLFWwindow *window;
+    typedef std::chrono::steady_clock Clock;
 
-    if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, "jason.obj")) {
-        std::cout << "Failed to load obj file\n";
-        return -1;
-    }
+    // layout of the uploaded vertices, see vertexpack.h
+    const VertexFormat vertexFormat = VERTEX_FORMAT_PACKED;
 
-    if(!warn.empty()) {
-        std::cout << "Warning: " << warn << std::endl;
-    }
+    const char *objPath = "jason.obj";
+    const char *cachePath = "jason.obj.cache";
 
-    if(!err.empty()) {
-        std::cout << "Error: " << err << std::endl;
-        return -1;
-    }
+    // baked offline by tools/bake.cpp and used as is when it has objPath;
+    // rebake it after editing the sources
+    const char *bundlePath = "assets.bundle";
 
-    // vertices
-    GLfloat vertices[attrib.vertices.size()];
-    for(size_t i = 0; i < attrib.vertices.size(); i++) {
-        vertices[i] = attrib.vertices[i];
-    }
+    // the mesh shader; #version and #defines go in front of the vertex shader
+    const char *vertexShaderPath = "shaders/mesh.vert";
+    const char *fragmentShaderPath = "shaders/mesh.frag";
 
-    // colors
-    GLfloat colors[attrib.vertices.size()];
-    for(size_t i = 0; i < attrib.vertices.size(); i++) {
-        colors[i] = 1;
-    }
+    // reorder each material's triangles and the vertices for the vertex cache,
+    // split them into meshlets and simplify them into LODs before caching, see
+    // meshbake.h; the cache is made again when this changes
+    const MeshBakeOptions bakeOptions = defaultMeshBakeOptions();
 
-    // indices
-    GLuint indices[shapes[0].mesh.indices.size()];
-    for(size_t i = 0; i < shapes[0].mesh.indices.size(); i++) {
-        indices[i] = shapes[0].mesh.indices[i].vertex_index;
-    }
+    // draw the coarsest LOD whose error covers at most this many pixels,
+    // going coarser only once it is this fraction under
+    const float lodPixelError = 1.0f;
+    const float lodHysteresis = 0.25f;
 
-    // normals
-    GLfloat normals[attrib.normals.size()];
-    for(size_t i = 0; i < attrib.normals.size(); i++) {
-        normals[i] = attrib.normals[i];
-    }
+    // load the .obj a bounded chunk at a time straight into GPU buffers,
+    // skipping the cache and the passes above; for meshes too big to hold
+    const bool streamMesh = false;
+    const size_t streamBudget = OBJSTREAM_DEFAULT_BUDGET; // bytes
 
-    GLuint vao, vbo, cbo;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    // seconds of each frame spent uploading loaded meshes, a chunk at a time
+    const double uploadBudget = 0.002;
 
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // reload the mesh, its materials and the shaders when they change on disk
+    const bool hotReload = true;
 
-    glEnableVertexAttribArray(attribPos);
-    glVertexAttribPointer(attribPos, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    // bound to these locations when linking, so vertex arrays keep working
+    // with reloaded shaders
+    const VertexAttribs attribs = { 0, 1, 2, 3 };
+    glm::vec3 light = glm::vec3(0, 10, 10);
 
-    glGenBuffers(1, &cbo);
-    glBindBuffer(GL_ARRAY_BUFFER, cbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
+    // what to draw: one per chunk when streaming, else the whole mesh, which
+    // may be split into meshlets, or a placeholder until it's uploaded
+    std::vector<MeshDraw> draws;
+
+    // called on the GL thread once a load of the mesh is uploaded, set up
+    // further down
+    std::function<void(const MeshDraw *, bool reload, unsigned generation, Clock::time_point requested)> meshUploaded;
+
+    // every load of the mesh gets the next generation; one overtaken by a
+    // newer load before it starts is skipped
+    std::atomic<unsigned> meshGeneration(0);
+
+    // one loader thread, so loads finish in order; bakeObj() spreads over the
+    // cores itself.  Declared after everything its loads use, so it's gone
+    // before they are
+    AssetLoader loader(1);
+    auto loadMeshAsync = [&](bool reload) {
+        const unsigned generation = ++meshGeneration;
+        const Clock::time_point requested = Clock::now();
+        loader.load([&, reload, generation, requested]() -> PendingUpload * {
+            if(generation != meshGeneration) return 0;
+
+            std::shared_ptr<MeshData> mesh = std::make_shared<MeshData>();
+            loadMesh(objPath, cachePath, bundlePath, reload, bakeOptions, vertexFormat, light, mesh.get());
+            return new MeshUpload(mesh, attribs, [&, reload, generation, requested](const MeshDraw *draw) {
+                meshUploaded(draw, reload, generation, requested);
+            });
+        });
+    };
+
+    // load the mesh on the loader thread while the window, context and
+    // shaders are created; it gets uploaded a chunk per frame after that
+    const Clock::time_point startTime = Clock::now();
+    if(!streamMesh) loadMeshAsync(false);
 
-    glEnableVertexAttribArray(attribColor);
-    glVertexAttribPointer(attribColor, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    if (!glfwInit()) {
+        std::cout << "Init error";
+        return -1;
+    }
 
-    GLuint indicesBuf;
-    glGenBuffers(1, &indicesBuf);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indicesBuf);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    window = glfwCreateWindow(800, 800, "Hello", 0, 0);
+    if (!window) {
+        std::cout << "Window creation error";
+        glfwTerminate();
+        return -1;
+    }
 
-    GLuint normalsBuf;
-    glGenBuffers(1, &normalsBuf);
-    glBindBuffer(GL_ARRAY_BUFFER, normalsBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(normals), normals, GL_STATIC_DRAW);
+    glfwMakeContextCurrent(window);
+    
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "GLAD init error";
+        return -1;
+    }
+
+    // compile shaders
+    std::string vertexSource, fragmentSource, shaderLog;
+    if(!readTextFile(vertexShaderPath, &vertexSource) || !readTextFile(fragmentShaderPath, &fragmentSource)) {
+        std::cout << "Failed to read " << vertexShaderPath << " or " << fragmentShaderPath << std::endl;
+        return -1;
+    }
+    GLuint shaderProgram = buildProgram(vertexSource, fragmentSource, vertexFormat, attribs, &shaderLog);
+    if(!shaderProgram) {
+        std::cout << shaderLog << std::endl;
+        return -1;
+    }
+
+    if(streamMesh) {
+        ObjStreamStats stats;
+        std::string err;
+        bool ok = streamObj(objPath, streamBudget, [&](const MeshChunk &chunk) {
+            // uploaded right away, the chunk is only valid until we return
+            std::shared_ptr<MeshData> mesh = std::make_shared<MeshData>();
+            mesh->vertices = chunk.vertices;
+            mesh->vertexCount = chunk.vertexCount;
+            mesh->indexCount = chunk.indexCount;
+            mesh->indexData = chunk.indices;
+            mesh->indexType = GL_UNSIGNED_SHORT;
+            mesh->batches.push_back(wholeBatch(chunk.indexCount, 0));
+            mesh->lodStates.resize(1);
+            prepareVertices(mesh.get(), vertexFormat, light, 0);
+            mesh->loaded = true;
+
+            MeshUpload(mesh, attribs, [&](const MeshDraw *draw) { draws.push_back(*draw); }).uploadAll();
+        }, &stats, &err);
+
+        if(!ok) {
+            std::cout << "Failed to load obj file\n" << err;
+            return -1;
+        }
+
+        std::cout << "Streamed " << stats.triangles << " triangles in " << stats.chunks << " chunks, "
+                  << (stats.chunkBytes + stats.attributeBytes) / 1024 << " KiB held" << std::endl;
+    } else {
+        // drawn until the mesh is uploaded
+        std::shared_ptr<MeshData> placeholder = std::make_shared<MeshData>();
+        placeholderMesh(1.0f, placeholder.get());
+        prepareVertices(placeholder.get(), vertexFormat, light, 0);
+        prepareIndices(placeholder.get());
+        MeshUpload(placeholder, attribs, [&](const MeshDraw *draw) { draws.push_back(*draw); }).uploadAll();
+    }
 
     glm::mat4 model = glm::mat4(0.5f);
     glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 10), glm::vec3(0, 0, 0), glm::vec3(0, -1, 0));
     glm::mat4 projection = glm::perspective(glm::radians(240.0f), 1.0f, 0.1f, 100.0f);
     glm::mat4 mvp = projection * view * model;
 
-    // for(int i = 0; i < sizeof(vertices)/sizeof(GLfloat); i++) {
-    //     std::cout << vertices[i] << std::endl;
+    // for(size_t i = 0; i < nVertices; i++) {
+    //     std::cout << vertices[i].position[0] << std::endl;
     // }
 
-    GLuint attribMvp;
-    attribMvp = glGetUniformLocation(shaderProgram, "mvp");
-    glUniformMatrix4fv(attribMvp, 1, GL_FALSE, glm::value_ptr(mvp));
+    ShaderUniforms uniforms = useProgram(shaderProgram, mvp, light);
 
-    GLuint attribTime;
-    attribTime = glGetUniformLocation(shaderProgram, "time");
+    // meshlet culling happens in model space
+    CullCamera cullCamera;
+    extractFrustumPlanes(glm::value_ptr(mvp), cullCamera.planes);
+    glm::vec4 eye = glm::inverse(view * model) * glm::vec4(0, 0, 0, 1);
+    for(int k = 0; k < 3; k++) cullCamera.position[k] = eye[k] / eye.w;
 
-    glm::vec3 light = glm::vec3(0, 10, 10);
-
-    GLuint attribLight;
-    attribLight = glGetUniformLocation(shaderProgram, "light");
-    glUniform3f(attribLight, light.x, light.y, light.z);
-
-    GLuint attribLightColor;
-    attribLightColor = glGetUniformLocation(shaderProgram, "lightColor");
-    glUniform3f(attribLightColor, 1, 1, 1);
-    GLuint attribDiffuseColor;
-    attribDiffuseColor = glGetUniformLocation(shaderProgram, "diffuseColor");
-    glUniform3f(attribDiffuseColor, 1, 1, 1);
+    std::vector<IndexRange> visibleRanges;
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void *> drawOffsets;
 
-    GLuint attribDistance;
-    attribDistance = glGetAttribLocation(shaderProgram, "distance");
-    GLfloat distances[attrib.vertices.size()];
-    //calculate distance between each vertex and light
-    for(size_t i = 0; i < attrib.vertices.size(); i+=3) {
-        distances[i/3] = sqrt(pow(attrib.vertices[i] - light.x, 2) + pow(attrib.vertices[i + 1] - light.y, 2) + pow(attrib.vertices[i + 2] - light.z, 2));
+    FileWatcher watcher;
+    std::vector<std::string> changedFiles;
+    if(hotReload) {
+        watcher.watch(objPath);
+        watcher.watch(vertexShaderPath);
+        watcher.watch(fragmentShaderPath);
     }
-    GLuint distancesBuf;
-    glGenBuffers(1, &distancesBuf);
-    glBindBuffer(GL_ARRAY_BUFFER, distancesBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(distances), distances, GL_STATIC_DRAW);
-    glVertexAttribPointer(attribDistance, 1, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(attribDistance);
-
-    GLuint attribPower;
-    attribPower = glGetUniformLocation(shaderProgram, "power");
-    glUniform1f(attribPower, 100);
 
-    const GLuint nVertices = sizeof(vertices) / sizeof(vertices[0]) / 3;
+    // swaps in each load of the mesh once it's uploaded, at the start of a
+    // frame, freeing what it replaces; gives up if the first load fails but
+    // keeps the old mesh if a reload does
+    int exitCode = 0;
+    size_t frames = 0;
+    unsigned shownMeshGeneration = 0;
+    meshUploaded = [&](const MeshDraw *draw, bool reload, unsigned generation, Clock::time_point requested) {
+        if(!draw) {
+            if(reload) {
+                std::cout << "Keeping the old " << objPath << std::endl;
+            } else {
+                exitCode = -1;
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            }
+            return;
+        }
+        if(generation < shownMeshGeneration) {
+            deleteDraw(*draw);
+            return;
+        }
+
+        const Clock::time_point swapStart = Clock::now();
+        for(size_t d = 0; d < draws.size(); d++) deleteDraw(draws[d]);
+        draws.assign(1, *draw);
+        shownMeshGeneration = generation;
+        const double swapTime = msSince(swapStart);
+
+        if(reload) {
+            std::cout << "Reloaded " << objPath << " " << msSince(requested) << " ms after the change, swap took "
+                      << swapTime << " ms" << std::endl;
+        } else {
+            std::cout << objPath << " ready after " << msSince(startTime) << " ms, " << frames << " frames" << std::endl;
+        }
+
+        // materials may have been added
+        if(hotReload) {
+            for(size_t i = 0; i < draw->data->materialLibraries.size(); i++) watcher.watch(draw->data->materialLibraries[i]);
+        }
+
+        if(draw->data->meshletCount) {
+            MeshletCullStats stats = cullMeshlets(draw->meshlets, draw->data->meshletCount, cullCamera, &visibleRanges);
+            std::cout << "Meshlets: culled " << stats.culledMeshlets << " of " << stats.meshlets
+                      << " (" << stats.culledTriangles << " of " << stats.triangles << " triangles)" << std::endl;
+        }
+    };
+
+    // reads the shader sources on the loader thread; building and swapping
+    // in the program happens at the start of a frame, keeping the old one if
+    // the new one doesn't build
+    auto loadShadersAsync = [&]() {
+        const Clock::time_point requested = Clock::now();
+        loader.load([&, requested]() -> PendingUpload * {
+            std::string vertexSource, fragmentSource;
+            bool ok = readTextFile(vertexShaderPath, &vertexSource) && readTextFile(fragmentShaderPath, &fragmentSource);
+            return new FunctionUpload([&, ok, vertexSource, fragmentSource, requested]() {
+                if(!ok) {
+                    std::cout << "Failed to read " << vertexShaderPath << " or " << fragmentShaderPath << std::endl;
+                    return;
+                }
+
+                const Clock::time_point swapStart = Clock::now();
+                std::string log;
+                GLuint program = buildProgram(vertexSource, fragmentSource, vertexFormat, attribs, &log);
+                if(!program) {
+                    std::cout << log << "Keeping the old shaders" << std::endl;
+                    return;
+                }
+                glDeleteProgram(shaderProgram);
+                shaderProgram = program;
+                uniforms = useProgram(shaderProgram, mvp, light);
+
+                std::cout << "Reloaded shaders " << msSince(requested) << " ms after the change, swap took "
+                          << msSince(swapStart) << " ms" << std::endl;
+            });
+        });
+    };
 
     glEnable(GL_DEPTH_TEST);
 
+    LodStats lastLodStats = { 0, 0 };
+
     while(!glfwWindowShouldClose(window)) {
+        // reload what changed in the background, without waiting for it
+        if(hotReload) {
+            changedFiles.clear();
+            watcher.poll(&changedFiles);
+
+            bool meshChanged = false, shadersChanged = false;
+            for(size_t i = 0; i < changedFiles.size(); i++) {
+                if(changedFiles[i] == vertexShaderPath || changedFiles[i] == fragmentShaderPath) shadersChanged = true;
+                else meshChanged = true;
+            }
+            if(meshChanged && !streamMesh) loadMeshAsync(true);
+            if(shadersChanged) loadShadersAsync();
+        }
+
+        // may replace draws and the shaders, so before drawing
+        loader.upload(uploadBudget);
+
         glClearColor(0, 0, 0, 0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUniform1f(attribTime, glfwGetTime());
-
-        glDrawElements(GL_TRIANGLES, sizeof(indices)/sizeof(indices[0]), GL_UNSIGNED_INT, 0);
+        glUniform1f(uniforms.time, glfwGetTime());
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        const float pixelScale = lodPixelScale(glm::value_ptr(projection), (float)height);
+        LodStats lodStats = { 0, 0 };
+
+        for(size_t d = 0; d < draws.size(); d++) {
+            MeshDraw &draw = draws[d];
+            glBindVertexArray(draw.vao);
+            glUniform3fv(uniforms.positionOffset, 1, draw.quant.offset);
+            glUniform3fv(uniforms.positionScale, 1, draw.quant.scale);
+
+            const size_t indexSize = draw.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(GLuint);
+            for(size_t b = 0; b < draw.batches.size(); b++) {
+                const MeshBatch &batch = draw.batches[b];
+                glUniform3fv(uniforms.diffuseColor, 1, batch.diffuse);
+                lodStats.availableTriangles += batch.indexCount / 3;
+
+                const MeshLod *batchLods = batch.lodCount ? draw.lods + batch.lodOffset : 0;
+                unsigned level = selectLod(&draw.lodStates[b], batchLods, batch.lodCount, cullCamera.position,
+                                           pixelScale, lodPixelError, lodHysteresis);
+                if(level) {
+                    const MeshLod &lod = batchLods[level - 1];
+                    glDrawElements(GL_TRIANGLES, lod.indexCount, draw.indexType, (const void *)(lod.indexOffset * indexSize));
+                    lodStats.triangles += lod.indexCount / 3;
+                } else if(batch.meshletCount) {
+                    // the camera doesn't move yet, but this is where it would be redone
+                    cullMeshlets(draw.meshlets + batch.meshletOffset, batch.meshletCount, cullCamera, &visibleRanges);
+                    if(visibleRanges.empty()) continue;
+
+                    drawCounts.resize(visibleRanges.size());
+                    drawOffsets.resize(visibleRanges.size());
+                    for(size_t i = 0; i < visibleRanges.size(); i++) {
+                        drawCounts[i] = visibleRanges[i].count;
+                        drawOffsets[i] = (const void *)(visibleRanges[i].offset * indexSize);
+                        lodStats.triangles += visibleRanges[i].count / 3;
+                    }
+                    glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), draw.indexType, drawOffsets.data(), (GLsizei)drawCounts.size());
+                } else {
+                    glDrawElements(GL_TRIANGLES, batch.indexCount, draw.indexType, (const void *)(batch.indexOffset * indexSize));
+                    lodStats.triangles += batch.indexCount / 3;
+                }
+            }
+        }
+
+        if(lodStats.triangles != lastLodStats.triangles || lodStats.availableTriangles != lastLodStats.availableTriangles) {
+            std::cout << "Drawing " << lodStats.triangles << " of " << lodStats.availableTriangles << " triangles" << std::endl;
+            lastLodStats = lodStats;
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        if(frames++ == 0) {
+            std::cout << "First frame after " << msSince(startTime) << " ms" << std::endl;
+        }
     }
+
+    return exitCode;
 }
\ No newline at end of file
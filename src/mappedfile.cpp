@@ -0,0 +1,132 @@
+/* mappedfile.cpp
+ * Read-only memory mapping of a whole file.
+ */
+
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile()
+    : data_(0), size_(0), open_(false)
+#ifdef _WIN32
+    , file_(INVALID_HANDLE_VALUE), mapping_(0)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+    file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if(file_ == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file_, &fileSize)) {
+        close();
+        return false;
+    }
+
+    // empty files can't be mapped
+    if(fileSize.QuadPart == 0) {
+        open_ = true;
+        return true;
+    }
+
+    mapping_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+    if(!mapping_) {
+        close();
+        return false;
+    }
+
+    data_ = (const unsigned char *)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if(!data_) {
+        close();
+        return false;
+    }
+
+    size_ = (size_t)fileSize.QuadPart;
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(data_) UnmapViewOfFile(data_);
+    if(mapping_) CloseHandle(mapping_);
+    if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+
+    data_ = 0;
+    size_ = 0;
+    open_ = false;
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = 0;
+}
+
+#else
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat sb;
+    if(fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // empty files can't be mapped
+    if(sb.st_size == 0) {
+        ::close(fd);
+        open_ = true;
+        return true;
+    }
+
+    void *p = mmap(0, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping stays valid
+    if(p == MAP_FAILED) return false;
+
+    madvise(p, (size_t)sb.st_size, MADV_SEQUENTIAL);
+
+    data_ = (const unsigned char *)p;
+    size_ = (size_t)sb.st_size;
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(data_) munmap((void *)data_, size_);
+
+    data_ = 0;
+    size_ = 0;
+    open_ = false;
+}
+
+#endif
@@ -0,0 +1,217 @@
+/* mesh.cpp
+ * Renderable meshes built from parsed .obj data.
+ */
+
+
+#include "mesh.h"
+
+#include <string.h>
+
+#include <unordered_map>
+
+#include "normals.h"
+#include "parallel.h"
+
+
+static const uint32_t EMPTY_SLOT = 0xffffffffu;
+
+// corners without a normal weld only within their smoothing group, or, with
+// smoothing off, their face: a smoothing group id, or FLAT_SMOOTHING + face
+static const uint64_t FLAT_SMOOTHING = 1ull << 32;
+
+struct WeldKey
+{
+    tinyobj::index_t idx;
+    uint64_t smoothing; // 0 if the corner has a normal
+};
+
+static uint32_t hashWeldKey(const WeldKey &key)
+{
+    uint32_t h = hashObjIndex(key.idx);
+    h ^= (uint32_t)key.smoothing * 0x27d4eb2fu ^ (uint32_t)(key.smoothing >> 32);
+    return h ^ (h >> 13);
+}
+
+static bool sameWeldKey(const WeldKey &a, const WeldKey &b)
+{
+    return sameObjIndex(a.idx, b.idx) && a.smoothing == b.smoothing;
+}
+
+// copies n floats of element i, or zeros if i is missing or out of range
+static void fetch(const std::vector<tinyobj::real_t> &src, int i, int n, float *dst)
+{
+    if(i < 0 || (size_t)i * n + n > src.size()) {
+        memset(dst, 0, n * sizeof(float));
+        return;
+    }
+    for(int k = 0; k < n; k++) dst[k] = (float)src[(size_t)i * n + k];
+}
+
+void buildMesh(const tinyobj::attrib_t &attrib, const tinyobj::shape_t &shape,
+               Mesh *mesh, unsigned numThreads)
+{
+    const std::vector<tinyobj::index_t> &corners = shape.mesh.indices;
+
+    mesh->vertices.clear();
+    mesh->indices.resize(corners.size());
+
+    const size_t triCount = corners.size() / 3;
+    const std::vector<int> &faceMaterials = shape.mesh.material_ids;
+    mesh->materialIds.resize(triCount);
+    for(size_t t = 0; t < triCount; t++) {
+        mesh->materialIds[t] = t < faceMaterials.size() ? faceMaterials[t] : -1;
+    }
+
+    // open addressing with linear probing, at most half full
+    size_t capacity = 16;
+    while(capacity < corners.size() * 2) capacity *= 2;
+    const size_t mask = capacity - 1;
+    std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+
+    // what each vertex was made from, for comparing on collisions
+    std::vector<WeldKey> keys;
+    bool missingNormals = false;
+
+    for(size_t i = 0; i < corners.size(); i++) {
+        WeldKey key;
+        key.idx = corners[i];
+        key.smoothing = 0;
+
+        const tinyobj::index_t &idx = key.idx;
+        if(idx.normal_index < 0 || (size_t)idx.normal_index * 3 + 3 > attrib.normals.size()) {
+            size_t face = i / 3;
+            unsigned group = face < shape.mesh.smoothing_group_ids.size() ? shape.mesh.smoothing_group_ids[face] : 0;
+            key.smoothing = group ? group : FLAT_SMOOTHING + face;
+            missingNormals = true;
+        }
+
+        size_t slot = hashWeldKey(key) & mask;
+        while(table[slot] != EMPTY_SLOT && !sameWeldKey(keys[table[slot]], key)) {
+            slot = (slot + 1) & mask;
+        }
+
+        if(table[slot] == EMPTY_SLOT) {
+            table[slot] = (uint32_t)mesh->vertices.size();
+            keys.push_back(key);
+
+            Vertex v;
+            fetch(attrib.vertices, idx.vertex_index, 3, v.position);
+            fetch(attrib.normals, idx.normal_index, 3, v.normal);
+            fetch(attrib.texcoords, idx.texcoord_index, 2, v.texcoord);
+            mesh->vertices.push_back(v);
+        }
+
+        mesh->indices[i] = table[slot];
+    }
+
+    if(!missingNormals) return;
+
+    // vertices at one position in one smoothing group share a normal, even
+    // if a texcoord seam splits them; flat ones get one each
+    std::vector<uint32_t> normalGroups(keys.size(), NORMAL_GROUP_NONE);
+    std::unordered_map<uint64_t, uint32_t> smoothGroups;
+    uint32_t groupCount = 0;
+    for(size_t v = 0; v < keys.size(); v++) {
+        if(keys[v].smoothing == 0) continue;
+        if(keys[v].smoothing >= FLAT_SMOOTHING) {
+            normalGroups[v] = groupCount++;
+            continue;
+        }
+
+        uint64_t at = ((uint64_t)(uint32_t)keys[v].idx.vertex_index << 32) | keys[v].smoothing;
+        std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> it = smoothGroups.insert(std::make_pair(at, groupCount));
+        if(it.second) groupCount++;
+        normalGroups[v] = it.first->second;
+    }
+
+    generateNormals(mesh, normalGroups.data(), groupCount, numThreads);
+}
+
+void buildMeshes(const tinyobj::attrib_t &attrib,
+                 const std::vector<tinyobj::shape_t> &shapes,
+                 std::vector<Mesh> *meshes, unsigned numThreads)
+{
+    meshes->clear();
+    meshes->resize(shapes.size());
+
+    // threads go to the shapes, or within the shape if there is only one
+    unsigned shapeThreads = shapes.size() > 1 ? 1 : numThreads;
+    parallelFor(shapes.size(), numThreads, [&](size_t i) {
+        buildMesh(attrib, shapes[i], &(*meshes)[i], shapeThreads);
+    });
+}
+
+void mergeMeshes(const std::vector<Mesh> &meshes, Mesh *out)
+{
+    size_t nVertices = 0, nIndices = 0, nTriangles = 0;
+    for(size_t i = 0; i < meshes.size(); i++) {
+        nVertices += meshes[i].vertices.size();
+        nIndices += meshes[i].indices.size();
+        nTriangles += meshes[i].materialIds.size();
+    }
+
+    out->vertices.clear();
+    out->indices.clear();
+    out->materialIds.clear();
+    out->vertices.reserve(nVertices);
+    out->indices.reserve(nIndices);
+    out->materialIds.reserve(nTriangles);
+
+    for(size_t i = 0; i < meshes.size(); i++) {
+        const uint32_t base = (uint32_t)out->vertices.size();
+        out->vertices.insert(out->vertices.end(), meshes[i].vertices.begin(), meshes[i].vertices.end());
+        for(size_t k = 0; k < meshes[i].indices.size(); k++) {
+            out->indices.push_back(base + meshes[i].indices[k]);
+        }
+        out->materialIds.insert(out->materialIds.end(), meshes[i].materialIds.begin(), meshes[i].materialIds.end());
+    }
+}
+
+void groupByMaterial(Mesh *mesh, const std::vector<tinyobj::material_t> &materials,
+                     std::vector<MeshBatch> *batches)
+{
+    const size_t triCount = mesh->indices.size() / 3;
+    const size_t nSlots = materials.size() + 1; // slot 0 is no material
+    batches->clear();
+
+    std::vector<size_t> slots(triCount);
+    std::vector<size_t> offsets(nSlots + 1, 0);
+    for(size_t t = 0; t < triCount; t++) {
+        int32_t id = t < mesh->materialIds.size() ? mesh->materialIds[t] : -1;
+        slots[t] = id >= 0 && (size_t)id < materials.size() ? (size_t)id + 1 : 0;
+        offsets[slots[t] + 1]++;
+    }
+    for(size_t i = 0; i < nSlots; i++) offsets[i + 1] += offsets[i];
+
+    for(size_t i = 0; i < nSlots; i++) {
+        if(offsets[i + 1] == offsets[i]) continue;
+
+        MeshBatch batch;
+        batch.indexOffset = (uint32_t)(offsets[i] * 3);
+        batch.indexCount = (uint32_t)((offsets[i + 1] - offsets[i]) * 3);
+        batch.meshletOffset = 0;
+        batch.meshletCount = 0;
+        batch.lodOffset = 0;
+        batch.lodCount = 0;
+        batch.material = (int32_t)i - 1;
+        for(int k = 0; k < 3; k++) batch.diffuse[k] = i ? (float)materials[i - 1].diffuse[k] : 1.0f;
+        batches->push_back(batch);
+    }
+
+    // counting sort of the triangles by slot, stable within a slot
+    std::vector<uint32_t> indices(triCount * 3);
+    mesh->materialIds.resize(triCount);
+    for(size_t t = 0; t < triCount; t++) {
+        size_t dst = offsets[slots[t]]++;
+        for(int k = 0; k < 3; k++) indices[dst * 3 + k] = mesh->indices[t * 3 + k];
+        mesh->materialIds[dst] = slots[t] ? (int32_t)slots[t] - 1 : -1;
+    }
+    mesh->indices.swap(indices);
+}
+
+void narrowIndices(const uint32_t *indices, size_t count,
+                   std::vector<uint16_t> *out)
+{
+    out->resize(count);
+    for(size_t i = 0; i < count; i++) (*out)[i] = (uint16_t)indices[i];
+}
@@ -0,0 +1,164 @@
+/* meshbake.cpp
+ * Turns an .obj into the render-ready mesh main.cpp draws.
+ */
+
+
+#include "meshbake.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include "plyload.h"
+
+
+static const float DEFAULT_LOD_RATIOS[] = { 0.5f, 0.25f, 0.1f, 0.02f };
+
+MeshBakeOptions defaultMeshBakeOptions()
+{
+    MeshBakeOptions options;
+    options.optimize = true;
+    options.lodRatios = DEFAULT_LOD_RATIOS;
+    options.lodCount = sizeof(DEFAULT_LOD_RATIOS) / sizeof(DEFAULT_LOD_RATIOS[0]);
+    options.numThreads = 0;
+    return options;
+}
+
+// path up to and including its last slash, empty if it has none
+static std::string directoryOf(const std::string &path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// optimizes each batch of out in place and appends its meshlets and LODs
+static void optimizeBatches(const MeshBakeOptions &options, BakedMesh *out, MeshBakeStats *stats)
+{
+    Mesh &mesh = out->mesh;
+    const size_t lodLevels = options.lodCount;
+
+    stats->cacheBefore = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    stats->overdrawBefore = analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size());
+
+    // triangles must not leave their material's batch
+    std::vector<Meshlet> batchMeshlets;
+    std::vector<uint32_t> lodIndices, batchLodIndices;
+    out->lods.resize(out->batches.size() * lodLevels);
+    for(size_t b = 0; b < out->batches.size(); b++) {
+        MeshBatch &batch = out->batches[b];
+        uint32_t *batchIndices = &mesh.indices[batch.indexOffset];
+        optimizeVertexCache(batchIndices, batch.indexCount, mesh.vertices.size());
+        optimizeOverdraw(batchIndices, batch.indexCount, mesh.vertices.data(), mesh.vertices.size());
+        buildMeshlets(batchIndices, batch.indexCount, mesh.vertices.data(), mesh.vertices.size(), &batchMeshlets);
+
+        batch.meshletOffset = (uint32_t)out->meshlets.size();
+        batch.meshletCount = (uint32_t)batchMeshlets.size();
+        for(size_t i = 0; i < batchMeshlets.size(); i++) {
+            batchMeshlets[i].indexOffset += batch.indexOffset;
+            out->meshlets.push_back(batchMeshlets[i]);
+        }
+
+        // LOD indices go after every batch's full detail ones
+        MeshLod *batchLods = &out->lods[b * lodLevels];
+        buildLods(batchIndices, batch.indexCount, mesh.vertices.data(), mesh.vertices.size(),
+                  options.lodRatios, lodLevels, &batchLodIndices, batchLods, options.numThreads);
+        batch.lodOffset = (uint32_t)(b * lodLevels);
+        batch.lodCount = (uint32_t)lodLevels;
+        for(size_t i = 0; i < lodLevels; i++) {
+            batchLods[i].indexOffset += (uint32_t)(mesh.indices.size() + lodIndices.size());
+        }
+        lodIndices.insert(lodIndices.end(), batchLodIndices.begin(), batchLodIndices.end());
+    }
+
+    const size_t baseIndexCount = mesh.indices.size();
+    mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+    optimizeVertexFetch(&mesh);
+    stats->cacheAfter = analyzeVertexCache(mesh.indices.data(), baseIndexCount, mesh.vertices.size());
+    stats->overdrawAfter = analyzeOverdraw(mesh.indices.data(), baseIndexCount, mesh.vertices.data(), mesh.vertices.size());
+}
+
+// optimizes out if asked, filling in stats
+static void finishBake(const MeshBakeOptions &options, BakedMesh *out, MeshBakeStats *stats)
+{
+    out->meshlets.clear();
+    out->lods.clear();
+    MeshBakeStats unused;
+    if(!stats) stats = &unused;
+    memset(stats, 0, sizeof(*stats));
+    if(options.optimize) optimizeBatches(options, out, stats);
+}
+
+bool bakeObj(const char *objPath, const MeshBakeOptions &options,
+             BakedMesh *out, MeshBakeStats *stats,
+             std::string *warn, std::string *err)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+
+    // materials live next to the .obj
+    std::string baseDir = directoryOf(objPath);
+
+    if(!tinyobj::LoadObj(&attrib, &shapes, &materials, warn, err, objPath, baseDir.c_str())) {
+        if(err->empty()) *err = std::string("failed to load ") + objPath;
+        return false;
+    }
+    if(!err->empty()) return false;
+
+    // one vertex per distinct position/texcoord/normal triple
+    std::vector<Mesh> shapeMeshes;
+    buildMeshes(attrib, shapes, &shapeMeshes, options.numThreads);
+    mergeMeshes(shapeMeshes, &out->mesh);
+
+    // one draw per material instead of per shape
+    groupByMaterial(&out->mesh, materials, &out->batches);
+
+    finishBake(options, out, stats);
+    return true;
+}
+
+bool bakePly(const char *plyPath, const MeshBakeOptions &options,
+             BakedMesh *out, MeshBakeStats *stats, std::string *err)
+{
+    if(!loadPly(plyPath, &out->mesh, err, options.numThreads)) return false;
+
+    groupByMaterial(&out->mesh, std::vector<tinyobj::material_t>(), &out->batches);
+
+    finishBake(options, out, stats);
+    return true;
+}
+
+bool bakeMeshFile(const char *path, const MeshBakeOptions &options,
+                  BakedMesh *out, MeshBakeStats *stats,
+                  std::string *warn, std::string *err)
+{
+    const size_t n = strlen(path);
+    const bool ply = n >= 4 && path[n - 4] == '.' && tolower(path[n - 3]) == 'p' &&
+                     tolower(path[n - 2]) == 'l' && tolower(path[n - 1]) == 'y';
+    if(ply) return bakePly(path, options, out, stats, err);
+    return bakeObj(path, options, out, stats, warn, err);
+}
+
+void findMaterialLibraries(const char *objPath, const void *obj, size_t size,
+                           std::vector<std::string> *mtlPaths)
+{
+    const std::string baseDir = directoryOf(objPath);
+    const char *p = (const char *)obj, *end = p + size;
+    while(p < end) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if(!eol) eol = end;
+        while(p < eol && (*p == ' ' || *p == '\t')) p++;
+
+        // each whitespace separated word after mtllib names a file
+        if(eol - p > 6 && memcmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t')) {
+            const char *word = p + 6;
+            while(word < eol) {
+                while(word < eol && (*word == ' ' || *word == '\t' || *word == '\r')) word++;
+                const char *wordEnd = word;
+                while(wordEnd < eol && *wordEnd != ' ' && *wordEnd != '\t' && *wordEnd != '\r') wordEnd++;
+                if(wordEnd > word) mtlPaths->push_back(baseDir + std::string(word, wordEnd - word));
+                word = wordEnd;
+            }
+        }
+        p = eol + 1;
+    }
+}
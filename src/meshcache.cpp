@@ -0,0 +1,220 @@
+/* meshcache.cpp
+ * Binary cache of parsed mesh data.
+ */
+
+
+#include "meshcache.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t hash = seed;
+
+    for(size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static size_t alignUp(size_t x)
+{
+    return (x + MESHCACHE_ALIGNMENT - 1) & ~(size_t)(MESHCACHE_ALIGNMENT - 1);
+}
+
+// hashes the whole source file, returns false if it can't be read
+static bool hashFile(const char *path, uint64_t *hash)
+{
+    MappedFile source;
+    if(!source.open(path)) return false;
+
+    *hash = hashBytes(source.data(), source.size());
+    return true;
+}
+
+// rewrites the modification time of a cache's index'th source in place
+static bool writeSourceMtime(const char *cachePath, uint32_t index, int64_t mtime)
+{
+    FILE *fp = fopen(cachePath, "r+b");
+    if(!fp) return false;
+    const long offset = (long)(sizeof(MeshCacheHeader) + index * sizeof(MeshCacheSource) + offsetof(MeshCacheSource, mtime));
+    bool ok = fseek(fp, offset, SEEK_SET) == 0 && fwrite(&mtime, sizeof(mtime), 1, fp) == 1;
+    if(fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+// fills in source for path as it is now
+static bool describeSource(const char *path, MeshCacheSource *source)
+{
+    memset(source, 0, sizeof(*source));
+    if(strlen(path) >= MESHCACHE_PATH_SIZE) return false;
+    strcpy(source->path, path);
+
+    struct stat st;
+    if(stat(path, &st) != 0) return true;
+    source->exists = 1;
+    source->mtime = (int64_t)st.st_mtime;
+    source->size = (uint64_t)st.st_size;
+    return hashFile(path, &source->hash);
+}
+
+bool MeshCache::open(const char *cachePath, const char *sourcePath, uint64_t optionsHash)
+{
+    if(!file_.open(cachePath)) return false;
+
+    do {
+        size_t size = file_.size();
+        if(size < sizeof(MeshCacheHeader)) break;
+
+        const MeshCacheHeader *header = (const MeshCacheHeader *)file_.data();
+        if(memcmp(header->magic, MESHCACHE_MAGIC, 4) != 0) break;
+        if(header->version != MESHCACHE_VERSION) break;
+        if(header->optionsHash != optionsHash) break;
+
+        // sources and table of contents must fit in the file
+        size_t tocEnd = sizeof(MeshCacheHeader);
+        if(header->sourceCount == 0 || header->sourceCount > (size - tocEnd) / sizeof(MeshCacheSource)) break;
+        tocEnd += header->sourceCount * sizeof(MeshCacheSource);
+        if(header->blobCount > (size - tocEnd) / sizeof(MeshCacheBlob)) break;
+        tocEnd += header->blobCount * sizeof(MeshCacheBlob);
+
+        const MeshCacheSource *sources = (const MeshCacheSource *)(header + 1);
+        const MeshCacheBlob *toc = (const MeshCacheBlob *)(sources + header->sourceCount);
+        uint32_t i;
+        for(i = 0; i < header->blobCount; i++) {
+            if(toc[i].offset < tocEnd || toc[i].offset > size) break;
+            if(toc[i].size > size - toc[i].offset) break;
+            if(toc[i].offset % MESHCACHE_ALIGNMENT) break;
+        }
+        if(i != header->blobCount) break;
+
+        // made from sourcePath?
+        if(memchr(sources[0].path, 0, MESHCACHE_PATH_SIZE) == 0 || strcmp(sources[0].path, sourcePath) != 0) break;
+
+        // stale?  Sources touched but the same are noted to have their new
+        // times recorded
+        std::vector<std::pair<uint32_t, int64_t> > touched;
+        for(i = 0; i < header->sourceCount; i++) {
+            const MeshCacheSource &source = sources[i];
+            if(memchr(source.path, 0, MESHCACHE_PATH_SIZE) == 0) break;
+
+            struct stat st;
+            const bool exists = stat(source.path, &st) == 0;
+            if(exists != (source.exists != 0)) break;
+            if(!exists) continue;
+
+            if(source.size != (uint64_t)st.st_size) break;
+            if(source.mtime != (int64_t)st.st_mtime) {
+                uint64_t hash;
+                if(!hashFile(source.path, &hash) || hash != source.hash) break;
+                touched.push_back(std::make_pair(i, (int64_t)st.st_mtime));
+            }
+        }
+        if(i != header->sourceCount) break;
+
+        if(!touched.empty()) {
+            // record the new times so later opens don't hash them again.
+            // Patched with the mapping closed, since Windows won't write to a
+            // file that is mapped
+            file_.close();
+            for(i = 0; i < touched.size(); i++) writeSourceMtime(cachePath, touched[i].first, touched[i].second);
+            return file_.open(cachePath) && file_.size() == size;
+        }
+
+        return true;
+    } while(0);
+
+    file_.close();
+    return false;
+}
+
+const void *MeshCache::blob(uint32_t id, size_t *size) const
+{
+    if(!file_.data()) return 0;
+
+    const MeshCacheHeader *header = (const MeshCacheHeader *)file_.data();
+    const MeshCacheBlob *toc = (const MeshCacheBlob *)((const MeshCacheSource *)(header + 1) + header->sourceCount);
+
+    for(uint32_t i = 0; i < header->blobCount; i++) {
+        if(toc[i].id == id) {
+            if(size) *size = (size_t)toc[i].size;
+            return file_.data() + toc[i].offset;
+        }
+    }
+
+    return 0;
+}
+
+bool writeMeshCache(const char *cachePath, const char *const *sourcePaths, size_t sourceCount,
+                    uint64_t optionsHash, const MeshCacheBlobData *blobs, size_t blobCount)
+{
+    std::vector<MeshCacheSource> sources(sourceCount);
+    for(size_t i = 0; i < sourceCount; i++) {
+        if(!describeSource(sourcePaths[i], &sources[i])) return false;
+    }
+    if(sourceCount == 0 || !sources[0].exists) return false;
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESHCACHE_MAGIC, 4);
+    header.version = MESHCACHE_VERSION;
+    header.optionsHash = optionsHash;
+    header.sourceCount = (uint32_t)sourceCount;
+    header.blobCount = (uint32_t)blobCount;
+
+    std::string tmpPath = std::string(cachePath) + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if(!fp) return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(sources.data(), sizeof(MeshCacheSource), sourceCount, fp) == sourceCount;
+
+    // table of contents
+    const size_t tocEnd = sizeof(header) + sourceCount * sizeof(MeshCacheSource) + blobCount * sizeof(MeshCacheBlob);
+    size_t offset = alignUp(tocEnd);
+    for(size_t i = 0; ok && i < blobCount; i++) {
+        MeshCacheBlob entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.id = blobs[i].id;
+        entry.offset = offset;
+        entry.size = blobs[i].size;
+        ok = fwrite(&entry, sizeof(entry), 1, fp) == 1;
+
+        offset = alignUp(offset + blobs[i].size);
+    }
+
+    // blob data, zero padded up to each aligned offset
+    static const unsigned char zeros[MESHCACHE_ALIGNMENT] = {0};
+    size_t written = tocEnd;
+    for(size_t i = 0; ok && i < blobCount; i++) {
+        size_t pad = alignUp(written) - written;
+        if(pad) ok = fwrite(zeros, 1, pad, fp) == pad;
+        written += pad;
+
+        if(ok && blobs[i].size)
+            ok = fwrite(blobs[i].data, 1, blobs[i].size, fp) == blobs[i].size;
+        written += blobs[i].size;
+    }
+
+    if(fclose(fp) != 0) ok = false;
+
+    if(!ok) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    // rename() doesn't replace an existing file on Windows
+    remove(cachePath);
+    return rename(tmpPath.c_str(), cachePath) == 0;
+}
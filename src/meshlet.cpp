@@ -0,0 +1,278 @@
+/* meshlet.cpp
+ * Small triangle clusters that can be culled on the CPU before drawing.
+ */
+
+
+#include "meshlet.h"
+
+#include <math.h>
+
+#include "meshopt.h"
+
+
+static const uint32_t NO_MESHLET = 0xffffffffu;
+static const size_t NO_TRIANGLE = (size_t)-1;
+
+// unit normal of a triangle, false if it has no area
+static bool triangleNormal(const float *p0, const float *p1, const float *p2, float *n)
+{
+    float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if(length == 0) return false;
+    for(int k = 0; k < 3; k++) n[k] /= length;
+    return true;
+}
+
+// bounding sphere and normal cone of a finished meshlet
+static void computeBounds(const uint32_t *indices, const Vertex *vertices,
+                          const std::vector<uint32_t> &local, Meshlet *m)
+{
+    float lo[3], hi[3];
+    for(int k = 0; k < 3; k++) lo[k] = hi[k] = vertices[local[0]].position[k];
+    for(size_t i = 1; i < local.size(); i++) {
+        const float *p = vertices[local[i]].position;
+        for(int k = 0; k < 3; k++) {
+            if(p[k] < lo[k]) lo[k] = p[k];
+            if(p[k] > hi[k]) hi[k] = p[k];
+        }
+    }
+
+    float radius2 = 0;
+    for(int k = 0; k < 3; k++) m->center[k] = (lo[k] + hi[k]) * 0.5f;
+    for(size_t i = 0; i < local.size(); i++) {
+        const float *p = vertices[local[i]].position;
+        float dx = p[0] - m->center[0], dy = p[1] - m->center[1], dz = p[2] - m->center[2];
+        float d2 = dx * dx + dy * dy + dz * dz;
+        if(d2 > radius2) radius2 = d2;
+    }
+    m->radius = sqrtf(radius2);
+
+    // the axis is the average normal, the cone as wide as the normal
+    // furthest from it
+    const uint32_t *tri = &indices[m->indexOffset];
+    const size_t triCount = m->indexCount / 3;
+
+    float axis[3] = { 0, 0, 0 };
+    for(size_t t = 0; t < triCount; t++) {
+        float n[3];
+        if(!triangleNormal(vertices[tri[t * 3 + 0]].position, vertices[tri[t * 3 + 1]].position,
+                           vertices[tri[t * 3 + 2]].position, n)) continue;
+        for(int k = 0; k < 3; k++) axis[k] += n[k];
+    }
+
+    float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minCos = length > 0 ? 1.0f : -1.0f;
+    for(int k = 0; k < 3; k++) m->coneAxis[k] = length > 0 ? axis[k] / length : 0;
+
+    for(size_t t = 0; t < triCount && minCos > 0; t++) {
+        float n[3];
+        if(!triangleNormal(vertices[tri[t * 3 + 0]].position, vertices[tri[t * 3 + 1]].position,
+                           vertices[tri[t * 3 + 2]].position, n)) continue;
+        float c = n[0] * m->coneAxis[0] + n[1] * m->coneAxis[1] + n[2] * m->coneAxis[2];
+        if(c < minCos) minCos = c;
+    }
+
+    // a cone of 90 degrees or more always has something facing the camera
+    if(minCos > 0) {
+        m->coneCos = minCos;
+        m->coneSin = sqrtf(1 - minCos * minCos);
+    } else {
+        m->coneCos = 0;
+        m->coneSin = 1;
+    }
+}
+
+void buildMeshlets(uint32_t *indices, size_t indexCount,
+                   const Vertex *vertices, size_t vertexCount,
+                   std::vector<Meshlet> *meshlets)
+{
+    meshlets->clear();
+
+    const size_t triCount = indexCount / 3;
+    if(triCount == 0) return;
+
+    // triangles using each vertex, packed per vertex
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for(size_t i = 0; i < triCount * 3; i++) offsets[indices[i] + 1]++;
+    for(size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+    std::vector<uint32_t> adjacency(triCount * 3);
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < triCount * 3; i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<float> centroids(triCount * 3);
+    for(size_t t = 0; t < triCount; t++) {
+        for(int k = 0; k < 3; k++) {
+            centroids[t * 3 + k] = (vertices[indices[t * 3 + 0]].position[k] +
+                                    vertices[indices[t * 3 + 1]].position[k] +
+                                    vertices[indices[t * 3 + 2]].position[k]) / 3;
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triCount * 3);
+    std::vector<char> emitted(triCount, 0);
+
+    // the meshlet each vertex was last added to, so membership needs no clearing
+    std::vector<uint32_t> owner(vertexCount, NO_MESHLET);
+    std::vector<uint32_t> local;
+    local.reserve(MESHLET_MAX_VERTICES);
+    std::vector<uint32_t> localIndices;
+    localIndices.reserve(MESHLET_MAX_TRIANGLES * 3);
+
+    size_t cursor = 0;
+    for(;;) {
+        while(cursor < triCount && emitted[cursor]) cursor++;
+        if(cursor == triCount) break;
+
+        const uint32_t id = (uint32_t)meshlets->size();
+        Meshlet m;
+        m.indexOffset = (uint32_t)output.size();
+        local.clear();
+
+        float sum[3] = { 0, 0, 0 };
+        size_t tris = 0;
+
+        for(size_t t = cursor; t != NO_TRIANGLE;) {
+            const uint32_t *tri = &indices[t * 3];
+            for(int k = 0; k < 3; k++) {
+                output.push_back(tri[k]);
+                if(owner[tri[k]] != id) {
+                    owner[tri[k]] = id;
+                    local.push_back(tri[k]);
+                }
+                sum[k] += centroids[t * 3 + k];
+            }
+            emitted[t] = 1;
+            if(++tris == MESHLET_MAX_TRIANGLES) break;
+
+            float center[3] = { sum[0] / tris, sum[1] / tris, sum[2] / tris };
+
+            // the unused neighbour adding the fewest vertices, then the closest
+            size_t best = NO_TRIANGLE;
+            unsigned bestExtra = 4;
+            float bestDistance = 0;
+
+            for(size_t i = 0; i < local.size(); i++) {
+                uint32_t v = local[i];
+                for(size_t j = offsets[v]; j < offsets[v + 1]; j++) {
+                    uint32_t u = adjacency[j];
+                    if(emitted[u]) continue;
+
+                    const uint32_t *w = &indices[u * 3];
+                    unsigned extra = (owner[w[0]] != id) +
+                                     (owner[w[1]] != id && w[1] != w[0]) +
+                                     (owner[w[2]] != id && w[2] != w[0] && w[2] != w[1]);
+                    if(local.size() + extra > MESHLET_MAX_VERTICES) continue;
+
+                    const float *c = &centroids[u * 3];
+                    float dx = c[0] - center[0], dy = c[1] - center[1], dz = c[2] - center[2];
+                    float distance = dx * dx + dy * dy + dz * dz;
+
+                    if(extra < bestExtra || (extra == bestExtra && (distance < bestDistance ||
+                                             (distance == bestDistance && u < best)))) {
+                        best = u;
+                        bestExtra = extra;
+                        bestDistance = distance;
+                    }
+                }
+            }
+            t = best;
+        }
+
+        m.indexCount = (uint32_t)(output.size() - m.indexOffset);
+        m.vertexCount = (uint32_t)local.size();
+
+        // growing by distance scatters the cache order, redo it within the
+        // meshlet on indices numbered by first use
+        uint32_t *meshletIndices = &output[m.indexOffset];
+        localIndices.resize(m.indexCount);
+        for(size_t i = 0; i < local.size(); i++) owner[local[i]] = (uint32_t)i;
+        for(size_t i = 0; i < m.indexCount; i++) localIndices[i] = owner[meshletIndices[i]];
+        optimizeVertexCache(localIndices.data(), localIndices.size(), local.size());
+        for(size_t i = 0; i < m.indexCount; i++) meshletIndices[i] = local[localIndices[i]];
+        for(size_t i = 0; i < local.size(); i++) owner[local[i]] = id;
+        computeBounds(output.data(), vertices, local, &m);
+        meshlets->push_back(m);
+    }
+
+    for(size_t i = 0; i < triCount * 3; i++) indices[i] = output[i];
+}
+
+void extractFrustumPlanes(const float *mvp, float planes[6][4])
+{
+    // Gribb and Hartmann: -w <= x, y, z <= w in clip space, written in terms
+    // of the rows of the matrix
+    for(int i = 0; i < 3; i++) {
+        for(int k = 0; k < 4; k++) {
+            planes[i * 2 + 0][k] = mvp[k * 4 + 3] + mvp[k * 4 + i];
+            planes[i * 2 + 1][k] = mvp[k * 4 + 3] - mvp[k * 4 + i];
+        }
+    }
+
+    for(int i = 0; i < 6; i++) {
+        float *p = planes[i];
+        float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if(length == 0) continue;
+        for(int k = 0; k < 4; k++) p[k] /= length;
+    }
+}
+
+// true if every triangle of m faces away from the camera: with the camera
+// at angle phi from the cone axis and the normals at most theta from it, no
+// normal is nearer than phi + theta, and the sphere must be entirely behind
+// the planes at that angle
+static bool backfacing(const Meshlet &m, const float *camera)
+{
+    float v[3] = { m.center[0] - camera[0], m.center[1] - camera[1], m.center[2] - camera[2] };
+    float d = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if(d <= m.radius) return false;
+
+    float cosPhi = (v[0] * m.coneAxis[0] + v[1] * m.coneAxis[1] + v[2] * m.coneAxis[2]) / d;
+    float sinPhi = sqrtf(fmaxf(0, 1 - cosPhi * cosPhi));
+    return (cosPhi * m.coneCos - sinPhi * m.coneSin) * d > m.radius;
+}
+
+static bool outsideFrustum(const Meshlet &m, const float planes[6][4])
+{
+    for(int i = 0; i < 6; i++) {
+        const float *p = planes[i];
+        if(p[0] * m.center[0] + p[1] * m.center[1] + p[2] * m.center[2] + p[3] < -m.radius) return true;
+    }
+    return false;
+}
+
+MeshletCullStats cullMeshlets(const Meshlet *meshlets, size_t count,
+                              const CullCamera &camera,
+                              std::vector<IndexRange> *ranges)
+{
+    MeshletCullStats stats = { count, 0, 0, 0 };
+    ranges->clear();
+
+    for(size_t i = 0; i < count; i++) {
+        const Meshlet &m = meshlets[i];
+        stats.triangles += m.indexCount / 3;
+
+        if(outsideFrustum(m, camera.planes) || backfacing(m, camera.position)) {
+            stats.culledMeshlets++;
+            stats.culledTriangles += m.indexCount / 3;
+            continue;
+        }
+
+        if(!ranges->empty() && ranges->back().offset + ranges->back().count == m.indexOffset) {
+            ranges->back().count += m.indexCount;
+        } else {
+            IndexRange range = { m.indexOffset, m.indexCount };
+            ranges->push_back(range);
+        }
+    }
+
+    return stats;
+}
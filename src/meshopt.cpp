@@ -0,0 +1,465 @@
+/* meshopt.cpp
+ * Index and vertex reordering for faster rendering.
+ */
+
+
+#include "meshopt.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+
+// FIFO post-transform cache: a vertex is cached while fewer than size
+// misses came after its own
+struct FifoCache
+{
+    std::vector<size_t> stamp;
+    size_t time;
+    unsigned size;
+
+    FifoCache(size_t vertexCount, unsigned cacheSize)
+        : stamp(vertexCount, 0), time(cacheSize + 1), size(cacheSize)
+    {
+    }
+
+    // returns 1 on a miss
+    unsigned access(uint32_t v)
+    {
+        if(time - stamp[v] <= size) return 0;
+        stamp[v] = time++;
+        return 1;
+    }
+
+    // empties the cache
+    void flush()
+    {
+        time += size + 1;
+    }
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+                                    size_t vertexCount, unsigned cacheSize)
+{
+    VertexCacheStats stats = { 0, 0, 0 };
+
+    FifoCache cache(vertexCount, cacheSize);
+    for(size_t i = 0; i < indexCount; i++) stats.transformed += cache.access(indices[i]);
+
+    if(indexCount) stats.acmr = (float)stats.transformed / (indexCount / 3);
+    if(vertexCount) stats.atvr = (float)stats.transformed / vertexCount;
+    return stats;
+}
+
+// Forsyth's scoring, tuned for a 32 entry LRU cache
+static const unsigned FORSYTH_CACHE_SIZE = 32;
+static const unsigned FORSYTH_MAX_VALENCE = 32; // tabulated valence scores
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+struct ForsythTables
+{
+    float cache[FORSYTH_CACHE_SIZE + 1]; // by cache position + 1, 0 = not cached
+    float valence[FORSYTH_MAX_VALENCE + 1];
+
+    ForsythTables()
+    {
+        cache[0] = 0;
+        for(unsigned i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+            if(i < 3) {
+                // the last triangle's vertices score the same, so it doesn't
+                // matter which order its corners were emitted in
+                cache[i + 1] = FORSYTH_LAST_TRI_SCORE;
+            } else {
+                float scale = 1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3);
+                cache[i + 1] = powf(scale, FORSYTH_CACHE_DECAY_POWER);
+            }
+        }
+
+        valence[0] = 0;
+        for(unsigned i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+            valence[i] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+        }
+    }
+};
+
+static float vertexScore(const ForsythTables &tables, int cachePos, unsigned remaining)
+{
+    // no triangles left to draw, the vertex is done
+    if(remaining == 0) return -1.0f;
+
+    float score = tables.cache[cachePos + 1];
+    if(remaining <= FORSYTH_MAX_VALENCE) {
+        score += tables.valence[remaining];
+    } else {
+        score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remaining, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+    return score;
+}
+
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+    static const ForsythTables tables;
+
+    const size_t triCount = indexCount / 3;
+    if(triCount == 0) return;
+
+    // triangles using each vertex, packed per vertex; the first remaining[v]
+    // entries of a vertex are the triangles it still has to be drawn in
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for(size_t i = 0; i < triCount * 3; i++) remaining[indices[i]]++;
+
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for(size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(triCount * 3);
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < triCount * 3; i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for(size_t v = 0; v < vertexCount; v++) vScore[v] = vertexScore(tables, -1, remaining[v]);
+
+    std::vector<float> tScore(triCount);
+    for(size_t t = 0; t < triCount; t++) {
+        const uint32_t *tri = &indices[t * 3];
+        tScore[t] = vScore[tri[0]] + vScore[tri[1]] + vScore[tri[2]];
+    }
+
+    std::vector<uint32_t> output(triCount * 3);
+    std::vector<char> emitted(triCount, 0);
+
+    // LRU cache, most recent first, with room for a triangle's worth of
+    // vertices to be pushed past the end
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    size_t cacheCount = 0;
+
+    size_t best = 0;
+    bool haveBest = false;
+    size_t cursor = 0;
+
+    for(size_t n = 0; n < triCount; n++) {
+        // dead end, nothing in the cache has triangles left: carry on with
+        // the next triangle in input order
+        if(!haveBest) {
+            while(emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        const uint32_t *tri = &indices[best * 3];
+        output[n * 3 + 0] = tri[0];
+        output[n * 3 + 1] = tri[1];
+        output[n * 3 + 2] = tri[2];
+        emitted[best] = 1;
+
+        // remove the triangle from its vertices' lists
+        for(int k = 0; k < 3; k++) {
+            uint32_t v = tri[k];
+            uint32_t *adj = &adjacency[offsets[v]];
+            uint32_t r = remaining[v];
+            for(uint32_t j = 0; j < r; j++) {
+                if(adj[j] == best) {
+                    adj[j] = adj[r - 1];
+                    break;
+                }
+            }
+            remaining[v] = r - 1;
+        }
+
+        // move the triangle's vertices to the front of the cache
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        size_t newCount = 0;
+        for(int k = 0; k < 3; k++) {
+            if(k > 0 && tri[k] == tri[0]) continue;
+            if(k > 1 && tri[k] == tri[1]) continue;
+            newCache[newCount++] = tri[k];
+        }
+        for(size_t i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            if(v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+        }
+
+        // rescore everything that moved, including what fell out
+        for(size_t i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            cachePos[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+            vScore[v] = vertexScore(tables, cachePos[v], remaining[v]);
+        }
+
+        // the best candidate is the best triangle touching the cache
+        haveBest = false;
+        float bestScore = -1.0f;
+        for(size_t i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            const uint32_t *adj = &adjacency[offsets[v]];
+            for(uint32_t j = 0; j < remaining[v]; j++) {
+                uint32_t t = adj[j];
+                const uint32_t *u = &indices[t * 3];
+                tScore[t] = vScore[u[0]] + vScore[u[1]] + vScore[u[2]];
+                if(i < FORSYTH_CACHE_SIZE && tScore[t] > bestScore) {
+                    bestScore = tScore[t];
+                    best = t;
+                    haveBest = true;
+                }
+            }
+        }
+
+        cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+        for(size_t i = 0; i < cacheCount; i++) cache[i] = newCache[i];
+    }
+
+    for(size_t i = 0; i < triCount * 3; i++) indices[i] = output[i];
+}
+
+static const int OVERDRAW_GRID = 256;          // pixels per side of each view
+static const unsigned OVERDRAW_CACHE_SIZE = 16; // cache model for clustering
+
+// rasterizes a triangle given in pixel coordinates plus depth, counting the
+// fragments that pass a less-than depth test
+static size_t rasterizeTriangle(float *depth, const float *a, const float *b, const float *c)
+{
+    float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    if(area == 0) return 0;
+    float invArea = 1.0f / area; // either winding, no culling
+
+    int minX = (int)std::max(0.0f, floorf(std::min(a[0], std::min(b[0], c[0]))));
+    int minY = (int)std::max(0.0f, floorf(std::min(a[1], std::min(b[1], c[1]))));
+    int maxX = (int)std::min((float)OVERDRAW_GRID - 1, ceilf(std::max(a[0], std::max(b[0], c[0]))));
+    int maxY = (int)std::min((float)OVERDRAW_GRID - 1, ceilf(std::max(a[1], std::max(b[1], c[1]))));
+
+    size_t shaded = 0;
+    for(int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        for(int x = minX; x <= maxX; x++) {
+            float px = x + 0.5f;
+
+            // barycentric weights of a, b and c
+            float wa = ((b[0] - px) * (c[1] - py) - (b[1] - py) * (c[0] - px)) * invArea;
+            float wb = ((c[0] - px) * (a[1] - py) - (c[1] - py) * (a[0] - px)) * invArea;
+            float wc = ((a[0] - px) * (b[1] - py) - (a[1] - py) * (b[0] - px)) * invArea;
+            if(wa < 0 || wb < 0 || wc < 0) continue;
+
+            float z = wa * a[2] + wb * b[2] + wc * c[2];
+            float &d = depth[y * OVERDRAW_GRID + x];
+            if(z < d) {
+                d = z;
+                shaded++;
+            }
+        }
+    }
+    return shaded;
+}
+
+OverdrawStats analyzeOverdraw(const uint32_t *indices, size_t indexCount,
+                              const Vertex *vertices, size_t vertexCount)
+{
+    OverdrawStats stats = { 0, 0, 0 };
+    if(vertexCount == 0) return stats;
+
+    // fit the bounding box into the grid, keeping proportions
+    float lo[3], hi[3];
+    for(int k = 0; k < 3; k++) lo[k] = hi[k] = vertices[0].position[k];
+    for(size_t i = 1; i < vertexCount; i++) {
+        for(int k = 0; k < 3; k++) {
+            lo[k] = std::min(lo[k], vertices[i].position[k]);
+            hi[k] = std::max(hi[k], vertices[i].position[k]);
+        }
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    float scale = extent > 0 ? (OVERDRAW_GRID - 1) / extent : 0;
+
+    std::vector<float> depth(OVERDRAW_GRID * OVERDRAW_GRID);
+
+    for(int axis = 0; axis < 3; axis++) {
+        // screen x and y are the other two axes
+        int sx = (axis + 1) % 3, sy = (axis + 2) % 3;
+
+        for(int dir = -1; dir <= 1; dir += 2) {
+            std::fill(depth.begin(), depth.end(), INFINITY);
+
+            for(size_t i = 0; i + 2 < indexCount; i += 3) {
+                float p[3][3];
+                for(int k = 0; k < 3; k++) {
+                    const float *v = vertices[indices[i + k]].position;
+                    p[k][0] = (v[sx] - lo[sx]) * scale;
+                    p[k][1] = (v[sy] - lo[sy]) * scale;
+                    p[k][2] = v[axis] * dir;
+                }
+                stats.shaded += rasterizeTriangle(depth.data(), p[0], p[1], p[2]);
+            }
+
+            for(size_t i = 0; i < depth.size(); i++) {
+                if(depth[i] != INFINITY) stats.covered++;
+            }
+        }
+    }
+
+    if(stats.covered) stats.overdraw = (float)stats.shaded / stats.covered;
+    return stats;
+}
+
+// Cuts a cache-ordered triangle list into clusters, storing the first
+// triangle of each.
+static void clusterTriangles(const uint32_t *indices, size_t triCount,
+                             size_t vertexCount, float threshold,
+                             std::vector<size_t> *clusters)
+{
+    FifoCache cache(vertexCount, OVERDRAW_CACHE_SIZE);
+
+    // a triangle missing all three vertices starts a new patch of the mesh,
+    // the cache was going to start over there anyway
+    std::vector<size_t> patches;
+    for(size_t t = 0; t < triCount; t++) {
+        const uint32_t *tri = &indices[t * 3];
+        unsigned misses = cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+        if(t == 0 || misses == 3) patches.push_back(t);
+    }
+
+    // split patches where the ACMR so far is close enough to the patch's
+    for(size_t p = 0; p < patches.size(); p++) {
+        size_t start = patches[p];
+        size_t end = p + 1 < patches.size() ? patches[p + 1] : triCount;
+
+        cache.flush();
+        size_t patchMisses = 0;
+        for(size_t t = start; t < end; t++) {
+            const uint32_t *tri = &indices[t * 3];
+            patchMisses += cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+        }
+        float target = threshold * patchMisses / (end - start);
+
+        clusters->push_back(start);
+        cache.flush();
+        size_t misses = 0, faces = 0;
+        for(size_t t = start; t < end; t++) {
+            const uint32_t *tri = &indices[t * 3];
+            misses += cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+            faces++;
+            if(misses <= target * faces) {
+                clusters->push_back(t + 1);
+                cache.flush();
+                misses = faces = 0;
+            }
+        }
+
+        // whatever is left after the last split is rarely good on its own,
+        // merge it into the cluster before (this also drops a split at end)
+        if(clusters->back() != start) clusters->pop_back();
+    }
+}
+
+struct ClusterOrder
+{
+    float key;
+    size_t cluster;
+
+    bool operator<(const ClusterOrder &other) const { return key > other.key; }
+};
+
+void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+                      const Vertex *vertices, size_t vertexCount,
+                      float threshold)
+{
+    const size_t triCount = indexCount / 3;
+    if(triCount == 0) return;
+
+    std::vector<size_t> clusters;
+    clusterTriangles(indices, triCount, vertexCount, threshold, &clusters);
+    if(clusters.size() < 2) return;
+    clusters.push_back(triCount);
+
+    const size_t nClusters = clusters.size() - 1;
+
+    // area weighted centroid and normal of each cluster and of the mesh
+    std::vector<float> centroids(nClusters * 3, 0), normals(nClusters * 3, 0);
+    float meshCentroid[3] = { 0, 0, 0 };
+    float meshArea = 0;
+
+    for(size_t c = 0; c < nClusters; c++) {
+        float area = 0;
+        float *centroid = &centroids[c * 3];
+        float *normal = &normals[c * 3];
+
+        for(size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const float *p0 = vertices[indices[t * 3 + 0]].position;
+            const float *p1 = vertices[indices[t * 3 + 1]].position;
+            const float *p2 = vertices[indices[t * 3 + 2]].position;
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]
+            };
+            float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for(int k = 0; k < 3; k++) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) / 3 * a;
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+
+        for(int k = 0; k < 3; k++) meshCentroid[k] += centroid[k];
+        meshArea += area;
+
+        if(area > 0) {
+            for(int k = 0; k < 3; k++) centroid[k] /= area;
+        }
+    }
+    if(meshArea > 0) {
+        for(int k = 0; k < 3; k++) meshCentroid[k] /= meshArea;
+    }
+
+    // clusters facing away from the centre are the ones likely to be in front
+    std::vector<ClusterOrder> order(nClusters);
+    for(size_t c = 0; c < nClusters; c++) {
+        const float *centroid = &centroids[c * 3];
+        const float *normal = &normals[c * 3];
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        float key = 0;
+        if(length > 0) {
+            for(int k = 0; k < 3; k++) key += (centroid[k] - meshCentroid[k]) * normal[k];
+            key /= length;
+        }
+
+        order[c].key = key;
+        order[c].cluster = c;
+    }
+    std::stable_sort(order.begin(), order.end());
+
+    std::vector<uint32_t> output;
+    output.reserve(triCount * 3);
+    for(size_t i = 0; i < nClusters; i++) {
+        size_t c = order[i].cluster;
+        output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(Mesh *mesh)
+{
+    const uint32_t unused = 0xffffffffu;
+    std::vector<uint32_t> remap(mesh->vertices.size(), unused);
+
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh->vertices.size());
+
+    for(size_t i = 0; i < mesh->indices.size(); i++) {
+        uint32_t &index = mesh->indices[i];
+        if(remap[index] == unused) {
+            remap[index] = (uint32_t)vertices.size();
+            vertices.push_back(mesh->vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh->vertices.swap(vertices);
+}
@@ -0,0 +1,307 @@
+/* mipmap.cpp
+ * Mipmap chains for RGBA8 images.
+ */
+
+
+#include "mipmap.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "parallel.h"
+
+// SSE is always there on x86-64 and NEON on AArch64; define MIPMAP_NO_SIMD
+// to filter with plain loops instead, which give the same bytes
+#if !defined(MIPMAP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <xmmintrin.h>
+#define MIPMAP_SSE
+#elif !defined(MIPMAP_NO_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIPMAP_NEON
+#endif
+
+
+static const double PI = 3.14159265358979323846;
+static const double FILTER_RADIUS = 3; // of the windowed sincs, in pixels of the smaller level
+static const double KAISER_BETA = 4;
+static const size_t MIN_BAND_PIXELS = 16384; // levels smaller than this aren't worth a thread
+static const size_t BANDS_PER_THREAD = 4;
+
+// channels are filtered as floats from 0 to 255, so box averages of the
+// stored bytes are exact and round the way integer ones would
+struct GammaTables
+{
+    float toLinear[256];      // sRGB byte to linear light
+    float midpoints[255];     // linear light halfway between byte i and i + 1
+    uint8_t encode[65536];    // byte for linear light i / 257, or one off
+    float identity[256];
+
+    GammaTables()
+    {
+        for(int i = 0; i < 256; i++) {
+            toLinear[i] = (float)(255 * srgbToLinear(i / 255.0));
+            identity[i] = (float)i;
+        }
+        for(int i = 0; i < 255; i++) midpoints[i] = (float)(255 * srgbToLinear((i + 0.5) / 255.0));
+        int code = 0;
+        for(int i = 0; i < 65536; i++) {
+            while(code < 255 && i / 257.0f >= midpoints[code]) code++;
+            encode[i] = (uint8_t)code;
+        }
+    }
+
+    static double srgbToLinear(double c)
+    {
+        return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+    }
+};
+
+static const GammaTables &gammaTables()
+{
+    static const GammaTables tables;
+    return tables;
+}
+
+// the nearest sRGB byte to linear light v; the table narrows it down to one of
+// two bytes, the midpoints pick
+static inline uint8_t encodeSrgb(const GammaTables &tables, float v)
+{
+    v = v < 0 ? 0 : v > 255 ? 255 : v;
+    int code = tables.encode[(int)(v * 257)];
+    while(code > 0 && v < tables.midpoints[code - 1]) code--;
+    while(code < 255 && v >= tables.midpoints[code]) code++;
+    return (uint8_t)code;
+}
+
+static inline uint8_t encodeLinear(float v)
+{
+    v = v < 0 ? 0 : v > 255 ? 255 : v;
+    return (uint8_t)(v + 0.5f);
+}
+
+static double sinc(double x)
+{
+    if(x == 0) return 1;
+    x *= PI;
+    return sin(x) / x;
+}
+
+// modified Bessel function of the first kind, order 0
+static double besselI0(double x)
+{
+    double sum = 1, term = 1;
+    for(int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// weight of a pixel x pixels of the smaller level from the center
+static double kernel(MipFilter filter, double x)
+{
+    if(fabs(x) >= FILTER_RADIUS) return 0;
+    if(filter == MIP_FILTER_LANCZOS) return sinc(x) * sinc(x / FILTER_RADIUS);
+    double r = x / FILTER_RADIUS;
+    return sinc(x) * besselI0(KAISER_BETA * sqrt(1 - r * r)) / besselI0(KAISER_BETA);
+}
+
+// the pixels of a size pixel row or column each pixel of a smaller one of
+// size dsize is made from: count weights from first, at stride apart
+struct FilterTaps
+{
+    std::vector<uint32_t> first, count;
+    std::vector<float> weights;
+    size_t stride;
+};
+
+static void makeTaps(MipFilter filter, unsigned size, unsigned dsize, FilterTaps *taps)
+{
+    const double scale = (double)size / dsize;
+    const double reach = filter == MIP_FILTER_BOX ? scale / 2 : FILTER_RADIUS * scale;
+    std::vector<double> sums(size);
+
+    taps->stride = std::min((size_t)ceil(2 * reach) + 2, (size_t)size);
+    taps->first.resize(dsize);
+    taps->count.resize(dsize);
+    taps->weights.assign(dsize * taps->stride, 0);
+
+    for(unsigned i = 0; i < dsize; i++) {
+        const double center = (i + 0.5) * scale;
+        const long lo = (long)floor(center - reach), hi = (long)ceil(center + reach);
+
+        // clamped to the edges, so pixels past them add to the edge ones
+        long first = size, last = -1;
+        double total = 0;
+        for(long j = lo; j <= hi; j++) {
+            double w;
+            if(filter == MIP_FILTER_BOX) {
+                w = std::min(j + 1.0, center + reach) - std::max((double)j, center - reach);
+                if(w <= 0) continue;
+            } else {
+                w = kernel(filter, (j + 0.5 - center) / scale);
+                if(w == 0) continue;
+            }
+            const long k = std::min(std::max(j, 0L), (long)size - 1);
+            if(k < first) first = k;
+            if(k > last) last = k;
+            sums[k] += w;
+            total += w;
+        }
+
+        taps->first[i] = (uint32_t)first;
+        taps->count[i] = (uint32_t)(last - first + 1);
+        float *weights = &taps->weights[i * taps->stride];
+        for(long k = first; k <= last; k++) {
+            weights[k - first] = (float)(sums[k] / total);
+            sums[k] = 0;
+        }
+    }
+}
+
+// acc[i] += w * row[i] for count floats, a multiple of 4
+static void accumulateRow(float *acc, float w, const float *row, size_t count)
+{
+#if defined(MIPMAP_SSE)
+    const __m128 weight = _mm_set1_ps(w);
+    for(size_t i = 0; i < count; i += 4) {
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(weight, _mm_loadu_ps(row + i))));
+    }
+#elif defined(MIPMAP_NEON)
+    for(size_t i = 0; i < count; i += 4) {
+        vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), vmulq_n_f32(vld1q_f32(row + i), w)));
+    }
+#else
+    for(size_t i = 0; i < count; i++) acc[i] += w * row[i];
+#endif
+}
+
+// the weighted sum of count RGBA pixels from row into out[4]
+static void filterPixel(const float *row, const float *weights, uint32_t count, float *out)
+{
+#if defined(MIPMAP_SSE)
+    __m128 sum = _mm_setzero_ps();
+    for(uint32_t t = 0; t < count; t++) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(row + t * 4)));
+    _mm_storeu_ps(out, sum);
+#elif defined(MIPMAP_NEON)
+    float32x4_t sum = vdupq_n_f32(0);
+    for(uint32_t t = 0; t < count; t++) sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(row + t * 4), weights[t]));
+    vst1q_f32(out, sum);
+#else
+    out[0] = out[1] = out[2] = out[3] = 0;
+    for(uint32_t t = 0; t < count; t++) {
+        for(int c = 0; c < 4; c++) out[c] += weights[t] * row[t * 4 + c];
+    }
+#endif
+}
+
+// filters rows [y0, y1) of dst from src, keeping the last few source rows
+// converted to floats in a ring since neighbouring rows share most of them
+static void filterBand(const uint8_t *src, unsigned w, uint8_t *dst, unsigned dw,
+                       const FilterTaps &rows, const FilterTaps &columns, bool srgb, unsigned y0, unsigned y1)
+{
+    const GammaTables &tables = gammaTables();
+    const float *luts[4] = { srgb ? tables.toLinear : tables.identity, srgb ? tables.toLinear : tables.identity,
+                             srgb ? tables.toLinear : tables.identity, tables.identity };
+    const size_t rowFloats = (size_t)w * 4, ringSize = rows.stride;
+    std::vector<float> ring(ringSize * rowFloats), acc(rowFloats);
+    std::vector<long> ringRows(ringSize, -1);
+
+    for(unsigned y = y0; y < y1; y++) {
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        const float *weights = &rows.weights[y * rows.stride];
+        for(uint32_t t = 0; t < rows.count[y]; t++) {
+            const uint32_t sy = rows.first[y] + t;
+            float *row = &ring[(sy % ringSize) * rowFloats];
+            if(ringRows[sy % ringSize] != (long)sy) {
+                const uint8_t *in = src + (size_t)sy * rowFloats;
+                for(size_t i = 0; i < rowFloats; i += 4) {
+                    for(int c = 0; c < 4; c++) row[i + c] = luts[c][in[i + c]];
+                }
+                ringRows[sy % ringSize] = sy;
+            }
+            accumulateRow(acc.data(), weights[t], row, rowFloats);
+        }
+
+        uint8_t *out = dst + (size_t)y * dw * 4;
+        for(unsigned x = 0; x < dw; x++) {
+            float pixel[4];
+            filterPixel(&acc[(size_t)columns.first[x] * 4], &columns.weights[x * columns.stride], columns.count[x], pixel);
+            for(int c = 0; c < 3; c++) out[x * 4 + c] = srgb ? encodeSrgb(tables, pixel[c]) : encodeLinear(pixel[c]);
+            out[x * 4 + 3] = encodeLinear(pixel[3]);
+        }
+    }
+}
+
+MipOptions defaultMipOptions()
+{
+    MipOptions options;
+    options.filter = MIP_FILTER_KAISER;
+    options.srgb = true;
+    options.numThreads = 0;
+    return options;
+}
+
+unsigned mipLevelCount(unsigned width, unsigned height)
+{
+    unsigned levels = 1;
+    while(width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+size_t mipChainLayout(unsigned width, unsigned height, std::vector<MipLevel> *levels)
+{
+    const unsigned levelCount = mipLevelCount(width, height);
+    levels->resize(levelCount);
+
+    size_t size = 0;
+    unsigned w = width, h = height;
+    for(unsigned i = 0; i < levelCount; i++) {
+        MipLevel &level = (*levels)[i];
+        level.offset = size;
+        level.width = w;
+        level.height = h;
+        size += (size_t)w * h * 4;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    return size;
+}
+
+void buildMipLevels(uint8_t *pixels, const std::vector<MipLevel> &levels, const MipOptions &options)
+{
+    for(size_t i = 1; i < levels.size(); i++) {
+        const MipLevel &above = levels[i - 1], &level = levels[i];
+        if(above.width == 0 || above.height == 0) return;
+
+        FilterTaps rows, columns;
+        makeTaps(options.filter, above.height, level.height, &rows);
+        makeTaps(options.filter, above.width, level.width, &columns);
+
+        // bands of rows, a few per thread so they balance
+        const size_t pixelCount = (size_t)level.width * level.height;
+        const unsigned threads = parallelThreadCount(std::max(pixelCount / MIN_BAND_PIXELS, (size_t)1), options.numThreads);
+        const size_t bands = threads == 1 ? 1 : std::min((size_t)level.height, threads * BANDS_PER_THREAD);
+        const uint8_t *src = pixels + above.offset;
+        uint8_t *dst = pixels + level.offset;
+        parallelFor(bands, threads, [&](size_t band) {
+            filterBand(src, above.width, dst, level.width, rows, columns, options.srgb,
+                       (unsigned)(band * level.height / bands), (unsigned)((band + 1) * level.height / bands));
+        });
+    }
+}
+
+void buildMipChain(const uint8_t *rgba, unsigned width, unsigned height, const MipOptions &options,
+                   std::vector<MipLevel> *levels, std::vector<uint8_t> *pixels)
+{
+    pixels->resize(mipChainLayout(width, height, levels));
+    if(pixels->empty()) return;
+    memcpy(pixels->data(), rgba, (size_t)width * height * 4);
+    buildMipLevels(pixels->data(), *levels, options);
+}
@@ -0,0 +1,228 @@
+/* normals.cpp
+ * Vertex normals and tangents for meshes that lack them.
+ */
+
+
+#include "normals.h"
+
+#include <math.h>
+
+#include "parallel.h"
+
+
+static const size_t RANGE_SIZE = 4096; // triangles or vertices per work item
+
+// calls fn(begin, end) over [0, count) in RANGE_SIZE pieces
+template <typename Fn>
+static void parallelRanges(size_t count, unsigned numThreads, Fn fn)
+{
+    parallelFor((count + RANGE_SIZE - 1) / RANGE_SIZE, numThreads, [&](size_t i) {
+        size_t begin = i * RANGE_SIZE;
+        fn(begin, begin + RANGE_SIZE < count ? begin + RANGE_SIZE : count);
+    });
+}
+
+// lists the corners (positions in indices) of each group in index order:
+// those of group g are corners[offsets[g]] up to corners[offsets[g + 1]]
+static void listCorners(const uint32_t *indices, size_t indexCount,
+                        const uint32_t *groupOf, size_t groupCount,
+                        std::vector<uint32_t> *offsets, std::vector<uint32_t> *corners)
+{
+    offsets->assign(groupCount + 1, 0);
+    for(size_t i = 0; i < indexCount; i++) {
+        uint32_t g = groupOf ? groupOf[indices[i]] : indices[i];
+        if(g != NORMAL_GROUP_NONE) (*offsets)[g + 1]++;
+    }
+    for(size_t g = 0; g < groupCount; g++) (*offsets)[g + 1] += (*offsets)[g];
+
+    corners->resize((*offsets)[groupCount]);
+    std::vector<uint32_t> fill(offsets->begin(), offsets->end() - 1);
+    for(size_t i = 0; i < indexCount; i++) {
+        uint32_t g = groupOf ? groupOf[indices[i]] : indices[i];
+        if(g != NORMAL_GROUP_NONE) (*corners)[fill[g]++] = (uint32_t)i;
+    }
+}
+
+static void sub(const float *a, const float *b, float *out)
+{
+    for(int k = 0; k < 3; k++) out[k] = a[k] - b[k];
+}
+
+static float dot(const float *a, const float *b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cross(const float *a, const float *b, float *out)
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void normalize(float *v)
+{
+    float length = sqrtf(dot(v, v));
+    if(length > 0) {
+        for(int k = 0; k < 3; k++) v[k] /= length;
+    }
+}
+
+// angle at each corner of triangle p[0], p[1], p[2]
+static void cornerAngles(const float *const *p, float *angles)
+{
+    for(int k = 0; k < 3; k++) {
+        float e1[3], e2[3];
+        sub(p[(k + 1) % 3], p[k], e1);
+        sub(p[(k + 2) % 3], p[k], e2);
+        float lengths = sqrtf(dot(e1, e1) * dot(e2, e2));
+        float c = lengths > 0 ? dot(e1, e2) / lengths : 1;
+        angles[k] = acosf(c < -1 ? -1 : c > 1 ? 1 : c);
+    }
+}
+
+void generateNormals(Mesh *mesh, const uint32_t *normalGroups, size_t groupCount,
+                     unsigned numThreads)
+{
+    const uint32_t *indices = mesh->indices.data();
+    const size_t triCount = mesh->indices.size() / 3;
+    Vertex *vertices = mesh->vertices.data();
+
+    // what each triangle gives each corner: its normal, as long as twice its
+    // area, times the corner's angle
+    std::vector<float> cornerNormals(triCount * 9);
+    parallelRanges(triCount, numThreads, [&](size_t begin, size_t end) {
+        for(size_t t = begin; t < end; t++) {
+            const float *p[3];
+            for(int k = 0; k < 3; k++) p[k] = vertices[indices[t * 3 + k]].position;
+
+            float e1[3], e2[3], n[3], angles[3];
+            sub(p[1], p[0], e1);
+            sub(p[2], p[0], e2);
+            cross(e1, e2, n);
+            cornerAngles(p, angles);
+
+            for(int k = 0; k < 3; k++) {
+                for(int j = 0; j < 3; j++) cornerNormals[t * 9 + k * 3 + j] = n[j] * angles[k];
+            }
+        }
+    });
+
+    std::vector<uint32_t> offsets, corners;
+    listCorners(indices, triCount * 3, normalGroups, groupCount, &offsets, &corners);
+
+    std::vector<float> groupNormals(groupCount * 3);
+    parallelRanges(groupCount, numThreads, [&](size_t begin, size_t end) {
+        for(size_t g = begin; g < end; g++) {
+            float sum[3] = { 0, 0, 0 };
+            for(uint32_t i = offsets[g]; i < offsets[g + 1]; i++) {
+                for(int j = 0; j < 3; j++) sum[j] += cornerNormals[corners[i] * 3 + j];
+            }
+            normalize(sum);
+            for(int j = 0; j < 3; j++) groupNormals[g * 3 + j] = sum[j];
+        }
+    });
+
+    parallelRanges(mesh->vertices.size(), numThreads, [&](size_t begin, size_t end) {
+        for(size_t v = begin; v < end; v++) {
+            uint32_t g = normalGroups[v];
+            if(g == NORMAL_GROUP_NONE) continue;
+            for(int j = 0; j < 3; j++) vertices[v].normal[j] = groupNormals[g * 3 + j];
+        }
+    });
+}
+
+// some unit vector perpendicular to unit n
+static void perpendicular(const float *n, float *out)
+{
+    float axis[3] = { 0, 0, 0 };
+    axis[fabsf(n[0]) < 0.9f ? 0 : 1] = 1;
+    cross(n, axis, out);
+    normalize(out);
+}
+
+void generateTangents(const Mesh &mesh, std::vector<float> *tangents,
+                      unsigned numThreads)
+{
+    const uint32_t *indices = mesh.indices.data();
+    const size_t triCount = mesh.indices.size() / 3;
+    const size_t vertexCount = mesh.vertices.size();
+    const Vertex *vertices = mesh.vertices.data();
+
+    // per corner, as in MikkTSpace: the triangle's directions of increasing
+    // u and v, made perpendicular to the corner's normal, normalized and
+    // weighted by the corner's angle
+    std::vector<float> cornerTangents(triCount * 9), cornerBitangents(triCount * 9);
+    parallelRanges(triCount, numThreads, [&](size_t begin, size_t end) {
+        for(size_t t = begin; t < end; t++) {
+            const Vertex *v[3];
+            const float *p[3];
+            for(int k = 0; k < 3; k++) {
+                v[k] = &vertices[indices[t * 3 + k]];
+                p[k] = v[k]->position;
+            }
+
+            float d1[3], d2[3], angles[3];
+            sub(p[1], p[0], d1);
+            sub(p[2], p[0], d2);
+            cornerAngles(p, angles);
+
+            float s1 = v[1]->texcoord[0] - v[0]->texcoord[0], t1 = v[1]->texcoord[1] - v[0]->texcoord[1];
+            float s2 = v[2]->texcoord[0] - v[0]->texcoord[0], t2 = v[2]->texcoord[1] - v[0]->texcoord[1];
+            float area = s1 * t2 - s2 * t1;
+            float orientation = area < 0 ? -1.0f : 1.0f;
+
+            float os[3], ot[3];
+            for(int j = 0; j < 3; j++) {
+                os[j] = (t2 * d1[j] - t1 * d2[j]) * orientation;
+                ot[j] = (s1 * d2[j] - s2 * d1[j]) * orientation;
+            }
+            normalize(os);
+            normalize(ot);
+
+            for(int k = 0; k < 3; k++) {
+                const float *n = v[k]->normal;
+                float ts = dot(n, os), tt = dot(n, ot);
+                float *outS = &cornerTangents[t * 9 + k * 3];
+                float *outT = &cornerBitangents[t * 9 + k * 3];
+                for(int j = 0; j < 3; j++) {
+                    outS[j] = os[j] - n[j] * ts;
+                    outT[j] = ot[j] - n[j] * tt;
+                }
+                normalize(outS);
+                normalize(outT);
+                for(int j = 0; j < 3; j++) {
+                    outS[j] *= angles[k];
+                    outT[j] *= angles[k];
+                }
+            }
+        }
+    });
+
+    std::vector<uint32_t> offsets, corners;
+    listCorners(indices, triCount * 3, 0, vertexCount, &offsets, &corners);
+
+    tangents->resize(vertexCount * 4);
+    float *out = tangents->data();
+    parallelRanges(vertexCount, numThreads, [&](size_t begin, size_t end) {
+        for(size_t v = begin; v < end; v++) {
+            float s[3] = { 0, 0, 0 }, b[3] = { 0, 0, 0 };
+            for(uint32_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                for(int j = 0; j < 3; j++) {
+                    s[j] += cornerTangents[corners[i] * 3 + j];
+                    b[j] += cornerBitangents[corners[i] * 3 + j];
+                }
+            }
+
+            const float *n = vertices[v].normal;
+            normalize(s);
+            if(dot(s, s) == 0) perpendicular(n, s);
+
+            // the bitangent sum says which way v runs across the tangent
+            float nxs[3];
+            cross(n, s, nxs);
+            for(int j = 0; j < 3; j++) out[v * 4 + j] = s[j];
+            out[v * 4 + 3] = dot(nxs, b) < 0 ? -1.0f : 1.0f;
+        }
+    });
+}
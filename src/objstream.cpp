@@ -0,0 +1,267 @@
+/* objstream.cpp
+ * Loads .obj files of any size in bounded memory.
+ */
+
+
+#include "objstream.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+
+static const size_t POOL_BLOCK = 16384; // elements per attribute block
+static const size_t MIN_CHUNK_VERTICES = 256;
+static const size_t MAX_CHUNK_VERTICES = 65536;
+static const size_t INDICES_PER_VERTEX = 6; // two triangles, as in a closed mesh
+static const uint32_t EMPTY_SLOT = 0xffffffffu;
+
+// floats in fixed-size blocks, width per element
+class FloatPool
+{
+public:
+    explicit FloatPool(int width) : width_(width), count_(0) {}
+
+    void push(const float *v)
+    {
+        if(count_ % POOL_BLOCK == 0) {
+            blocks_.push_back(std::vector<float>());
+            blocks_.back().reserve(POOL_BLOCK * width_);
+        }
+        blocks_.back().insert(blocks_.back().end(), v, v + width_);
+        count_++;
+    }
+
+    // copies element i, which must exist
+    void get(size_t i, float *dst) const
+    {
+        memcpy(dst, &blocks_[i / POOL_BLOCK][(i % POOL_BLOCK) * width_], width_ * sizeof(float));
+    }
+
+    size_t size() const { return count_; }
+    size_t bytes() const { return blocks_.size() * POOL_BLOCK * width_ * sizeof(float); }
+
+private:
+    std::vector<std::vector<float> > blocks_;
+    int width_;
+    size_t count_;
+};
+
+struct StreamState
+{
+    FloatPool positions, normals, texcoords;
+
+    // the chunk being filled, welded through an open addressing table
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    std::vector<tinyobj::index_t> keys;
+    std::vector<uint32_t> table;
+    std::vector<uint16_t> corners;
+    size_t vertexCapacity, indexCapacity;
+    size_t faces;
+
+    const MeshChunkSink *sink;
+    ObjStreamStats stats;
+    std::string error;
+
+    StreamState() : positions(3), normals(3), texcoords(2), faces(0) {}
+};
+
+static void flushChunk(StreamState *s)
+{
+    if(s->indices.empty()) return;
+
+    MeshChunk chunk = { s->vertices.data(), s->vertices.size(), s->indices.data(), s->indices.size() };
+    (*s->sink)(chunk);
+
+    s->stats.vertices += s->vertices.size();
+    s->stats.chunks++;
+
+    s->vertices.clear();
+    s->indices.clear();
+    s->keys.clear();
+    std::fill(s->table.begin(), s->table.end(), EMPTY_SLOT);
+}
+
+// raw .obj index (1-based, negative = relative, 0 = none) to 0-based, or -1
+static int resolveIndex(int raw, size_t count)
+{
+    if(raw > 0 && (size_t)raw <= count) return raw - 1;
+    if(raw < 0 && (size_t)-(long long)raw <= count) return (int)((long long)count + raw);
+    return -1;
+}
+
+static void fetch(const FloatPool &pool, int i, int n, float *dst)
+{
+    if(i < 0) {
+        memset(dst, 0, n * sizeof(float));
+        return;
+    }
+    pool.get((size_t)i, dst);
+}
+
+static uint16_t weldCorner(StreamState *s, const tinyobj::index_t &raw)
+{
+    tinyobj::index_t idx;
+    idx.vertex_index = resolveIndex(raw.vertex_index, s->positions.size());
+    idx.texcoord_index = resolveIndex(raw.texcoord_index, s->texcoords.size());
+    idx.normal_index = resolveIndex(raw.normal_index, s->normals.size());
+
+    const size_t mask = s->table.size() - 1;
+    size_t slot = hashObjIndex(idx) & mask;
+    while(s->table[slot] != EMPTY_SLOT && !sameObjIndex(s->keys[s->table[slot]], idx)) {
+        slot = (slot + 1) & mask;
+    }
+
+    if(s->table[slot] == EMPTY_SLOT) {
+        s->table[slot] = (uint32_t)s->vertices.size();
+        s->keys.push_back(idx);
+
+        Vertex v;
+        fetch(s->positions, idx.vertex_index, 3, v.position);
+        fetch(s->normals, idx.normal_index, 3, v.normal);
+        fetch(s->texcoords, idx.texcoord_index, 2, v.texcoord);
+        s->vertices.push_back(v);
+    }
+
+    return (uint16_t)s->table[slot];
+}
+
+static float distance2(const Vertex &a, const Vertex &b)
+{
+    float dx = b.position[0] - a.position[0];
+    float dy = b.position[1] - a.position[1];
+    float dz = b.position[2] - a.position[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+static void pushTriangle(StreamState *s, uint16_t a, uint16_t b, uint16_t c)
+{
+    s->indices.push_back(a);
+    s->indices.push_back(b);
+    s->indices.push_back(c);
+}
+
+static void onVertex(void *user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t)
+{
+    float v[3] = { (float)x, (float)y, (float)z };
+    ((StreamState *)user)->positions.push(v);
+}
+
+static void onNormal(void *user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z)
+{
+    float v[3] = { (float)x, (float)y, (float)z };
+    ((StreamState *)user)->normals.push(v);
+}
+
+static void onTexcoord(void *user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t)
+{
+    float v[2] = { (float)x, (float)y };
+    ((StreamState *)user)->texcoords.push(v);
+}
+
+static void onFace(void *user, tinyobj::index_t *corners, int count)
+{
+    StreamState *s = (StreamState *)user;
+    if(!s->error.empty() || count < 3) return;
+
+    const size_t n = (size_t)count;
+    const size_t faceIndices = (n - 2) * 3;
+    if(n > s->vertexCapacity || faceIndices > s->indexCapacity) {
+        s->error = "Face with " + std::to_string(n) + " corners does not fit in a chunk\n";
+        return;
+    }
+
+    // LoadObj() rejects these too
+    for(size_t i = 0; i < n; i++) {
+        int v = corners[i].vertex_index;
+        if(v == 0 || (v < 0 && (size_t)-(long long)v > s->positions.size())) {
+            s->error = "Invalid vertex index in face " + std::to_string(s->faces + 1) + "\n";
+            return;
+        }
+    }
+
+    // a new corner per face corner is the worst case
+    if(s->vertices.size() + n > s->vertexCapacity || s->indices.size() + faceIndices > s->indexCapacity) {
+        flushChunk(s);
+    }
+
+    s->corners.clear();
+    for(size_t i = 0; i < n; i++) s->corners.push_back(weldCorner(s, corners[i]));
+
+    const uint16_t *c = s->corners.data();
+    if(n == 4) {
+        // split along the shorter diagonal, as LoadObj() does
+        if(distance2(s->vertices[c[0]], s->vertices[c[2]]) < distance2(s->vertices[c[1]], s->vertices[c[3]])) {
+            pushTriangle(s, c[0], c[1], c[2]);
+            pushTriangle(s, c[0], c[2], c[3]);
+        } else {
+            pushTriangle(s, c[0], c[1], c[3]);
+            pushTriangle(s, c[1], c[2], c[3]);
+        }
+    } else {
+        for(size_t i = 1; i + 1 < n; i++) pushTriangle(s, c[0], c[i], c[i + 1]);
+    }
+    s->stats.triangles += n - 2;
+    s->faces++;
+}
+
+bool streamObj(const char *path, size_t budgetBytes, const MeshChunkSink &sink,
+               ObjStreamStats *stats, std::string *err)
+{
+    std::ifstream file(path);
+    if(!file) {
+        if(err) *err = std::string("Cannot open file ") + path + "\n";
+        return false;
+    }
+
+    StreamState s;
+    s.sink = &sink;
+    memset(&s.stats, 0, sizeof(s.stats));
+
+    // what a chunk vertex costs: itself, its weld key, two table slots and
+    // its share of the indices
+    const size_t bytesPerVertex = sizeof(Vertex) + sizeof(tinyobj::index_t) +
+                                  2 * sizeof(uint32_t) + INDICES_PER_VERTEX * sizeof(uint16_t);
+    s.vertexCapacity = budgetBytes / bytesPerVertex;
+    if(s.vertexCapacity < MIN_CHUNK_VERTICES) s.vertexCapacity = MIN_CHUNK_VERTICES;
+    if(s.vertexCapacity > MAX_CHUNK_VERTICES) s.vertexCapacity = MAX_CHUNK_VERTICES;
+    s.indexCapacity = s.vertexCapacity * INDICES_PER_VERTEX;
+
+    size_t tableSize = 16;
+    while(tableSize < s.vertexCapacity * 2) tableSize *= 2;
+
+    s.vertices.reserve(s.vertexCapacity);
+    s.keys.reserve(s.vertexCapacity);
+    s.indices.reserve(s.indexCapacity);
+    s.table.assign(tableSize, EMPTY_SLOT);
+
+    s.stats.chunkBytes = s.vertices.capacity() * sizeof(Vertex) +
+                         s.keys.capacity() * sizeof(tinyobj::index_t) +
+                         s.indices.capacity() * sizeof(uint16_t) +
+                         s.table.size() * sizeof(uint32_t);
+
+    tinyobj::callback_t callback;
+    callback.vertex_cb = onVertex;
+    callback.normal_cb = onNormal;
+    callback.texcoord_cb = onTexcoord;
+    callback.index_cb = onFace;
+
+    std::string warn, loadErr;
+    bool ok = tinyobj::LoadObjWithCallback(file, callback, &s, NULL, &warn, &loadErr);
+    if(ok && s.error.empty()) flushChunk(&s);
+
+    s.stats.positions = s.positions.size();
+    s.stats.normals = s.normals.size();
+    s.stats.texcoords = s.texcoords.size();
+    s.stats.attributeBytes = s.positions.bytes() + s.normals.bytes() + s.texcoords.bytes();
+    if(stats) *stats = s.stats;
+
+    if(!ok || !s.error.empty()) {
+        if(err) *err = loadErr + s.error;
+        return false;
+    }
+    return true;
+}
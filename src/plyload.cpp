@@ -0,0 +1,417 @@
+/* plyload.cpp
+ * Loads binary PLY meshes straight into a Mesh.
+ */
+
+
+#include "plyload.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "mappedfile.h"
+#include "normals.h"
+
+
+enum PlyType
+{
+    PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+};
+
+static const size_t PLY_TYPE_SIZES[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type;      // of the value, or of each list item
+    PlyType countType; // PLY_NONE unless it's a list
+};
+
+struct PlyElement
+{
+    std::string name;
+    uint64_t count;
+    std::vector<PlyProperty> properties;
+    size_t rowSize; // 0 if it has lists, so rows vary
+};
+
+// vertex properties we read, in Vertex order
+enum VertexField
+{
+    FIELD_X, FIELD_Y, FIELD_Z, FIELD_NX, FIELD_NY, FIELD_NZ, FIELD_U, FIELD_V, FIELD_COUNT
+};
+
+static PlyType parseType(const std::string &word)
+{
+    static const struct { const char *name; PlyType type; } TYPES[] = {
+        { "char", PLY_INT8 }, { "int8", PLY_INT8 },
+        { "uchar", PLY_UINT8 }, { "uint8", PLY_UINT8 },
+        { "short", PLY_INT16 }, { "int16", PLY_INT16 },
+        { "ushort", PLY_UINT16 }, { "uint16", PLY_UINT16 },
+        { "int", PLY_INT32 }, { "int32", PLY_INT32 },
+        { "uint", PLY_UINT32 }, { "uint32", PLY_UINT32 },
+        { "float", PLY_FLOAT32 }, { "float32", PLY_FLOAT32 },
+        { "double", PLY_FLOAT64 }, { "float64", PLY_FLOAT64 },
+    };
+    for(size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); i++) {
+        if(word == TYPES[i].name) return TYPES[i].type;
+    }
+    return PLY_NONE;
+}
+
+static int vertexField(const std::string &name)
+{
+    static const struct { const char *name; VertexField field; } NAMES[] = {
+        { "x", FIELD_X }, { "y", FIELD_Y }, { "z", FIELD_Z },
+        { "nx", FIELD_NX }, { "ny", FIELD_NY }, { "nz", FIELD_NZ },
+        { "u", FIELD_U }, { "v", FIELD_V }, { "s", FIELD_U }, { "t", FIELD_V },
+        { "texture_u", FIELD_U }, { "texture_v", FIELD_V },
+        { "texture_s", FIELD_U }, { "texture_t", FIELD_V },
+    };
+    for(size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if(name == NAMES[i].name) return NAMES[i].field;
+    }
+    return -1;
+}
+
+// whitespace separated words of a header line
+static std::vector<std::string> splitWords(const char *line, size_t length)
+{
+    std::vector<std::string> words;
+    size_t i = 0;
+    while(i < length) {
+        while(i < length && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+        size_t start = i;
+        while(i < length && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') i++;
+        if(i > start) words.push_back(std::string(line + start, i - start));
+    }
+    return words;
+}
+
+// Parses the header into elements, and sets headerSize to where the data
+// starts.
+static bool parseHeader(const char *data, size_t size, bool *bigEndian,
+                        std::vector<PlyElement> *elements, size_t *headerSize, std::string *err)
+{
+    const char *p = data, *end = data + size;
+    bool haveFormat = false;
+    for(size_t line = 0; p < end; line++) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if(!eol) break;
+        std::vector<std::string> words = splitWords(p, eol - p);
+        p = eol + 1;
+
+        if(line == 0) {
+            if(words.size() != 1 || words[0] != "ply") break;
+        } else if(words.empty() || words[0] == "comment" || words[0] == "obj_info") {
+            continue;
+        } else if(words[0] == "format" && words.size() >= 2) {
+            if(words[1] == "binary_little_endian") {
+                *bigEndian = false;
+            } else if(words[1] == "binary_big_endian") {
+                *bigEndian = true;
+            } else {
+                *err = "only binary PLY is supported, not " + words[1];
+                return false;
+            }
+            haveFormat = true;
+        } else if(words[0] == "element" && words.size() == 3) {
+            PlyElement element;
+            element.name = words[1];
+            element.count = strtoull(words[2].c_str(), 0, 10);
+            element.rowSize = 0;
+            elements->push_back(element);
+        } else if(words[0] == "property" && !elements->empty()) {
+            PlyProperty property;
+            if(words.size() == 5 && words[1] == "list") {
+                property.countType = parseType(words[2]);
+                property.type = parseType(words[3]);
+                property.name = words[4];
+                if(property.countType == PLY_NONE || property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64) property.type = PLY_NONE;
+            } else if(words.size() == 3) {
+                property.countType = PLY_NONE;
+                property.type = parseType(words[1]);
+                property.name = words[2];
+            } else {
+                property.type = PLY_NONE;
+            }
+            if(property.type == PLY_NONE) {
+                *err = "bad PLY property on header line " + std::to_string(line + 1);
+                return false;
+            }
+            elements->back().properties.push_back(property);
+        } else if(words[0] == "end_header") {
+            if(!haveFormat) break;
+
+            for(size_t e = 0; e < elements->size(); e++) {
+                PlyElement &element = (*elements)[e];
+                size_t rowSize = 0;
+                for(size_t i = 0; i < element.properties.size(); i++) {
+                    if(element.properties[i].countType != PLY_NONE) {
+                        rowSize = 0;
+                        break;
+                    }
+                    rowSize += PLY_TYPE_SIZES[element.properties[i].type];
+                }
+                element.rowSize = rowSize;
+            }
+
+            *headerSize = p - data;
+            return true;
+        } else {
+            *err = "unknown PLY header line " + std::to_string(line + 1);
+            return false;
+        }
+    }
+
+    *err = "not a PLY file";
+    return false;
+}
+
+// reads a value of type at p, swapping its bytes if the file's order isn't ours
+static double readValue(const unsigned char *p, PlyType type, bool swap)
+{
+    unsigned char b[8];
+    const size_t n = PLY_TYPE_SIZES[type];
+    if(swap) {
+        for(size_t i = 0; i < n; i++) b[i] = p[n - 1 - i];
+    } else {
+        memcpy(b, p, n);
+    }
+
+    switch(type) {
+    case PLY_INT8: return (int8_t)b[0];
+    case PLY_UINT8: return b[0];
+    case PLY_INT16: { int16_t v; memcpy(&v, b, 2); return v; }
+    case PLY_UINT16: { uint16_t v; memcpy(&v, b, 2); return v; }
+    case PLY_INT32: { int32_t v; memcpy(&v, b, 4); return v; }
+    case PLY_UINT32: { uint32_t v; memcpy(&v, b, 4); return v; }
+    case PLY_FLOAT32: { float v; memcpy(&v, b, 4); return v; }
+    case PLY_FLOAT64: { double v; memcpy(&v, b, 8); return v; }
+    default: return 0;
+    }
+}
+
+// Reads count fixed-size vertex rows at p into mesh.  Returns whether the
+// file had normals.
+static bool readVertices(const unsigned char *p, const PlyElement &element, bool swap, Mesh *mesh)
+{
+    // where each field is in a row, -1 if it isn't
+    long offsets[FIELD_COUNT];
+    PlyType types[FIELD_COUNT];
+    for(int f = 0; f < FIELD_COUNT; f++) offsets[f] = -1;
+    size_t offset = 0;
+    for(size_t i = 0; i < element.properties.size(); i++) {
+        const PlyProperty &property = element.properties[i];
+        int field = vertexField(property.name);
+        if(field >= 0 && offsets[field] < 0) {
+            offsets[field] = (long)offset;
+            types[field] = property.type;
+        }
+        offset += PLY_TYPE_SIZES[property.type];
+    }
+
+    float *out[FIELD_COUNT];
+    mesh->vertices.resize(element.count);
+    for(size_t v = 0; v < mesh->vertices.size(); v++) {
+        Vertex &vertex = mesh->vertices[v];
+        out[FIELD_X] = &vertex.position[0];
+        out[FIELD_Y] = &vertex.position[1];
+        out[FIELD_Z] = &vertex.position[2];
+        out[FIELD_NX] = &vertex.normal[0];
+        out[FIELD_NY] = &vertex.normal[1];
+        out[FIELD_NZ] = &vertex.normal[2];
+        out[FIELD_U] = &vertex.texcoord[0];
+        out[FIELD_V] = &vertex.texcoord[1];
+
+        for(int f = 0; f < FIELD_COUNT; f++) {
+            if(offsets[f] < 0) {
+                *out[f] = 0;
+            } else if(types[f] == PLY_FLOAT32 && !swap) {
+                // already a float in our byte order
+                memcpy(out[f], p + offsets[f], sizeof(float));
+            } else {
+                *out[f] = (float)readValue(p + offsets[f], types[f], swap);
+            }
+        }
+        p += element.rowSize;
+    }
+
+    return offsets[FIELD_NX] >= 0 || offsets[FIELD_NY] >= 0 || offsets[FIELD_NZ] >= 0;
+}
+
+// Reads the rows of a face element at *data, splitting each polygon of its
+// vertex_indices into a fan.  Advances *data past the element.
+static bool readFaces(const unsigned char **data, const unsigned char *end, const PlyElement &element,
+                      bool swap, Mesh *mesh, std::string *err)
+{
+    size_t list = element.properties.size();
+    for(size_t i = 0; i < element.properties.size(); i++) {
+        const PlyProperty &property = element.properties[i];
+        if(property.countType != PLY_NONE && (property.name == "vertex_indices" || property.name == "vertex_index")) list = i;
+    }
+    if(list == element.properties.size()) {
+        *err = "PLY face element has no vertex_indices";
+        return false;
+    }
+
+    const double vertexCount = (double)mesh->vertices.size();
+    mesh->indices.reserve(element.count * 3);
+
+    const unsigned char *p = *data;
+    for(uint64_t row = 0; row < element.count; row++) {
+        for(size_t i = 0; i < element.properties.size(); i++) {
+            const PlyProperty &property = element.properties[i];
+            const size_t itemSize = PLY_TYPE_SIZES[property.type];
+            const size_t headSize = property.countType == PLY_NONE ? itemSize : PLY_TYPE_SIZES[property.countType];
+            if((size_t)(end - p) < headSize) {
+                *err = "PLY file is truncated";
+                return false;
+            }
+            if(property.countType == PLY_NONE) {
+                p += itemSize;
+                continue;
+            }
+
+            double count = readValue(p, property.countType, swap);
+            p += headSize;
+            if(count < 0 || count > (double)(end - p) / itemSize) {
+                *err = "PLY file is truncated";
+                return false;
+            }
+
+            const size_t n = (size_t)count;
+            if(i == list) {
+                uint32_t first = 0, previous = 0;
+                for(size_t k = 0; k < n; k++) {
+                    double index = readValue(p + k * itemSize, property.type, swap);
+                    if(!(index >= 0 && index < vertexCount)) {
+                        *err = "PLY face " + std::to_string(row) + " has an index out of range";
+                        return false;
+                    }
+                    if(k == 0) first = (uint32_t)index;
+                    if(k >= 2) {
+                        mesh->indices.push_back(first);
+                        mesh->indices.push_back(previous);
+                        mesh->indices.push_back((uint32_t)index);
+                    }
+                    previous = (uint32_t)index;
+                }
+            }
+            p += n * itemSize;
+        }
+    }
+
+    *data = p;
+    return true;
+}
+
+// Steps *data past the rows of an element we don't use.
+static bool skipElement(const unsigned char **data, const unsigned char *end, const PlyElement &element, bool swap)
+{
+    const unsigned char *p = *data;
+    if(element.rowSize) {
+        if(element.count > (uint64_t)(end - p) / element.rowSize) return false;
+        *data = p + element.count * element.rowSize;
+        return true;
+    }
+
+    for(uint64_t row = 0; row < element.count; row++) {
+        for(size_t i = 0; i < element.properties.size(); i++) {
+            const PlyProperty &property = element.properties[i];
+            size_t size = PLY_TYPE_SIZES[property.type];
+            if(property.countType != PLY_NONE) {
+                const size_t countSize = PLY_TYPE_SIZES[property.countType];
+                if((size_t)(end - p) < countSize) return false;
+                double count = readValue(p, property.countType, swap);
+                p += countSize;
+                if(count < 0 || count > (double)(end - p) / size) return false;
+                size *= (size_t)count;
+            }
+            if((size_t)(end - p) < size) return false;
+            p += size;
+        }
+    }
+    *data = p;
+    return true;
+}
+
+bool loadPlyFromBuffer(const void *data, size_t size, Mesh *mesh,
+                       std::string *err, unsigned numThreads)
+{
+    mesh->vertices.clear();
+    mesh->indices.clear();
+    mesh->materialIds.clear();
+
+    bool bigEndian = false;
+    std::vector<PlyElement> elements;
+    size_t headerSize = 0;
+    if(!parseHeader((const char *)data, size, &bigEndian, &elements, &headerSize, err)) return false;
+
+    const uint16_t one = 1;
+    const bool swap = bigEndian == (*(const unsigned char *)&one == 1);
+
+    const unsigned char *p = (const unsigned char *)data + headerSize, *end = (const unsigned char *)data + size;
+    bool haveVertices = false, haveFaces = false, haveNormals = false;
+    for(size_t e = 0; e < elements.size() && !(haveVertices && haveFaces); e++) {
+        const PlyElement &element = elements[e];
+
+        if(element.name == "vertex" && !haveVertices) {
+            bool havePositions = false;
+            for(size_t i = 0; i < element.properties.size(); i++) havePositions |= element.properties[i].name == "x";
+            if(!havePositions) {
+                *err = "PLY vertices have no positions";
+                return false;
+            }
+            if(!element.rowSize) {
+                *err = "PLY vertices with list properties aren't supported";
+                return false;
+            }
+            if(element.count > (uint64_t)(end - p) / element.rowSize) {
+                *err = "PLY file is truncated";
+                return false;
+            }
+            haveNormals = readVertices(p, element, swap, mesh);
+            p += element.count * element.rowSize;
+            haveVertices = true;
+        } else if(element.name == "face" && !haveFaces) {
+            if(!haveVertices) {
+                *err = "PLY faces come before the vertices";
+                return false;
+            }
+            if(!readFaces(&p, end, element, swap, mesh, err)) return false;
+            haveFaces = true;
+        } else if(!skipElement(&p, end, element, swap)) {
+            *err = "PLY file is truncated";
+            return false;
+        }
+    }
+
+    if(!haveVertices) {
+        *err = "PLY file has no vertices";
+        return false;
+    }
+
+    mesh->materialIds.assign(mesh->indices.size() / 3, -1);
+
+    // every vertex is already shared by the faces around it
+    if(!haveNormals) {
+        std::vector<uint32_t> groups(mesh->vertices.size());
+        for(size_t i = 0; i < groups.size(); i++) groups[i] = (uint32_t)i;
+        generateNormals(mesh, groups.data(), groups.size(), numThreads);
+    }
+
+    return true;
+}
+
+bool loadPly(const char *path, Mesh *mesh, std::string *err, unsigned numThreads)
+{
+    MappedFile file;
+    if(!file.open(path)) {
+        *err = std::string("failed to open ") + path;
+        return false;
+    }
+    return loadPlyFromBuffer(file.data(), file.size(), mesh, err, numThreads);
+}
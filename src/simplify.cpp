@@ -0,0 +1,558 @@
+/* simplify.cpp
+ * Quadric error mesh simplification for building levels of detail.
+ */
+
+
+#include "simplify.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+#include "meshopt.h"
+#include "parallel.h"
+
+
+static const uint32_t NO_VERTEX = 0xffffffffu;
+
+// a quadric covers position, normal and texcoord, weighted against positions
+// scaled to the unit cube
+static const int QUADRIC_SIZE = 8;
+static const double NORMAL_WEIGHT = 0.5;
+static const double TEXCOORD_WEIGHT = 0.5;
+
+// a triangle counts as flipped if the cos between its old and new normal is
+// this or less
+static const double FLIP_COS = 0.0;
+
+// sum of squared distances to a set of hyperplanes through triangles:
+// x A x + 2 b x + c, with A symmetric and stored as its upper triangle
+struct Quadric
+{
+    double a[QUADRIC_SIZE * (QUADRIC_SIZE + 1) / 2];
+    double b[QUADRIC_SIZE];
+    double c;
+};
+
+static void addQuadric(Quadric *q, const Quadric &r)
+{
+    for(size_t i = 0; i < sizeof(q->a) / sizeof(q->a[0]); i++) q->a[i] += r.a[i];
+    for(int i = 0; i < QUADRIC_SIZE; i++) q->b[i] += r.b[i];
+    q->c += r.c;
+}
+
+static double evaluate(const Quadric &q, const double *x)
+{
+    double sum = q.c;
+    const double *a = q.a;
+    for(int i = 0; i < QUADRIC_SIZE; i++) {
+        double row = *a++ * x[i];
+        for(int j = i + 1; j < QUADRIC_SIZE; j++) row += 2 * *a++ * x[j];
+        sum += x[i] * row + 2 * q.b[i] * x[i];
+    }
+    return sum;
+}
+
+static double dot(const double *u, const double *v, int n)
+{
+    double sum = 0;
+    for(int i = 0; i < n; i++) sum += u[i] * v[i];
+    return sum;
+}
+
+// Garland and Heckbert's quadric for the plane through p, q and r in
+// QUADRIC_SIZE dimensions, times weight; false if the triangle is degenerate
+static bool triangleQuadric(const double *p, const double *q, const double *r,
+                            double weight, Quadric *out)
+{
+    double e1[QUADRIC_SIZE], e2[QUADRIC_SIZE];
+    for(int i = 0; i < QUADRIC_SIZE; i++) {
+        e1[i] = q[i] - p[i];
+        e2[i] = r[i] - p[i];
+    }
+
+    double length = sqrt(dot(e1, e1, QUADRIC_SIZE));
+    if(length == 0) return false;
+    for(int i = 0; i < QUADRIC_SIZE; i++) e1[i] /= length;
+
+    double along = dot(e1, e2, QUADRIC_SIZE);
+    for(int i = 0; i < QUADRIC_SIZE; i++) e2[i] -= along * e1[i];
+    length = sqrt(dot(e2, e2, QUADRIC_SIZE));
+    if(length == 0) return false;
+    for(int i = 0; i < QUADRIC_SIZE; i++) e2[i] /= length;
+
+    // A = I - e1 e1' - e2 e2', b = (p.e1) e1 + (p.e2) e2 - p
+    double pe1 = dot(p, e1, QUADRIC_SIZE), pe2 = dot(p, e2, QUADRIC_SIZE);
+    double *a = out->a;
+    for(int i = 0; i < QUADRIC_SIZE; i++) {
+        for(int j = i; j < QUADRIC_SIZE; j++) {
+            *a++ = weight * ((i == j) - e1[i] * e1[j] - e2[i] * e2[j]);
+        }
+        out->b[i] = weight * (pe1 * e1[i] + pe2 * e2[i] - p[i]);
+    }
+    out->c = weight * (dot(p, p, QUADRIC_SIZE) - pe1 * pe1 - pe2 * pe2);
+    return true;
+}
+
+static void cross(const double *u, const double *v, double *n)
+{
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// normal of p, q, r scaled by twice its area
+static void triangleNormal(const double *p, const double *q, const double *r, double *n)
+{
+    double e1[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+    double e2[3] = { r[0] - p[0], r[1] - p[1], r[2] - p[2] };
+    cross(e1, e2, n);
+}
+
+// squared distance from p to the triangle a, b, c, by the region of the
+// triangle p is nearest (Ericson, "Real-Time Collision Detection" 5.1.5)
+static double pointTriangleDistance2(const double *p, const double *a, const double *b, const double *c)
+{
+    double ab[3], ac[3], ap[3], closest[3];
+    for(int k = 0; k < 3; k++) {
+        ab[k] = b[k] - a[k];
+        ac[k] = c[k] - a[k];
+        ap[k] = p[k] - a[k];
+    }
+
+    const double d1 = dot(ab, ap, 3), d2 = dot(ac, ap, 3);
+    double bp[3], cp[3];
+    for(int k = 0; k < 3; k++) {
+        bp[k] = p[k] - b[k];
+        cp[k] = p[k] - c[k];
+    }
+    const double d3 = dot(ab, bp, 3), d4 = dot(ac, bp, 3);
+    const double d5 = dot(ab, cp, 3), d6 = dot(ac, cp, 3);
+    const double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+
+    if(d1 <= 0 && d2 <= 0) {
+        return dot(ap, ap, 3);
+    } else if(d3 >= 0 && d4 <= d3) {
+        return dot(bp, bp, 3);
+    } else if(d6 >= 0 && d5 <= d6) {
+        return dot(cp, cp, 3);
+    } else if(vc <= 0 && d1 >= 0 && d3 <= 0) {
+        const double t = d1 / (d1 - d3);
+        for(int k = 0; k < 3; k++) closest[k] = a[k] + t * ab[k];
+    } else if(vb <= 0 && d2 >= 0 && d6 <= 0) {
+        const double t = d2 / (d2 - d6);
+        for(int k = 0; k < 3; k++) closest[k] = a[k] + t * ac[k];
+    } else if(va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+        const double t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        for(int k = 0; k < 3; k++) closest[k] = b[k] + t * (c[k] - b[k]);
+    } else {
+        const double denom = va + vb + vc;
+        if(denom == 0) return dot(ap, ap, 3); // degenerate
+        const double v = vb / denom, w = vc / denom;
+        for(int k = 0; k < 3; k++) closest[k] = a[k] + v * ab[k] + w * ac[k];
+    }
+
+    double d[3] = { p[0] - closest[0], p[1] - closest[1], p[2] - closest[2] };
+    return dot(d, d, 3);
+}
+
+// the cheapest collapse of u, onto v, valid while u's stamp is unchanged
+struct Collapse
+{
+    double cost;
+    uint32_t u, v;
+    uint32_t stamp;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+struct SimplifyState
+{
+    size_t vertexCount;                 // local vertices
+    std::vector<double> points;         // QUADRIC_SIZE per vertex
+    std::vector<Quadric> quadrics;
+    std::vector<double> ownCosts;       // each quadric at its own vertex
+    std::vector<char> locked, removed;
+    std::vector<char> used;             // by a triangle that isn't degenerate
+    std::vector<uint32_t> stamps;
+    std::vector<uint32_t> collapsedInto; // the vertex each removed one went onto
+
+    std::vector<uint32_t> corners;      // three local vertices per triangle
+    std::vector<char> alive;
+    std::vector<std::vector<uint32_t> > triangles; // per vertex, may hold dead ones
+    std::vector<uint32_t> neighbors;    // scratch for listNeighbors()
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > heap;
+};
+
+// stores the vertices sharing a triangle with v in s->neighbors, dropping
+// dead triangles from v's list
+static void listNeighbors(SimplifyState *s, uint32_t v)
+{
+    std::vector<uint32_t> &list = s->triangles[v];
+    s->neighbors.clear();
+
+    size_t kept = 0;
+    for(size_t i = 0; i < list.size(); i++) {
+        uint32_t t = list[i];
+        if(!s->alive[t]) continue;
+        list[kept++] = t;
+
+        const uint32_t *tri = &s->corners[t * 3];
+        for(int k = 0; k < 3; k++) {
+            if(tri[k] != v && std::find(s->neighbors.begin(), s->neighbors.end(), tri[k]) == s->neighbors.end()) {
+                s->neighbors.push_back(tri[k]);
+            }
+        }
+    }
+    list.resize(kept);
+}
+
+// queues the cheapest collapse of u, replacing any queued before
+static void pushCollapse(SimplifyState *s, uint32_t u)
+{
+    s->stamps[u]++;
+    if(s->locked[u]) return;
+
+    listNeighbors(s, u);
+
+    Collapse best;
+    best.cost = 0;
+    best.v = NO_VERTEX;
+    for(size_t i = 0; i < s->neighbors.size(); i++) {
+        uint32_t v = s->neighbors[i];
+        const double *x = &s->points[v * QUADRIC_SIZE];
+        double cost = evaluate(s->quadrics[u], x) + s->ownCosts[v];
+        if(best.v == NO_VERTEX || cost < best.cost) {
+            best.cost = cost;
+            best.v = v;
+        }
+    }
+    if(best.v == NO_VERTEX) return;
+
+    best.u = u;
+    best.stamp = s->stamps[u];
+    s->heap.push(best);
+}
+
+// true if moving u onto v leaves every surviving triangle of u facing the
+// same way
+static bool keepsOrientation(const SimplifyState &s, uint32_t u, uint32_t v)
+{
+    const std::vector<uint32_t> &list = s.triangles[u];
+    for(size_t i = 0; i < list.size(); i++) {
+        uint32_t t = list[i];
+        if(!s.alive[t]) continue;
+
+        const uint32_t *tri = &s.corners[t * 3];
+        if(tri[0] == v || tri[1] == v || tri[2] == v) continue;
+
+        const double *p[3], *q[3];
+        for(int k = 0; k < 3; k++) {
+            p[k] = &s.points[tri[k] * QUADRIC_SIZE];
+            q[k] = tri[k] == u ? &s.points[v * QUADRIC_SIZE] : p[k];
+        }
+
+        double before[3], after[3];
+        triangleNormal(p[0], p[1], p[2], before);
+        triangleNormal(q[0], q[1], q[2], after);
+        double d = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        if(d <= FLIP_COS * sqrt(dot(before, before, 3) * dot(after, after, 3))) return false;
+    }
+    return true;
+}
+
+static bool shareTriangle(const SimplifyState &s, uint32_t u, uint32_t v)
+{
+    const std::vector<uint32_t> &list = s.triangles[u];
+    for(size_t i = 0; i < list.size(); i++) {
+        const uint32_t *tri = &s.corners[list[i] * 3];
+        if(s.alive[list[i]] && (tri[0] == v || tri[1] == v || tri[2] == v)) return true;
+    }
+    return false;
+}
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+// nearest of the given live triangles to p, squared, stored in nearest2
+// and *triangle if nearer than what they hold; nearest2 < 0 holds nothing
+static void nearestTriangle(const SimplifyState &s, const double *p, const uint32_t *list, size_t count,
+                            double *nearest2, uint32_t *triangle)
+{
+    for(size_t i = 0; i < count; i++) {
+        if(!s.alive[list[i]]) continue;
+        const uint32_t *tri = &s.corners[list[i] * 3];
+        double d2 = pointTriangleDistance2(p, &s.points[tri[0] * QUADRIC_SIZE], &s.points[tri[1] * QUADRIC_SIZE],
+                                           &s.points[tri[2] * QUADRIC_SIZE]);
+        if(*nearest2 < 0 || d2 < *nearest2) {
+            *nearest2 = d2;
+            *triangle = list[i];
+        }
+    }
+}
+
+// How far the furthest vertex of the original triangles is from the result,
+// in the unit cube, or a little more.  Each is measured from the triangles
+// around the vertex it was collapsed onto, walking on to the triangles
+// around the corners of the nearest while that gets nearer.  All of them
+// are part of the result, so no distance comes out less than the true one.
+static double furthestVertex(SimplifyState &s)
+{
+    std::vector<uint32_t> all, seen(s.vertexCount, NO_VERTEX);
+    double furthest2 = 0;
+    for(uint32_t i = 0; i < s.vertexCount; i++) {
+        if(!s.used[i]) continue;
+
+        // the vertex it ended up on, shortening the path for the next
+        uint32_t onto = i;
+        while(s.collapsedInto[onto] != NO_VERTEX) onto = s.collapsedInto[onto];
+        for(uint32_t j = i; s.collapsedInto[j] != NO_VERTEX;) {
+            uint32_t next = s.collapsedInto[j];
+            s.collapsedInto[j] = onto;
+            j = next;
+        }
+
+        const double *p = &s.points[i * QUADRIC_SIZE];
+        double nearest2 = -1;
+        uint32_t triangle = 0;
+        nearestTriangle(s, p, s.triangles[onto].data(), s.triangles[onto].size(), &nearest2, &triangle);
+        seen[onto] = i;
+
+        // nothing left around it: all of the result, rare enough to search
+        if(nearest2 < 0) {
+            if(all.empty()) {
+                for(uint32_t t = 0; t < s.alive.size(); t++) {
+                    if(s.alive[t]) all.push_back(t);
+                }
+                if(all.empty()) return sqrt(3.0); // all gone: across the cube
+            }
+            nearestTriangle(s, p, all.data(), all.size(), &nearest2, &triangle);
+        }
+
+        for(uint32_t walked = NO_VERTEX; walked != triangle;) {
+            walked = triangle;
+            for(int k = 0; k < 3; k++) {
+                uint32_t corner = s.corners[walked * 3 + k];
+                if(seen[corner] == i) continue;
+                seen[corner] = i;
+                nearestTriangle(s, p, s.triangles[corner].data(), s.triangles[corner].size(), &nearest2, &triangle);
+            }
+        }
+        if(nearest2 > furthest2) furthest2 = nearest2;
+    }
+    return sqrt(furthest2);
+}
+
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                    const Vertex *vertices, size_t vertexCount,
+                    size_t targetIndexCount, float *error)
+{
+    const size_t triCount = indexCount / 3;
+    if(error) *error = 0;
+
+    SimplifyState s;
+
+    // number the vertices used from 0, so the work is in proportion to the
+    // triangles given rather than the whole vertex buffer
+    std::vector<uint32_t> localOf(vertexCount, NO_VERTEX);
+    std::vector<uint32_t> globalOf;
+    s.corners.resize(triCount * 3);
+    for(size_t i = 0; i < triCount * 3; i++) {
+        uint32_t g = indices[i];
+        if(localOf[g] == NO_VERTEX) {
+            localOf[g] = (uint32_t)globalOf.size();
+            globalOf.push_back(g);
+        }
+        s.corners[i] = localOf[g];
+    }
+    s.vertexCount = globalOf.size();
+    const size_t n = s.vertexCount;
+
+    // positions go to the unit cube so the attribute weights mean the same
+    // on any mesh
+    float lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+    for(size_t i = 0; i < n; i++) {
+        const float *p = vertices[globalOf[i]].position;
+        for(int k = 0; k < 3; k++) {
+            if(i == 0 || p[k] < lo[k]) lo[k] = p[k];
+            if(i == 0 || p[k] > hi[k]) hi[k] = p[k];
+        }
+    }
+    double extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    if(extent == 0) extent = 1;
+
+    s.points.resize(n * QUADRIC_SIZE);
+    for(size_t i = 0; i < n; i++) {
+        const Vertex &vertex = vertices[globalOf[i]];
+        double *x = &s.points[i * QUADRIC_SIZE];
+        for(int k = 0; k < 3; k++) x[k] = ((double)vertex.position[k] - lo[k]) / extent;
+        for(int k = 0; k < 3; k++) x[3 + k] = vertex.normal[k] * NORMAL_WEIGHT;
+        for(int k = 0; k < 2; k++) x[6 + k] = vertex.texcoord[k] * TEXCOORD_WEIGHT;
+    }
+
+    // lock seams, where vertices share a position, and open borders, where
+    // an edge between positions has a single triangle
+    s.locked.assign(n, 0);
+    std::vector<uint32_t> group(n);
+    {
+        std::unordered_map<uint64_t, uint32_t> firstAt;
+        firstAt.reserve(n);
+        for(size_t i = 0; i < n; i++) {
+            const float *p = vertices[globalOf[i]].position;
+            uint32_t bits[3];
+            memcpy(bits, p, sizeof(bits));
+            uint64_t key = ((uint64_t)bits[0] * 0x9e3779b97f4a7c15ull) ^ ((uint64_t)bits[1] * 0xc2b2ae3d27d4eb4full) ^ bits[2];
+
+            // collisions just lock a few more vertices
+            std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> it = firstAt.insert(std::make_pair(key, (uint32_t)i));
+            group[i] = it.first->second;
+            if(!it.second) {
+                s.locked[i] = 1;
+                s.locked[group[i]] = 1;
+            }
+        }
+
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        edgeUses.reserve(triCount * 3);
+        for(size_t t = 0; t < triCount; t++) {
+            for(int k = 0; k < 3; k++) {
+                edgeUses[edgeKey(group[s.corners[t * 3 + k]], group[s.corners[t * 3 + (k + 1) % 3]])]++;
+            }
+        }
+        for(size_t t = 0; t < triCount; t++) {
+            for(int k = 0; k < 3; k++) {
+                uint32_t a = s.corners[t * 3 + k], b = s.corners[t * 3 + (k + 1) % 3];
+                if(edgeUses[edgeKey(group[a], group[b])] == 1) s.locked[a] = s.locked[b] = 1;
+            }
+        }
+    }
+
+    // each vertex starts with the quadrics of its triangles, weighted by area
+    Quadric zero;
+    memset(&zero, 0, sizeof(zero));
+    s.quadrics.assign(n, zero);
+    s.triangles.resize(n);
+    s.used.assign(n, 0);
+    s.alive.assign(triCount, 1);
+
+    size_t live = 0;
+    for(size_t t = 0; t < triCount; t++) {
+        const uint32_t *tri = &s.corners[t * 3];
+        if(tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+            s.alive[t] = 0;
+            continue;
+        }
+        live++;
+        for(int k = 0; k < 3; k++) {
+            s.triangles[tri[k]].push_back((uint32_t)t);
+            s.used[tri[k]] = 1;
+        }
+
+        const double *p = &s.points[tri[0] * QUADRIC_SIZE];
+        const double *q = &s.points[tri[1] * QUADRIC_SIZE];
+        const double *r = &s.points[tri[2] * QUADRIC_SIZE];
+
+        double normal[3];
+        triangleNormal(p, q, r, normal);
+        double length = sqrt(dot(normal, normal, 3));
+        if(length == 0) continue;
+
+        Quadric quadric;
+        if(triangleQuadric(p, q, r, length * 0.5, &quadric)) {
+            for(int k = 0; k < 3; k++) addQuadric(&s.quadrics[tri[k]], quadric);
+        }
+    }
+
+    s.removed.assign(n, 0);
+    s.collapsedInto.assign(n, NO_VERTEX);
+    s.ownCosts.resize(n);
+    for(size_t i = 0; i < n; i++) s.ownCosts[i] = evaluate(s.quadrics[i], &s.points[i * QUADRIC_SIZE]);
+
+    s.stamps.assign(n, 0);
+    for(size_t i = 0; i < n; i++) pushCollapse(&s, (uint32_t)i);
+
+    std::vector<uint32_t> around;
+    while(live * 3 > targetIndexCount && !s.heap.empty()) {
+        Collapse c = s.heap.top();
+        s.heap.pop();
+
+        const uint32_t u = c.u, v = c.v;
+        if(s.removed[u] || c.stamp != s.stamps[u]) continue;
+        if(!shareTriangle(s, u, v) || !keepsOrientation(s, u, v)) continue;
+
+        // triangles on the edge go, the rest of u's move to v
+        const std::vector<uint32_t> &list = s.triangles[u];
+        for(size_t i = 0; i < list.size(); i++) {
+            uint32_t t = list[i];
+            if(!s.alive[t]) continue;
+
+            uint32_t *tri = &s.corners[t * 3];
+            if(tri[0] == v || tri[1] == v || tri[2] == v) {
+                s.alive[t] = 0;
+                live--;
+                continue;
+            }
+            for(int k = 0; k < 3; k++) {
+                if(tri[k] == u) tri[k] = v;
+            }
+            s.triangles[v].push_back(t);
+        }
+
+        addQuadric(&s.quadrics[v], s.quadrics[u]);
+        s.ownCosts[v] = evaluate(s.quadrics[v], &s.points[v * QUADRIC_SIZE]);
+        s.removed[u] = 1;
+        s.collapsedInto[u] = v;
+        s.triangles[u].clear();
+
+        // v's quadric changed, and with it the cost of every edge at v
+        listNeighbors(&s, v);
+        around.assign(s.neighbors.begin(), s.neighbors.end());
+        pushCollapse(&s, v);
+        for(size_t i = 0; i < around.size(); i++) pushCollapse(&s, around[i]);
+    }
+
+    size_t written = 0;
+    for(size_t t = 0; t < triCount; t++) {
+        if(!s.alive[t]) continue;
+        for(int k = 0; k < 3; k++) destination[written++] = globalOf[s.corners[t * 3 + k]];
+    }
+
+    // rounded up, so the bound holds in float too
+    if(error) {
+        const double furthest = furthestVertex(s) * extent;
+        *error = (float)furthest;
+        if(*error < furthest) *error = nextafterf(*error, INFINITY);
+    }
+    return written;
+}
+
+void buildLods(const uint32_t *indices, size_t indexCount,
+               const Vertex *vertices, size_t vertexCount,
+               const float *ratios, size_t lodCount,
+               std::vector<uint32_t> *lodIndices, MeshLod *lods,
+               unsigned numThreads)
+{
+    std::vector<std::vector<uint32_t> > results(lodCount);
+
+    // every LOD starts from the full mesh, so they don't wait on each other
+    parallelFor(lodCount, numThreads, [&](size_t i) {
+        size_t target = (size_t)(indexCount / 3 * ratios[i]) * 3;
+        std::vector<uint32_t> &result = results[i];
+        result.resize(indexCount);
+        result.resize(simplifyMesh(result.data(), indices, indexCount, vertices, vertexCount, target, &lods[i].error));
+        optimizeVertexCache(result.data(), result.size(), vertexCount);
+    });
+
+    lodIndices->clear();
+    for(size_t i = 0; i < lodCount; i++) {
+        lods[i].indexOffset = (uint32_t)lodIndices->size();
+        lods[i].indexCount = (uint32_t)results[i].size();
+        lodIndices->insert(lodIndices->end(), results[i].begin(), results[i].end());
+    }
+}
@@ -0,0 +1,8 @@
+/* tiny_obj_loader.cpp
+ * The tinyobjloader implementation, compiled once for every module that
+ * includes tiny_obj_loader.h.
+ */
+
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
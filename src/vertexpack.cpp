@@ -0,0 +1,201 @@
+/* vertexpack.cpp
+ * Compact vertex layout for uploading meshes.
+ */
+
+
+#include "vertexpack.h"
+
+#include <math.h>
+#include <string.h>
+
+
+uint16_t floatToHalf(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+
+    const uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+    const uint32_t a = x & 0x7fffffff;
+
+    // infinity and nan, keeping nans quiet
+    if(a >= 0x7f800000) return sign | 0x7c00 | (a > 0x7f800000 ? 0x200 : 0);
+
+    // 65520 and up round to infinity
+    if(a >= 0x477ff000) return sign | 0x7c00;
+
+    // subnormal halves: units of 2^-24, rounded to nearest even
+    if(a < 0x38800000) {
+        uint32_t e = a >> 23;
+        if(e < 102) return sign;
+        uint32_t m = (a & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - e;
+        uint32_t h = m >> shift;
+        uint32_t rem = m & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if(rem > halfway || (rem == halfway && (h & 1))) h++;
+        return sign | (uint16_t)h;
+    }
+
+    // rebias the exponent and drop 13 mantissa bits, rounded to nearest even;
+    // a carry out of the mantissa bumps the exponent, which is what we want
+    uint32_t h = (a - 0x38000000) >> 13;
+    uint32_t rem = a & 0x1fff;
+    if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+    return sign | (uint16_t)h;
+}
+
+float halfToFloat(uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    const uint32_t e = (h >> 10) & 0x1f;
+    const uint32_t m = h & 0x3ff;
+
+    if(e == 0) {
+        float f = ldexpf((float)m, -24);
+        return sign ? -f : f;
+    }
+
+    uint32_t x = sign | (m << 13);
+    x |= e == 31 ? 0x7f800000 : (e + 112) << 23;
+
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static int16_t toSnorm16(float v)
+{
+    return (int16_t)lroundf(clampf(v, -1, 1) * 32767);
+}
+
+// the GL 4.2+ conversion; older GL maps -32768..32767 to -1..1 instead,
+// which is no further off than the rounding itself
+static float fromSnorm16(int16_t v)
+{
+    float f = v / 32767.0f;
+    return f < -1 ? -1 : f;
+}
+
+// folds the unit octahedron onto the [-1, 1] square, lower half outside the
+// diamond; see "A Survey of Efficient Representations for Independent Unit
+// Vectors" (Cigolle et al., 2014)
+static void encodeOctahedral(const float *n, int16_t *out)
+{
+    float sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    if(sum == 0) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float x = n[0] / sum, y = n[1] / sum;
+    if(n[2] < 0) {
+        float fx = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+        float fy = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+        x = fx;
+        y = fy;
+    }
+
+    out[0] = toSnorm16(x);
+    out[1] = toSnorm16(y);
+}
+
+// same as octDecode() in the vertex shader
+static void decodeOctahedral(const int16_t *e, float *n)
+{
+    float x = fromSnorm16(e[0]), y = fromSnorm16(e[1]);
+    float z = 1 - fabsf(x) - fabsf(y);
+    if(z < 0) {
+        float fx = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+        float fy = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+        x = fx;
+        y = fy;
+    }
+
+    float length = sqrtf(x * x + y * y + z * z);
+    n[0] = x / length;
+    n[1] = y / length;
+    n[2] = z / length;
+}
+
+void packVertices(const Vertex *vertices, const float *colors,
+                  const float *distances, size_t count,
+                  PackedVertex *out, PositionQuantization *quant)
+{
+    float lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+    for(size_t i = 0; i < count; i++) {
+        for(int k = 0; k < 3; k++) {
+            float p = vertices[i].position[k];
+            if(i == 0 || p < lo[k]) lo[k] = p;
+            if(i == 0 || p > hi[k]) hi[k] = p;
+        }
+    }
+    for(int k = 0; k < 3; k++) {
+        quant->offset[k] = lo[k];
+        quant->scale[k] = hi[k] - lo[k];
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        const Vertex &v = vertices[i];
+        PackedVertex &p = out[i];
+
+        for(int k = 0; k < 3; k++) {
+            float t = quant->scale[k] > 0 ? (v.position[k] - lo[k]) / quant->scale[k] : 0;
+            p.position[k] = (uint16_t)lroundf(clampf(t, 0, 1) * 65535);
+        }
+
+        p.distance = floatToHalf(distances[i]);
+        encodeOctahedral(v.normal, p.normal);
+        p.texcoord[0] = floatToHalf(v.texcoord[0]);
+        p.texcoord[1] = floatToHalf(v.texcoord[1]);
+
+        for(int k = 0; k < 3; k++) {
+            p.color[k] = (uint8_t)lroundf(clampf(colors[i * 3 + k], 0, 1) * 255);
+        }
+        p.color[3] = 255;
+    }
+}
+
+VertexPackError measurePackError(const Vertex *vertices, const float *colors,
+                                 const float *distances, size_t count,
+                                 const PackedVertex *packed,
+                                 const PositionQuantization &quant)
+{
+    VertexPackError error = { 0, 0, 0, 0, 0 };
+    float maxCosine = 1;
+
+    for(size_t i = 0; i < count; i++) {
+        const Vertex &v = vertices[i];
+        const PackedVertex &p = packed[i];
+
+        for(int k = 0; k < 3; k++) {
+            float position = quant.offset[k] + quant.scale[k] * (p.position[k] / 65535.0f);
+            error.position = fmaxf(error.position, fabsf(position - v.position[k]));
+
+            float color = p.color[k] / 255.0f;
+            error.color = fmaxf(error.color, fabsf(color - colors[i * 3 + k]));
+        }
+
+        for(int k = 0; k < 2; k++) {
+            error.texcoord = fmaxf(error.texcoord, fabsf(halfToFloat(p.texcoord[k]) - v.texcoord[k]));
+        }
+
+        error.distance = fmaxf(error.distance, fabsf(halfToFloat(p.distance) - distances[i]));
+
+        const float *n = v.normal;
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if(length > 0) {
+            float decoded[3];
+            decodeOctahedral(p.normal, decoded);
+            float cosine = (n[0] * decoded[0] + n[1] * decoded[1] + n[2] * decoded[2]) / length;
+            maxCosine = fminf(maxCosine, cosine);
+        }
+    }
+
+    error.normal = acosf(clampf(maxCosine, -1, 1)) * (180 / 3.14159265f);
+    return error;
+}
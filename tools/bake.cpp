@@ -0,0 +1,395 @@
+/* bake.cpp
+ * Offline asset baker: turns .obj, .ply, .mtl and .bmp files into one bundle
+ * (bundle.h) that main.cpp maps and uploads without conditioning anything.
+ *
+ * An .obj or binary .ply becomes a mesh baked the way main.cpp would
+ * (meshbake.h), with its vertices packed and lit and its indices narrowed
+ * if they fit.  The .mtl files an .obj names are baked in with it.  A .bmp becomes an RGBA8 mip
+ * chain (mipmap.h), decoded straight into its first level and filtered
+ * down from there, and so does every .bmp a .mtl on the command line maps.
+ *
+ * Assets are baked in parallel.  Each is keyed by a hash of its source
+ * files and of the settings below; if the bundle being replaced has an
+ * asset with the same name and hash, its blobs are carried over instead of
+ * baking it again.
+ *
+ *   g++ -O2 -std=c++17 -pthread -Iinclude tools/bake.cpp src/bundle.cpp
+ *       src/bmpread.c src/mappedfile.cpp src/mesh.cpp src/meshbake.cpp
+ *       src/meshcache.cpp src/meshlet.cpp src/meshopt.cpp src/mipmap.cpp
+ *       src/normals.cpp src/plyload.cpp src/simplify.cpp
+ *       src/tiny_obj_loader.cpp src/vertexpack.cpp -o bake
+ *   ./bake [-o assets.bundle] [-j threads] [-l x y z] [-m filter] [-g] [-f] input...
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "bmpread.h"
+#include "bundle.h"
+#include "mappedfile.h"
+#include "meshbake.h"
+#include "meshcache.h"
+#include "mipmap.h"
+#include "parallel.h"
+#include "vertexpack.h"
+
+
+static const char *DEFAULT_OUTPUT = "assets.bundle";
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct BakeSettings
+{
+    MeshBakeOptions mesh;
+    float light[3]; // main.cpp's light, what vertex distances are to
+    MipOptions mip;
+};
+
+// an asset to bake and, once done, its blobs
+struct BakeJob
+{
+    std::string name;
+    uint32_t type;
+    uint64_t sourceHash;
+    bool reused;
+    std::string error;
+    double milliseconds;
+
+    std::vector<std::vector<unsigned char> > buffers;
+    std::vector<MeshCacheBlobData> blobs;
+};
+
+static void addBlob(BakeJob *job, uint32_t id, const void *data, size_t size)
+{
+    // moving buffers around as it grows keeps each one's data where it is
+    job->buffers.push_back(std::vector<unsigned char>((const unsigned char *)data, (const unsigned char *)data + size));
+    MeshCacheBlobData blob = { id, job->buffers.back().data(), size };
+    job->blobs.push_back(blob);
+}
+
+static bool hasExtension(const std::string &path, const char *extension)
+{
+    size_t n = strlen(extension);
+    if(path.size() < n) return false;
+    for(size_t i = 0; i < n; i++) {
+        char c = path[path.size() - n + i];
+        if(c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if(c != extension[i]) return false;
+    }
+    return true;
+}
+
+static std::string directoryOf(const std::string &path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// calls fn(line, length) for every line of data starting with keyword and a space
+template <typename Fn>
+static void forEachLine(const unsigned char *data, size_t size, const char *keyword, Fn fn)
+{
+    const size_t n = strlen(keyword);
+    const char *p = (const char *)data, *end = p + size;
+    while(p < end) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if(!eol) eol = end;
+        while(p < eol && (*p == ' ' || *p == '\t')) p++;
+        if((size_t)(eol - p) > n && memcmp(p, keyword, n) == 0 && (p[n] == ' ' || p[n] == '\t')) fn(p + n, (size_t)(eol - p - n));
+        p = eol + 1;
+    }
+}
+
+// whitespace separated words of a line
+static std::vector<std::string> splitWords(const char *line, size_t length)
+{
+    std::vector<std::string> words;
+    size_t i = 0;
+    while(i < length) {
+        while(i < length && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+        size_t start = i;
+        while(i < length && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') i++;
+        if(i > start) words.push_back(std::string(line + start, i - start));
+    }
+    return words;
+}
+
+static bool bakeMesh(BakeJob *job, const BakeSettings &settings, unsigned numThreads)
+{
+    MeshBakeOptions options = settings.mesh;
+    options.numThreads = numThreads;
+
+    BakedMesh baked;
+    std::string warn;
+    if(!bakeMeshFile(job->name.c_str(), options, &baked, 0, &warn, &job->error)) return false;
+
+    const Mesh &mesh = baked.mesh;
+    const size_t count = mesh.vertices.size();
+
+    // white and lit from the light, as main.cpp's uploadVertices() does
+    std::vector<float> colors(count * 3, 1), distances(count);
+    for(size_t i = 0; i < count; i++) {
+        const float *p = mesh.vertices[i].position;
+        distances[i] = sqrt(pow(p[0] - settings.light[0], 2) + pow(p[1] - settings.light[1], 2) + pow(p[2] - settings.light[2], 2));
+    }
+
+    BundleMeshInfo info;
+    memset(&info, 0, sizeof(info));
+    memcpy(info.light, settings.light, sizeof(info.light));
+    std::vector<PackedVertex> packed(count);
+    packVertices(mesh.vertices.data(), colors.data(), distances.data(), count, packed.data(), &info.quant);
+
+    addBlob(job, MESHCACHE_VERTICES, mesh.vertices.data(), count * sizeof(Vertex));
+    addBlob(job, MESHCACHE_INDICES, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    addBlob(job, MESHCACHE_BATCHES, baked.batches.data(), baked.batches.size() * sizeof(MeshBatch));
+    addBlob(job, MESHCACHE_MESHLETS, baked.meshlets.data(), baked.meshlets.size() * sizeof(Meshlet));
+    addBlob(job, MESHCACHE_LODS, baked.lods.data(), baked.lods.size() * sizeof(MeshLod));
+    addBlob(job, BUNDLE_MESH_INFO, &info, sizeof(info));
+    addBlob(job, BUNDLE_PACKED_VERTICES, packed.data(), packed.size() * sizeof(PackedVertex));
+    if(fitsIndices16(count)) {
+        std::vector<uint16_t> indices16;
+        narrowIndices(mesh.indices.data(), mesh.indices.size(), &indices16);
+        addBlob(job, BUNDLE_INDICES16, indices16.data(), indices16.size() * sizeof(uint16_t));
+    }
+    return true;
+}
+
+static bool bakeTexture(BakeJob *job, const BakeSettings &settings, unsigned numThreads)
+{
+    const unsigned flags = BMPREAD_ALPHA | BMPREAD_ANY_SIZE | BMPREAD_BYTE_ALIGN;
+    bmpread_info_t bmp;
+    if(!bmpread_info(job->name.c_str(), flags, &bmp)) {
+        job->error = "failed to read " + job->name;
+        return false;
+    }
+
+    // level 0 is decoded in place, the rest filtered down from it
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t> pixels(mipChainLayout((unsigned)bmp.width, (unsigned)bmp.height, &levels));
+    if(!bmpread_into(job->name.c_str(), flags, numThreads, pixels.data(), 0, pixels.size())) {
+        job->error = "failed to read " + job->name;
+        return false;
+    }
+    MipOptions mip = settings.mip;
+    mip.numThreads = numThreads;
+    buildMipLevels(pixels.data(), levels, mip);
+
+    BundleTextureInfo info;
+    memset(&info, 0, sizeof(info));
+    info.width = (uint32_t)bmp.width;
+    info.height = (uint32_t)bmp.height;
+    info.levelCount = (uint32_t)levels.size();
+    info.srgb = settings.mip.srgb;
+
+    std::vector<unsigned char> infoBlob(sizeof(info) + levels.size() * sizeof(MipLevel));
+    memcpy(infoBlob.data(), &info, sizeof(info));
+    memcpy(infoBlob.data() + sizeof(info), levels.data(), levels.size() * sizeof(MipLevel));
+    addBlob(job, BUNDLE_TEXTURE_INFO, infoBlob.data(), infoBlob.size());
+    addBlob(job, BUNDLE_TEXTURE_PIXELS, pixels.data(), pixels.size());
+    return true;
+}
+
+// copies the blobs of asset out of bundle
+static void reuseAsset(BakeJob *job, const Bundle &bundle, const BundleAsset *asset)
+{
+    static const uint32_t ids[] = {
+        MESHCACHE_VERTICES, MESHCACHE_INDICES, MESHCACHE_BATCHES, MESHCACHE_MESHLETS, MESHCACHE_LODS,
+        BUNDLE_MESH_INFO, BUNDLE_PACKED_VERTICES, BUNDLE_INDICES16, BUNDLE_TEXTURE_INFO, BUNDLE_TEXTURE_PIXELS
+    };
+    for(size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+        size_t size;
+        const void *data = bundle.blob(asset, ids[i], &size);
+        if(data) addBlob(job, ids[i], data, size);
+    }
+    job->reused = true;
+}
+
+static void addJob(std::vector<BakeJob> *jobs, const std::string &name, uint32_t type)
+{
+    for(size_t i = 0; i < jobs->size(); i++) {
+        if((*jobs)[i].name == name) return;
+    }
+    BakeJob job;
+    job.name = name;
+    job.type = type;
+    job.sourceHash = 0;
+    job.reused = false;
+    job.milliseconds = 0;
+    jobs->push_back(job);
+}
+
+// the .bmp files an .mtl maps, as textures to bake
+static bool addMaterialTextures(const std::string &mtlPath, std::vector<BakeJob> *jobs)
+{
+    MappedFile mtl;
+    if(!mtl.open(mtlPath.c_str())) {
+        fprintf(stderr, "can't read %s\n", mtlPath.c_str());
+        return false;
+    }
+
+    const char *keywords[] = { "map_Ka", "map_Kd", "map_Ks", "map_Ns", "map_d", "map_bump", "bump", "disp", "decal" };
+    for(size_t k = 0; k < sizeof(keywords) / sizeof(keywords[0]); k++) {
+        forEachLine(mtl.data(), mtl.size(), keywords[k], [&](const char *line, size_t length) {
+            // options come first, the file name last
+            std::vector<std::string> words = splitWords(line, length);
+            if(words.empty()) return;
+            std::string path = directoryOf(mtlPath) + words.back();
+            if(hasExtension(path, ".bmp")) {
+                addJob(jobs, path, BUNDLE_TEXTURE);
+            } else {
+                fprintf(stderr, "%s: skipping %s, only .bmp textures are baked\n", mtlPath.c_str(), path.c_str());
+            }
+        });
+    }
+    return true;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: bake [-o bundle] [-j threads] [-l x y z] [-m filter] [-g] [-f] input...\n"
+            "  inputs are .obj, binary .ply, .mtl (bakes the .bmp textures it maps) and .bmp files\n"
+            "  -o  bundle to write, default %s\n"
+            "  -j  threads, default one per hardware thread\n"
+            "  -l  light position vertex distances are baked for, default 0 10 10\n"
+            "  -m  texture mip filter, box, kaiser or lanczos, default kaiser\n"
+            "  -g  average texture channels as stored, not as sRGB in linear light\n"
+            "  -f  bake everything, even assets the old bundle has up to date\n",
+            DEFAULT_OUTPUT);
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = DEFAULT_OUTPUT;
+    unsigned numThreads = 0;
+    bool force = false;
+
+    BakeSettings settings;
+    settings.mesh = defaultMeshBakeOptions();
+    settings.light[0] = 0;
+    settings.light[1] = 10;
+    settings.light[2] = 10;
+    settings.mip = defaultMipOptions();
+
+    std::vector<BakeJob> jobs;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if(arg == "-j" && i + 1 < argc) {
+            numThreads = (unsigned)atoi(argv[++i]);
+        } else if(arg == "-l" && i + 3 < argc) {
+            for(int k = 0; k < 3; k++) settings.light[k] = (float)atof(argv[++i]);
+        } else if(arg == "-m" && i + 1 < argc) {
+            std::string filter = argv[++i];
+            if(filter == "box") {
+                settings.mip.filter = MIP_FILTER_BOX;
+            } else if(filter == "kaiser") {
+                settings.mip.filter = MIP_FILTER_KAISER;
+            } else if(filter == "lanczos") {
+                settings.mip.filter = MIP_FILTER_LANCZOS;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if(arg == "-g") {
+            settings.mip.srgb = false;
+        } else if(arg == "-f") {
+            force = true;
+        } else if(hasExtension(arg, ".obj") || hasExtension(arg, ".ply")) {
+            addJob(&jobs, arg, BUNDLE_MESH);
+        } else if(hasExtension(arg, ".bmp")) {
+            addJob(&jobs, arg, BUNDLE_TEXTURE);
+        } else if(hasExtension(arg, ".mtl")) {
+            if(!addMaterialTextures(arg, &jobs)) return 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(jobs.empty()) {
+        usage();
+        return 1;
+    }
+
+    for(size_t i = 0; i < jobs.size(); i++) {
+        if(jobs[i].name.size() >= BUNDLE_NAME_SIZE) {
+            fprintf(stderr, "%s: path too long for a bundle, at most %u characters\n", jobs[i].name.c_str(), BUNDLE_NAME_SIZE - 1);
+            return 1;
+        }
+    }
+
+    Bundle previous;
+    if(!force) previous.open(output);
+
+    // threads go to the assets, or to the one asset if there is only one
+    const unsigned assetThreads = jobs.size() > 1 ? numThreads : 1;
+    const unsigned jobThreads = jobs.size() > 1 ? 1 : numThreads;
+
+    Clock::time_point start = Clock::now();
+    parallelFor(jobs.size(), assetThreads, [&](size_t i) {
+        BakeJob &job = jobs[i];
+        Clock::time_point jobStart = Clock::now();
+
+        if(job.type == BUNDLE_MESH) {
+            job.sourceHash = hashBundleMesh(job.name.c_str(), settings.mesh, settings.light);
+        } else {
+            job.sourceHash = hashBundleTexture(job.name.c_str(), settings.mip);
+        }
+
+        const BundleAsset *old = previous.findAsset(job.name.c_str());
+        if(old && old->type == job.type && old->sourceHash == job.sourceHash) {
+            reuseAsset(&job, previous, old);
+        } else if(job.type == BUNDLE_MESH) {
+            bakeMesh(&job, settings, jobThreads);
+        } else {
+            bakeTexture(&job, settings, jobThreads);
+        }
+
+        job.milliseconds = millisecondsSince(jobStart);
+    });
+    previous.close();
+
+    bool ok = true;
+    size_t baked = 0;
+    std::vector<BundleAssetData> assets;
+    for(size_t i = 0; i < jobs.size(); i++) {
+        const BakeJob &job = jobs[i];
+        if(!job.error.empty()) {
+            fprintf(stderr, "%s: %s\n", job.name.c_str(), job.error.c_str());
+            ok = false;
+            continue;
+        }
+
+        size_t bytes = 0;
+        for(size_t b = 0; b < job.blobs.size(); b++) bytes += job.blobs[b].size;
+        printf("%-40s %s %8.1f ms %10zu bytes\n", job.name.c_str(), job.reused ? "unchanged" : "baked    ",
+               job.milliseconds, bytes);
+        if(!job.reused) baked++;
+
+        BundleAssetData asset = { job.name.c_str(), job.type, job.sourceHash, job.blobs.data(), job.blobs.size() };
+        assets.push_back(asset);
+    }
+    if(!ok) return 1;
+
+    if(!writeBundle(output, assets.data(), assets.size())) {
+        fprintf(stderr, "can't write %s\n", output);
+        return 1;
+    }
+
+    printf("%s: %zu assets, %zu baked, %zu unchanged, %.1f ms\n", output, jobs.size(), baked,
+           jobs.size() - baked, millisecondsSince(start));
+    return 0;
+}